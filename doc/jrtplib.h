@@ -218,6 +218,13 @@ member function Poll regularly to process incoming data and to send
 RTCP data when necessary. For now, let's assume that we're working 
 with the poll thread enabled.
 
+When a large number of sessions is needed, having a poll thread for each
+of them can become expensive. On Linux, the sessions can instead be created
+without a poll thread and be added to an RTPReactor, which monitors the
+sockets of all sessions using a single epoll instance and polls them from a
+small pool of worker threads, only when data has arrived or when an RTCP
+packet needs to be sent.
+
 Lets suppose that for a duration of one minute, we want to send
 packets containing 20 ms (or 160 samples) of silence and we want
 to indicate when a packet from someone else has been received. Also
@@ -398,6 +405,20 @@ The second parameter of the RTPMemoryManager::AllocateBuffer member function
 indicates what the purpose is of this memory block. This allows you to handle
 different kinds of data in different ways.
 
+The library also provides a ready-made implementation, RTPPoolMemoryManager,
+which recycles memory blocks using a free list for each of a number of size
+classes. In thread-safe mode, and if the platform supports it, each thread
+has its own cache of free blocks, so that e.g. the poll thread and the thread
+which processes the packets don't have to contend on a lock to allocate and
+release memory. It can also keep statistics, like the maximum amount of memory
+that was in use for each memory type:
+
+~~~{.cpp}
+    RTPPoolMemoryManager mgr;
+    mgr.Init(true);
+    RTPSession session(0, &mgr);
+~~~
+
 With the introduction of the memory management system, the RTPSession class was
 extended with member function RTPSession::DeletePacket and RTPSession::DeleteTransmissionInfo.
 These functions should be used to deallocate RTPPacket instances and RTPTransmissionInfo
@@ -52,13 +52,15 @@
 #include "rtpipv4destination.h"
 #include "rtphashtable.h"
 #include "rtpkeyhashtable.h"
+#include "rtpflathashtable.h"
+#include "rtpflatkeyhashtable.h"
 #include <list>
 
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jmutex.h>
 #endif // RTP_SUPPORT_THREAD
 
-#define RTPFAKETRANS_HASHSIZE									8317
+#define RTPFAKETRANS_HASHSIZE									8317 // deprecated, only kept for source compatibility
 #define RTPFAKETRANS_DEFAULTPORTBASE								5000
 
 namespace jrtplib
@@ -125,6 +127,9 @@ private:
     RTPFakeTransmissionParams *params;
 };
 	
+// Deprecated: the GetHashIndex classes are no longer used by the transmitter,
+// they are only kept for source compatibility
+
 class RTPFakeTrans_GetHashIndex_IPv4Dest
 {
 public:
@@ -137,6 +142,18 @@ public:
 	static int GetIndex(const uint32_t &k)							{ return k%RTPFAKETRANS_HASHSIZE; }
 };
 
+class RTPFakeTrans_GetHash_IPv4Dest
+{
+public:
+	static uint32_t GetHash(const RTPIPv4Destination &d)				{ return d.GetIP()^(((uint32_t)d.GetRTPPort_NBO())<<16); }
+};
+
+class RTPFakeTrans_GetHash_uint32_t
+{
+public:
+	static uint32_t GetHash(const uint32_t &k)						{ return k; }
+};
+
 #define RTPFAKETRANS_HEADERSIZE						(20+8)
 	
 class RTPFakeTransmitter : public RTPTransmitter
@@ -212,9 +229,9 @@ private:
 	uint8_t *localhostname;
 	size_t localhostnamelength;
 	
-	RTPHashTable<const RTPIPv4Destination,RTPFakeTrans_GetHashIndex_IPv4Dest,RTPFAKETRANS_HASHSIZE> destinations;
+	RTPFlatHashTable<const RTPIPv4Destination,RTPFakeTrans_GetHash_IPv4Dest> destinations;
 #ifdef RTP_SUPPORT_IPV4MULTICAST
-//	RTPHashTable<const uint32_t,RTPFakeTrans_GetHashIndex_uint32_t,RTPFAKETRANS_HASHSIZE> multicastgroups;
+//	RTPFlatHashTable<const uint32_t,RTPFakeTrans_GetHash_uint32_t> multicastgroups;
 #endif // RTP_SUPPORT_IPV4MULTICAST
 	std::list<RTPRawPacket*> rawpacketlist;
 
@@ -230,7 +247,7 @@ private:
 		std::list<uint16_t> portlist;
 	};
 
-	RTPKeyHashTable<const uint32_t,PortInfo*,RTPFakeTrans_GetHashIndex_uint32_t,RTPFAKETRANS_HASHSIZE> acceptignoreinfo;
+	RTPFlatKeyHashTable<const uint32_t,PortInfo*,RTPFakeTrans_GetHash_uint32_t> acceptignoreinfo;
 
 	int CreateAbortDescriptors();
 	void DestroyAbortDescriptors();
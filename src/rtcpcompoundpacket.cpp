@@ -41,6 +41,7 @@
 #include "rtcpbyepacket.h"
 #include "rtcpapppacket.h"
 #include "rtcpunknownpacket.h"
+#include <new>
 #ifdef RTP_SUPPORT_NETINET_IN
 	#include <netinet/in.h>
 #endif // RTP_SUPPORT_NETINET_IN
@@ -50,11 +51,22 @@
 namespace jrtplib
 {
 
+// The RTCPPacket instances are created in the storage of the packet views, this
+// fails to compile if one of them doesn't fit
+typedef char RTCPCompoundPacket_CheckPacketStorage[(sizeof(RTCPSRPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE &&
+                                                    sizeof(RTCPRRPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE &&
+                                                    sizeof(RTCPSDESPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE &&
+                                                    sizeof(RTCPBYEPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE &&
+                                                    sizeof(RTCPAPPPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE &&
+                                                    sizeof(RTCPUnknownPacket) <= RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE)?1:-1];
+
 RTCPCompoundPacket::RTCPCompoundPacket(RTPRawPacket &rawpack, RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
 {
 	compoundpacket = 0;
 	compoundpacketlength = 0;
 	error = 0;
+	slab = 0;
+	InitPacketList();
 	
 	if (rawpack.IsRTP())
 	{
@@ -73,15 +85,26 @@ RTCPCompoundPacket::RTCPCompoundPacket(RTPRawPacket &rawpack, RTPMemoryManager *
 	compoundpacketlength = rawpack.GetDataLength();
 	deletepacket = true;
 
+	// If the data is stored in a receive slab, keep that slab alive instead
+	// of taking ownership of the data itself
+	slab = rawpack.GetDataSlab();
+	if (slab)
+	{
+		slab->AddReference();
+		deletepacket = false;
+	}
+
 	rawpack.ZeroData();
 	
-	rtcppackit = rtcppacklist.begin();
+	packetindex = 0;
 }
 
 RTCPCompoundPacket::RTCPCompoundPacket(uint8_t *packet, size_t packetlen, bool deletedata, RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
 {
 	compoundpacket = 0;
 	compoundpacketlength = 0;
+	slab = 0;
+	InitPacketList();
 	
 	error = ParseData(packet,packetlen);
 	if (error < 0)
@@ -91,7 +114,7 @@ RTCPCompoundPacket::RTCPCompoundPacket(uint8_t *packet, size_t packetlen, bool d
 	compoundpacketlength = packetlen;
 	deletepacket = deletedata;
 
-	rtcppackit = rtcppacklist.begin();
+	packetindex = 0;
 }
 
 RTCPCompoundPacket::RTCPCompoundPacket(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
@@ -100,11 +123,22 @@ RTCPCompoundPacket::RTCPCompoundPacket(RTPMemoryManager *mgr) : RTPMemoryObject(
 	compoundpacketlength = 0;
 	error = 0;
 	deletepacket = true;
+	slab = 0;
+	InitPacketList();
+}
+
+void RTCPCompoundPacket::InitPacketList()
+{
+	packetviews = inlinepacketviews;
+	numpackets = 0;
+	maxpackets = RTCPCOMPOUNDPACKET_INLINEPACKETS;
+	packetindex = 0;
 }
 
 int RTCPCompoundPacket::ParseData(uint8_t *data, size_t datalen)
 {
 	bool first;
+	size_t offset = 0;
 	
 	if (datalen < sizeof(RTCPCommonHeader))
 		return ERR_RTP_RTCPCOMPOUND_INVALIDPACKET;
@@ -154,39 +188,39 @@ int RTCPCompoundPacket::ParseData(uint8_t *data, size_t datalen)
 			}
 		}
 
-		RTCPPacket *p;
+		RTCPPacket::PacketType t;
+		int status;
 		
 		switch (rtcphdr->packettype)
 		{
 		case RTP_RTCPTYPE_SR:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPSRPACKET) RTCPSRPacket(data,length);
+			t = RTCPPacket::SR;
 			break;
 		case RTP_RTCPTYPE_RR:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPRRPACKET) RTCPRRPacket(data,length);
+			t = RTCPPacket::RR;
 			break;
 		case RTP_RTCPTYPE_SDES:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPSDESPACKET) RTCPSDESPacket(data,length);
+			t = RTCPPacket::SDES;
 			break;
 		case RTP_RTCPTYPE_BYE:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPBYEPACKET) RTCPBYEPacket(data,length);
+			t = RTCPPacket::BYE;
 			break;
 		case RTP_RTCPTYPE_APP:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPAPPPACKET) RTCPAPPPacket(data,length);
+			t = RTCPPacket::APP;
 			break;
 		default:
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPUNKNOWNPACKET) RTCPUnknownPacket(data,length);
+			t = RTCPPacket::Unknown;
 		}
 
-		if (p == 0)
+		if ((status = AddPacketView(t,offset,length)) < 0)
 		{
 			ClearPacketList();
-			return ERR_RTP_OUTOFMEM;
+			return status;
 		}
-
-		rtcppacklist.push_back(p);
 		
 		datalen -= length;
 		data += length;
+		offset += length;
 	} while (datalen >= (size_t)sizeof(RTCPCommonHeader));
 
 	if (datalen != 0) // some remaining bytes
@@ -202,28 +236,104 @@ RTCPCompoundPacket::~RTCPCompoundPacket()
 	ClearPacketList();
 	if (compoundpacket && deletepacket)
 		RTPDeleteByteArray(compoundpacket,GetMemoryManager());
+	if (slab)
+		slab->Release();
 }
 
 void RTCPCompoundPacket::ClearPacketList()
 {
-	std::list<RTCPPacket *>::const_iterator it;
+	for (size_t i = 0 ; i < numpackets ; i++)
+	{
+		if (packetviews[i].packet)
+			packetviews[i].packet->~RTCPPacket();
+	}
+	if (packetviews != inlinepacketviews)
+		RTPDeleteByteArray((uint8_t *)packetviews,GetMemoryManager());
+	InitPacketList();
+}
+
+int RTCPCompoundPacket::AddPacketView(RTCPPacket::PacketType t, size_t offset, size_t length)
+{
+	if (numpackets == maxpackets)
+	{
+		// Only happens for compound packets with many individual packets, the
+		// RTCPPacket instances haven't been created yet at this point
+
+		size_t newmax = maxpackets*2;
+		uint8_t *newbuf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPPACKETVIEWS) uint8_t[newmax*sizeof(RTCPPacketView)];
+		if (newbuf == 0)
+			return ERR_RTP_OUTOFMEM;
+
+		RTCPPacketView *newviews = (RTCPPacketView *)newbuf;
+		for (size_t i = 0 ; i < numpackets ; i++)
+		{
+			newviews[i].packettype = packetviews[i].packettype;
+			newviews[i].offset = packetviews[i].offset;
+			newviews[i].length = packetviews[i].length;
+			newviews[i].packet = 0;
+		}
+		if (packetviews != inlinepacketviews)
+			RTPDeleteByteArray((uint8_t *)packetviews,GetMemoryManager());
+		packetviews = newviews;
+		maxpackets = newmax;
+	}
 
-	for (it = rtcppacklist.begin() ; it != rtcppacklist.end() ; it++)
-		RTPDelete(*it,GetMemoryManager());
-	rtcppacklist.clear();
-	rtcppackit = rtcppacklist.begin();
+	RTCPPacketView &view = packetviews[numpackets++];
+
+	view.packettype = t;
+	view.offset = (uint32_t)offset;
+	view.length = (uint32_t)length;
+	view.packet = 0;
+	return 0;
+}
+
+RTCPPacket *RTCPCompoundPacket::GetNextPacket()
+{
+	if (packetindex >= numpackets)
+		return 0;
+
+	RTCPPacketView &view = packetviews[packetindex++];
+
+	if (view.packet == 0)
+	{
+		uint8_t *data = compoundpacket+view.offset;
+		size_t length = view.length;
+		void *mem = view.storage.bytes;
+
+		switch (view.packettype)
+		{
+		case RTCPPacket::SR:
+			view.packet = new (mem) RTCPSRPacket(data,length);
+			break;
+		case RTCPPacket::RR:
+			view.packet = new (mem) RTCPRRPacket(data,length);
+			break;
+		case RTCPPacket::SDES:
+			view.packet = new (mem) RTCPSDESPacket(data,length);
+			break;
+		case RTCPPacket::BYE:
+			view.packet = new (mem) RTCPBYEPacket(data,length);
+			break;
+		case RTCPPacket::APP:
+			view.packet = new (mem) RTCPAPPPacket(data,length);
+			break;
+		default:
+			view.packet = new (mem) RTCPUnknownPacket(data,length);
+		}
+	}
+	return view.packet;
 }
 
 #ifdef RTPDEBUG
 void RTCPCompoundPacket::Dump()
 {
-	std::list<RTCPPacket *>::const_iterator it;
-	for (it = rtcppacklist.begin() ; it != rtcppacklist.end() ; it++)
-	{
-		RTCPPacket *p = *it;
+	size_t previndex = packetindex;
+	RTCPPacket *p;
 
+	packetindex = 0;
+	while ((p = GetNextPacket()) != 0)
 		p->Dump();
-	}
+	packetindex = previndex;
 }
 #endif // RTPDEBUG
 
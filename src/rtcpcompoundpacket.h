@@ -41,13 +41,59 @@
 #include "rtpconfig.h"
 #include "rtptypes.h"
 #include "rtpmemoryobject.h"
-#include <list>
+#include "rtcppacket.h"
+
+/** Number of packet views stored inside an RTCPCompoundPacket instance, more packets require an allocation.
+ *  Number of packet views stored inside an RTCPCompoundPacket instance, more packets require an allocation. 
+ *  Each view takes about 88 bytes on a 64-bit system, so these add about 700 bytes to every compound packet 
+ *  (and compound packet builder) instance.
+ */
+#define RTCPCOMPOUNDPACKET_INLINEPACKETS						8
+
+/** Number of bytes reserved in an RTCPPacketView for the RTCPPacket instance which describes the packet. */
+#define RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE					64
 
 namespace jrtplib
 {
 
 class RTPRawPacket;
-class RTCPPacket;
+class RTPReceiveSlab;
+
+/** Describes one of the individual RTCP packets in an RTCP compound packet.
+ *  Describes one of the individual RTCP packets in an RTCP compound packet: its type and where it 
+ *  is located in the compound packet. Unlike the RTCPPacket instances returned by 
+ *  RTCPCompoundPacket::GetNextPacket, this information is already available after the compound 
+ *  packet has been validated. 
+ */
+class JRTPLIB_IMPORTEXPORT RTCPPacketView
+{
+public:
+	/** Returns the type of the RTCP packet. */
+	RTCPPacket::PacketType GetPacketType() const			{ return packettype; }
+
+	/** Returns the offset of the RTCP packet in the compound packet. */
+	size_t GetPacketOffset() const							{ return (size_t)offset; }
+
+	/** Returns the length of the RTCP packet. */
+	size_t GetPacketLength() const							{ return (size_t)length; }
+private:
+	friend class RTCPCompoundPacket;
+
+	RTCPPacket::PacketType packettype;
+	uint32_t offset;
+	uint32_t length;
+
+	// The RTCPPacket instance is only created in 'storage' when GetNextPacket
+	// reaches this view
+	RTCPPacket *packet;
+	union
+	{
+		uint8_t bytes[RTCPCOMPOUNDPACKET_PACKETSTORAGESIZE];
+		double alignment1;
+		void *alignment2;
+		uint64_t alignment3;
+	} storage;
+};
 
 /** Represents an RTCP compound packet. */
 class JRTPLIB_IMPORTEXPORT RTCPCompoundPacket : public RTPMemoryObject
@@ -80,14 +126,28 @@ public:
 	/** Returns the size of the entire RTCP compound packet. */
 	size_t GetCompoundPacketLength() const					{ return compoundpacketlength; }
 
+	/** Returns the number of individual RTCP packets in the RTCP compound packet. */
+	size_t GetPacketCount() const							{ return numpackets; }
+
 	/** Starts the iteration over the individual RTCP packets in the RTCP compound packet. */
-	void GotoFirstPacket()									{ rtcppackit = rtcppacklist.begin(); }
+	void GotoFirstPacket()									{ packetindex = 0; }
 
 	/** Returns a pointer to the next individual RTCP packet. 
 	 *  Returns a pointer to the next individual RTCP packet. Note that no \c delete call may be done 
-	 *  on the RTCPPacket instance which is returned.
+	 *  on the RTCPPacket instance which is returned. The instance is stored inside the compound packet
+	 *  and remains valid as long as the compound packet exists.
+	 */
+	RTCPPacket *GetNextPacket();
+
+	/** Starts the iteration over the views of the individual RTCP packets (same as GotoFirstPacket). */
+	void GotoFirstPacketView()								{ packetindex = 0; }
+
+	/** Returns the view of the next individual RTCP packet, or \c NULL if there are no more packets.
+	 *  Returns the view of the next individual RTCP packet, or \c NULL if there are no more packets.
+	 *  This shares the iteration position with GetNextPacket, but doesn't create an RTCPPacket 
+	 *  instance.
 	 */
-	RTCPPacket *GetNextPacket()								{ if (rtcppackit == rtcppacklist.end()) return 0; RTCPPacket *p = *rtcppackit; rtcppackit++; return p; }
+	const RTCPPacketView *GetNextPacketView()				{ if (packetindex >= numpackets) return 0; return &packetviews[packetindex++]; }
 
 #ifdef RTPDEBUG
 	void Dump();	
@@ -95,15 +155,23 @@ public:
 protected:
 	void ClearPacketList();
 	int ParseData(uint8_t *packet, size_t len);
+	int AddPacketView(RTCPPacket::PacketType t, size_t offset, size_t length);
 	
 	int error;
 
 	uint8_t *compoundpacket;
 	size_t compoundpacketlength;
 	bool deletepacket;
+	RTPReceiveSlab *slab;
 	
-	std::list<RTCPPacket *> rtcppacklist;
-	std::list<RTCPPacket *>::const_iterator rtcppackit;
+private:
+	void InitPacketList();
+
+	RTCPPacketView inlinepacketviews[RTCPCOMPOUNDPACKET_INLINEPACKETS];
+	RTCPPacketView *packetviews;
+	size_t numpackets;
+	size_t maxpackets;
+	size_t packetindex;
 };
 
 } // end namespace
@@ -49,62 +49,53 @@
 namespace jrtplib
 {
 
-RTCPCompoundPacketBuilder::RTCPCompoundPacketBuilder(RTPMemoryManager *mgr) : RTCPCompoundPacket(mgr), report(mgr), sdes(mgr)
+RTCPCompoundPacketBuilder::RTCPCompoundPacketBuilder(RTPMemoryManager *mgr) : RTCPCompoundPacket(mgr)
 {
-	byesize = 0;
-	appsize = 0;
-#ifdef RTP_SUPPORT_RTCPUNKNOWN
-	unknownsize = 0;
-#endif // RTP_SUPPORT_RTCPUNKNOWN
 	maximumpacketsize = 0;
 	buffer = 0;
+	arena = 0;
+	arenasize = 0;
 	external = false;
 	arebuilding = false;
+	deletepacket = false; // the arena is deleted by this class
+	ClearBuildBuffers();
 }
 
 RTCPCompoundPacketBuilder::~RTCPCompoundPacketBuilder()
 {
-	if (external)
-		compoundpacket = 0; // make sure RTCPCompoundPacket doesn't delete the external buffer
-	ClearBuildBuffers();
+	compoundpacket = 0;
+	if (arena)
+		RTPDeleteByteArray(arena,GetMemoryManager());
 }
 
 void RTCPCompoundPacketBuilder::ClearBuildBuffers()
 {
-	report.Clear();
-	sdes.Clear();
-
-	std::list<Buffer>::const_iterator it;
-	for (it = byepackets.begin() ; it != byepackets.end() ; it++)
-	{
-		if ((*it).packetdata)
-			RTPDeleteByteArray((*it).packetdata,GetMemoryManager());
-	}
-	for (it = apppackets.begin() ; it != apppackets.end() ; it++)
-	{
-		if ((*it).packetdata)
-			RTPDeleteByteArray((*it).packetdata,GetMemoryManager());
-	}
-#ifdef RTP_SUPPORT_RTCPUNKNOWN
-	for (it = unknownpackets.begin() ; it != unknownpackets.end() ; it++)
-	{
-		if ((*it).packetdata)
-			RTPDeleteByteArray((*it).packetdata,GetMemoryManager());
-	}
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-
-	byepackets.clear();
-	apppackets.clear();
-#ifdef RTP_SUPPORT_RTCPUNKNOWN
-	unknownpackets.clear();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	byesize = 0;
+	reportsize = 0;
+	reportheaderoffset = 0;
+	numreportblocks = 0;
+	sdessize = 0;
+	sdesheaderoffset = 0;
+	sdeschunkoffset = 0;
+	sdesitemsize = 0;
+	numsdessources = 0;
 	appsize = 0;
+	byesize = 0;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownsize = 0;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 }
 
+void RTCPCompoundPacketBuilder::ClearBuild()
+{
+	ClearPacketList();
+	compoundpacket = 0;
+	compoundpacketlength = 0;
+	buffer = 0;
+	external = false;
+	arebuilding = false;
+	ClearBuildBuffers();
+}
+
 int RTCPCompoundPacketBuilder::InitBuild(size_t maxpacketsize)
 {
 	if (arebuilding)
@@ -114,15 +105,22 @@ int RTCPCompoundPacketBuilder::InitBuild(size_t maxpacketsize)
 
 	if (maxpacketsize < RTP_MINPACKETSIZE)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_MAXPACKETSIZETOOSMALL;
+
+	if (arenasize < maxpacketsize)
+	{
+		uint8_t *newarena = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPCOMPOUNDPACKET) uint8_t[maxpacketsize];
+		if (newarena == 0)
+			return ERR_RTP_OUTOFMEM;
+		if (arena)
+			RTPDeleteByteArray(arena,GetMemoryManager());
+		arena = newarena;
+		arenasize = maxpacketsize;
+	}
 	
 	maximumpacketsize = maxpacketsize;
-	buffer = 0;
+	buffer = arena;
 	external = false;
-	byesize = 0;
-	appsize = 0;
-#ifdef RTP_SUPPORT_RTCPUNKNOWN
-	unknownsize = 0;
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
+	ClearBuildBuffers();
 	
 	arebuilding = true;
 	return 0;
@@ -141,51 +139,79 @@ int RTCPCompoundPacketBuilder::InitBuild(void *externalbuffer,size_t buffersize)
 	maximumpacketsize = buffersize;
 	buffer = (uint8_t *)externalbuffer;
 	external = true;
-	byesize = 0;
-	appsize = 0;
-#ifdef RTP_SUPPORT_RTCPUNKNOWN
-	unknownsize = 0;
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
+	ClearBuildBuffers();
 
 	arebuilding = true;
 	return 0;
 }
 
+// Makes room for 'len' bytes at 'offset' by moving the data after it, the caller
+// has already checked that the maximum size won't be exceeded
+
+uint8_t *RTCPCompoundPacketBuilder::InsertBytes(size_t offset,size_t len)
+{
+	size_t used = GetBuildSize();
+
+	if (offset < used)
+		memmove(buffer+offset+len,buffer+offset,used-offset);
+	return buffer+offset;
+}
+
+void RTCPCompoundPacketBuilder::UpdateReportHeader()
+{
+	RTCPCommonHeader *hdr = (RTCPCommonHeader *)(buffer+reportheaderoffset);
+	size_t numwords = (reportsize-reportheaderoffset)/sizeof(uint32_t);
+
+	hdr->count = (numreportblocks == 0)?0:(uint8_t)(((numreportblocks-1)%31)+1);
+	hdr->length = htons((uint16_t)(numwords-1));
+}
+
+void RTCPCompoundPacketBuilder::UpdateSDESHeader()
+{
+	RTCPCommonHeader *hdr = (RTCPCommonHeader *)(buffer+reportsize+sdesheaderoffset);
+	size_t numwords = (sdessize-sdesheaderoffset)/sizeof(uint32_t);
+
+	hdr->count = (uint8_t)(((numsdessources-1)%31)+1);
+	hdr->length = htons((uint16_t)(numwords-1));
+}
+
 int RTCPCompoundPacketBuilder::StartSenderReport(uint32_t senderssrc,const RTPNTPTime &ntptimestamp,uint32_t rtptimestamp,
                                                  uint32_t packetcount,uint32_t octetcount)
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
 
-	if (report.headerlength != 0)
+	if (reportsize != 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_ALREADYGOTREPORT;
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalsize = byesize+appsize+sdes.NeededBytes();
-#else
-	size_t totalsize = byesize+appsize+unknownsize+sdes.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t sizeleft = maximumpacketsize-totalsize;
 	size_t neededsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)+sizeof(RTCPSenderReport);
 	
-	if (neededsize > sizeleft)
+	if (GetBuildSize()+neededsize > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 	
 	// fill in some things
 
-	report.headerlength = sizeof(uint32_t)+sizeof(RTCPSenderReport);
-	report.isSR = true;	
+	uint8_t *buf = InsertBytes(0,neededsize);
+	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
+
+	hdr->version = 2;
+	hdr->padding = 0;
+	hdr->packettype = RTP_RTCPTYPE_SR;
 	
-	uint32_t *ssrc = (uint32_t *)report.headerdata;
+	uint32_t *ssrc = (uint32_t *)(buf+sizeof(RTCPCommonHeader));
 	*ssrc = htonl(senderssrc);
 
-	RTCPSenderReport *sr = (RTCPSenderReport *)(report.headerdata + sizeof(uint32_t));
+	RTCPSenderReport *sr = (RTCPSenderReport *)(buf+sizeof(RTCPCommonHeader)+sizeof(uint32_t));
 	sr->ntptime_msw = htonl(ntptimestamp.GetMSW());
 	sr->ntptime_lsw = htonl(ntptimestamp.GetLSW());
 	sr->rtptimestamp = htonl(rtptimestamp);
 	sr->packetcount = htonl(packetcount);
 	sr->octetcount = htonl(octetcount);
 
+	reportsize = neededsize;
+	reportheaderoffset = 0;
+	numreportblocks = 0;
+	UpdateReportHeader();
 	return 0;
 }
 
@@ -193,28 +219,30 @@ int RTCPCompoundPacketBuilder::StartReceiverReport(uint32_t senderssrc)
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
-	if (report.headerlength != 0)
+	if (reportsize != 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_ALREADYGOTREPORT;
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalsize = byesize+appsize+sdes.NeededBytes();
-#else
-	size_t totalsize = byesize+appsize+unknownsize+sdes.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t sizeleft = maximumpacketsize-totalsize;
 	size_t neededsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t);
 	
-	if (neededsize > sizeleft)
+	if (GetBuildSize()+neededsize > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 	
 	// fill in some things
 
-	report.headerlength = sizeof(uint32_t);
-	report.isSR = false;
-	
-	uint32_t *ssrc = (uint32_t *)report.headerdata;
+	uint8_t *buf = InsertBytes(0,neededsize);
+	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
+
+	hdr->version = 2;
+	hdr->padding = 0;
+	hdr->packettype = RTP_RTCPTYPE_RR;
+
+	uint32_t *ssrc = (uint32_t *)(buf+sizeof(RTCPCommonHeader));
 	*ssrc = htonl(senderssrc);
 
+	reportsize = neededsize;
+	reportheaderoffset = 0;
+	numreportblocks = 0;
+	UpdateReportHeader();
 	return 0;
 }
 
@@ -223,22 +251,33 @@ int RTCPCompoundPacketBuilder::AddReportBlock(uint32_t ssrc,uint8_t fractionlost
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
-	if (report.headerlength == 0)
+	if (reportsize == 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_REPORTNOTSTARTED;
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalothersize = byesize+appsize+sdes.NeededBytes();
-#else
-	size_t totalothersize = byesize+appsize+unknownsize+sdes.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t reportsizewithextrablock = report.NeededBytesWithExtraReportBlock();
+	// max 31 report blocks per report, after that a new receiver report is needed
+	bool newreport = (numreportblocks > 0 && (numreportblocks%31) == 0);
+	size_t neededsize = sizeof(RTCPReceiverReport);
+
+	if (newreport)
+		neededsize += sizeof(RTCPCommonHeader)+sizeof(uint32_t);
 	
-	if ((totalothersize+reportsizewithextrablock) > maximumpacketsize)
+	if (GetBuildSize()+neededsize > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 
-	uint8_t *buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPRECEIVERREPORT) uint8_t[sizeof(RTCPReceiverReport)];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
+	uint8_t *buf = InsertBytes(reportsize,neededsize);
+
+	if (newreport)
+	{
+		RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
+
+		hdr->version = 2;
+		hdr->padding = 0;
+		hdr->packettype = RTP_RTCPTYPE_RR;
+		memcpy(buf+sizeof(RTCPCommonHeader),buffer+sizeof(RTCPCommonHeader),sizeof(uint32_t)); // sender ssrc
+		
+		reportheaderoffset = reportsize;
+		buf += sizeof(RTCPCommonHeader)+sizeof(uint32_t);
+	}
 	
 	RTCPReceiverReport *rr = (RTCPReceiverReport *)buf;
 	uint32_t *packlost = (uint32_t *)&packetslost;
@@ -254,7 +293,9 @@ int RTCPCompoundPacketBuilder::AddReportBlock(uint32_t ssrc,uint8_t fractionlost
 	rr->lsr = htonl(lsr);
 	rr->dlsr = htonl(dlsr);
 
-	report.reportblocks.push_back(Buffer(buf,sizeof(RTCPReceiverReport)));
+	reportsize += neededsize;
+	numreportblocks++;
+	UpdateReportHeader();
 	return 0;
 }
 
@@ -263,20 +304,66 @@ int RTCPCompoundPacketBuilder::AddSDESSource(uint32_t ssrc)
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = byesize+appsize+report.NeededBytes();
-#else
-	size_t totalotherbytes = byesize+appsize+unknownsize+report.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t sdessizewithextrasource = sdes.NeededBytesWithExtraSource();
+	// max 31 sources per SDES packet; the new source needs at least 8 bytes (ssrc and four 0 bytes)
+	bool newsdes = ((numsdessources%31) == 0);
+	size_t neededsize = sizeof(uint32_t)*2;
 
-	if ((totalotherbytes + sdessizewithextrasource) > maximumpacketsize)
+	if (newsdes)
+		neededsize += sizeof(RTCPCommonHeader);
+
+	if (GetBuildSize()+neededsize > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 
-	int status;
+	uint8_t *buf = InsertBytes(reportsize+sdessize,neededsize);
 
-	if ((status = sdes.AddSSRC(ssrc)) < 0)
-		return status;
+	if (newsdes)
+	{
+		RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
+
+		hdr->version = 2;
+		hdr->padding = 0;
+		hdr->packettype = RTP_RTCPTYPE_SDES;
+
+		sdesheaderoffset = sdessize;
+		buf += sizeof(RTCPCommonHeader);
+	}
+
+	uint32_t *ssrcptr = (uint32_t *)buf;
+	*ssrcptr = htonl(ssrc);
+	memset(buf+sizeof(uint32_t),0,sizeof(uint32_t)); // end of the (still empty) item list
+
+	sdeschunkoffset = sdessize+neededsize-sizeof(uint32_t)*2;
+	sdessize += neededsize;
+	sdesitemsize = 0;
+	numsdessources++;
+	UpdateSDESHeader();
+	return 0;
+}
+
+// The current chunk is always the last one, and ends with the 0 byte which terminates
+// the item list and the zero bytes which align it to a 32 bit boundary. This makes room
+// for an item of 'itemlength' bytes before these terminating bytes.
+
+int RTCPCompoundPacketBuilder::ReserveSDESItem(size_t itemlength,uint8_t **item)
+{
+	size_t len = sizeof(RTCPSDESHeader)+itemlength;
+	size_t oldsize = ((sdesitemsize+1+3)/4)*4; // items and terminating bytes
+	size_t newsize = ((sdesitemsize+len+1+3)/4)*4;
+	size_t extrasize = newsize-oldsize;
+
+	if (GetBuildSize()+extrasize > maximumpacketsize)
+		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
+
+	InsertBytes(reportsize+sdessize,extrasize);
+
+	uint8_t *itemstart = buffer+reportsize+sdeschunkoffset+sizeof(uint32_t)+sdesitemsize;
+
+	memset(itemstart+len,0,newsize-sdesitemsize-len);
+	sdessize += extrasize;
+	sdesitemsize += len;
+	UpdateSDESHeader();
+
+	*item = itemstart;
 	return 0;
 }
 
@@ -284,7 +371,7 @@ int RTCPCompoundPacketBuilder::AddSDESNormalItem(RTCPSDESPacket::ItemType t,cons
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
-	if (sdes.sdessources.empty())
+	if (numsdessources == 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOCURRENTSOURCE;
 
 	uint8_t itemid;
@@ -316,23 +403,11 @@ int RTCPCompoundPacketBuilder::AddSDESNormalItem(RTCPSDESPacket::ItemType t,cons
 		return ERR_RTP_RTCPCOMPPACKBUILDER_INVALIDITEMTYPE;
 	}
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = byesize+appsize+report.NeededBytes();
-#else
-	size_t totalotherbytes = byesize+appsize+unknownsize+report.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t sdessizewithextraitem = sdes.NeededBytesWithExtraItem(itemlength);
-
-	if ((sdessizewithextraitem+totalotherbytes) > maximumpacketsize)
-		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
-
 	uint8_t *buf;
-	size_t len;
+	int status;
 
-	buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPSDESBLOCK) uint8_t[sizeof(RTCPSDESHeader)+(size_t)itemlength];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
-	len = sizeof(RTCPSDESHeader)+(size_t)itemlength;
+	if ((status = ReserveSDESItem((size_t)itemlength,&buf)) < 0)
+		return status;
 
 	RTCPSDESHeader *sdeshdr = (RTCPSDESHeader *)(buf);
 
@@ -340,8 +415,6 @@ int RTCPCompoundPacketBuilder::AddSDESNormalItem(RTCPSDESPacket::ItemType t,cons
 	sdeshdr->length = itemlength;
 	if (itemlength != 0)
 		memcpy((buf + sizeof(RTCPSDESHeader)),itemdata,(size_t)itemlength);
-
-	sdes.AddItem(buf,len);
 	return 0;
 }
 
@@ -351,30 +424,18 @@ int RTCPCompoundPacketBuilder::AddSDESPrivateItem(const void *prefixdata,uint8_t
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
-	if (sdes.sdessources.empty())
+	if (numsdessources == 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOCURRENTSOURCE;
 
 	size_t itemlength = ((size_t)prefixlength)+1+((size_t)valuelength);
 	if (itemlength > 255)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_TOTALITEMLENGTHTOOBIG;
 	
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = byesize+appsize+report.NeededBytes();
-#else
-	size_t totalotherbytes = byesize+appsize+unknownsize+report.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	size_t sdessizewithextraitem = sdes.NeededBytesWithExtraItem(itemlength);
-
-	if ((sdessizewithextraitem+totalotherbytes) > maximumpacketsize)
-		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
-
 	uint8_t *buf;
-	size_t len;
+	int status;
 
-	buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPSDESBLOCK) uint8_t[sizeof(RTCPSDESHeader)+itemlength];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
-	len = sizeof(RTCPSDESHeader)+(size_t)itemlength;
+	if ((status = ReserveSDESItem(itemlength,&buf)) < 0)
+		return status;
 
 	RTCPSDESHeader *sdeshdr = (RTCPSDESHeader *)(buf);
 
@@ -386,8 +447,6 @@ int RTCPCompoundPacketBuilder::AddSDESPrivateItem(const void *prefixdata,uint8_t
 		memcpy((buf+sizeof(RTCPSDESHeader)+1),prefixdata,(size_t)prefixlength);
 	if (valuelength != 0)
 		memcpy((buf+sizeof(RTCPSDESHeader)+1+(size_t)prefixlength),valuedata,(size_t)valuelength);
-
-	sdes.AddItem(buf,len);
 	return 0;
 }
 #endif // RTP_SUPPORT_SDESPRIV
@@ -416,22 +475,13 @@ int RTCPCompoundPacketBuilder::AddBYEPacket(uint32_t *ssrcs,uint8_t numssrcs,con
 		}
 	}
 
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = appsize+byesize+sdes.NeededBytes()+report.NeededBytes();
-#else
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-
-	if ((totalotherbytes + packsize) > maximumpacketsize)
+	if ((GetBuildSize() + packsize) > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 
-	uint8_t *buf;
+	// the BYE packets are the last ones
+	uint8_t *buf = buffer+GetBuildSize();
 	size_t numwords;
 	
-	buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPBYEPACKET) uint8_t[packsize];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
-
 	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
 
 	hdr->version = 2;
@@ -458,7 +508,6 @@ int RTCPCompoundPacketBuilder::AddBYEPacket(uint32_t *ssrcs,uint8_t numssrcs,con
 			buf[packsize-1-i] = 0;
 	}
 
-	byepackets.push_back(Buffer(buf,packsize));
 	byesize += packsize;
 	
 	return 0;
@@ -479,21 +528,12 @@ int RTCPCompoundPacketBuilder::AddAPPPacket(uint8_t subtype,uint32_t ssrc,const
 		return ERR_RTP_RTCPCOMPPACKBUILDER_APPDATALENTOOBIG;
 	
 	size_t packsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2+appdatalen;
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = appsize+byesize+sdes.NeededBytes()+report.NeededBytes();
-#else
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
 
-	if ((totalotherbytes + packsize) > maximumpacketsize)
+	if ((GetBuildSize() + packsize) > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 
-	uint8_t *buf;
+	uint8_t *buf = InsertBytes(reportsize+sdessize+appsize,packsize);
 	
-	buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPAPPPACKET) uint8_t[packsize];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
-
 	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
 
 	hdr->version = 2;
@@ -514,7 +554,6 @@ int RTCPCompoundPacketBuilder::AddAPPPacket(uint8_t subtype,uint32_t ssrc,const
 	if (appdatalen > 0)
 		memcpy((buf+sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2),appdata,appdatalen);
 
-	apppackets.push_back(Buffer(buf,packsize));
 	appsize += packsize;
 	
 	return 0;
@@ -533,14 +572,11 @@ int RTCPCompoundPacketBuilder::AddUnknownPacket(uint8_t payload_type, uint8_t su
 		return ERR_RTP_RTCPCOMPPACKBUILDER_APPDATALENTOOBIG;
 	
 	size_t packsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)+len;
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 
-	if ((totalotherbytes + packsize) > maximumpacketsize)
+	if ((GetBuildSize() + packsize) > maximumpacketsize)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT;
 
-	uint8_t *buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPUNKNOWNPACKET) uint8_t[packsize];
-	if (buf == 0)
-		return ERR_RTP_OUTOFMEM;
+	uint8_t *buf = InsertBytes(reportsize+sdessize+appsize+unknownsize,packsize);
 
 	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
 
@@ -556,7 +592,6 @@ int RTCPCompoundPacketBuilder::AddUnknownPacket(uint8_t payload_type, uint8_t su
 	if (len > 0)
 		memcpy((buf+sizeof(RTCPCommonHeader)+sizeof(uint32_t)),data,len);
 
-	unknownpackets.push_back(Buffer(buf,packsize));
 	unknownsize += packsize;
 	
 	return 0;
@@ -564,248 +599,81 @@ int RTCPCompoundPacketBuilder::AddUnknownPacket(uint8_t payload_type, uint8_t su
 
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 
+// Adds the packets in the 'size' bytes at 'offset' to the parent's list, using the
+// length fields in their headers. All packets in this part have type 't',
+// except that the report part can start with a sender report.
+
+int RTCPCompoundPacketBuilder::CreatePackets(size_t offset,size_t size,RTCPPacket::PacketType t)
+{
+	while (size > 0)
+	{
+		RTCPCommonHeader *hdr = (RTCPCommonHeader *)(buffer+offset);
+		size_t len = ((size_t)ntohs(hdr->length)+1)*sizeof(uint32_t);
+		int status;
+
+		if (len > size) // can happen for an unknown packet of which the length isn't a multiple of four
+			len = size;
+
+		if (t == RTCPPacket::RR && hdr->packettype == RTP_RTCPTYPE_SR)
+			status = AddPacketView(RTCPPacket::SR,offset,len);
+		else
+			status = AddPacketView(t,offset,len);
+		if (status < 0)
+			return status;
+
+		offset += len;
+		size -= len;
+	}
+	return 0;
+}
+
 int RTCPCompoundPacketBuilder::EndBuild()
 {
 	if (!arebuilding)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOTBUILDING;
-	if (report.headerlength == 0)
+	if (reportsize == 0)
 		return ERR_RTP_RTCPCOMPPACKBUILDER_NOREPORTPRESENT;
 	
-	uint8_t *buf;
-	size_t len;
-	
-#ifndef RTP_SUPPORT_RTCPUNKNOWN
-	len = appsize+byesize+report.NeededBytes()+sdes.NeededBytes();
-#else
-	len = appsize+unknownsize+byesize+report.NeededBytes()+sdes.NeededBytes();
-#endif // RTP_SUPPORT_RTCPUNKNOWN 
-	
-	if (!external)
-	{
-		buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTCPCOMPOUNDPACKET) uint8_t[len];
-		if (buf == 0)
-			return ERR_RTP_OUTOFMEM;
-	}
-	else
-		buf = buffer;
-	
-	uint8_t *curbuf = buf;
-	RTCPPacket *p;
+	// The data is already in place, only the packet list needs to be filled in
+	size_t offset = 0;
+	int status;
 
-	// first, we'll add all report info
-	
+	if ((status = CreatePackets(offset,reportsize,RTCPPacket::RR)) < 0)
 	{
-		bool firstpacket = true;
-		bool done = false;
-		std::list<Buffer>::const_iterator it = report.reportblocks.begin();
-		do
-		{
-			RTCPCommonHeader *hdr = (RTCPCommonHeader *)curbuf;
-			size_t offset;
-			
-			hdr->version = 2;
-			hdr->padding = 0;
-
-			if (firstpacket && report.isSR)
-			{
-				hdr->packettype = RTP_RTCPTYPE_SR;
-				memcpy((curbuf+sizeof(RTCPCommonHeader)),report.headerdata,report.headerlength);
-				offset = sizeof(RTCPCommonHeader)+report.headerlength;
-			}
-			else
-			{
-				hdr->packettype = RTP_RTCPTYPE_RR;
-				memcpy((curbuf+sizeof(RTCPCommonHeader)),report.headerdata,sizeof(uint32_t));
-				offset = sizeof(RTCPCommonHeader)+sizeof(uint32_t);
-			}
-			firstpacket = false;
-			
-			uint8_t count = 0;
-
-			while (it != report.reportblocks.end() && count < 31)
-			{
-				memcpy(curbuf+offset,(*it).packetdata,(*it).packetlength);
-				offset += (*it).packetlength;
-				count++;
-				it++;
-			}
-
-			size_t numwords = offset/sizeof(uint32_t);
-
-			hdr->length = htons((uint16_t)(numwords-1));
-			hdr->count = count;
-
-			// add entry in parent's list
-			if (hdr->packettype == RTP_RTCPTYPE_SR)
-				p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPSRPACKET) RTCPSRPacket(curbuf,offset);
-			else
-				p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPRRPACKET) RTCPRRPacket(curbuf,offset);
-			if (p == 0)
-			{
-				if (!external)
-					RTPDeleteByteArray(buf,GetMemoryManager());
-				ClearPacketList();
-				return ERR_RTP_OUTOFMEM;
-			}
-			rtcppacklist.push_back(p);
-
-			curbuf += offset;
-			if (it == report.reportblocks.end())
-				done = true;
-		} while (!done);
+		ClearPacketList();
+		return status;
 	}
-		
-	// then, we'll add the sdes info
-
-	if (!sdes.sdessources.empty())
+	offset += reportsize;
+	if ((status = CreatePackets(offset,sdessize,RTCPPacket::SDES)) < 0)
 	{
-		bool done = false;
-		std::list<SDESSource *>::const_iterator sourceit = sdes.sdessources.begin();
-		
-		do
-		{
-			RTCPCommonHeader *hdr = (RTCPCommonHeader *)curbuf;
-			size_t offset = sizeof(RTCPCommonHeader);
-			
-			hdr->version = 2;
-			hdr->padding = 0;
-			hdr->packettype = RTP_RTCPTYPE_SDES;
-
-			uint8_t sourcecount = 0;
-			
-			while (sourceit != sdes.sdessources.end() && sourcecount < 31)
-			{
-				uint32_t *ssrc = (uint32_t *)(curbuf+offset);
-				*ssrc = htonl((*sourceit)->ssrc);
-				offset += sizeof(uint32_t);
-				
-				std::list<Buffer>::const_iterator itemit,itemend;
-
-				itemit = (*sourceit)->items.begin();
-				itemend = (*sourceit)->items.end();
-				while (itemit != itemend)
-				{
-					memcpy(curbuf+offset,(*itemit).packetdata,(*itemit).packetlength);
-					offset += (*itemit).packetlength;
-					itemit++;
-				}
-
-				curbuf[offset] = 0; // end of item list;
-				offset++;
-
-				size_t r = offset&0x03;
-				if (r != 0) // align to 32 bit boundary
-				{
-					size_t num = 4-r;
-					size_t i;
-
-					for (i = 0 ; i < num ; i++)
-						curbuf[offset+i] = 0;
-					offset += num;
-				}
-				
-				sourceit++;
-				sourcecount++;
-			}
-
-			size_t numwords = offset/4;
-			
-			hdr->count = sourcecount;
-			hdr->length = htons((uint16_t)(numwords-1));
-
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPSDESPACKET) RTCPSDESPacket(curbuf,offset);
-			if (p == 0)
-			{
-				if (!external)
-					RTPDeleteByteArray(buf,GetMemoryManager());
-				ClearPacketList();
-				return ERR_RTP_OUTOFMEM;
-			}
-			rtcppacklist.push_back(p);
-			
-			curbuf += offset;
-			if (sourceit == sdes.sdessources.end())
-				done = true;
-		} while (!done);
+		ClearPacketList();
+		return status;
 	}
-	
-	// adding the app data
-	
+	offset += sdessize;
+	if ((status = CreatePackets(offset,appsize,RTCPPacket::APP)) < 0)
 	{
-		std::list<Buffer>::const_iterator it;
-
-		for (it = apppackets.begin() ; it != apppackets.end() ; it++)
-		{
-			memcpy(curbuf,(*it).packetdata,(*it).packetlength);
-			
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPAPPPACKET) RTCPAPPPacket(curbuf,(*it).packetlength);
-			if (p == 0)
-			{
-				if (!external)
-					RTPDeleteByteArray(buf,GetMemoryManager());
-				ClearPacketList();
-				return ERR_RTP_OUTOFMEM;
-			}
-			rtcppacklist.push_back(p);
-	
-			curbuf += (*it).packetlength;
-		}
+		ClearPacketList();
+		return status;
 	}
-
+	offset += appsize;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
-
-	// adding the unknown data
-	
+	if ((status = CreatePackets(offset,unknownsize,RTCPPacket::Unknown)) < 0)
 	{
-		std::list<Buffer>::const_iterator it;
-
-		for (it = unknownpackets.begin() ; it != unknownpackets.end() ; it++)
-		{
-			memcpy(curbuf,(*it).packetdata,(*it).packetlength);
-			
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPUNKNOWNPACKET) RTCPUnknownPacket(curbuf,(*it).packetlength);
-			if (p == 0)
-			{
-				if (!external)
-					RTPDeleteByteArray(buf,GetMemoryManager());
-				ClearPacketList();
-				return ERR_RTP_OUTOFMEM;
-			}
-			rtcppacklist.push_back(p);
-	
-			curbuf += (*it).packetlength;
-		}
+		ClearPacketList();
+		return status;
 	}
-
+	offset += unknownsize;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
-
-	// adding bye packets
-	
+	if ((status = CreatePackets(offset,byesize,RTCPPacket::BYE)) < 0)
 	{
-		std::list<Buffer>::const_iterator it;
-
-		for (it = byepackets.begin() ; it != byepackets.end() ; it++)
-		{
-			memcpy(curbuf,(*it).packetdata,(*it).packetlength);
-			
-			p = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTCPBYEPACKET) RTCPBYEPacket(curbuf,(*it).packetlength);
-			if (p == 0)
-			{
-				if (!external)
-					RTPDeleteByteArray(buf,GetMemoryManager());
-				ClearPacketList();
-				return ERR_RTP_OUTOFMEM;
-			}
-			rtcppacklist.push_back(p);
-	
-			curbuf += (*it).packetlength;
-		}
+		ClearPacketList();
+		return status;
 	}
 	
-	compoundpacket = buf;
-	compoundpacketlength = len;
+	compoundpacket = buffer;
+	compoundpacketlength = GetBuildSize();
+	GotoFirstPacket();
 	arebuilding = false;
-	ClearBuildBuffers();
 	return 0;
 }
 
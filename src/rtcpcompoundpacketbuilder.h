@@ -43,7 +43,6 @@
 #include "rtptimeutilities.h"
 #include "rtcpsdespacket.h"
 #include "rtperrors.h"
-#include <list>
 
 namespace jrtplib
 {
@@ -65,7 +64,8 @@ public:
 
 	/** Starts building an RTCP compound packet with maximum size \c maxpacketsize.
 	 *  Starts building an RTCP compound packet with maximum size \c maxpacketsize. New memory will be allocated 
-	 *  to store the packet.
+	 *  to store the packet, unless the memory of a previous build is large enough (see ClearBuild). The
+	 *  data is written into this memory in its final form, so EndBuild doesn't need to copy it.
 	 */
 	int InitBuild(size_t maxpacketsize);
 
@@ -130,6 +130,14 @@ public:
 	 */
 	int EndBuild();
 
+	/** Discards the compound packet that was built or is being built.
+	 *  Discards the compound packet that was built or is being built, so that InitBuild can be called
+	 *  again. Memory that was allocated by InitBuild(size_t) is kept and will be reused by the next
+	 *  build if it's large enough, so that the same instance can be used to build a packet in each
+	 *  RTCP interval without allocating a new buffer.
+	 */
+	void ClearBuild();
+
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	/** Adds the RTCP packet specified by the arguments to the compound packet.
 	 *  Adds the RTCP packet specified by the arguments to the compound packet.
@@ -137,261 +145,49 @@ public:
 	int AddUnknownPacket(uint8_t payload_type, uint8_t subtype, uint32_t ssrc, const void *data, size_t len);
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 private:
-	class Buffer
-	{
-	public:
-		Buffer():packetdata(0),packetlength(0) { }
-		Buffer(uint8_t *data,size_t len):packetdata(data),packetlength(len) { }			
-		
-		uint8_t *packetdata;
-		size_t packetlength;
-	};
-
-	class Report : public RTPMemoryObject
-	{
-	public:
-		Report(RTPMemoryManager *mgr) : RTPMemoryObject(mgr) 
-		{ 
-			headerdata = (uint8_t *)headerdata32; 
-			isSR = false; 
-			headerlength = 0; 
-		}
-		~Report() { Clear(); }
-
-		void Clear()
-		{
-			std::list<Buffer>::const_iterator it; 
-			for (it = reportblocks.begin() ; it != reportblocks.end() ; it++) 
-			{
-				if ((*it).packetdata) 
-					RTPDeleteByteArray((*it).packetdata,GetMemoryManager()); 
-			}
-			reportblocks.clear();
-			isSR = false;
-			headerlength = 0;
-		}
-
-		size_t NeededBytes() 
-		{ 
-			size_t x,n,d,r; 
-			n = reportblocks.size(); 
-			if (n == 0)
-			{
-				if (headerlength == 0)
-					return 0;
-				x = sizeof(RTCPCommonHeader)+headerlength;
-			}
-			else
-			{
-				x = n*sizeof(RTCPReceiverReport);
-				d = n/31; // max 31 reportblocks per report
-				r = n%31;
-				if (r != 0)
-					d++;
-				x += d*(sizeof(RTCPCommonHeader)+sizeof(uint32_t)); /* header and SSRC */
-				if (isSR)
-					x += sizeof(RTCPSenderReport);
-			}
-			return x;
-		}			
-
-		size_t NeededBytesWithExtraReportBlock()
-		{
-			size_t x,n,d,r; 
-			n = reportblocks.size() + 1; // +1 for the extra block
-			x = n*sizeof(RTCPReceiverReport);
-			d = n/31; // max 31 reportblocks per report
-			r = n%31;
-			if (r != 0)
-				d++;
-			x += d*(sizeof(RTCPCommonHeader)+sizeof(uint32_t)); /* header and SSRC */
-			if (isSR)
-				x += sizeof(RTCPSenderReport);
-			return x;
-		}
-		
-		bool isSR;
-
-		uint8_t *headerdata;
-		uint32_t headerdata32[(sizeof(uint32_t)+sizeof(RTCPSenderReport))/sizeof(uint32_t)]; // either for ssrc and sender info or just ssrc
-		size_t headerlength;
-		std::list<Buffer> reportblocks;
-	};
-
-	class SDESSource : public RTPMemoryObject
-	{
-	public:
-		SDESSource(uint32_t s,RTPMemoryManager *mgr) : RTPMemoryObject(mgr),ssrc(s),totalitemsize(0)  { }
-		~SDESSource()
-		{
-			std::list<Buffer>::const_iterator it;
-			for (it = items.begin() ; it != items.end() ; it++)
-			{
-				if ((*it).packetdata)
-					RTPDeleteByteArray((*it).packetdata,GetMemoryManager());
-			}
-			items.clear();
-		}
-
-		size_t NeededBytes()
-		{
-			size_t x,r;
-			x = totalitemsize + 1; // +1 for the 0 byte which terminates the item list
-			r = x%sizeof(uint32_t);
-			if (r != 0)
-				x += (sizeof(uint32_t)-r); // make sure it ends on a 32 bit boundary
-			x += sizeof(uint32_t); // for ssrc
-			return x;
-		}
-
-		size_t NeededBytesWithExtraItem(uint8_t itemdatalength)
-		{
-			size_t x,r;
-			x = totalitemsize + sizeof(RTCPSDESHeader) + (size_t)itemdatalength + 1;
-			r = x%sizeof(uint32_t);
-			if (r != 0)
-				x += (sizeof(uint32_t)-r); // make sure it ends on a 32 bit boundary
-			x += sizeof(uint32_t); // for ssrc
-			return x;
-		}
-		
-		void AddItem(uint8_t *buf,size_t len)
-		{
-			Buffer b(buf,len);
-			totalitemsize += len;
-			items.push_back(b);	
-		}
-		
-		uint32_t ssrc;
-		std::list<Buffer> items;
-	private:
-		size_t totalitemsize;
-	};
-	
-	class SDES : public RTPMemoryObject
+	uint8_t *InsertBytes(size_t offset,size_t len);
+	int ReserveSDESItem(size_t itemlength,uint8_t **item);
+	void UpdateReportHeader();
+	void UpdateSDESHeader();
+	int CreatePackets(size_t offset,size_t size,RTCPPacket::PacketType t);
+	void ClearBuildBuffers();
+
+	size_t GetBuildSize() const
 	{
-	public:
-		SDES(RTPMemoryManager *mgr) : RTPMemoryObject(mgr) { sdesit = sdessources.end(); }
-		~SDES() { Clear(); }
-
-		void Clear()
-		{
-			std::list<SDESSource *>::const_iterator it;
-
-			for (it = sdessources.begin() ; it != sdessources.end() ; it++)
-				RTPDelete(*it,GetMemoryManager());
-			sdessources.clear();
-		}
-
-		int AddSSRC(uint32_t ssrc)
-		{
-			SDESSource *s = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_SDESSOURCE) SDESSource(ssrc,GetMemoryManager());
-			if (s == 0)
-				return ERR_RTP_OUTOFMEM;
-			sdessources.push_back(s);
-			sdesit = sdessources.end();
-			sdesit--;
-			return 0;
-		}
-
-		int AddItem(uint8_t *buf,size_t len)
-		{
-			if (sdessources.empty())
-				return ERR_RTP_RTCPCOMPPACKBUILDER_NOCURRENTSOURCE;
-			(*sdesit)->AddItem(buf,len);
-			return 0;
-		}
-
-		size_t NeededBytes()
-		{
-			std::list<SDESSource *>::const_iterator it;
-			size_t x = 0;
-			size_t n,d,r;
-			
-			if (sdessources.empty())
-				return 0;
-			
-			for (it = sdessources.begin() ; it != sdessources.end() ; it++)
-				x += (*it)->NeededBytes();
-			n = sdessources.size();
-			d = n/31;
-			r = n%31;
-			if (r != 0)
-				d++;
-			x += d*sizeof(RTCPCommonHeader);
-			return x;
-		}
-		
-		size_t NeededBytesWithExtraItem(uint8_t itemdatalength)
-		{
-			std::list<SDESSource *>::const_iterator it;
-			size_t x = 0;
-			size_t n,d,r;
-			
-			if (sdessources.empty())
-				return 0;
-			
-			for (it = sdessources.begin() ; it != sdesit ; it++)
-				x += (*it)->NeededBytes();
-			x += (*sdesit)->NeededBytesWithExtraItem(itemdatalength);
-			n = sdessources.size();
-			d = n/31;
-			r = n%31;
-			if (r != 0)
-				d++;
-			x += d*sizeof(RTCPCommonHeader);
-			return x;
-		}
-
-		size_t NeededBytesWithExtraSource()
-		{
-			std::list<SDESSource *>::const_iterator it;
-			size_t x = 0;
-			size_t n,d,r;
-			
-			if (sdessources.empty())
-				return 0;
-			
-			for (it = sdessources.begin() ; it != sdessources.end() ; it++)
-				x += (*it)->NeededBytes();
-			
-			// for the extra source we'll need at least 8 bytes (ssrc and four 0 bytes)
-			x += sizeof(uint32_t)*2;
-			
-			n = sdessources.size() + 1; // also, the number of sources will increase
-			d = n/31;
-			r = n%31;
-			if (r != 0)
-				d++;
-			x += d*sizeof(RTCPCommonHeader);
-			return x;
-		}
-		
-		std::list<SDESSource *> sdessources;
-	private:
-		std::list<SDESSource *>::const_iterator sdesit;
-	};
+#ifndef RTP_SUPPORT_RTCPUNKNOWN
+		return reportsize+sdessize+appsize+byesize;
+#else
+		return reportsize+sdessize+appsize+unknownsize+byesize;
+#endif // RTP_SUPPORT_RTCPUNKNOWN 
+	}
 
 	size_t maximumpacketsize;
 	uint8_t *buffer;
+	uint8_t *arena;
+	size_t arenasize;
 	bool external;
 	bool arebuilding;
-	
-	Report report;
-	SDES sdes;
 
-	std::list<Buffer> byepackets;
-	size_t byesize;
+	// The packet is stored in its final form: first the report packets, then the
+	// SDES packets, the APP packets, the unknown packets and the BYE packets.
+	// The header of the last report or SDES packet is updated when something is
+	// added to it, and the data after it is moved when it grows.
+	size_t reportsize;
+	size_t reportheaderoffset;
+	int numreportblocks;
+
+	size_t sdessize;
+	size_t sdesheaderoffset; // relative to the start of the SDES packets
+	size_t sdeschunkoffset; // idem
+	size_t sdesitemsize;
+	int numsdessources;
 	
-	std::list<Buffer> apppackets;
 	size_t appsize;
+	size_t byesize;
 
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
-	std::list<Buffer> unknownpackets;
 	size_t unknownsize;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
-	
-	void ClearBuildBuffers();
 };
 
 } // end namespace
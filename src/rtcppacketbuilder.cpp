@@ -305,18 +305,45 @@ int RTCPPacketBuilder::BuildNextPacket(RTCPCompoundPacket **pack)
 	return 0;
 }
 
+// Only the sources in the report list of the source table can have their flag set
+
 void RTCPPacketBuilder::ClearAllSourceFlags()
 {
-	if (sources.GotoFirstSource())
+	if (sources.GotoFirstReportSource())
 	{
 		do
 		{
-			RTPSourceData *srcdat = sources.GetCurrentSourceInfo();
+			RTPSourceData *srcdat = sources.GetCurrentReportSourceInfo();
 			srcdat->SetProcessedInRTCP(false);
-		} while (sources.GotoNextSource());
+		} while (sources.GotoNextReportSource());
 	}
 }
 
+bool RTCPPacketBuilder::NeedsReportBlock(RTPSourceData *srcdat) const
+{
+	if (srcdat->IsOwnSSRC()) // don't send to ourselves
+		return false;
+	if (srcdat->IsCSRC()) // p 35: no reports should go to CSRCs
+		return false;
+	if (!srcdat->INF_HasSentData()) // if this isn't true, INF_GetLastRTPPacketTime() won't make any sense
+		return false;
+	if (firstpacket)
+		return true;
+
+	// p 35: only if rtp packets were received since the last RTP packet, a report block
+	// should be added
+	RTPTime lastrtptime = srcdat->INF_GetLastRTPPacketTime();
+	
+	if (lastrtptime > prevbuildtime)
+		return true;
+	return false;
+}
+
+// Only the sources in the report list of the source table are considered: these are
+// the ones that received RTP data since they were last removed from it. A source that
+// doesn't need a report block and isn't marked as processed is removed from the list,
+// it will be added again when new RTP data arrives for it.
+
 int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppack,const RTPTime &curtime,int maxcount,bool *full,int *added,int *skipped,bool *atendoflist)
 {
 	RTPSourceData *srcdat;
@@ -327,36 +354,12 @@ int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppac
 	bool atend = false;
 	int status;
 
-	if (sources.GotoFirstSource())
+	if (sources.GotoFirstReportSource())
 	{
 		do
 		{
-			bool shouldprocess = false;
-			
-			srcdat = sources.GetCurrentSourceInfo();
-			if (!srcdat->IsOwnSSRC()) // don't send to ourselves
-			{
-				if (!srcdat->IsCSRC()) // p 35: no reports should go to CSRCs
-				{
-					if (srcdat->INF_HasSentData()) // if this isn't true, INF_GetLastRTPPacketTime() won't make any sense
-					{
-						if (firstpacket)
-							shouldprocess = true;
-						else
-						{
-							// p 35: only if rtp packets were received since the last RTP packet, a report block
-							// should be added
-							
-							RTPTime lastrtptime = srcdat->INF_GetLastRTPPacketTime();
-							
-							if (lastrtptime > prevbuildtime)
-								shouldprocess = true;
-						}
-					}
-				}
-			}
-
-			if (shouldprocess)
+			srcdat = sources.GetCurrentReportSourceInfo();
+			if (NeedsReportBlock(srcdat))
 			{
 				if (srcdat->IsProcessedInRTCP()) // already covered this one
 				{
@@ -426,7 +429,7 @@ int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppac
 						if (addedcount >= maxcount)
 						{
 							done = true;
-							if (!sources.GotoNextSource())
+							if (!sources.GotoNextReportSource())
 								atend = true;
 						}
 						srcdat->INF_StartNewInterval();
@@ -434,10 +437,19 @@ int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppac
 					}
 				}
 			}
+			else if (!srcdat->IsProcessedInRTCP())
+			{
+				if (!sources.DeleteCurrentReportSource())
+				{
+					atend = true;
+					done = true;
+				}
+				continue;
+			}
 
 			if (!done)
 			{
-				if (!sources.GotoNextSource())
+				if (!sources.GotoNextReportSource())
 				{
 					atend = true;
 					done = true;
@@ -446,6 +458,8 @@ int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppac
 
 		} while (!done);
 	}
+	else
+		atend = true;
 	
 	*added = addedcount;
 	*skipped = skippedcount;
@@ -453,46 +467,30 @@ int RTCPPacketBuilder::FillInReportBlocks(RTCPCompoundPacketBuilder *rtcpcomppac
 	
 	if (!atend) // search for available sources
 	{
-		bool shouldprocess = false;
+		bool found = false;
 		
 		do
 		{	
-			srcdat = sources.GetCurrentSourceInfo();
-			if (!srcdat->IsOwnSSRC()) // don't send to ourselves
+			srcdat = sources.GetCurrentReportSourceInfo();
+			if (NeedsReportBlock(srcdat))
 			{
-				if (!srcdat->IsCSRC()) // p 35: no reports should go to CSRCs
-				{
-					if (srcdat->INF_HasSentData()) // if this isn't true, INF_GetLastRTPPacketTime() won't make any sense
-					{
-						if (firstpacket)
-							shouldprocess = true;
-						else
-						{
-							// p 35: only if rtp packets were received since the last RTP packet, a report block
-							// should be added
-							
-							RTPTime lastrtptime = srcdat->INF_GetLastRTPPacketTime();
-							
-							if (lastrtptime > prevbuildtime)
-								shouldprocess = true;
-						}
-					}
-				}
+				if (!srcdat->IsProcessedInRTCP())
+					found = true;
 			}
-			
-			if (shouldprocess)
+			else if (!srcdat->IsProcessedInRTCP())
 			{
-				if (srcdat->IsProcessedInRTCP())
-					shouldprocess = false;
+				if (!sources.DeleteCurrentReportSource())
+					atend = true;
+				continue;
 			}
 
-			if (!shouldprocess)
+			if (!found)
 			{
-				if (!sources.GotoNextSource())
+				if (!sources.GotoNextReportSource())
 					atend = true;
 			}
 	
-		} while (!atend && !shouldprocess);
+		} while (!atend && !found);
 	}	
 
 	*atendoflist = atend;
@@ -49,6 +49,7 @@ namespace jrtplib
 {
 
 class RTPSources;
+class RTPSourceData;
 class RTPPacketBuilder;
 class RTCPScheduler;
 class RTCPCompoundPacket;
@@ -180,6 +181,7 @@ public:
 	uint8_t *GetLocalCNAME(size_t *len) const					{ if (!init) return 0; return ownsdesinfo.GetCNAME(len); }
 private:
 	void ClearAllSourceFlags();
+	bool NeedsReportBlock(RTPSourceData *srcdat) const;
 	int FillInReportBlocks(RTCPCompoundPacketBuilder *pack,const RTPTime &curtime,int maxcount,bool *full,int *added,int *skipped,bool *atendoflist);
 	int FillInSDES(RTCPCompoundPacketBuilder *pack,bool *full,bool *processedall,int *added);
 	void ClearAllSDESFlags();
@@ -109,10 +109,10 @@ void RTCPScheduler::Reset()
 void RTCPScheduler::AnalyseIncoming(RTCPCompoundPacket &rtcpcomppack)
 {
 	bool isbye = false;
-	RTCPPacket *p;
+	const RTCPPacketView *p;
 	
-	rtcpcomppack.GotoFirstPacket();
-	while (!isbye && ((p = rtcpcomppack.GetNextPacket()) != 0))
+	rtcpcomppack.GotoFirstPacketView();
+	while (!isbye && ((p = rtcpcomppack.GetNextPacketView()) != 0))
 	{
 		if (p->GetPacketType() == RTCPPacket::BYE)
 			isbye = true;
@@ -137,10 +137,10 @@ void RTCPScheduler::AnalyseIncoming(RTCPCompoundPacket &rtcpcomppack)
 void RTCPScheduler::AnalyseOutgoing(RTCPCompoundPacket &rtcpcomppack)
 {
 	bool isbye = false;
-	RTCPPacket *p;
+	const RTCPPacketView *p;
 	
-	rtcpcomppack.GotoFirstPacket();
-	while (!isbye && ((p = rtcpcomppack.GetNextPacket()) != 0))
+	rtcpcomppack.GotoFirstPacketView();
+	while (!isbye && ((p = rtcpcomppack.GetNextPacketView()) != 0))
 	{
 		if (p->GetPacketType() == RTCPPacket::BYE)
 			isbye = true;
@@ -46,6 +46,8 @@
 #define RTP_COLLISIONTIMEOUTMULTIPLIER					10
 #define RTP_NOTETTIMEOUTMULTIPLIER					25
 #define RTP_DEFAULTSESSIONBANDWIDTH					10000.0
+#define RTP_DEFAULTREORDERDEPTH						1024
+#define RTP_MAXIOVECS							16
 
 #define RTP_RTCPTYPE_SR							200
 #define RTP_RTCPTYPE_RR							201
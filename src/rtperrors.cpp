@@ -245,6 +245,36 @@ static RTPErrorInfo ErrorDescriptions[]=
 	{ ERR_RTP_TCPTRANS_SOCKETNOTFOUNDINDESTINATIONS, "The specified destination address (socket) was not found in the list of destinations of the TCP transmitter" },
 	{ ERR_RTP_TCPTRANS_ERRORINSEND, "An error occurred in the TCP transmitter while sending a packet" },
 	{ ERR_RTP_TCPTRANS_ERRORINRECV, "An error occurred in the TCP transmitter while receiving a packet" },
+	{ ERR_RTP_SLABPOOL_ALREADYCREATED, "The slab pool was already created" },
+	{ ERR_RTP_SLABPOOL_ILLEGALSLABSIZE, "The size of the slabs in a slab pool must be larger than zero" },
+	{ ERR_RTP_SLABPOOL_CANTINITMUTEX, "Failed to initialize the slab pool's mutex" },
+	{ ERR_RTP_POOLMEMMGR_ALREADYINIT, "The pool memory manager was already initialized" },
+	{ ERR_RTP_POOLMEMMGR_CANTINITMUTEX, "Failed to initialize the pool memory manager's mutex" },
+	{ ERR_RTP_REACTOR_ALREADYRUNNING, "The reactor is already running" },
+	{ ERR_RTP_REACTOR_NOTRUNNING, "The reactor is not running" },
+	{ ERR_RTP_REACTOR_ILLEGALNUMBEROFWORKERS, "The reactor needs at least one worker thread" },
+	{ ERR_RTP_REACTOR_ILLEGALTIMERRESOLUTION, "The reactor's timer resolution must be positive" },
+	{ ERR_RTP_REACTOR_CANTINITMUTEX, "Failed to initialize the reactor's mutex" },
+	{ ERR_RTP_REACTOR_CANTCREATEEPOLL, "Failed to create the reactor's epoll instance" },
+	{ ERR_RTP_REACTOR_CANTCREATETIMER, "Failed to create the reactor's timer descriptor" },
+	{ ERR_RTP_REACTOR_CANTSTARTTHREAD, "Failed to start a reactor worker thread" },
+	{ ERR_RTP_REACTOR_SESSIONALREADYADDED, "The session was already added to the reactor" },
+	{ ERR_RTP_REACTOR_SESSIONNOTFOUND, "The session was not found in the reactor" },
+	{ ERR_RTP_REACTOR_UNSUPPORTEDTRANSMITTER, "The reactor only supports sessions using the UDP over IPv4 or IPv6 transmitters" },
+	{ ERR_RTP_REACTOR_CANTADDSOCKET, "Failed to add a session socket to the reactor's epoll instance" },
+	{ ERR_RTP_SECURESESSION_ILLEGALNUMBEROFRECEIVECONTEXTS, "The number of SRTP receive contexts must be at least one" },
+	{ ERR_RTP_SECURESESSION_RECEIVECONTEXTSALREADYINITIALIZED, "The SRTP receive contexts were already initialized" },
+	{ ERR_RTP_SECURESESSION_CANTSTARTTHREAD, "Failed to start an SRTP decryption thread" },
+	{ ERR_RTP_SECURESESSION_INVALIDRECEIVECONTEXTINDEX, "The specified SRTP receive context index is not valid" },
+	{ ERR_RTP_SESSION_TOOMANYPAYLOADPARTS, "The payload consists of too many parts (at most RTP_MAXIOVECS-1 are allowed)" },
+	{ ERR_RTP_UDPSHARDS_ALREADYCREATED, "The receive shards were already created" },
+	{ ERR_RTP_UDPSHARDS_CANTGETSOCKETADDRESS, "Can't obtain the address the RTP socket is bound to" },
+	{ ERR_RTP_UDPSHARDS_CANTCREATESOCKET, "Can't create the socket of a receive shard" },
+	{ ERR_RTP_UDPSHARDS_CANTSETSOCKETOPTION, "Can't set an option of the socket of a receive shard" },
+	{ ERR_RTP_UDPSHARDS_CANTBINDSOCKET, "Can't bind the socket of a receive shard to the RTP port (the RTP socket must allow SO_REUSEPORT)" },
+	{ ERR_RTP_UDPSHARDS_CANTATTACHFILTER, "Can't attach the SSRC steering program to the receive shards" },
+	{ ERR_RTP_UDPSHARDS_CANTINITMUTEX, "Failed to initialize the mutex of the receive shards" },
+	{ ERR_RTP_UDPSHARDS_CANTSTARTTHREAD, "Failed to start the thread of a receive shard" },
 	{ 0,0 }
 };
 
@@ -246,6 +246,36 @@ std::string JRTPLIB_IMPORTEXPORT RTPGetErrorString(int errcode);
 #define ERR_RTP_TCPTRANS_SOCKETNOTFOUNDINDESTINATIONS             -195
 #define ERR_RTP_TCPTRANS_ERRORINSEND                              -196
 #define ERR_RTP_TCPTRANS_ERRORINRECV                              -197
+#define ERR_RTP_SLABPOOL_ALREADYCREATED                           -198
+#define ERR_RTP_SLABPOOL_ILLEGALSLABSIZE                          -199
+#define ERR_RTP_SLABPOOL_CANTINITMUTEX                            -200
+#define ERR_RTP_POOLMEMMGR_ALREADYINIT                            -201
+#define ERR_RTP_POOLMEMMGR_CANTINITMUTEX                          -202
+#define ERR_RTP_REACTOR_ALREADYRUNNING                            -203
+#define ERR_RTP_REACTOR_NOTRUNNING                                -204
+#define ERR_RTP_REACTOR_ILLEGALNUMBEROFWORKERS                    -205
+#define ERR_RTP_REACTOR_ILLEGALTIMERRESOLUTION                    -206
+#define ERR_RTP_REACTOR_CANTINITMUTEX                             -207
+#define ERR_RTP_REACTOR_CANTCREATEEPOLL                           -208
+#define ERR_RTP_REACTOR_CANTCREATETIMER                           -209
+#define ERR_RTP_REACTOR_CANTSTARTTHREAD                           -210
+#define ERR_RTP_REACTOR_SESSIONALREADYADDED                       -211
+#define ERR_RTP_REACTOR_SESSIONNOTFOUND                           -212
+#define ERR_RTP_REACTOR_UNSUPPORTEDTRANSMITTER                    -213
+#define ERR_RTP_REACTOR_CANTADDSOCKET                             -214
+#define ERR_RTP_SECURESESSION_ILLEGALNUMBEROFRECEIVECONTEXTS      -215
+#define ERR_RTP_SECURESESSION_RECEIVECONTEXTSALREADYINITIALIZED   -216
+#define ERR_RTP_SECURESESSION_CANTSTARTTHREAD                     -217
+#define ERR_RTP_SECURESESSION_INVALIDRECEIVECONTEXTINDEX          -218
+#define ERR_RTP_SESSION_TOOMANYPAYLOADPARTS                       -219
+#define ERR_RTP_UDPSHARDS_ALREADYCREATED                          -220
+#define ERR_RTP_UDPSHARDS_CANTGETSOCKETADDRESS                    -221
+#define ERR_RTP_UDPSHARDS_CANTCREATESOCKET                        -222
+#define ERR_RTP_UDPSHARDS_CANTSETSOCKETOPTION                     -223
+#define ERR_RTP_UDPSHARDS_CANTBINDSOCKET                          -224
+#define ERR_RTP_UDPSHARDS_CANTATTACHFILTER                        -225
+#define ERR_RTP_UDPSHARDS_CANTINITMUTEX                           -226
+#define ERR_RTP_UDPSHARDS_CANTSTARTTHREAD                         -227
 
 #endif // RTPERRORS_H
 
@@ -60,11 +60,14 @@
 	#define WAITMUTEX_UNLOCK
 #endif // RTP_SUPPORT_THREAD
 
+#define RTPEXTTRANS_MAXFREESLABS					64
+
 namespace jrtplib
 {
 
 RTPExternalTransmitter::RTPExternalTransmitter(RTPMemoryManager *mgr) : RTPTransmitter(mgr), packetinjector((RTPExternalTransmitter *)this)
 {
+	m_pSlabPool = 0;
 	created = false;
 	init = false;
 }
@@ -138,6 +141,30 @@ int RTPExternalTransmitter::Create(size_t maximumpacketsize,const RTPTransmissio
 		return status;
 	}
 	m_abortCount = 0;
+
+	// Packets that are copied are stored in slabs of this pool, which also
+	// wraps the buffers that are injected without copying them
+#ifdef RTP_SUPPORT_THREAD
+	bool slabthreadsafe = (threadsafe)?true:false;
+#else
+	bool slabthreadsafe = false;
+#endif // RTP_SUPPORT_THREAD
+
+	m_pSlabPool = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPSLABPOOL) RTPSlabPool(GetMemoryManager());
+	if (m_pSlabPool == 0)
+	{
+		m_abortDesc.Destroy();
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_OUTOFMEM;
+	}
+	if ((status = m_pSlabPool->Create(maximumpacketsize, RTPEXTTRANS_MAXFREESLABS, slabthreadsafe)) < 0)
+	{
+		m_pSlabPool->Release();
+		m_pSlabPool = 0;
+		m_abortDesc.Destroy();
+		MAINMUTEX_UNLOCK
+		return status;
+	}
 	
 	maxpacksize = maximumpacketsize;
 	sender = params->GetSender();
@@ -173,6 +200,10 @@ void RTPExternalTransmitter::Destroy()
 	
 	FlushPackets();
 	created = false;
+
+	// Packets that still use one of the slabs keep the pool alive
+	m_pSlabPool->Release();
+	m_pSlabPool = 0;
 	
 	if (waitingfordata)
 	{
@@ -396,6 +427,45 @@ int RTPExternalTransmitter::SendRTPData(const void *data,size_t len)
 	return 0;
 }
 
+int RTPExternalTransmitter::SendRTPDataIov(const RTPIOVec *iov,int numiov)
+{
+	if (!init)
+		return ERR_RTP_EXTERNALTRANS_NOTINIT;
+
+	size_t len = 0;
+	for (int i = 0 ; i < numiov ; i++)
+		len += iov[i].len;
+
+	MAINMUTEX_LOCK
+	
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_EXTERNALTRANS_NOTCREATED;
+	}
+	if (len > maxpacksize)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_EXTERNALTRANS_SPECIFIEDSIZETOOBIG;
+	}
+	
+	if (!sender)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_EXTERNALTRANS_NOSENDER;
+	}
+
+	MAINMUTEX_UNLOCK
+
+	if (!sender->SupportsSendRTPv()) // let the parts be combined and passed to SendRTP
+		return RTPTransmitter::SendRTPDataIov(iov, numiov);
+
+	if (!sender->SendRTPv(iov, numiov))
+		return ERR_RTP_EXTERNALTRANS_SENDERROR;
+
+	return 0;
+}
+
 int RTPExternalTransmitter::SendRTCPData(const void *data,size_t len)
 {
 	if (!init)
@@ -578,7 +648,7 @@ RTPRawPacket *RTPExternalTransmitter::GetNextPacket()
 
 void RTPExternalTransmitter::FlushPackets()
 {
-	std::list<RTPRawPacket*>::const_iterator it;
+	std::deque<RTPRawPacket*>::const_iterator it;
 
 	for (it = rawpacketlist.begin() ; it != rawpacketlist.end() ; ++it)
 		RTPDelete(*it,GetMemoryManager());
@@ -587,152 +657,214 @@ void RTPExternalTransmitter::FlushPackets()
 
 void RTPExternalTransmitter::InjectRTP(const void *data, size_t len, const RTPAddress &a)
 {
-	if (!init)
-		return;
-
-	MAINMUTEX_LOCK
-	if (!created)
-	{
-		MAINMUTEX_UNLOCK
-		return;
-	}
-
-	RTPAddress *addr = a.CreateCopy(GetMemoryManager());
-	if (addr == 0)
-		return;
-
-	uint8_t *datacopy;
+	RTPExternalInjectedPacket packet;
 
-	datacopy = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET) uint8_t[len];
-	if (datacopy == 0)
-	{
-		RTPDelete(addr,GetMemoryManager());
-		return;
-	}
-	memcpy(datacopy, data, len);
+	packet.data = (uint8_t *)data; // won't be modified, it's copied
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTP;
+	InjectPackets(&packet, 1);
+}
 
-	RTPTime curtime = RTPTime::CurrentTime();
-	RTPRawPacket *pack;
+void RTPExternalTransmitter::InjectRTCP(const void *data, size_t len, const RTPAddress &a)
+{
+	RTPExternalInjectedPacket packet;
 
-	pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,len,addr,curtime,true,GetMemoryManager());
-	if (pack == 0)
-	{
-		RTPDelete(addr,GetMemoryManager());
-		RTPDeleteByteArray(localhostname,GetMemoryManager());
-		return;
-	}
-	rawpacketlist.push_back(pack);
+	packet.data = (uint8_t *)data; // won't be modified, it's copied
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTCP;
+	InjectPackets(&packet, 1);
+}
 
-	if (m_abortCount == 0)
-	{
-		m_abortDesc.SendAbortSignal();
-		m_abortCount++;
-	}
+void RTPExternalTransmitter::InjectRTPorRTCP(const void *data, size_t len, const RTPAddress &a)
+{
+	RTPExternalInjectedPacket packet;
 
-	MAINMUTEX_UNLOCK
+	packet.data = (uint8_t *)data; // won't be modified, it's copied
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTPorRTCP;
+	InjectPackets(&packet, 1);
 }
 
-void RTPExternalTransmitter::InjectRTCP(const void *data, size_t len, const RTPAddress &a)
+void RTPExternalTransmitter::InjectPackets(const RTPExternalInjectedPacket *packets, size_t numpackets)
 {
+	size_t i;
+
 	if (!init)
+	{
+		for (i = 0 ; i < numpackets ; i++)
+		{
+			if (packets[i].release)
+				packets[i].release(packets[i].data, packets[i].length, packets[i].releasearg);
+		}
 		return;
+	}
 
 	MAINMUTEX_LOCK
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
+		for (i = 0 ; i < numpackets ; i++)
+		{
+			if (packets[i].release)
+				packets[i].release(packets[i].data, packets[i].length, packets[i].releasearg);
+		}
 		return;
 	}
 
-	RTPAddress *addr = a.CreateCopy(GetMemoryManager());
-	if (addr == 0)
-		return;
-
-	uint8_t *datacopy;
-
-	datacopy = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RECEIVEDRTCPPACKET) uint8_t[len];
-	if (datacopy == 0)
-	{
-		RTPDelete(addr,GetMemoryManager());
-		return;
-	}
-	memcpy(datacopy, data, len);
-
 	RTPTime curtime = RTPTime::CurrentTime();
-	RTPRawPacket *pack;
+	bool added = false;
+	std::vector<size_t> releaseindices;
+	std::vector<RTPReceiveSlab *> releaseslabs;
 
-	pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,len,addr,curtime,false,GetMemoryManager());
-	if (pack == 0)
+	for (i = 0 ; i < numpackets ; i++)
 	{
-		RTPDelete(addr,GetMemoryManager());
-		RTPDeleteByteArray(localhostname,GetMemoryManager());
-		return;
+		bool releasedata = false;
+		RTPReceiveSlab *releaseslab = 0;
+		RTPRawPacket *pack = CreateRawPacket(packets[i], curtime, releasedata, releaseslab);
+
+		if (pack)
+		{
+			rawpacketlist.push_back(pack);
+			added = true;
+		}
+		else if (releasedata)
+			releaseindices.push_back(i);
+		else if (releaseslab)
+			releaseslabs.push_back(releaseslab);
 	}
-	rawpacketlist.push_back(pack);
 
-	if (m_abortCount == 0)
+	if (added && m_abortCount == 0)
 	{
 		m_abortDesc.SendAbortSignal();
 		m_abortCount++;
 	}
 
 	MAINMUTEX_UNLOCK
+
+	// The release callbacks of the packets that couldn't be queued are only
+	// called now, so that they can inject packets again without deadlocking
+
+	for (i = 0 ; i < releaseindices.size() ; i++)
+	{
+		const RTPExternalInjectedPacket &packet = packets[releaseindices[i]];
+
+		packet.release(packet.data, packet.length, packet.releasearg);
+	}
+	for (i = 0 ; i < releaseslabs.size() ; i++)
+		releaseslabs[i]->Release(); // also releases the caller's buffer
 }
 
-void RTPExternalTransmitter::InjectRTPorRTCP(const void *data, size_t len, const RTPAddress &a)
+// Creates the raw packet for an injected packet. If this fails, the data of a
+// packet that wasn't going to be copied still needs to be released, which the
+// caller does after unlocking the mutex: 'releasedata' is set if the release
+// callback must be called, 'releaseslab' is set if the slab which wraps the
+// data must be released.
+RTPRawPacket *RTPExternalTransmitter::CreateRawPacket(const RTPExternalInjectedPacket &packet, RTPTime &recvtime, bool &releasedata, RTPReceiveSlab *&releaseslab)
 {
-	if (!init)
-		return;
+	releasedata = false;
+	releaseslab = 0;
 
-	MAINMUTEX_LOCK
-	if (!created)
+	if (packet.length == 0) // like the UDP transmitters, don't queue empty packets
 	{
-		MAINMUTEX_UNLOCK
-		return;
+		if (packet.release)
+			releasedata = true;
+		return 0;
 	}
 
-	RTPAddress *addr = a.CreateCopy(GetMemoryManager());
-	if (addr == 0)
-		return;
-
-	uint8_t *datacopy;
-	bool rtp = true;
+	bool rtp = (packet.type != RTPExternalInjectedPacket::RTCP);
 
-	if (len >= 2)
+	if (packet.type == RTPExternalInjectedPacket::RTPorRTCP && packet.length >= 2)
 	{
-		const uint8_t *pData = (const uint8_t *)data;
-		if (pData[1] >= 200 && pData[1] <= 204)
+		if (packet.data[1] >= 200 && packet.data[1] <= 204)
 			rtp = false;
 	}
 
-	datacopy = RTPNew(GetMemoryManager(),(rtp)?RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET:RTPMEM_TYPE_BUFFER_RECEIVEDRTCPPACKET) uint8_t[len];
-	if (datacopy == 0)
+	RTPReceiveSlab *slab = 0;
+	RTPRawPacket *pack;
+
+	if (packet.release)
 	{
-		RTPDelete(addr,GetMemoryManager());
-		return;
+		slab = m_pSlabPool->WrapExternalData(packet.data, packet.length, packet.release, packet.releasearg);
+		if (slab == 0)
+		{
+			releasedata = true;
+			return 0;
+		}
+	}
+	else if (packet.length <= m_pSlabPool->GetSlabSize())
+	{
+		slab = m_pSlabPool->AcquireSlab();
+		if (slab == 0)
+			return 0;
+		memcpy(slab->GetData(), packet.data, packet.length);
 	}
-	memcpy(datacopy, data, len);
+	else // too large for a slab, store a copy of its own
+	{
+		RTPAddress *addr = packet.address->CreateCopy(GetMemoryManager());
+		if (addr == 0)
+			return 0;
 
-	RTPTime curtime = RTPTime::CurrentTime();
-	RTPRawPacket *pack;
+		uint8_t *datacopy = RTPNew(GetMemoryManager(),(rtp)?RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET:RTPMEM_TYPE_BUFFER_RECEIVEDRTCPPACKET) uint8_t[packet.length];
+		if (datacopy == 0)
+		{
+			RTPDelete(addr,GetMemoryManager());
+			return 0;
+		}
+		memcpy(datacopy, packet.data, packet.length);
 
-	pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,len,addr,curtime,rtp,GetMemoryManager());
-	if (pack == 0)
+		pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,packet.length,addr,recvtime,rtp,GetMemoryManager());
+		if (pack == 0)
+		{
+			RTPDelete(addr,GetMemoryManager());
+			RTPDeleteByteArray(datacopy,GetMemoryManager());
+			return 0;
+		}
+		return pack;
+	}
+
+	// Releasing the slab on failure also releases the caller's buffer, so
+	// for a wrapped buffer this is left to the caller
+	if (SetSlabAddress(slab, *(packet.address)) < 0)
 	{
-		RTPDelete(addr,GetMemoryManager());
-		RTPDeleteByteArray(localhostname,GetMemoryManager());
-		return;
+		if (packet.release)
+			releaseslab = slab;
+		else
+			slab->Release();
+		return 0;
 	}
-	rawpacketlist.push_back(pack);
 
-	if (m_abortCount == 0)
+	pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(slab,packet.length,recvtime,rtp,GetMemoryManager());
+	if (pack == 0)
 	{
-		m_abortDesc.SendAbortSignal();
-		m_abortCount++;
+		if (packet.release)
+			releaseslab = slab;
+		else
+			slab->Release();
+		return 0;
 	}
+	return pack;
+}
 
-	MAINMUTEX_UNLOCK
+int RTPExternalTransmitter::SetSlabAddress(RTPReceiveSlab *slab, const RTPAddress &a)
+{
+	// Slabs are reused, and so is the address instance they contain if
+	// the packet comes from the same sender
 
+	RTPAddress *addr = slab->GetAddress();
+	if (addr && addr->IsSameAddress(&a))
+		return 0;
+
+	RTPAddress *newaddr = a.CreateCopy(GetMemoryManager());
+	if (newaddr == 0)
+		return ERR_RTP_OUTOFMEM;
+
+	if (addr)
+		RTPDelete(addr,GetMemoryManager());
+	slab->SetAddress(newaddr);
+	return 0;
 }
 
 #ifdef RTPDEBUG
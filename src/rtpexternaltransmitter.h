@@ -41,7 +41,9 @@
 #include "rtpconfig.h"
 #include "rtptransmitter.h"
 #include "rtpabortdescriptors.h"
-#include <list>
+#include "rtpslabpool.h"
+#include <deque>
+#include <vector>
 
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jmutex.h>
@@ -72,10 +74,53 @@ public:
 	/** This member function will be called when an RTCP packet needs to be transmitted. */
 	virtual bool SendRTCP(const void *data, size_t len) = 0;
 
+	/** Should return \c true if RTPExternalSender::SendRTPv is implemented, in which case an RTP packet
+	 *  that consists of several parts (see RTPSession::SendPacketIov) is passed on without combining 
+	 *  the parts first. */
+	virtual bool SupportsSendRTPv()										{ return false; }
+
+	/** If RTPExternalSender::SupportsSendRTPv returns \c true, this member function will be called
+	 *  when RTP data consisting of the \c numiov parts in \c iov needs to be transmitted. */
+	virtual bool SendRTPv(const RTPIOVec *iov, int numiov)						{ JRTPLIB_UNUSED(iov); JRTPLIB_UNUSED(numiov); return false; }
+
 	/** Used to identify if an RTPAddress instance originated from this sender (to be able to detect own packets). */
 	virtual bool ComesFromThisSender(const RTPAddress *a) = 0;
 };
 
+/** Describes a packet that's passed to RTPExternalPacketInjecter::InjectPackets. */
+struct JRTPLIB_IMPORTEXPORT RTPExternalInjectedPacket
+{
+	/** Used to specify what kind of data the packet contains. */
+	enum PacketType 
+	{ 
+		RTP, /**< The packet contains RTP data. */
+		RTCP, /**< The packet contains RTCP data. */
+		RTPorRTCP /**< The type of data should be determined from the header. */
+	};
+
+	RTPExternalInjectedPacket()											{ data = 0; length = 0; address = 0; type = RTPorRTCP; release = 0; releasearg = 0; }
+
+	/** The data of the packet. */
+	uint8_t *data;
+
+	/** The length of the packet data. */
+	size_t length;
+
+	/** The address the packet originated from. */
+	const RTPAddress *address;
+
+	/** The kind of data the packet contains. */
+	PacketType type;
+
+	/** If null, the data is copied; otherwise the library takes ownership of \c data and 
+	 *  calls this function with \c data, \c length and \c releasearg when it's no longer 
+	 *  needed. */
+	RTPReceiveSlabReleaseFunction release;
+
+	/** Argument that's passed to the \c release function. */
+	void *releasearg;
+};
+
 /** Interface to inject incoming RTP and RTCP packets into the library.
  *  Interface to inject incoming RTP and RTCP packets into the library. When you have your own
  *  mechanism to receive incoming RTP/RTCP data, you'll need to pass these packets to the library.
@@ -97,6 +142,32 @@ public:
 
 	/** Use this function to inject an RTP or RTCP packet and the transmitter will try to figure out which type of packet it is. */
 	void InjectRTPorRTCP(const void *data, size_t len, const RTPAddress &a);
+
+	/** Inserts the RTP packet in \c data into the transmission component without copying it.
+	 *  Inserts the RTP packet in \c data into the transmission component without copying it: the
+	 *  buffer is used by the RTPRawPacket and RTPPacket instances directly. When the data is no
+	 *  longer needed, \c release is called with \c data, \c len and \c releasearg; this also
+	 *  happens right away if the packet could not be stored. Note that this release function can 
+	 *  be called from any thread in which the last packet instance using the data is deleted.
+	 */
+	void InjectRTPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg);
+
+	/** Inserts the RTCP packet in \c data into the transmission component without copying it,
+	 *  see RTPExternalPacketInjecter::InjectRTPBuffer. */
+	void InjectRTCPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg);
+
+	/** Inserts the RTP or RTCP packet in \c data into the transmission component without copying 
+	 *  it, see RTPExternalPacketInjecter::InjectRTPBuffer; the type of the packet is determined
+	 *  from its header. */
+	void InjectRTPorRTCPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg);
+
+	/** Inserts \c numpackets packets into the transmission component at once.
+	 *  Inserts \c numpackets packets into the transmission component at once, only locking the
+	 *  transmitter a single time. For each packet that has a release function set, the data is 
+	 *  used without copying it, as in RTPExternalPacketInjecter::InjectRTPBuffer, the others
+	 *  are copied.
+	 */
+	void InjectPackets(const RTPExternalInjectedPacket *packets, size_t numpackets);
 private:
 	RTPExternalTransmitter *transmitter;
 };
@@ -160,6 +231,7 @@ public:
 	
 	int SendRTPData(const void *data,size_t len);	
 	int SendRTCPData(const void *data,size_t len);
+	int SendRTPDataIov(const RTPIOVec *iov,int numiov);
 
 	int AddDestination(const RTPAddress &addr);
 	int DeleteDestination(const RTPAddress &addr);
@@ -188,8 +260,11 @@ public:
 	void InjectRTP(const void *data, size_t len, const RTPAddress &a);
 	void InjectRTCP(const void *data, size_t len, const RTPAddress &a);
 	void InjectRTPorRTCP(const void *data, size_t len, const RTPAddress &a);
+	void InjectPackets(const RTPExternalInjectedPacket *packets, size_t numpackets);
 private:
 	void FlushPackets();
+	RTPRawPacket *CreateRawPacket(const RTPExternalInjectedPacket &packet, RTPTime &recvtime, bool &releasedata, RTPReceiveSlab *&releaseslab);
+	int SetSlabAddress(RTPReceiveSlab *slab, const RTPAddress &a);
 	
 	bool init;
 	bool created;
@@ -197,7 +272,8 @@ private:
 	RTPExternalSender *sender;
 	RTPExternalPacketInjecter packetinjector;
 
-	std::list<RTPRawPacket*> rawpacketlist;
+	std::deque<RTPRawPacket*> rawpacketlist;
+	RTPSlabPool *m_pSlabPool;
 
 	uint8_t *localhostname;
 	size_t localhostnamelength;
@@ -228,6 +304,50 @@ inline void RTPExternalPacketInjecter::InjectRTPorRTCP(const void *data, size_t
 	transmitter->InjectRTPorRTCP(data, len, a); 
 }
 
+inline void RTPExternalPacketInjecter::InjectRTPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg)
+{
+	RTPExternalInjectedPacket packet;
+
+	packet.data = data;
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTP;
+	packet.release = release;
+	packet.releasearg = releasearg;
+	transmitter->InjectPackets(&packet, 1);
+}
+
+inline void RTPExternalPacketInjecter::InjectRTCPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg)
+{
+	RTPExternalInjectedPacket packet;
+
+	packet.data = data;
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTCP;
+	packet.release = release;
+	packet.releasearg = releasearg;
+	transmitter->InjectPackets(&packet, 1);
+}
+
+inline void RTPExternalPacketInjecter::InjectRTPorRTCPBuffer(uint8_t *data, size_t len, const RTPAddress &a, RTPReceiveSlabReleaseFunction release, void *releasearg)
+{
+	RTPExternalInjectedPacket packet;
+
+	packet.data = data;
+	packet.length = len;
+	packet.address = &a;
+	packet.type = RTPExternalInjectedPacket::RTPorRTCP;
+	packet.release = release;
+	packet.releasearg = releasearg;
+	transmitter->InjectPackets(&packet, 1);
+}
+
+inline void RTPExternalPacketInjecter::InjectPackets(const RTPExternalInjectedPacket *packets, size_t numpackets)
+{
+	transmitter->InjectPackets(packets, numpackets);
+}
+
 } // end namespace
 
 #endif // RTPTCPSOCKETTRANSMITTER_H
@@ -0,0 +1,100 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpflathashtable.h
+ */
+
+#ifndef RTPFLATHASHTABLE_H
+
+#define RTPFLATHASHTABLE_H
+
+#include "rtpconfig.h"
+#include "rtpflatkeyhashtable.h"
+
+namespace jrtplib
+{
+
+/** An open addressing hash table which stores a set of elements.
+ *  An open addressing hash table which stores a set of elements, offering the same interface
+ *  as RTPHashTable. It's an RTPFlatKeyHashTable in which the elements themselves are used
+ *  as the keys; see that class for the way the elements are stored.
+ */
+template<class Element,class Hash>
+class RTPFlatHashTable : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPFlatHashTable)
+public:
+	RTPFlatHashTable(RTPMemoryManager *mgr = 0,int memtype = RTPMEM_TYPE_OTHER) : RTPMemoryObject(mgr),table(mgr,memtype) { }
+	~RTPFlatHashTable()						{ }
+
+	void GotoFirstElement()					{ table.GotoFirstElement(); }
+	void GotoLastElement()					{ table.GotoLastElement(); }
+	bool HasCurrentElement()				{ return table.HasCurrentElement(); }
+	int DeleteCurrentElement()				{ return (table.DeleteCurrentElement() < 0)?ERR_RTP_HASHTABLE_NOCURRENTELEMENT:0; }
+	Element &GetCurrentElement()			{ return table.GetCurrentKey(); }
+	int GotoElement(const Element &e)		{ return (table.GotoElement(e) < 0)?ERR_RTP_HASHTABLE_ELEMENTNOTFOUND:0; }
+	bool HasElement(const Element &e)		{ return table.HasElement(e); }
+	void GotoNextElement()					{ table.GotoNextElement(); }
+	void GotoPreviousElement()				{ table.GotoPreviousElement(); }
+	void Clear()							{ table.Clear(); }
+
+	int AddElement(const Element &elem);
+	int DeleteElement(const Element &elem)	{ return (table.DeleteElement(elem) < 0)?ERR_RTP_HASHTABLE_ELEMENTNOTFOUND:0; }
+
+	/** Returns the number of elements in the table. */
+	size_t GetNumberOfElements() const		{ return table.GetNumberOfElements(); }
+
+	/** Returns the position of the current element, which is the number of elements before 
+	 *  it when iterating from the first to the last element. */
+	size_t GetCurrentPosition() const		{ return table.GetCurrentPosition(); }
+
+	/** Returns the element at position \c pos, which must be smaller than the number of elements. */
+	Element &GetElementAt(size_t pos)		{ return table.GetKeyAt(pos); }
+private:
+	RTPFlatKeyHashTable<Element,char,Hash> table;
+};
+
+template<class Element,class Hash>
+inline int RTPFlatHashTable<Element,Hash>::AddElement(const Element &elem)
+{
+	int status = table.AddElement(elem,0);
+
+	if (status == ERR_RTP_KEYHASHTABLE_KEYALREADYEXISTS)
+		return ERR_RTP_HASHTABLE_ELEMENTALREADYEXISTS;
+	return status;
+}
+
+} // end namespace
+
+#endif // RTPFLATHASHTABLE_H
+
@@ -0,0 +1,386 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpflatkeyhashtable.h
+ */
+
+#ifndef RTPFLATKEYHASHTABLE_H
+
+#define RTPFLATKEYHASHTABLE_H
+
+#include "rtpconfig.h"
+#include "rtperrors.h"
+#include "rtptypes.h"
+#include "rtpmemoryobject.h"
+#include <new>
+
+#define RTPFLATHASHTABLE_MINSLOTS								16
+
+namespace jrtplib
+{
+
+// Used to store a copy of a 'const Key' or 'const Element' in the table's arrays
+template<class T> struct RTPFlatHashTable_Stored						{ typedef T Type; };
+template<class T> struct RTPFlatHashTable_Stored<const T>				{ typedef T Type; };
+
+/** An open addressing hash table which maps keys to elements.
+ *  An open addressing hash table which maps keys to elements, offering the same interface
+ *  as RTPKeyHashTable. The keys and elements are stored in two dense arrays, in the order 
+ *  in which they were added, so iterating over the table simply walks these arrays. A 
+ *  separate array of slots, of which the number is a power of two, stores the hash value 
+ *  of each key together with the position of the key in the dense arrays; collisions are 
+ *  resolved using linear probing and the table grows when it's three quarters full. The 
+ *  class \c Hash must provide a function \c GetHash which returns a 32-bit hash value for
+ *  a key, which is spread over the slots using multiplicative hashing. 
+ *
+ *  When an element is deleted, the last element is moved into its place, so the element
+ *  that becomes the current one after RTPFlatKeyHashTable::DeleteCurrentElement is the
+ *  one that hasn't been visited yet when iterating from first to last. Note that adding
+ *  or deleting elements can move the others, so references to them should not be kept.
+ */
+template<class Key,class Element,class Hash>
+class RTPFlatKeyHashTable : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPFlatKeyHashTable)
+public:
+	RTPFlatKeyHashTable(RTPMemoryManager *mgr = 0,int memtype = RTPMEM_TYPE_OTHER);
+	~RTPFlatKeyHashTable()					{ Clear(); }
+
+	void GotoFirstElement()					{ curindex = (numelements > 0)?0:NoIndex(); }
+	void GotoLastElement()					{ curindex = (numelements > 0)?numelements-1:NoIndex(); }
+	bool HasCurrentElement()				{ return (curindex < numelements)?true:false; }
+	int DeleteCurrentElement();
+	Element &GetCurrentElement()			{ return elements[curindex]; }
+	Key &GetCurrentKey()					{ return keys[curindex]; }
+	int GotoElement(const Key &k);
+	bool HasElement(const Key &k);
+	void GotoNextElement()					{ if (curindex < numelements) curindex = (curindex+1 < numelements)?curindex+1:NoIndex(); }
+	void GotoPreviousElement()				{ if (curindex < numelements) curindex = (curindex > 0)?curindex-1:NoIndex(); }
+	void Clear();
+
+	int AddElement(const Key &k,const Element &elem);
+	int DeleteElement(const Key &k);
+
+	/** Returns the number of elements in the table. */
+	size_t GetNumberOfElements() const		{ return numelements; }
+
+	/** Returns the position of the current element, which is the number of elements before 
+	 *  it when iterating from the first to the last element. */
+	size_t GetCurrentPosition() const		{ return curindex; }
+
+	/** Returns the key at position \c pos, which must be smaller than the number of elements. */
+	Key &GetKeyAt(size_t pos)				{ return keys[pos]; }
+
+	/** Returns the element at position \c pos, which must be smaller than the number of elements. */
+	Element &GetElementAt(size_t pos)		{ return elements[pos]; }
+private:
+	typedef typename RTPFlatHashTable_Stored<Key>::Type StoredKey;
+	typedef typename RTPFlatHashTable_Stored<Element>::Type StoredElement;
+
+	// The position in the dense arrays is stored plus one, zero marks an empty slot
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t index;
+	};
+
+	static size_t NoIndex()					{ return (size_t)-1; }
+	size_t GetIdealSlot(uint32_t hash) const { return (size_t)((uint32_t)(hash*2654435769U) >> slotshift); }
+	size_t FindSlot(const Key &k,uint32_t hash) const;
+	void RemoveSlot(size_t pos);
+	void RemoveAt(size_t pos);
+	int Grow();
+
+	Slot *slots;
+	size_t numslots, slotshift;
+	StoredKey *keys;
+	StoredElement *elements;
+	size_t numelements, maxelements;
+	size_t curindex;
+#ifdef RTP_SUPPORT_MEMORYMANAGEMENT
+	int memorytype;
+#endif // RTP_SUPPORT_MEMORYMANAGEMENT
+};
+
+template<class Key,class Element,class Hash>
+inline RTPFlatKeyHashTable<Key,Element,Hash>::RTPFlatKeyHashTable(RTPMemoryManager *mgr,int memtype) : RTPMemoryObject(mgr)
+{
+	JRTPLIB_UNUSED(memtype); // possibly unused
+
+	slots = 0;
+	numslots = 0;
+	slotshift = 32;
+	keys = 0;
+	elements = 0;
+	numelements = 0;
+	maxelements = 0;
+	curindex = NoIndex();
+#ifdef RTP_SUPPORT_MEMORYMANAGEMENT
+	memorytype = memtype;
+#endif // RTP_SUPPORT_MEMORYMANAGEMENT
+}
+
+template<class Key,class Element,class Hash>
+inline size_t RTPFlatKeyHashTable<Key,Element,Hash>::FindSlot(const Key &k,uint32_t hash) const
+{
+	if (numelements == 0)
+		return NoIndex();
+
+	size_t mask = numslots-1;
+	size_t pos = GetIdealSlot(hash);
+
+	// The table is never full, so an empty slot ends the search
+	while (slots[pos].index != 0)
+	{
+		if (slots[pos].hash == hash && keys[slots[pos].index-1] == k)
+			return pos;
+		pos = (pos+1)&mask;
+	}
+	return NoIndex();
+}
+
+template<class Key,class Element,class Hash>
+inline void RTPFlatKeyHashTable<Key,Element,Hash>::RemoveSlot(size_t pos)
+{
+	size_t mask = numslots-1;
+	size_t next = (pos+1)&mask;
+
+	// Move entries back into the gap unless that would put them before their
+	// ideal slot, so no tombstones are needed
+	while (slots[next].index != 0)
+	{
+		size_t ideal = GetIdealSlot(slots[next].hash);
+
+		if (((next-ideal)&mask) >= ((next-pos)&mask))
+		{
+			slots[pos] = slots[next];
+			pos = next;
+		}
+		next = (next+1)&mask;
+	}
+	slots[pos].index = 0;
+}
+
+template<class Key,class Element,class Hash>
+inline void RTPFlatKeyHashTable<Key,Element,Hash>::RemoveAt(size_t pos)
+{
+	size_t index = slots[pos].index-1;
+	size_t last = numelements-1;
+
+	RemoveSlot(pos);
+
+	keys[index].~StoredKey();
+	elements[index].~StoredElement();
+
+	if (index != last) // move the last element into the gap to keep the arrays dense
+	{
+		size_t mask = numslots-1;
+		size_t lastpos = GetIdealSlot(Hash::GetHash(keys[last]));
+
+		while (slots[lastpos].index != last+1)
+			lastpos = (lastpos+1)&mask;
+		slots[lastpos].index = (uint32_t)(index+1);
+
+		new (&keys[index]) StoredKey(keys[last]);
+		new (&elements[index]) StoredElement(elements[last]);
+		keys[last].~StoredKey();
+		elements[last].~StoredElement();
+	}
+	numelements--;
+}
+
+template<class Key,class Element,class Hash>
+inline int RTPFlatKeyHashTable<Key,Element,Hash>::Grow()
+{
+	size_t newnumslots = (numslots == 0)?RTPFLATHASHTABLE_MINSLOTS:numslots*2;
+	size_t newmaxelements = (newnumslots/4)*3;
+	size_t newslotshift = slotshift;
+
+	while (((size_t)1 << (32-newslotshift)) < newnumslots)
+		newslotshift--;
+
+	Slot *newslots = (Slot *)RTPNew(GetMemoryManager(),memorytype) uint8_t[sizeof(Slot)*newnumslots];
+	StoredKey *newkeys = (StoredKey *)RTPNew(GetMemoryManager(),memorytype) uint8_t[sizeof(StoredKey)*newmaxelements];
+	StoredElement *newelements = (StoredElement *)RTPNew(GetMemoryManager(),memorytype) uint8_t[sizeof(StoredElement)*newmaxelements];
+
+	if (newslots == 0 || newkeys == 0 || newelements == 0)
+	{
+		if (newslots)
+			RTPDeleteByteArray((uint8_t *)newslots,GetMemoryManager());
+		if (newkeys)
+			RTPDeleteByteArray((uint8_t *)newkeys,GetMemoryManager());
+		if (newelements)
+			RTPDeleteByteArray((uint8_t *)newelements,GetMemoryManager());
+		return ERR_RTP_OUTOFMEM;
+	}
+
+	for (size_t i = 0 ; i < newnumslots ; i++)
+		newslots[i].index = 0;
+
+	// The order of the dense arrays is kept, only the slots need to be rebuilt
+	size_t mask = newnumslots-1;
+
+	for (size_t i = 0 ; i < numelements ; i++)
+	{
+		uint32_t hash = Hash::GetHash(keys[i]);
+		size_t pos = (size_t)((uint32_t)(hash*2654435769U) >> newslotshift);
+
+		while (newslots[pos].index != 0)
+			pos = (pos+1)&mask;
+		newslots[pos].hash = hash;
+		newslots[pos].index = (uint32_t)(i+1);
+
+		new (&newkeys[i]) StoredKey(keys[i]);
+		new (&newelements[i]) StoredElement(elements[i]);
+		keys[i].~StoredKey();
+		elements[i].~StoredElement();
+	}
+
+	if (slots)
+	{
+		RTPDeleteByteArray((uint8_t *)slots,GetMemoryManager());
+		RTPDeleteByteArray((uint8_t *)keys,GetMemoryManager());
+		RTPDeleteByteArray((uint8_t *)elements,GetMemoryManager());
+	}
+	slots = newslots;
+	numslots = newnumslots;
+	slotshift = newslotshift;
+	keys = newkeys;
+	elements = newelements;
+	maxelements = newmaxelements;
+	return 0;
+}
+
+template<class Key,class Element,class Hash>
+inline int RTPFlatKeyHashTable<Key,Element,Hash>::DeleteCurrentElement()
+{
+	if (curindex >= numelements)
+		return ERR_RTP_KEYHASHTABLE_NOCURRENTELEMENT;
+
+	size_t pos = FindSlot(keys[curindex],Hash::GetHash(keys[curindex]));
+
+	RemoveAt(pos);
+	if (curindex >= numelements) // the last element was deleted
+		curindex = NoIndex();
+	return 0;
+}
+
+template<class Key,class Element,class Hash>
+inline int RTPFlatKeyHashTable<Key,Element,Hash>::GotoElement(const Key &k)
+{
+	size_t pos = FindSlot(k,Hash::GetHash(k));
+
+	if (pos == NoIndex())
+	{
+		curindex = NoIndex();
+		return ERR_RTP_KEYHASHTABLE_KEYNOTFOUND;
+	}
+	curindex = slots[pos].index-1;
+	return 0;
+}
+
+template<class Key,class Element,class Hash>
+inline bool RTPFlatKeyHashTable<Key,Element,Hash>::HasElement(const Key &k)
+{
+	return (FindSlot(k,Hash::GetHash(k)) == NoIndex())?false:true;
+}
+
+template<class Key,class Element,class Hash>
+inline void RTPFlatKeyHashTable<Key,Element,Hash>::Clear()
+{
+	for (size_t i = 0 ; i < numelements ; i++)
+	{
+		keys[i].~StoredKey();
+		elements[i].~StoredElement();
+	}
+	if (slots)
+	{
+		RTPDeleteByteArray((uint8_t *)slots,GetMemoryManager());
+		RTPDeleteByteArray((uint8_t *)keys,GetMemoryManager());
+		RTPDeleteByteArray((uint8_t *)elements,GetMemoryManager());
+	}
+	slots = 0;
+	numslots = 0;
+	slotshift = 32;
+	keys = 0;
+	elements = 0;
+	numelements = 0;
+	maxelements = 0;
+	curindex = NoIndex();
+}
+
+template<class Key,class Element,class Hash>
+inline int RTPFlatKeyHashTable<Key,Element,Hash>::AddElement(const Key &k,const Element &elem)
+{
+	uint32_t hash = Hash::GetHash(k);
+
+	if (FindSlot(k,hash) != NoIndex())
+		return ERR_RTP_KEYHASHTABLE_KEYALREADYEXISTS;
+
+	if (numelements == maxelements)
+	{
+		int status = Grow();
+		if (status < 0)
+			return status;
+	}
+
+	size_t mask = numslots-1;
+	size_t pos = GetIdealSlot(hash);
+
+	while (slots[pos].index != 0)
+		pos = (pos+1)&mask;
+
+	new (&keys[numelements]) StoredKey(k);
+	new (&elements[numelements]) StoredElement(elem);
+	numelements++;
+
+	slots[pos].hash = hash;
+	slots[pos].index = (uint32_t)numelements;
+	return 0;
+}
+
+template<class Key,class Element,class Hash>
+inline int RTPFlatKeyHashTable<Key,Element,Hash>::DeleteElement(const Key &k)
+{
+	int status;
+
+	status = GotoElement(k);
+	if (status < 0)
+		return status;
+	return DeleteCurrentElement();
+}
+
+} // end namespace
+
+#endif // RTPFLATKEYHASHTABLE_H
+
@@ -32,6 +32,8 @@
 
 #include "rtpinternalsourcedata.h"
 #include "rtppacket.h"
+#include "rtprawpacket.h"
+#include "rtpmemorymanager.h"
 #include <string.h>
 
 #include "rtpdebug.h"
@@ -47,14 +49,23 @@ RTPInternalSourceData::RTPInternalSourceData(uint32_t ssrc,RTPSources::Probation
 #ifdef RTP_SUPPORT_PROBATION
 	probationtype = probtype;
 #endif // RTP_SUPPORT_PROBATION
+	timeoutserial = 0;
+	sendertimeoutqueued = false;
+	byetimeoutqueued = false;
+	notetimeoutqueued = false;
+	prevreportsource = 0;
+	nextreportsource = 0;
+	inreportlist = false;
 }
 
 RTPInternalSourceData::~RTPInternalSourceData()
 {
 }
 
-// The following function should delete rtppack if necessary
-int RTPInternalSourceData::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,bool *stored,RTPSources *sources)
+// The following function should delete rtppack if necessary. If rtppack is null, an
+// RTPPacket instance is only created from rawpack when it actually needs to be stored;
+// such an instance is deleted again by this function if it is not stored.
+int RTPInternalSourceData::ProcessRTPPacket(RTPPacketView &view,RTPPacket *rtppack,RTPRawPacket *rawpack,bool *stored,RTPSources *sources)
 {
 	bool accept,onprobation,applyprobation;
 	double tsunit;
@@ -80,7 +91,7 @@ int RTPInternalSourceData::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &re
 	applyprobation = false;
 #endif // RTP_SUPPORT_PROBATION
 
-	stats.ProcessPacket(rtppack,receivetime,tsunit,ownssrc,&accept,applyprobation,&onprobation);
+	stats.ProcessPacket(&view,view.GetReceiveTime(),tsunit,ownssrc,&accept,applyprobation,&onprobation);
 
 #ifdef RTP_SUPPORT_PROBATION
 	switch (probationtype)
@@ -112,6 +123,30 @@ int RTPInternalSourceData::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &re
 	bool isonprobation = !validated;
 	bool ispackethandled = false;
 
+	sources->OnValidatedRTPPacketView(this, view, isonprobation, &ispackethandled);
+	if (ispackethandled) // Packet was consumed using the view, no RTPPacket instance is needed
+		return 0;
+
+	bool createdpacket = false;
+
+	if (rtppack == 0) // only now we need an RTPPacket instance, which takes over the data of rawpack
+	{
+		rtppack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPPACKET) RTPPacket(view,*rawpack,GetMemoryManager());
+		if (rtppack == 0)
+			return ERR_RTP_OUTOFMEM;
+		
+		int status;
+		
+		if ((status = rtppack->GetCreationError()) < 0)
+		{
+			RTPDelete(rtppack,GetMemoryManager());
+			return status;
+		}
+		createdpacket = true;
+	}
+	else
+		rtppack->SetExtendedSequenceNumber(view.GetExtendedSequenceNumber());
+
 	sources->OnValidatedRTPPacket(this, rtppack, isonprobation, &ispackethandled);
 	if (ispackethandled) // Packet is already handled in the callback, no need to store it in the list
 	{
@@ -122,68 +157,21 @@ int RTPInternalSourceData::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &re
 
 	// Now, we can place the packet in the queue
 	
-	if (packetlist.empty())
-	{
-		*stored = true;
-		packetlist.push_back(rtppack);
-		return 0;
-	}
-	
 	if (!validated) // still on probation
 	{
 		// Make sure that we don't buffer too much packets to avoid wasting memory
 		// on a bad source. Delete the packet in the queue with the lowest sequence
 		// number.
-		if (packetlist.size() == RTPINTERNALSOURCEDATA_MAXPROBATIONPACKETS)
-		{
-			RTPPacket *p = *(packetlist.begin());
-			packetlist.pop_front();
-			RTPDelete(p,GetMemoryManager());
-		}
+		if (packetring.GetPacketCount() >= RTPINTERNALSOURCEDATA_MAXPROBATIONPACKETS)
+			packetring.DeleteNextPacket();
 	}
 
-	// find the right position to insert the packet
-	
-	std::list<RTPPacket*>::iterator it,start;
-	bool done = false;
-	uint32_t newseqnr = rtppack->GetExtendedSequenceNumber();
-	
-	it = packetlist.end();
-	--it;
-	start = packetlist.begin();
-	
-	while (!done)
-	{
-		RTPPacket *p;
-		uint32_t seqnr;
-		
-		p = *it;
-		seqnr = p->GetExtendedSequenceNumber();
-		if (seqnr > newseqnr)
-		{
-			if (it != start)
-				--it;
-			else // we're at the start of the list
-			{
-				*stored = true;
-				done = true;
-				packetlist.push_front(rtppack);
-			}
-		}
-		else if (seqnr < newseqnr) // insert after this packet
-		{
-			++it;
-			packetlist.insert(it,rtppack);
-			done = true;
-			*stored = true;
-		}
-		else // they're equal !! Drop packet
-		{
-			done = true;
-		}
-	}
+	// This also drops duplicate packets
+	int status = packetring.AddPacket(rtppack,stored);
 
-	return 0;
+	if (createdpacket && !(*stored))
+		RTPDelete(rtppack,GetMemoryManager());
+	return status;
 }
 
 int RTPInternalSourceData::ProcessSDESItem(uint8_t sdesid,const uint8_t *data,size_t itemlen,const RTPTime &receivetime,bool *cnamecollis)
@@ -53,7 +53,7 @@ public:
 	RTPInternalSourceData(uint32_t ssrc, RTPSources::ProbationType probtype, RTPMemoryManager *mgr = 0);
 	~RTPInternalSourceData();
 
-	int ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,bool *stored, RTPSources *sources);
+	int ProcessRTPPacket(RTPPacketView &view,RTPPacket *rtppack,RTPRawPacket *rawpack,bool *stored, RTPSources *sources);
 	void ProcessSenderInfo(const RTPNTPTime &ntptime,uint32_t rtptime,uint32_t packetcount,
 	                       uint32_t octetcount,const RTPTime &receivetime)				{ SRprevinf = SRinf; SRinf.Set(ntptime,rtptime,packetcount,octetcount,receivetime); stats.SetLastMessageTime(receivetime); }
 	void ProcessReportBlock(uint8_t fractionlost,int32_t lostpackets,uint32_t exthighseqnr,
@@ -74,11 +74,25 @@ public:
 	void SetOwnSSRC()										{ ownssrc = true; validated = true; }
 	void SetCSRC()											{ validated = true; iscsrc = true; }
 	void ClearNote()										{ SDESinf.SetNote(0,0); }
+	void SetPacketQueueParameters(size_t depth,bool reorder)					{ packetring.SetParameters(depth,reorder); }
 	
-#ifdef RTP_SUPPORT_PROBATION
 private:
+#ifdef RTP_SUPPORT_PROBATION
 	RTPSources::ProbationType probationtype;
 #endif // RTP_SUPPORT_PROBATION
+
+	// Bookkeeping for the timeout queues of RTPSources
+	uint32_t timeoutserial;
+	bool sendertimeoutqueued;
+	bool byetimeoutqueued;
+	bool notetimeoutqueued;
+
+	// Links in the list of RTPSources of sources which may need a report block
+	RTPInternalSourceData *prevreportsource;
+	RTPInternalSourceData *nextreportsource;
+	bool inreportlist;
+
+	friend class RTPSources;
 };
 
 inline int RTPInternalSourceData::SetRTPDataAddress(const RTPAddress *a)
@@ -0,0 +1,166 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtpjitterbuffer.h"
+#include "rtppacketring.h"
+#include "rtppacket.h"
+
+#include "rtpdebug.h"
+
+namespace jrtplib
+{
+
+RTPJitterBuffer::RTPJitterBuffer()
+{
+	m_jitterMultiplier = RTPJITTERBUFFER_DEFAULTJITTERMULTIPLIER;
+	m_minDelay = RTPJITTERBUFFER_DEFAULTMINDELAY;
+	m_maxDelay = RTPJITTERBUFFER_DEFAULTMAXDELAY;
+	m_targetDelay = m_minDelay;
+	m_numLate = 0;
+	m_numLost = 0;
+	Reset();
+}
+
+void RTPJitterBuffer::SetParameters(double jittermultiplier, const RTPTime &mindelay, const RTPTime &maxdelay)
+{
+	m_jitterMultiplier = jittermultiplier;
+	m_minDelay = mindelay.GetDouble();
+	m_maxDelay = maxdelay.GetDouble();
+	if (m_maxDelay < m_minDelay)
+		m_maxDelay = m_minDelay;
+}
+
+void RTPJitterBuffer::Reset()
+{
+	m_havePlayed = false;
+	m_lastSeqNr = 0;
+	m_lastTimestamp = 0;
+	m_lastTimestampPos = 0;
+	m_haveTransit = false;
+	m_minTransit = 0;
+	m_prevMinTransit = 0;
+	m_windowStart = 0;
+}
+
+RTPPacket *RTPJitterBuffer::GetPlayoutPacket(RTPPacketRing &ring, const RTPTime &now, double tsunit, uint32_t jitter, uint32_t *lost)
+{
+	if (lost)
+		*lost = 0;
+
+	while (true)
+	{
+		RTPPacket *pack = ring.PeekNextPacket();
+
+		if (pack == 0)
+			return 0;
+
+		uint32_t seqnr = pack->GetExtendedSequenceNumber();
+		int32_t seqdiff = 1;
+
+		if (m_havePlayed)
+		{
+			seqdiff = (int32_t)(int16_t)(uint16_t)(seqnr - m_lastSeqNr);
+			if (seqdiff <= 0) // a later packet has already been played out
+			{
+				ring.DeleteNextPacket();
+				m_numLate++;
+				continue;
+			}
+		}
+
+		uint32_t timestamp = pack->GetTimestamp();
+
+		if (!m_havePlayed && !m_haveTransit)
+		{
+			m_lastTimestamp = timestamp;
+			m_lastTimestampPos = 0;
+		}
+
+		// Unwrapped timestamp, relative to the first packet
+		double pos = m_lastTimestampPos + (double)((int32_t)(timestamp - m_lastTimestamp));
+
+		if (tsunit > 0)
+		{
+			double t = now.GetDouble();
+			double transit = pack->GetReceiveTime().GetDouble() - pos*tsunit;
+			double base = (m_minTransit < m_prevMinTransit)?m_minTransit:m_prevMinTransit;
+
+			// Start over on the first packet, or if the timing of the source has
+			// changed drastically (e.g. because its timestamps jumped back)
+			if (!m_haveTransit || transit - base > RTPJITTERBUFFER_RESYNCTHRESHOLD)
+			{
+				m_minTransit = transit;
+				m_prevMinTransit = transit;
+				m_windowStart = t;
+				m_haveTransit = true;
+			}
+			else 
+			{
+				if (transit < m_minTransit)
+					m_minTransit = transit;
+				if (t - m_windowStart > RTPJITTERBUFFER_TRANSITWINDOW)
+				{
+					m_prevMinTransit = m_minTransit;
+					m_minTransit = transit;
+					m_windowStart = t;
+				}
+			}
+			base = (m_minTransit < m_prevMinTransit)?m_minTransit:m_prevMinTransit;
+
+			m_targetDelay = m_jitterMultiplier*(double)jitter*tsunit;
+			if (m_targetDelay < m_minDelay)
+				m_targetDelay = m_minDelay;
+			else if (m_targetDelay > m_maxDelay)
+				m_targetDelay = m_maxDelay;
+
+			if (t < pos*tsunit + base + m_targetDelay)
+				return 0;
+		}
+
+		if (seqdiff > 1)
+		{
+			if (lost)
+				*lost = (uint32_t)(seqdiff-1);
+			m_numLost += (uint32_t)(seqdiff-1);
+		}
+
+		m_havePlayed = true;
+		m_lastSeqNr = seqnr;
+		m_lastTimestamp = timestamp;
+		m_lastTimestampPos = pos;
+
+		return ring.GetNextPacket();
+	}
+}
+
+} // end namespace
+
@@ -0,0 +1,119 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpjitterbuffer.h
+ */
+
+#ifndef RTPJITTERBUFFER_H
+
+#define RTPJITTERBUFFER_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtptimeutilities.h"
+
+#define RTPJITTERBUFFER_DEFAULTJITTERMULTIPLIER						4.0
+#define RTPJITTERBUFFER_DEFAULTMINDELAY								0.010
+#define RTPJITTERBUFFER_DEFAULTMAXDELAY								0.500
+#define RTPJITTERBUFFER_TRANSITWINDOW								10.0
+#define RTPJITTERBUFFER_RESYNCTHRESHOLD								2.0
+
+namespace jrtplib
+{
+
+class RTPPacket;
+class RTPPacketRing;
+
+/** Determines when the queued RTP packets of a source should be played out.
+ *  This class determines the playout time of the packets which are queued in an RTPPacketRing.
+ *  The playout time of a packet is the time at which it was sent according to its RTP timestamp,
+ *  to which the smallest transit time of the recent packets and a target delay are added. The 
+ *  target delay is a multiple of the interarrival jitter estimate, limited to a minimum and 
+ *  maximum value, so that the buffering follows the actual network conditions. Packets that 
+ *  arrive after a packet with a higher sequence number has been played out are dropped, and 
+ *  the sequence numbers which are skipped when a packet is played out are reported as lost.
+ *  Normally, it is used through RTPSourceData::GetPlayoutPacket.
+ */
+class JRTPLIB_IMPORTEXPORT RTPJitterBuffer
+{
+public:
+	RTPJitterBuffer();
+
+	/** Sets the multiplier that's applied to the jitter estimate to obtain the target delay, and
+	 *  the limits for this delay. */
+	void SetParameters(double jittermultiplier, const RTPTime &mindelay, const RTPTime &maxdelay);
+
+	/** Returns the first packet in \c ring if its playout time has come, or 0 otherwise.
+	 *  Returns the first packet in \c ring if its playout time has come at time \c now, or 0 otherwise.
+	 *  The timestamp unit of the source is \c tsunit and \c jitter is the current interarrival jitter
+	 *  estimate, in timestamp units. If the timestamp unit is not known yet, the packets are returned
+	 *  immediately. If \c lost is not NULL, the number of packets which were skipped since the
+	 *  previously returned packet is stored in it.
+	 */
+	RTPPacket *GetPlayoutPacket(RTPPacketRing &ring, const RTPTime &now, double tsunit, uint32_t jitter, uint32_t *lost);
+
+	/** Returns the target delay which was used for the last packet. */
+	RTPTime GetTargetDelay() const										{ return RTPTime(m_targetDelay); }
+
+	/** Returns the number of packets which were dropped because they arrived too late. */
+	uint32_t GetNumberOfLatePackets() const								{ return m_numLate; }
+
+	/** Returns the number of packets which were skipped during playout. */
+	uint32_t GetNumberOfLostPackets() const								{ return m_numLost; }
+
+	/** Forgets the playout timing, which will be derived again from the next packet. */
+	void Reset();
+private:
+	double m_jitterMultiplier;
+	double m_minDelay, m_maxDelay;
+	double m_targetDelay;
+
+	bool m_havePlayed;
+	uint32_t m_lastSeqNr;
+	uint32_t m_lastTimestamp;
+	double m_lastTimestampPos;
+
+	// The minimum transit time is tracked over two windows of RTPJITTERBUFFER_TRANSITWINDOW
+	// seconds, so that it can follow a drifting clock
+	bool m_haveTransit;
+	double m_minTransit, m_prevMinTransit;
+	double m_windowStart;
+
+	uint32_t m_numLate;
+	uint32_t m_numLost;
+};
+
+} // end namespace
+
+#endif // RTPJITTERBUFFER_H
+
@@ -143,6 +143,45 @@
 /** Buffer that's used when encrypting a packet. */
 #define RTPMEM_TYPE_BUFFER_SRTPDATA								33
 
+/** Buffer used by the UDP transmitters to receive several datagrams at once. */
+#define RTPMEM_TYPE_BUFFER_RECEIVEBATCH							34
+
+/** Buffer to store an RTPUDPReceiveBatch instance. */
+#define RTPMEM_TYPE_CLASS_RTPUDPRECEIVEBATCH						35
+
+/** Buffer to store an RTPUDPSendBatch instance. */
+#define RTPMEM_TYPE_CLASS_RTPUDPSENDBATCH						36
+
+/** Buffer used as a receive slab by an RTPSlabPool instance. */
+#define RTPMEM_TYPE_BUFFER_RECEIVESLAB							37
+
+/** Buffer to store an RTPReceiveSlab instance. */
+#define RTPMEM_TYPE_CLASS_RTPRECEIVESLAB						38
+
+/** Buffer to store an RTPSlabPool instance. */
+#define RTPMEM_TYPE_CLASS_RTPSLABPOOL							39
+
+/** Buffer to store an RTPReactor worker thread. */
+#define RTPMEM_TYPE_CLASS_RTPREACTORWORKER						40
+
+/** Buffer to store the bookkeeping of a session registered with an RTPReactor. */
+#define RTPMEM_TYPE_CLASS_RTPREACTORSESSIONENTRY					41
+
+/** Buffer used by an RTPPacketRing instance to store the RTP packets of a source. */
+#define RTPMEM_TYPE_BUFFER_PACKETRING							42
+
+/** Buffer to store an SRTP receive context of an RTPSecureSession, including its worker thread. */
+#define RTPMEM_TYPE_CLASS_SRTPRECEIVESHARD						43
+
+/** Buffer to store an RTPUDPReceiveShards instance. */
+#define RTPMEM_TYPE_CLASS_RTPUDPRECEIVESHARDS					44
+
+/** Buffer to store a receive shard of an RTPUDPReceiveShards instance, including its thread. */
+#define RTPMEM_TYPE_CLASS_RTPUDPRECEIVESHARD						45
+
+/** Buffer to store the packet views of an RTCPCompoundPacket which doesn't fit in the inline array. */
+#define RTPMEM_TYPE_BUFFER_RTCPPACKETVIEWS						46
+
 namespace jrtplib
 {
 
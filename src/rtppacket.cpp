@@ -31,10 +31,12 @@
 */
 
 #include "rtppacket.h"
+#include "rtppacketview.h"
 #include "rtpstructs.h"
 #include "rtpdefines.h"
 #include "rtperrors.h"
 #include "rtprawpacket.h"
+#include "rtpslabpool.h"
 #ifdef RTP_SUPPORT_NETINET_IN
 	#include <netinet/in.h>
 #endif // RTP_SUPPORT_NETINET_IN
@@ -67,6 +69,7 @@ void RTPPacket::Clear()
 	extensionlength = 0;
 	error = 0;
 	externalbuffer = false;
+	slab = 0;
 }
 
 RTPPacket::RTPPacket(RTPRawPacket &rawpack,RTPMemoryManager *mgr) : RTPMemoryObject(mgr),receivetime(rawpack.GetReceiveTime())
@@ -75,6 +78,27 @@ RTPPacket::RTPPacket(RTPRawPacket &rawpack,RTPMemoryManager *mgr) : RTPMemoryObj
 	error = ParseRawPacket(rawpack);
 }
 
+RTPPacket::RTPPacket(const RTPPacketView &view,RTPRawPacket &rawpack,RTPMemoryManager *mgr) : RTPMemoryObject(mgr),receivetime(view.GetReceiveTime())
+{
+	Clear();
+	if (view.GetPacketData() == 0 || view.GetPacketData() != rawpack.GetData())
+		error = ERR_RTP_PACKET_INVALIDPACKET;
+	else
+		AdoptView(view,rawpack);
+}
+
+RTPPacket::RTPPacket(const RTPPacketView &view,RTPMemoryManager *mgr) : RTPMemoryObject(mgr),receivetime(view.GetReceiveTime())
+{
+	Clear();
+	if (view.GetPacketData() == 0)
+		error = ERR_RTP_PACKET_INVALIDPACKET;
+	else
+	{
+		SetFromView(view);
+		externalbuffer = true; // the data still belongs to the owner of the view
+	}
+}
+
 RTPPacket::RTPPacket(uint8_t payloadtype,const void *payloaddata,size_t payloadlen,uint16_t seqnr,
 		  uint32_t timestamp,uint32_t ssrc,bool gotmarker,uint8_t numcsrcs,const uint32_t *csrcs,
 		  bool gotextension,uint16_t extensionid,uint16_t extensionlen_numwords,const void *extensiondata,
@@ -100,108 +124,60 @@ RTPPacket::RTPPacket(uint8_t payloadtype,const void *payloaddata,size_t payloadl
 		                    csrcs,gotextension,extensionid,extensionlen_numwords,extensiondata,buffer,buffersize);
 }
 
+RTPPacket::~RTPPacket()
+{
+	if (slab) // the data was adopted from a receive slab
+		slab->Release();
+	else if (packet && !externalbuffer)
+		RTPDeleteByteArray(packet,GetMemoryManager());
+}
+
 int RTPPacket::ParseRawPacket(RTPRawPacket &rawpack)
 {
-	uint8_t *packetbytes;
-	size_t packetlen;
-	uint8_t payloadtype;
-	RTPHeader *rtpheader;
-	bool marker;
-	int csrccount;
-	bool hasextension;
-	int payloadoffset,payloadlength;
-	int numpadbytes;
-	RTPExtensionHeader *rtpextheader;
-	
-	if (!rawpack.IsRTP()) // If we didn't receive it on the RTP port, we'll ignore it
-		return ERR_RTP_PACKET_INVALIDPACKET;
-	
-	// The length should be at least the size of the RTP header
-	packetlen = rawpack.GetDataLength();
-	if (packetlen < sizeof(RTPHeader))
-		return ERR_RTP_PACKET_INVALIDPACKET;
-	
-	packetbytes = (uint8_t *)rawpack.GetData();
-	rtpheader = (RTPHeader *)packetbytes;
-	
-	// The version number should be correct
-	if (rtpheader->version != RTP_VERSION)
-		return ERR_RTP_PACKET_INVALIDPACKET;
-	
-	// We'll check if this is possibly a RTCP packet. For this to be possible
-	// the marker bit and payload type combined should be either an SR or RR
-	// identifier
-	marker = (rtpheader->marker == 0)?false:true;
-	payloadtype = rtpheader->payloadtype;
-	if (marker)
-	{
-		if (payloadtype == (RTP_RTCPTYPE_SR & 127)) // don't check high bit (this was the marker!!)
-			return ERR_RTP_PACKET_INVALIDPACKET;
-		if (payloadtype == (RTP_RTCPTYPE_RR & 127))
-			return ERR_RTP_PACKET_INVALIDPACKET;
-	}
+	RTPPacketView view;
+	int status;
 
-	csrccount = rtpheader->csrccount;
-	payloadoffset = sizeof(RTPHeader)+(int)(csrccount*sizeof(uint32_t));
-	
-	if (rtpheader->padding) // adjust payload length to take padding into account
-	{
-		numpadbytes = (int)packetbytes[packetlen-1]; // last byte contains number of padding bytes
-		if (numpadbytes <= 0)
-			return ERR_RTP_PACKET_INVALIDPACKET;
-	}
-	else
-		numpadbytes = 0;
+	if ((status = view.Parse(rawpack)) < 0)
+		return status;
 
-	hasextension = (rtpheader->extension == 0)?false:true;
-	if (hasextension) // got header extension
-	{
-		rtpextheader = (RTPExtensionHeader *)(packetbytes+payloadoffset);
-		payloadoffset += sizeof(RTPExtensionHeader);
-		
-		uint16_t exthdrlen = ntohs(rtpextheader->length);
-		payloadoffset += ((int)exthdrlen)*sizeof(uint32_t);
-	}
-	else
-	{
-		rtpextheader = 0;
-	}	
-	
-	payloadlength = packetlen-numpadbytes-payloadoffset;
-	if (payloadlength < 0)
-		return ERR_RTP_PACKET_INVALIDPACKET;
+	AdoptView(view,rawpack);
+	return 0;
+}
 
-	// Now, we've got a valid packet, so we can create a new instance of RTPPacket
-	// and fill in the members
-	
-	RTPPacket::hasextension = hasextension;
+void RTPPacket::SetFromView(const RTPPacketView &view)
+{
+	hasextension = view.HasExtension();
 	if (hasextension)
 	{
-		RTPPacket::extid = ntohs(rtpextheader->extid);
-		RTPPacket::extensionlength = ((int)ntohs(rtpextheader->length))*sizeof(uint32_t);
-		RTPPacket::extension = ((uint8_t *)rtpextheader)+sizeof(RTPExtensionHeader);
+		extid = view.GetExtensionID();
+		extensionlength = view.GetExtensionLength();
+		extension = view.GetExtensionData();
 	}
 
-	RTPPacket::hasmarker = marker;
-	RTPPacket::numcsrcs = csrccount;
-	RTPPacket::payloadtype = payloadtype;
-	
-	// Note: we don't fill in the EXTENDED sequence number here, since we
-	// don't have information about the source here. We just fill in the low
-	// 16 bits
-	RTPPacket::extseqnr = (uint32_t)ntohs(rtpheader->sequencenumber);
-
-	RTPPacket::timestamp = ntohl(rtpheader->timestamp);
-	RTPPacket::ssrc = ntohl(rtpheader->ssrc);
-	RTPPacket::packet = packetbytes;
-	RTPPacket::payload = packetbytes+payloadoffset;
-	RTPPacket::packetlength = packetlen;
-	RTPPacket::payloadlength = payloadlength;
+	hasmarker = view.HasMarker();
+	numcsrcs = view.GetCSRCCount();
+	payloadtype = view.GetPayloadType();
+	extseqnr = view.GetExtendedSequenceNumber();
+	timestamp = view.GetTimestamp();
+	ssrc = view.GetSSRC();
+	packet = view.GetPacketData();
+	payload = view.GetPayloadData();
+	packetlength = view.GetPacketLength();
+	payloadlength = view.GetPayloadLength();
+}
+
+void RTPPacket::AdoptView(const RTPPacketView &view,RTPRawPacket &rawpack)
+{
+	SetFromView(view);
+
+	// If the data is stored in a receive slab, we'll keep that slab alive
+	// instead of taking ownership of the data itself
+	slab = rawpack.GetDataSlab();
+	if (slab)
+		slab->AddReference();
 
 	// We'll zero the data of the raw packet, since we're using it here now!
 	rawpack.ZeroData();
-
-	return 0;
 }
 
 uint32_t RTPPacket::GetCSRC(int num) const
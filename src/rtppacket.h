@@ -47,6 +47,8 @@ namespace jrtplib
 {
 
 class RTPRawPacket;
+class RTPReceiveSlab;
+class RTPPacketView;
 
 /** Represents an RTP Packet.
  *  The RTPPacket class can be used to parse a RTPRawPacket instance if it represents RTP data. 
@@ -63,6 +65,20 @@ public:
 	 */
 	RTPPacket(RTPRawPacket &rawpack,RTPMemoryManager *mgr = 0);
 
+	/** Creates an RTPPacket instance from \c view, which must describe the data of \c rawpack.
+	 *  Creates an RTPPacket instance from \c view, which must describe the data of \c rawpack. The
+	 *  data is not parsed again, but like the constructor above, the data is moved from the raw
+	 *  packet to the RTPPacket instance.
+	 */
+	RTPPacket(const RTPPacketView &view,RTPRawPacket &rawpack,RTPMemoryManager *mgr = 0);
+
+	/** Creates an RTPPacket instance which refers to the data described by \c view.
+	 *  Creates an RTPPacket instance which refers to the data described by \c view. The data is
+	 *  neither copied nor owned by the new instance, so it must stay valid as long as the instance
+	 *  is used.
+	 */
+	RTPPacket(const RTPPacketView &view,RTPMemoryManager *mgr = 0);
+
 	/** Creates a new buffer for an RTP packet and fills in the fields according to the specified parameters. 
 	 *  Creates a new buffer for an RTP packet and fills in the fields according to the specified parameters.
 	 *  If \c maxpacksize is not equal to zero, an error is generated if the total packet size would exceed 
@@ -81,7 +97,7 @@ public:
 		  bool gotextension,uint16_t extensionid,uint16_t extensionlen_numwords,const void *extensiondata,
 		  void *buffer,size_t buffersize,RTPMemoryManager *mgr = 0);
 
-	virtual ~RTPPacket()																{ if (packet && !externalbuffer) RTPDeleteByteArray(packet,GetMemoryManager());  }
+	virtual ~RTPPacket();
 
 	/** If an error occurred in one of the constructors, this function returns the error code. */
 	int GetCreationError() const														{ return error; }
@@ -154,6 +170,8 @@ public:
 private:
 	void Clear();
 	int ParseRawPacket(RTPRawPacket &rawpack);
+	void SetFromView(const RTPPacketView &view);
+	void AdoptView(const RTPPacketView &view,RTPRawPacket &rawpack);
 	int BuildPacket(uint8_t payloadtype,const void *payloaddata,size_t payloadlen,uint16_t seqnr,
 	                uint32_t timestamp,uint32_t ssrc,bool gotmarker,uint8_t numcsrcs,const uint32_t *csrcs,
 	                bool gotextension,uint16_t extensionid,uint16_t extensionlen_numwords,const void *extensiondata,
@@ -174,6 +192,7 @@ private:
 	size_t extensionlength;
 
 	bool externalbuffer;
+	RTPReceiveSlab *slab;
 
 	RTPTime receivetime;
 };
@@ -34,8 +34,11 @@
 #include "rtperrors.h"
 #include "rtppacket.h"
 #include "rtpsources.h"
+#include "rtpstructs.h"
+#include "rtptransmitter.h"
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef RTPDEBUG
 	#include <iostream>
 #endif // RTPDEBUG
@@ -58,7 +61,7 @@ RTPPacketBuilder::~RTPPacketBuilder()
 	Destroy();
 }
 
-int RTPPacketBuilder::Init(size_t max)
+int RTPPacketBuilder::Init(size_t max, size_t reserve)
 {
 	if (init)
 		return ERR_RTP_PACKBUILD_ALREADYINIT;
@@ -66,10 +69,14 @@ int RTPPacketBuilder::Init(size_t max)
 		return ERR_RTP_PACKBUILD_INVALIDMAXPACKETSIZE;
 	
 	maxpacksize = max;
-	buffer = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKETBUILDERBUFFER) uint8_t [max];
+	trailerreserve = reserve;
+	buffer = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKETBUILDERBUFFER) uint8_t [max+reserve];
 	if (buffer == 0)
 		return ERR_RTP_OUTOFMEM;
 	packetlength = 0;
+	batchbuffer = 0;
+	batchbuffersize = 0;
+	batchsize = 0;
 	
 	CreateNewSSRC();
 
@@ -88,6 +95,11 @@ void RTPPacketBuilder::Destroy()
 	if (!init)
 		return;
 	RTPDeleteByteArray(buffer,GetMemoryManager());
+	if (batchbuffer)
+		RTPDeleteByteArray(batchbuffer,GetMemoryManager());
+	batchpackets.clear();
+	batchlengths.clear();
+	batchbuffersizes.clear();
 	init = false;
 }
 
@@ -97,7 +109,7 @@ int RTPPacketBuilder::SetMaximumPacketSize(size_t max)
 
 	if (max <= 0)
 		return ERR_RTP_PACKBUILD_INVALIDMAXPACKETSIZE;
-	newbuf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKETBUILDERBUFFER) uint8_t[max];
+	newbuf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKETBUILDERBUFFER) uint8_t[max+trailerreserve];
 	if (newbuf == 0)
 		return ERR_RTP_OUTOFMEM;
 	
@@ -235,18 +247,164 @@ int RTPPacketBuilder::BuildPacketEx(const void *data,size_t len,
 
 }
 
+int RTPPacketBuilder::BuildPacketHeader(size_t len)
+{
+	if (!init)
+		return ERR_RTP_PACKBUILD_NOTINIT;
+	if (!defptset)
+		return ERR_RTP_PACKBUILD_DEFAULTPAYLOADTYPENOTSET;
+	if (!defmarkset)
+		return ERR_RTP_PACKBUILD_DEFAULTMARKNOTSET;
+	if (!deftsset)
+		return ERR_RTP_PACKBUILD_DEFAULTTSINCNOTSET;
+	return PrivateBuildPacket(0,len,defaultpayloadtype,defaultmark,defaulttimestampinc,false,0,0,0,true);
+}
+
+int RTPPacketBuilder::BuildPacketHeader(size_t len,uint8_t pt,bool mark,uint32_t timestampinc)
+{
+	if (!init)
+		return ERR_RTP_PACKBUILD_NOTINIT;
+	return PrivateBuildPacket(0,len,pt,mark,timestampinc,false,0,0,0,true);
+}
+
 int RTPPacketBuilder::PrivateBuildPacket(const void *data,size_t len,
 	                  uint8_t pt,bool mark,uint32_t timestampinc,bool gotextension,
-	                  uint16_t hdrextID,const void *hdrextdata,size_t numhdrextwords)
+	                  uint16_t hdrextID,const void *hdrextdata,size_t numhdrextwords,
+	                  bool headeronly)
 {
-	RTPPacket p(pt,data,len,seqnr,timestamp,ssrc,mark,numcsrcs,csrcs,gotextension,hdrextID,
-	            (uint16_t)numhdrextwords,hdrextdata,buffer,maxpacksize,GetMemoryManager());
+	size_t maxsize = maxpacksize;
+	size_t hdrpayloadlen = len;
+
+	if (headeronly)
+	{
+		// Only the header is stored in the buffer, but it must still leave
+		// room for the payload that will follow it
+		if (len >= maxpacksize)
+			return ERR_RTP_PACKET_DATAEXCEEDSMAXSIZE;
+		maxsize = maxpacksize-len;
+		data = buffer;
+		hdrpayloadlen = 0;
+	}
+
+	RTPPacket p(pt,data,hdrpayloadlen,seqnr,timestamp,ssrc,mark,numcsrcs,csrcs,gotextension,hdrextID,
+	            (uint16_t)numhdrextwords,hdrextdata,buffer,maxsize,GetMemoryManager());
 	int status = p.GetCreationError();
 
 	if (status < 0)
 		return status;
 	packetlength = p.GetPacketLength();
 
+	UpdatePacketTime();
+	
+	numpayloadbytes += (uint32_t)len;
+	numpackets++;
+	timestamp += timestampinc;
+	seqnr++;
+
+	return 0;
+}
+
+int RTPPacketBuilder::BuildPacketBatch(const RTPIOVec *payloads,int num,bool markonlast,bool copypayloads)
+{
+	if (!init)
+		return ERR_RTP_PACKBUILD_NOTINIT;
+	if (!defptset)
+		return ERR_RTP_PACKBUILD_DEFAULTPAYLOADTYPENOTSET;
+	if (!deftsset)
+		return ERR_RTP_PACKBUILD_DEFAULTTSINCNOTSET;
+	return PrivateBuildPacketBatch(payloads,num,defaultpayloadtype,markonlast,defaulttimestampinc,copypayloads);
+}
+
+int RTPPacketBuilder::BuildPacketBatch(const RTPIOVec *payloads,int num,uint8_t pt,bool markonlast,uint32_t timestampinc,bool copypayloads)
+{
+	if (!init)
+		return ERR_RTP_PACKBUILD_NOTINIT;
+	return PrivateBuildPacketBatch(payloads,num,pt,markonlast,timestampinc,copypayloads);
+}
+
+int RTPPacketBuilder::PrivateBuildPacketBatch(const RTPIOVec *payloads,int num,uint8_t pt,bool markonlast,
+	                  uint32_t timestampinc,bool copypayloads)
+{
+	size_t hdrlen = sizeof(RTPHeader)+sizeof(uint32_t)*((size_t)numcsrcs);
+	size_t total = 0;
+	int i;
+
+	batchsize = 0;
+	if (num <= 0)
+		return 0;
+
+	// Check all sizes first, so that either the entire batch is built or
+	// nothing changes
+
+	for (i = 0 ; i < num ; i++)
+	{
+		if (hdrlen+payloads[i].len > maxpacksize)
+			return ERR_RTP_PACKET_DATAEXCEEDSMAXSIZE;
+		total += hdrlen;
+		if (copypayloads)
+			total += payloads[i].len+trailerreserve;
+	}
+
+	if (total > batchbuffersize)
+	{
+		uint8_t *newbuf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKETBUILDERBUFFER) uint8_t[total];
+		if (newbuf == 0)
+			return ERR_RTP_OUTOFMEM;
+		if (batchbuffer)
+			RTPDeleteByteArray(batchbuffer,GetMemoryManager());
+		batchbuffer = newbuf;
+		batchbuffersize = total;
+	}
+
+	if (batchpackets.size() < (size_t)num)
+	{
+		batchpackets.resize(num);
+		batchlengths.resize(num);
+		batchbuffersizes.resize(num);
+	}
+
+	uint8_t *pos = batchbuffer;
+	uint16_t seq = seqnr;
+
+	for (i = 0 ; i < num ; i++)
+	{
+		size_t len = payloads[i].len;
+		bool mark = (markonlast && i == num-1);
+		RTPPacket p(pt,pos,0,seq,timestamp,ssrc,mark,numcsrcs,csrcs,false,0,0,0,pos,maxpacksize-len,GetMemoryManager());
+		int status = p.GetCreationError();
+
+		if (status < 0) // can only fail for the first packet, as all headers use the same settings
+			return status;
+
+		batchpackets[i] = pos;
+		if (copypayloads)
+		{
+			if (len > 0)
+				memcpy(pos+hdrlen,payloads[i].data,len);
+			batchlengths[i] = hdrlen+len;
+			batchbuffersizes[i] = hdrlen+len+trailerreserve;
+		}
+		else
+		{
+			batchlengths[i] = hdrlen;
+			batchbuffersizes[i] = hdrlen;
+		}
+		pos += batchbuffersizes[i];
+		seq++;
+		numpayloadbytes += (uint32_t)len;
+	}
+
+	UpdatePacketTime();
+
+	batchsize = num;
+	numpackets += (uint32_t)num;
+	seqnr = seq;
+	timestamp += timestampinc;
+	return 0;
+}
+
+void RTPPacketBuilder::UpdatePacketTime()
+{
 	if (numpackets == 0) // first packet
 	{
 		lastwallclocktime = RTPTime::CurrentTime();
@@ -259,14 +417,6 @@ int RTPPacketBuilder::PrivateBuildPacket(const void *data,size_t len,
 		lastrtptimestamp = timestamp;
 		prevrtptimestamp = timestamp;
 	}
-	
-	numpayloadbytes += (uint32_t)p.GetPayloadLength();
-	numpackets++;
-	timestamp += timestampinc;
-	seqnr++;
-
-	return 0;
 }
 
 } // end namespace
-
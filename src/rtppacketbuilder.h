@@ -45,11 +45,13 @@
 #include "rtptimeutilities.h"
 #include "rtptypes.h"
 #include "rtpmemoryobject.h"
+#include <vector>
 
 namespace jrtplib
 {
 
 class RTPSources;
+struct RTPIOVec;
 
 /** This class can be used to build RTP packets and is a bit more high-level than the RTPPacket 
  *  class: it generates an SSRC identifier, keeps track of timestamp and sequence number etc.
@@ -64,8 +66,13 @@ public:
 	RTPPacketBuilder(RTPRandom &rtprand, RTPMemoryManager *mgr = 0);
 	~RTPPacketBuilder();
 
-	/** Initializes the builder to only allow packets with a size below \c maxpacksize. */
-	int Init(size_t maxpacksize);
+	/** Initializes the builder to only allow packets with a size below \c maxpacksize.
+	 *  Initializes the builder to only allow packets with a size below \c maxpacksize. If
+	 *  \c trailerreserve is non-zero, the internal packet buffer will be that many bytes larger
+	 *  than \c maxpacksize, so that a trailer (e.g. an SRTP authentication tag) can be appended
+	 *  to a built packet in place. The reserved space is never used by the builder itself.
+	 */
+	int Init(size_t maxpacksize, size_t trailerreserve = 0);
 
 	/** Cleans up the builder. */
 	void Destroy();
@@ -124,11 +131,63 @@ public:
 	                  uint8_t pt,bool mark,uint32_t timestampinc,
 	                  uint16_t hdrextID,const void *hdrextdata,size_t numhdrextwords);
 
+	/** Builds only the header of a packet which will have a payload length of \c len.
+	 *  Builds only the header of a packet which will have a payload length of \c len, using the
+	 *  default payload type, marker and timestamp increment. Afterwards, RTPPacketBuilder::GetPacket
+	 *  points to this header and RTPPacketBuilder::GetPacketLength returns the length of the header
+	 *  only; the payload itself must be appended (or sent along) by the caller. The sequence number,
+	 *  timestamp and packet/octet counts are updated as if the complete packet had been built.
+	 */
+	int BuildPacketHeader(size_t len);
+
+	/** Builds only the header of a packet which will have a payload length of \c len.
+	 *  Builds only the header of a packet which will have a payload length of \c len, using payload
+	 *  type \c pt and marker bit \c mark. After building this header, the timestamp will be
+	 *  incremented with \c timestampinc. See the other RTPPacketBuilder::BuildPacketHeader function
+	 *  for more information.
+	 */
+	int BuildPacketHeader(size_t len,uint8_t pt,bool mark,uint32_t timestampinc);
+
+	/** Builds a batch of \c numpackets packets, with payloads described by \c payloads, in one pass.
+	 *  Builds a batch of \c numpackets packets in one pass, the payload of the i-th packet being described by
+	 *  \c payloads[i]. All packets get the default payload type and the same timestamp, which is incremented
+	 *  with the default timestamp increment afterwards; if \c markonlast is set, the marker bit of the last
+	 *  packet is set. The headers are stored contiguously in a buffer that's kept between calls. If 
+	 *  \c copypayloads is \c true, each payload is copied behind its header and room for the trailer reserve
+	 *  is left behind each packet, otherwise the packets only contain the headers. The results can be
+	 *  obtained using RTPPacketBuilder::GetBatchPackets, RTPPacketBuilder::GetBatchPacketLengths and
+	 *  RTPPacketBuilder::GetBatchPacketBufferSizes.
+	 */
+	int BuildPacketBatch(const RTPIOVec *payloads,int numpackets,bool markonlast,bool copypayloads);
+
+	/** Builds a batch of \c numpackets packets, with payloads described by \c payloads, in one pass.
+	 *  Builds a batch of \c numpackets packets, using payload type \c pt and incrementing the timestamp
+	 *  with \c timestampinc after the batch has been built. See the other RTPPacketBuilder::BuildPacketBatch
+	 *  function for more information.
+	 */
+	int BuildPacketBatch(const RTPIOVec *payloads,int numpackets,uint8_t pt,bool markonlast,uint32_t timestampinc,bool copypayloads);
+
+	/** Returns the number of packets in the last built batch. */
+	int GetBatchSize() const					{ if (!init) return 0; return batchsize; }
+
+	/** Returns pointers to the packets of the last built batch. */
+	uint8_t **GetBatchPackets()					{ if (!init || batchsize == 0) return 0; return &(batchpackets[0]); }
+
+	/** Returns the lengths of the packets of the last built batch. */
+	size_t *GetBatchPacketLengths()					{ if (!init || batchsize == 0) return 0; return &(batchlengths[0]); }
+
+	/** Returns the sizes of the buffers of the packets of the last built batch. */
+	const size_t *GetBatchPacketBufferSizes() const			{ if (!init || batchsize == 0) return 0; return &(batchbuffersizes[0]); }
+
 	/** Returns a pointer to the last built RTP packet data. */
 	uint8_t *GetPacket()						{ if (!init) return 0; return buffer; }
 
 	/** Returns the size of the last built RTP packet. */
 	size_t GetPacketLength()					{ if (!init) return 0; return packetlength; }
+
+	/** Returns the total size of the buffer returned by RTPPacketBuilder::GetPacket, which
+	 *  includes the trailer reserve that was specified in RTPPacketBuilder::Init. */
+	size_t GetPacketBufferSize()				{ if (!init) return 0; return maxpacksize+trailerreserve; }
 	
 	/** Sets the default payload type to \c pt. */
 	int SetDefaultPayloadType(uint8_t pt);
@@ -195,12 +254,24 @@ public:
 private:
 	int PrivateBuildPacket(const void *data,size_t len,
 	                  uint8_t pt,bool mark,uint32_t timestampinc,bool gotextension,
-	                  uint16_t hdrextID = 0,const void *hdrextdata = 0,size_t numhdrextwords = 0);
+	                  uint16_t hdrextID = 0,const void *hdrextdata = 0,size_t numhdrextwords = 0,
+	                  bool headeronly = false);
+	int PrivateBuildPacketBatch(const RTPIOVec *payloads,int num,uint8_t pt,bool markonlast,
+	                  uint32_t timestampinc,bool copypayloads);
+	void UpdatePacketTime();
 
 	RTPRandom &rtprnd;	
 	size_t maxpacksize;
+	size_t trailerreserve;
 	uint8_t *buffer;
 	size_t packetlength;
+
+	uint8_t *batchbuffer;
+	size_t batchbuffersize;
+	int batchsize;
+	std::vector<uint8_t *> batchpackets;
+	std::vector<size_t> batchlengths;
+	std::vector<size_t> batchbuffersizes;
 	
 	uint32_t numpayloadbytes;
 	uint32_t numpackets;
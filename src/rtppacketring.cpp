@@ -0,0 +1,207 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtppacketring.h"
+#include "rtppacket.h"
+#include "rtpdefines.h"
+#include "rtperrors.h"
+#include <string.h>
+
+#include "rtpdebug.h"
+
+namespace jrtplib
+{
+
+RTPPacketRing::RTPPacketRing(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_pRing = 0;
+	m_depth = RTP_DEFAULTREORDERDEPTH;
+	m_reorder = true;
+	m_count = 0;
+	m_head = 0;
+	m_tail = 0;
+}
+
+RTPPacketRing::~RTPPacketRing()
+{
+	Clear();
+	if (m_pRing)
+		RTPDeleteByteArray((uint8_t *)m_pRing, GetMemoryManager());
+}
+
+void RTPPacketRing::SetParameters(size_t depth, bool reorder)
+{
+	Clear();
+	if (m_pRing)
+		RTPDeleteByteArray((uint8_t *)m_pRing, GetMemoryManager());
+	m_pRing = 0;
+
+	size_t d = 2;
+
+	while (d < depth && d < ((size_t)1 << 30))
+		d <<= 1;
+	m_depth = d;
+	m_reorder = reorder;
+}
+
+int RTPPacketRing::AddPacket(RTPPacket *pack, bool *stored)
+{
+	*stored = false;
+
+	// The ring itself is only allocated when it's needed, since many sources
+	// (e.g. receivers only) never store a packet
+	if (m_pRing == 0)
+	{
+		m_pRing = (RTPPacket **)RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_PACKETRING) uint8_t[m_depth*sizeof(RTPPacket *)];
+		if (m_pRing == 0)
+			return ERR_RTP_OUTOFMEM;
+		memset(m_pRing, 0, m_depth*sizeof(RTPPacket *));
+	}
+
+	if (!m_reorder)
+	{
+		if (m_count == m_depth) // make room by discarding the oldest packet
+			DeleteNextPacket();
+		m_pRing[GetIndex(m_tail)] = pack;
+		m_tail++;
+		m_count++;
+		*stored = true;
+		return 0;
+	}
+
+	uint32_t seqnr = pack->GetExtendedSequenceNumber();
+
+	if (m_count == 0)
+	{
+		m_head = seqnr;
+		m_tail = seqnr;
+	}
+	else
+	{
+		// A packet which was sent just before the sequence number wrapped around
+		// but which arrives after the wrap, can be assigned an extended sequence
+		// number in the next cycle; the position is therefore derived from the
+		// 16 bit distance to the most recent packet.
+		seqnr = m_tail + (uint32_t)(int32_t)(int16_t)(uint16_t)(seqnr - m_tail);
+	}
+
+	if ((int32_t)(seqnr - m_head) < 0) // older than all stored packets
+	{
+		if ((uint32_t)(m_tail - seqnr) > (uint32_t)m_depth) // doesn't fit anymore
+			return 0;
+		m_head = seqnr;
+	}
+	else if ((uint32_t)(seqnr - m_head) >= (uint32_t)m_depth) // beyond the current range
+	{
+		uint32_t newhead = seqnr - (uint32_t)m_depth + 1;
+
+		// Discard the packets which fall outside the new range; this can
+		// be at most m_depth slots
+		while (m_count > 0 && (int32_t)(newhead - m_head) > 0)
+		{
+			size_t idx = GetIndex(m_head);
+
+			if (m_pRing[idx])
+			{
+				RTPDelete(m_pRing[idx],GetMemoryManager());
+				m_pRing[idx] = 0;
+				m_count--;
+			}
+			m_head++;
+		}
+		m_head = (m_count == 0)?seqnr:newhead;
+		if (m_count == 0)
+			m_tail = seqnr;
+	}
+
+	size_t idx = GetIndex(seqnr);
+
+	if (m_pRing[idx] != 0) // duplicate packet
+		return 0;
+
+	m_pRing[idx] = pack;
+	m_count++;
+	if ((int32_t)(seqnr - m_tail) >= 0)
+		m_tail = seqnr + 1;
+	*stored = true;
+	return 0;
+}
+
+void RTPPacketRing::AdvanceToNextPacket()
+{
+	while (m_pRing[GetIndex(m_head)] == 0)
+		m_head++;
+}
+
+RTPPacket *RTPPacketRing::GetNextPacket()
+{
+	if (m_count == 0)
+		return 0;
+
+	AdvanceToNextPacket();
+
+	size_t idx = GetIndex(m_head);
+	RTPPacket *pack = m_pRing[idx];
+
+	m_pRing[idx] = 0;
+	m_head++;
+	m_count--;
+	return pack;
+}
+
+RTPPacket *RTPPacketRing::PeekNextPacket()
+{
+	if (m_count == 0)
+		return 0;
+
+	AdvanceToNextPacket();
+	return m_pRing[GetIndex(m_head)];
+}
+
+void RTPPacketRing::DeleteNextPacket()
+{
+	RTPPacket *pack = GetNextPacket();
+
+	if (pack)
+		RTPDelete(pack,GetMemoryManager());
+}
+
+void RTPPacketRing::Clear()
+{
+	while (m_count > 0)
+		DeleteNextPacket();
+	m_head = 0;
+	m_tail = 0;
+}
+
+} // end namespace
+
@@ -0,0 +1,122 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtppacketring.h
+ */
+
+#ifndef RTPPACKETRING_H
+
+#define RTPPACKETRING_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtpmemoryobject.h"
+#include <stddef.h>
+
+namespace jrtplib
+{
+
+class RTPPacket;
+
+/** Queue of the RTP packets which were received from a single source.
+ *  This class stores the RTP packets of a source in a ring buffer which is indexed by
+ *  extended sequence number, so that storing a packet, detecting a duplicate and
+ *  retrieving the packets in order of their sequence numbers are all constant time
+ *  operations. The depth of the ring determines the range of sequence numbers which
+ *  can be pending at the same time: when a packet arrives which lies beyond this
+ *  range, the oldest packets are discarded to make room for it, and a packet which
+ *  is older than this range is rejected. Alternatively, the reordering can be turned
+ *  off, in which case the packets are simply kept in the order in which they arrived
+ *  and no duplicates are detected; this can be useful for applications which perform
+ *  their own jitter buffering. The packets which are still stored when the instance is
+ *  destroyed are deleted.
+ */
+class JRTPLIB_IMPORTEXPORT RTPPacketRing : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPPacketRing)
+public:
+	RTPPacketRing(RTPMemoryManager *mgr = 0);
+	~RTPPacketRing();
+
+	/** Sets the number of packets that can be stored to \c depth (rounded up to a power of two)
+	 *  and specifies if the packets should be reordered or not; any stored packets are deleted. */
+	void SetParameters(size_t depth, bool reorder);
+
+	/** Returns the number of packets that can be stored. */
+	size_t GetDepth() const											{ return m_depth; }
+
+	/** Returns \c true if the packets are ordered by sequence number. */
+	bool IsReordering() const										{ return m_reorder; }
+
+	/** Stores \c pack in the ring.
+	 *  Stores \c pack in the ring; the flag \c stored indicates if this actually happened. If
+	 *  it's \c false, the packet was a duplicate or was too old, and the caller is still responsible 
+	 *  for deleting it. 
+	 */
+	int AddPacket(RTPPacket *pack, bool *stored);
+
+	/** Removes the first packet from the ring and returns it, or returns 0 if the ring is empty. */
+	RTPPacket *GetNextPacket();
+
+	/** Returns the first packet in the ring without removing it, or 0 if the ring is empty. */
+	RTPPacket *PeekNextPacket();
+
+	/** Deletes the first packet in the ring. */
+	void DeleteNextPacket();
+
+	/** Returns \c true if no packets are stored. */
+	bool IsEmpty() const											{ return m_count == 0; }
+
+	/** Returns the number of packets that are stored. */
+	size_t GetPacketCount() const									{ return m_count; }
+
+	/** Deletes all stored packets. */
+	void Clear();
+private:
+	size_t GetIndex(uint32_t pos) const								{ return (size_t)(pos & (uint32_t)(m_depth-1)); }
+	void AdvanceToNextPacket();
+	
+	RTPPacket **m_pRing;
+	size_t m_depth;
+	bool m_reorder;
+	size_t m_count;
+	// In reorder mode these are extended sequence numbers, otherwise these count
+	// the packets that were added and removed. Only slots in [m_head, m_tail)
+	// can contain a packet.
+	uint32_t m_head, m_tail;
+};
+
+} // end namespace
+
+#endif // RTPPACKETRING_H
+
@@ -0,0 +1,166 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtppacketview.h"
+#include "rtprawpacket.h"
+#include "rtpstructs.h"
+#include "rtpdefines.h"
+#include "rtperrors.h"
+#ifdef RTP_SUPPORT_NETINET_IN
+	#include <netinet/in.h>
+#endif // RTP_SUPPORT_NETINET_IN
+
+#include "rtpdebug.h"
+
+namespace jrtplib
+{
+
+RTPPacketView::RTPPacketView() : m_receiveTime(0,0)
+{
+	m_pData = 0;
+	m_packetLength = 0;
+	m_payloadOffset = 0;
+	m_payloadLength = 0;
+	m_extensionOffset = 0;
+	m_extensionLength = 0;
+	m_extSeqNr = 0;
+	m_timestamp = 0;
+	m_ssrc = 0;
+	m_extID = 0;
+	m_payloadType = 0;
+	m_numCSRCs = 0;
+	m_hasMarker = false;
+	m_hasExtension = false;
+}
+
+int RTPPacketView::Parse(RTPRawPacket &rawpack)
+{
+	if (!rawpack.IsRTP()) // If we didn't receive it on the RTP port, we'll ignore it
+		return ERR_RTP_PACKET_INVALIDPACKET;
+
+	return Parse(rawpack.GetData(), rawpack.GetDataLength(), rawpack.GetReceiveTime());
+}
+
+int RTPPacketView::Parse(uint8_t *data, size_t len, const RTPTime &receivetime)
+{
+	// The length should be at least the size of the RTP header
+	if (data == 0 || len < sizeof(RTPHeader))
+		return ERR_RTP_PACKET_INVALIDPACKET;
+
+	RTPHeader *rtpheader = (RTPHeader *)data;
+
+	// The version number should be correct
+	if (rtpheader->version != RTP_VERSION)
+		return ERR_RTP_PACKET_INVALIDPACKET;
+
+	// We'll check if this is possibly a RTCP packet. For this to be possible
+	// the marker bit and payload type combined should be either an SR or RR
+	// identifier
+	bool marker = (rtpheader->marker == 0)?false:true;
+	uint8_t payloadtype = rtpheader->payloadtype;
+	if (marker)
+	{
+		if (payloadtype == (RTP_RTCPTYPE_SR & 127)) // don't check high bit (this was the marker!!)
+			return ERR_RTP_PACKET_INVALIDPACKET;
+		if (payloadtype == (RTP_RTCPTYPE_RR & 127))
+			return ERR_RTP_PACKET_INVALIDPACKET;
+	}
+
+	int csrccount = rtpheader->csrccount;
+	size_t payloadoffset = sizeof(RTPHeader)+(size_t)csrccount*sizeof(uint32_t);
+	size_t numpadbytes = 0;
+
+	if (rtpheader->padding) // adjust payload length to take padding into account
+	{
+		numpadbytes = (size_t)data[len-1]; // last byte contains number of padding bytes
+		if (numpadbytes == 0)
+			return ERR_RTP_PACKET_INVALIDPACKET;
+	}
+
+	bool hasextension = (rtpheader->extension == 0)?false:true;
+	uint16_t extid = 0;
+	size_t extensionoffset = 0;
+	size_t extensionlength = 0;
+
+	if (hasextension) // got header extension
+	{
+		// Make sure the extension header itself is inside the packet
+		if (payloadoffset+sizeof(RTPExtensionHeader) > len)
+			return ERR_RTP_PACKET_INVALIDPACKET;
+
+		RTPExtensionHeader *rtpextheader = (RTPExtensionHeader *)(data+payloadoffset);
+
+		extid = ntohs(rtpextheader->extid);
+		extensionlength = ((size_t)ntohs(rtpextheader->length))*sizeof(uint32_t);
+		extensionoffset = payloadoffset+sizeof(RTPExtensionHeader);
+		payloadoffset = extensionoffset+extensionlength;
+	}
+
+	if (payloadoffset+numpadbytes > len)
+		return ERR_RTP_PACKET_INVALIDPACKET;
+
+	// Now, we've got a valid packet and we can fill in the members
+
+	m_pData = data;
+	m_packetLength = len;
+	m_payloadOffset = payloadoffset;
+	m_payloadLength = len-numpadbytes-payloadoffset;
+	m_extensionOffset = extensionoffset;
+	m_extensionLength = extensionlength;
+
+	// Note: we don't fill in the EXTENDED sequence number here, since we
+	// don't have information about the source here. We just fill in the low
+	// 16 bits
+	m_extSeqNr = (uint32_t)ntohs(rtpheader->sequencenumber);
+	m_timestamp = ntohl(rtpheader->timestamp);
+	m_ssrc = ntohl(rtpheader->ssrc);
+	m_extID = extid;
+	m_payloadType = payloadtype;
+	m_numCSRCs = (uint8_t)csrccount;
+	m_hasMarker = marker;
+	m_hasExtension = hasextension;
+	m_receiveTime = receivetime;
+
+	return 0;
+}
+
+uint32_t RTPPacketView::GetCSRC(int num) const
+{
+	if (num < 0 || num >= (int)m_numCSRCs)
+		return 0;
+
+	uint32_t *csrcval_nbo = (uint32_t *)(m_pData+sizeof(RTPHeader)+num*sizeof(uint32_t));
+	return ntohl(*csrcval_nbo);
+}
+
+} // end namespace
+
@@ -0,0 +1,153 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtppacketview.h
+ */
+
+#ifndef RTPPACKETVIEW_H
+
+#define RTPPACKETVIEW_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtptimeutilities.h"
+#include <stddef.h>
+
+namespace jrtplib
+{
+
+class RTPRawPacket;
+
+/** Non-owning, parsed representation of an RTP packet.
+ *  An RTPPacketView describes an RTP packet which is stored in a buffer owned by someone else,
+ *  typically an RTPRawPacket. It only contains a pointer to that buffer, the values of the
+ *  header fields and the offsets of the extension and payload data, so it can be created
+ *  on the stack and copied freely without allocating any memory. The view is only valid as
+ *  long as the buffer it refers to is. When an RTPPacket instance needs to be stored, it can
+ *  be created from the view without parsing the data a second time.
+ */
+class JRTPLIB_IMPORTEXPORT RTPPacketView
+{
+public:
+	/** Creates an empty view. */
+	RTPPacketView();
+
+	/** Parses the \c len bytes in \c data as an RTP packet which was received at \c receivetime.
+	 *  Parses the \c len bytes in \c data as an RTP packet which was received at \c receivetime.
+	 *  If the data does not describe a valid RTP packet, ERR_RTP_PACKET_INVALIDPACKET is
+	 *  returned. The data itself is not copied.
+	 */
+	int Parse(uint8_t *data, size_t len, const RTPTime &receivetime);
+
+	/** Parses the data of \c rawpack, which must have been received on the RTP channel. */
+	int Parse(RTPRawPacket &rawpack);
+
+	/** Returns \c true if the RTP packet has a header extension and \c false otherwise. */
+	bool HasExtension() const														{ return m_hasExtension; }
+
+	/** Returns \c true if the marker bit was set and \c false otherwise. */
+	bool HasMarker() const															{ return m_hasMarker; }
+
+	/** Returns the number of CSRCs contained in this packet. */
+	int GetCSRCCount() const														{ return m_numCSRCs; }
+
+	/** Returns a specific CSRC identifier; \c num can go from 0 to GetCSRCCount()-1. */
+	uint32_t GetCSRC(int num) const;
+
+	/** Returns the payload type of the packet. */
+	uint8_t GetPayloadType() const													{ return m_payloadType; }
+
+	/** Returns the extended sequence number of the packet.
+	 *  Returns the extended sequence number of the packet. Right after parsing, only the low
+	 *  16 bits will be set; the high 16 bits are filled in when the packet is validated.
+	 */
+	uint32_t GetExtendedSequenceNumber() const										{ return m_extSeqNr; }
+
+	/** Returns the sequence number of this packet. */
+	uint16_t GetSequenceNumber() const												{ return (uint16_t)(m_extSeqNr&0x0000FFFF); }
+
+	/** Sets the extended sequence number of this packet to \c seq. */
+	void SetExtendedSequenceNumber(uint32_t seq)									{ m_extSeqNr = seq; }
+
+	/** Returns the timestamp of this packet. */
+	uint32_t GetTimestamp() const													{ return m_timestamp; }
+
+	/** Returns the SSRC identifier stored in this packet. */
+	uint32_t GetSSRC() const														{ return m_ssrc; }
+
+	/** Returns a pointer to the data of the entire packet. */
+	uint8_t *GetPacketData() const													{ return m_pData; }
+
+	/** Returns the length of the entire packet. */
+	size_t GetPacketLength() const													{ return m_packetLength; }
+
+	/** Returns the offset of the payload data in the packet. */
+	size_t GetPayloadOffset() const													{ return m_payloadOffset; }
+
+	/** Returns a pointer to the actual payload data. */
+	uint8_t *GetPayloadData() const													{ return m_pData+m_payloadOffset; }
+
+	/** Returns the payload length. */
+	size_t GetPayloadLength() const													{ return m_payloadLength; }
+
+	/** If a header extension is present, this function returns the extension identifier. */
+	uint16_t GetExtensionID() const													{ return m_extID; }
+
+	/** Returns the offset of the header extension data in the packet. */
+	size_t GetExtensionOffset() const												{ return m_extensionOffset; }
+
+	/** Returns a pointer to the header extension data, or null if there is none. */
+	uint8_t *GetExtensionData() const												{ return (m_hasExtension)?(m_pData+m_extensionOffset):0; }
+
+	/** Returns the length of the header extension data. */
+	size_t GetExtensionLength() const												{ return m_extensionLength; }
+
+	/** Returns the time at which this packet was received. */
+	RTPTime GetReceiveTime() const													{ return m_receiveTime; }
+private:
+	uint8_t *m_pData;
+	size_t m_packetLength;
+	size_t m_payloadOffset, m_payloadLength;
+	size_t m_extensionOffset, m_extensionLength;
+	uint32_t m_extSeqNr, m_timestamp, m_ssrc;
+	uint16_t m_extID;
+	uint8_t m_payloadType;
+	uint8_t m_numCSRCs;
+	bool m_hasMarker, m_hasExtension;
+	RTPTime m_receiveTime;
+};
+
+} // end namespace
+
+#endif // RTPPACKETVIEW_H
+
@@ -58,6 +58,27 @@ RTPPollThread::~RTPPollThread()
 	Stop();
 }
  
+void RTPWaitForThreadStop(jthread::JThread &thread,const char *owner,const char *threadname)
+{
+	RTPTime thetime = RTPTime::CurrentTime();
+	bool done = false;
+
+	while (thread.IsRunning() && !done)
+	{
+		// wait max 5 sec
+		RTPTime curtime = RTPTime::CurrentTime();
+		if ((curtime.GetDouble()-thetime.GetDouble()) > 5.0)
+			done = true;
+		RTPTime::Wait(RTPTime(0,10000));
+	}
+
+	if (thread.IsRunning())
+	{
+		std::cerr << owner << ": Warning! Having to kill " << threadname << "!" << std::endl;
+		thread.Kill();
+	}
+}
+
 int RTPPollThread::Start(RTPTransmitter *trans)
 {
 	if (JThread::IsRunning())
@@ -87,23 +108,7 @@ void RTPPollThread::Stop()
 	if (transmitter)
 		transmitter->AbortWait();
 	
-	RTPTime thetime = RTPTime::CurrentTime();
-	bool done = false;
-
-	while (JThread::IsRunning() && !done)
-	{
-		// wait max 5 sec
-		RTPTime curtime = RTPTime::CurrentTime();
-		if ((curtime.GetDouble()-thetime.GetDouble()) > 5.0)
-			done = true;
-		RTPTime::Wait(RTPTime(0,10000));
-	}
-
-	if (JThread::IsRunning())
-	{
-		std::cerr << "RTPPollThread: Warning! Having to kill thread!" << std::endl;
-		JThread::Kill();
-	}
+	RTPWaitForThreadStop(*this,"RTPPollThread","thread");
 	stop = false;
 	transmitter = 0;
 }
@@ -73,6 +73,12 @@ private:
 	RTCPScheduler &rtcpsched;
 };
 
+/** Waits at most five seconds for \c thread to stop, and kills it if it's still running after that.
+ *  Waits at most five seconds for \c thread to stop, and kills it if it's still running after that.
+ *  In that case a warning is printed, which mentions \c owner and \c threadname.
+ */
+void JRTPLIB_IMPORTEXPORT RTPWaitForThreadStop(jthread::JThread &thread,const char *owner,const char *threadname);
+
 } // end namespace
 
 #endif // RTP_SUPPORT_THREAD
@@ -0,0 +1,521 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtppoolmemorymanager.h"
+#include "rtperrors.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtpdebug.h"
+
+// Every block starts with a header that describes it, the size of this header is
+// chosen so that the memory that's handed out keeps the alignment of 'malloc'
+#define RTPPOOLMEMMGR_HEADERSIZE								16
+#define RTPPOOLMEMMGR_LARGEBLOCK								-1
+
+#if defined(RTP_HAVE_PTHREAD_KEY) && defined(RTP_HAVE_SYNC_BUILTINS)
+	#define RTPPOOLMEMMGR_THREADCACHES
+#endif // RTP_HAVE_PTHREAD_KEY && RTP_HAVE_SYNC_BUILTINS
+
+namespace jrtplib
+{
+
+struct RTPPoolMemoryBlockHeader
+{
+	int32_t sizeclass;
+	int32_t memtype;
+	size_t numbytes;
+};
+
+// Compile time check that the header fits in the reserved space
+typedef char RTPPoolMemoryBlockHeaderCheck[(sizeof(RTPPoolMemoryBlockHeader) <= RTPPOOLMEMMGR_HEADERSIZE)?1:-1];
+
+RTPPoolMemoryManager::RTPPoolMemoryManager()
+{
+	// Until Init is called, the manager can be used from a single thread
+	m_init = false;
+	m_threadsafe = false;
+	m_keepStatistics = true;
+	m_useThreadCaches = false;
+	m_cacheSize = RTPPOOLMEMMGR_DEFAULTCACHESIZE;
+
+	for (int i = 0 ; i < RTPPOOLMEMMGR_NUMSIZECLASSES ; i++)
+		m_pGlobalFreeBlocks[i] = 0;
+	memset(m_statistics, 0, sizeof(m_statistics));
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	m_pThreadCaches = 0;
+#endif // RTPPOOLMEMMGR_THREADCACHES
+}
+
+RTPPoolMemoryManager::~RTPPoolMemoryManager()
+{
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	if (m_useThreadCaches)
+	{
+		pthread_key_delete(m_cacheKey);
+
+		ThreadCache *cache = m_pThreadCaches;
+		while (cache)
+		{
+			ThreadCache *next = cache->m_pNext;
+
+			for (int i = 0 ; i < RTPPOOLMEMMGR_NUMSIZECLASSES ; i++)
+			{
+				uint8_t *block = cache->m_pFreeBlocks[i];
+				while (block)
+				{
+					uint8_t *nextblock = NextBlock(block);
+					free(block);
+					block = nextblock;
+				}
+			}
+			free(cache);
+			cache = next;
+		}
+		m_pThreadCaches = 0;
+	}
+#endif // RTPPOOLMEMMGR_THREADCACHES
+	ClearFreeBlocks();
+}
+
+int RTPPoolMemoryManager::Init(bool threadsafe, bool keepstatistics, size_t cachesize)
+{
+	if (m_init)
+		return ERR_RTP_POOLMEMMGR_ALREADYINIT;
+
+	m_useThreadCaches = false;
+	if (threadsafe)
+	{
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+		if (pthread_key_create(&m_cacheKey, ThreadCacheDestructor) == 0)
+			m_useThreadCaches = true;
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+		if (!m_useThreadCaches) // fall back to a mutex for the global free lists
+		{
+#ifdef RTP_SUPPORT_THREAD
+			if (m_mutex.Init() < 0)
+				return ERR_RTP_POOLMEMMGR_CANTINITMUTEX;
+#else
+			return ERR_RTP_NOTHREADSUPPORT;
+#endif // RTP_SUPPORT_THREAD
+		}
+	}
+
+	m_threadsafe = threadsafe;
+	m_keepStatistics = keepstatistics;
+	m_cacheSize = (cachesize < 2)?2:cachesize;
+	m_init = true;
+	return 0;
+}
+
+void *RTPPoolMemoryManager::AllocateBuffer(size_t numbytes, int memtype)
+{
+	int sizeclass = GetSizeClass(numbytes);
+	uint8_t *block;
+
+	if (sizeclass == RTPPOOLMEMMGR_LARGEBLOCK)
+		block = (uint8_t *)malloc(RTPPOOLMEMMGR_HEADERSIZE + numbytes);
+	else
+		block = AllocateBlock(sizeclass);
+
+	if (block == 0)
+		return 0;
+
+	RTPPoolMemoryBlockHeader *hdr = (RTPPoolMemoryBlockHeader *)block;
+	hdr->sizeclass = sizeclass;
+	hdr->memtype = memtype;
+	hdr->numbytes = numbytes;
+
+	UpdateStatistics(memtype, numbytes, true);
+	return block + RTPPOOLMEMMGR_HEADERSIZE;
+}
+
+void RTPPoolMemoryManager::FreeBuffer(void *buffer)
+{
+	if (buffer == 0)
+		return;
+
+	uint8_t *block = ((uint8_t *)buffer) - RTPPOOLMEMMGR_HEADERSIZE;
+	RTPPoolMemoryBlockHeader *hdr = (RTPPoolMemoryBlockHeader *)block;
+
+	UpdateStatistics(hdr->memtype, hdr->numbytes, false);
+
+	if (hdr->sizeclass == RTPPOOLMEMMGR_LARGEBLOCK)
+		free(block);
+	else
+		ReleaseBlock(block, hdr->sizeclass);
+}
+
+bool RTPPoolMemoryManager::GetStatistics(int memtype, RTPPoolMemoryStatistics &stats) const
+{
+	if (!m_keepStatistics)
+		return false;
+	if (memtype < 0 || memtype >= RTPPOOLMEMMGR_MAXMEMTYPES)
+		memtype = RTPPOOLMEMMGR_MAXMEMTYPES;
+
+	stats = m_statistics[memtype];
+	return true;
+}
+
+bool RTPPoolMemoryManager::GetTotalStatistics(RTPPoolMemoryStatistics &stats) const
+{
+	if (!m_keepStatistics)
+		return false;
+
+	stats = m_statistics[RTPPOOLMEMMGR_MAXMEMTYPES+1];
+	return true;
+}
+
+void RTPPoolMemoryManager::ResetHighWaterMarks()
+{
+	Lock();
+	for (int i = 0 ; i < RTPPOOLMEMMGR_MAXMEMTYPES+2 ; i++)
+	{
+		m_statistics[i].maxblocksinuse = m_statistics[i].blocksinuse;
+		m_statistics[i].maxbytesinuse = m_statistics[i].bytesinuse;
+	}
+	Unlock();
+}
+
+size_t RTPPoolMemoryManager::GetSizeClassSize(int idx)
+{
+	// The sizes alternate between powers of two and one and a half times a
+	// power of two: 32, 48, 64, 96, 128, ..., 49152, 65536
+	if (idx&1)
+		return ((size_t)48) << (idx/2);
+	return ((size_t)32) << (idx/2);
+}
+
+int RTPPoolMemoryManager::GetSizeClass(size_t numbytes)
+{
+	if (numbytes <= 32)
+		return 0;
+	if (numbytes > GetSizeClassSize(RTPPOOLMEMMGR_NUMSIZECLASSES-1))
+		return RTPPOOLMEMMGR_LARGEBLOCK;
+
+	// numbytes lies in the interval ]2^k, 2^(k+1)]
+	size_t m = numbytes-1;
+	int k = 0;
+
+	while (m >>= 1)
+		k++;
+
+	if (numbytes <= (((size_t)3) << (k-1)))
+		return 2*(k-4)-1;
+	return 2*(k-4);
+}
+
+uint8_t *&RTPPoolMemoryManager::NextBlock(uint8_t *block)
+{
+	// A block on a free list stores the pointer to the next one right after its header
+	return *((uint8_t **)(block + RTPPOOLMEMMGR_HEADERSIZE));
+}
+
+uint8_t *RTPPoolMemoryManager::AllocateBlock(int sizeclass)
+{
+	uint8_t *block = 0;
+
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	if (m_useThreadCaches)
+	{
+		ThreadCache *cache = GetThreadCache();
+		if (cache)
+		{
+			block = cache->m_pFreeBlocks[sizeclass];
+			if (block == 0)
+			{
+				// Refill the cache by taking the entire global list at once; unlike
+				// removing a single element, this can't suffer from the ABA problem
+				block = __sync_lock_test_and_set(&m_pGlobalFreeBlocks[sizeclass], (uint8_t *)0);
+
+				size_t num = 0;
+				for (uint8_t *b = block ; b != 0 ; b = NextBlock(b))
+					num++;
+				cache->m_numFreeBlocks[sizeclass] = num;
+			}
+
+			if (block)
+			{
+				cache->m_pFreeBlocks[sizeclass] = NextBlock(block);
+				cache->m_numFreeBlocks[sizeclass]--;
+				return block;
+			}
+		}
+	}
+	else
+#endif // RTPPOOLMEMMGR_THREADCACHES
+	{
+		Lock();
+		block = m_pGlobalFreeBlocks[sizeclass];
+		if (block)
+			m_pGlobalFreeBlocks[sizeclass] = NextBlock(block);
+		Unlock();
+
+		if (block)
+			return block;
+	}
+
+	return (uint8_t *)malloc(RTPPOOLMEMMGR_HEADERSIZE + GetSizeClassSize(sizeclass));
+}
+
+void RTPPoolMemoryManager::ReleaseBlock(uint8_t *block, int sizeclass)
+{
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	if (m_useThreadCaches)
+	{
+		ThreadCache *cache = GetThreadCache();
+		if (cache)
+		{
+			NextBlock(block) = cache->m_pFreeBlocks[sizeclass];
+			cache->m_pFreeBlocks[sizeclass] = block;
+			cache->m_numFreeBlocks[sizeclass]++;
+
+			if (cache->m_numFreeBlocks[sizeclass] > m_cacheSize)
+				FlushThreadCache(cache, sizeclass, m_cacheSize/2);
+		}
+		else // no cache available for this thread, push the block onto the global list
+		{
+			uint8_t *head;
+
+			do
+			{
+				head = m_pGlobalFreeBlocks[sizeclass];
+				NextBlock(block) = head;
+			} while (!__sync_bool_compare_and_swap(&m_pGlobalFreeBlocks[sizeclass], head, block));
+		}
+		return;
+	}
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+	Lock();
+	NextBlock(block) = m_pGlobalFreeBlocks[sizeclass];
+	m_pGlobalFreeBlocks[sizeclass] = block;
+	Unlock();
+}
+
+void RTPPoolMemoryManager::ClearFreeBlocks()
+{
+	for (int i = 0 ; i < RTPPOOLMEMMGR_NUMSIZECLASSES ; i++)
+	{
+		uint8_t *block = m_pGlobalFreeBlocks[i];
+		while (block)
+		{
+			uint8_t *next = NextBlock(block);
+			free(block);
+			block = next;
+		}
+		m_pGlobalFreeBlocks[i] = 0;
+	}
+}
+
+void RTPPoolMemoryManager::UpdateStatistics(int memtype, size_t numbytes, bool allocated)
+{
+	if (!m_keepStatistics)
+		return;
+	if (memtype < 0 || memtype >= RTPPOOLMEMMGR_MAXMEMTYPES)
+		memtype = RTPPOOLMEMMGR_MAXMEMTYPES;
+
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	if (m_useThreadCaches) // the counters are updated atomically
+	{
+		UpdateStatistics(m_statistics[memtype], numbytes, allocated);
+		UpdateStatistics(m_statistics[RTPPOOLMEMMGR_MAXMEMTYPES+1], numbytes, allocated);
+		return;
+	}
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+	Lock();
+	UpdateStatistics(m_statistics[memtype], numbytes, allocated);
+	UpdateStatistics(m_statistics[RTPPOOLMEMMGR_MAXMEMTYPES+1], numbytes, allocated);
+	Unlock();
+}
+
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+inline static void RTPPoolMemoryManager_UpdateMaximum(size_t *maxvalue, size_t value)
+{
+	size_t cur;
+
+	while ((cur = *((volatile size_t *)maxvalue)) < value && !__sync_bool_compare_and_swap(maxvalue, cur, value))
+		;
+}
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+void RTPPoolMemoryManager::UpdateStatistics(RTPPoolMemoryStatistics &stats, size_t numbytes, bool allocated)
+{
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+	if (m_useThreadCaches)
+	{
+		if (allocated)
+		{
+			__sync_fetch_and_add(&stats.numallocations, 1);
+			RTPPoolMemoryManager_UpdateMaximum(&stats.maxblocksinuse, __sync_add_and_fetch(&stats.blocksinuse, 1));
+			RTPPoolMemoryManager_UpdateMaximum(&stats.maxbytesinuse, __sync_add_and_fetch(&stats.bytesinuse, numbytes));
+		}
+		else
+		{
+			__sync_fetch_and_sub(&stats.blocksinuse, 1);
+			__sync_fetch_and_sub(&stats.bytesinuse, numbytes);
+		}
+		return;
+	}
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+	if (allocated)
+	{
+		stats.numallocations++;
+		stats.blocksinuse++;
+		stats.bytesinuse += numbytes;
+		if (stats.blocksinuse > stats.maxblocksinuse)
+			stats.maxblocksinuse = stats.blocksinuse;
+		if (stats.bytesinuse > stats.maxbytesinuse)
+			stats.maxbytesinuse = stats.bytesinuse;
+	}
+	else
+	{
+		stats.blocksinuse--;
+		stats.bytesinuse -= numbytes;
+	}
+}
+
+void RTPPoolMemoryManager::Lock()
+{
+#ifdef RTP_SUPPORT_THREAD
+	if (m_threadsafe && !m_useThreadCaches)
+		m_mutex.Lock();
+#endif // RTP_SUPPORT_THREAD
+}
+
+void RTPPoolMemoryManager::Unlock()
+{
+#ifdef RTP_SUPPORT_THREAD
+	if (m_threadsafe && !m_useThreadCaches)
+		m_mutex.Unlock();
+#endif // RTP_SUPPORT_THREAD
+}
+
+#ifdef RTPPOOLMEMMGR_THREADCACHES
+
+RTPPoolMemoryManager::ThreadCache *RTPPoolMemoryManager::GetThreadCache()
+{
+	ThreadCache *cache = (ThreadCache *)pthread_getspecific(m_cacheKey);
+	if (cache)
+		return cache;
+
+	// Try to reuse the cache of a thread that has ended; the list of caches only
+	// grows, so it can be traversed safely
+	for (cache = m_pThreadCaches ; cache != 0 ; cache = cache->m_pNext)
+	{
+		if (cache->m_active == 0 && __sync_bool_compare_and_swap(&cache->m_active, 0, 1))
+			break;
+	}
+
+	if (cache == 0)
+	{
+		cache = (ThreadCache *)malloc(sizeof(ThreadCache));
+		if (cache == 0)
+			return 0;
+
+		memset(cache, 0, sizeof(ThreadCache));
+		cache->m_pManager = this;
+		cache->m_active = 1;
+
+		ThreadCache *head;
+		do
+		{
+			head = m_pThreadCaches;
+			cache->m_pNext = head;
+		} while (!__sync_bool_compare_and_swap(&m_pThreadCaches, head, cache));
+	}
+
+	if (pthread_setspecific(m_cacheKey, cache) != 0)
+	{
+		__sync_lock_release(&cache->m_active);
+		return 0;
+	}
+	return cache;
+}
+
+void RTPPoolMemoryManager::FlushThreadCache(ThreadCache *cache, int sizeclass, size_t numtokeep)
+{
+	uint8_t *first, *last;
+	size_t num = cache->m_numFreeBlocks[sizeclass];
+
+	if (num <= numtokeep)
+		return;
+
+	// Split the list after 'numtokeep' blocks
+	if (numtokeep == 0)
+	{
+		first = cache->m_pFreeBlocks[sizeclass];
+		cache->m_pFreeBlocks[sizeclass] = 0;
+	}
+	else
+	{
+		uint8_t *b = cache->m_pFreeBlocks[sizeclass];
+		for (size_t i = 1 ; i < numtokeep ; i++)
+			b = NextBlock(b);
+
+		first = NextBlock(b);
+		NextBlock(b) = 0;
+	}
+	cache->m_numFreeBlocks[sizeclass] = numtokeep;
+
+	last = first;
+	while (NextBlock(last) != 0)
+		last = NextBlock(last);
+
+	// Push the entire chain onto the global list at once
+	uint8_t *head;
+	do
+	{
+		head = m_pGlobalFreeBlocks[sizeclass];
+		NextBlock(last) = head;
+	} while (!__sync_bool_compare_and_swap(&m_pGlobalFreeBlocks[sizeclass], head, first));
+}
+
+void RTPPoolMemoryManager::ThreadCacheDestructor(void *c)
+{
+	// Called when a thread that used the memory manager ends: its free blocks are
+	// moved to the global lists, and the cache can be reused by another thread
+	ThreadCache *cache = (ThreadCache *)c;
+
+	for (int i = 0 ; i < RTPPOOLMEMMGR_NUMSIZECLASSES ; i++)
+		cache->m_pManager->FlushThreadCache(cache, i, 0);
+
+	__sync_lock_release(&cache->m_active);
+}
+
+#endif // RTPPOOLMEMMGR_THREADCACHES
+
+} // end namespace
+
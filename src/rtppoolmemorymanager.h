@@ -0,0 +1,186 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtppoolmemorymanager.h
+ */
+
+#ifndef RTPPOOLMEMORYMANAGER_H
+
+#define RTPPOOLMEMORYMANAGER_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtpmemorymanager.h"
+#ifdef RTP_SUPPORT_THREAD
+	#include <jthread/jmutex.h>
+#endif // RTP_SUPPORT_THREAD
+#ifdef RTP_HAVE_PTHREAD_KEY
+	#include <pthread.h>
+#endif // RTP_HAVE_PTHREAD_KEY
+
+/** Number of size classes used by RTPPoolMemoryManager, the largest one is 64 kB. */
+#define RTPPOOLMEMMGR_NUMSIZECLASSES							23
+
+/** Statistics are kept for the memory types below this value, other types are combined. */
+#define RTPPOOLMEMMGR_MAXMEMTYPES							64
+
+/** Default number of free blocks a thread's cache keeps for each size class. */
+#define RTPPOOLMEMMGR_DEFAULTCACHESIZE							128
+
+namespace jrtplib
+{
+
+/** Describes the memory usage of a specific type of memory block, as returned by
+ *  RTPPoolMemoryManager::GetStatistics. */
+struct RTPPoolMemoryStatistics
+{
+	/** The number of allocations that were done so far. */
+	size_t numallocations;
+
+	/** The number of blocks that are currently allocated. */
+	size_t blocksinuse;
+
+	/** The number of bytes that are currently allocated. */
+	size_t bytesinuse;
+
+	/** The largest number of blocks that were allocated at the same time. */
+	size_t maxblocksinuse;
+
+	/** The largest number of bytes that were allocated at the same time. */
+	size_t maxbytesinuse;
+};
+
+/** A memory manager that recycles memory blocks using size-class free lists.
+ *  This memory manager rounds every request up to one of a number of size classes
+ *  (going from 32 bytes to 64 kB), and keeps a free list for each class so that 
+ *  released blocks can be reused without going through the system allocator; larger 
+ *  requests are passed on to the system allocator directly. When created in thread-safe 
+ *  mode on a platform which provides thread-specific keys and atomic operations, each 
+ *  thread gets its own cache of free blocks, so that allocating and releasing memory does 
+ *  not require any locking. A thread refills its cache by atomically taking the entire 
+ *  global free list of a size class, and when a cache grows too large, half of it is pushed 
+ *  back onto the global list, again without locking. This allows e.g. the thread that
+ *  receives packets and the application thread that deletes them to exchange memory blocks 
+ *  without contending on a lock. On other platforms, the global free lists are protected
+ *  by a mutex instead. For each memory type (see rtpmemorymanager.h) the manager can also
+ *  keep statistics, including the high-water marks of the memory in use.
+ */
+class JRTPLIB_IMPORTEXPORT RTPPoolMemoryManager : public RTPMemoryManager
+{
+	JRTPLIB_NO_COPY(RTPPoolMemoryManager)
+public:
+	RTPPoolMemoryManager();
+	~RTPPoolMemoryManager();
+
+	/** Initializes the memory manager.
+	 *  Initializes the memory manager. If \c threadsafe is \c true, the manager can be
+	 *  used from several threads at the same time. If \c keepstatistics is \c true, the
+	 *  statistics for each memory type are kept up to date; note that in thread-safe mode
+	 *  this requires atomic operations on counters that are shared by all threads. The
+	 *  \c cachesize parameter specifies how many free blocks of each size class a thread's
+	 *  cache may hold before half of them are returned to the global free list.
+	 */
+	int Init(bool threadsafe, bool keepstatistics = true, size_t cachesize = RTPPOOLMEMMGR_DEFAULTCACHESIZE);
+
+	/** Returns \c true if Init was called successfully. */
+	bool IsInitialized() const															{ return m_init; }
+
+	/** Returns \c true if thread-local caches are used for the free blocks. */
+	bool UsesThreadCaches() const														{ return m_useThreadCaches; }
+
+	void *AllocateBuffer(size_t numbytes, int memtype);
+	void FreeBuffer(void *buffer);
+
+	/** Stores the statistics of memory type \c memtype in \c stats.
+	 *  Stores the statistics of memory type \c memtype in \c stats. Returns \c false if
+	 *  no statistics are being kept. Memory types of \c RTPPOOLMEMMGR_MAXMEMTYPES and
+	 *  above share a single entry.
+	 */
+	bool GetStatistics(int memtype, RTPPoolMemoryStatistics &stats) const;
+
+	/** Stores the combined statistics of all memory types in \c stats, returns \c false
+	 *  if no statistics are being kept. */
+	bool GetTotalStatistics(RTPPoolMemoryStatistics &stats) const;
+
+	/** Resets the high-water marks of all memory types to the current usage. */
+	void ResetHighWaterMarks();
+
+	/** Returns the size of the blocks in size class \c idx, which ranges from 0 to
+	 *  \c RTPPOOLMEMMGR_NUMSIZECLASSES-1. */
+	static size_t GetSizeClassSize(int idx);
+private:
+	struct ThreadCache
+	{
+		uint8_t *m_pFreeBlocks[RTPPOOLMEMMGR_NUMSIZECLASSES];
+		size_t m_numFreeBlocks[RTPPOOLMEMMGR_NUMSIZECLASSES];
+		RTPPoolMemoryManager *m_pManager;
+		ThreadCache *m_pNext;
+		int m_active;
+	};
+
+	static int GetSizeClass(size_t numbytes);
+	static uint8_t *&NextBlock(uint8_t *block);
+	uint8_t *AllocateBlock(int sizeclass);
+	void ReleaseBlock(uint8_t *block, int sizeclass);
+	void ClearFreeBlocks();
+	void UpdateStatistics(int memtype, size_t numbytes, bool allocated);
+	void UpdateStatistics(RTPPoolMemoryStatistics &stats, size_t numbytes, bool allocated);
+	void Lock();
+	void Unlock();
+
+	bool m_init;
+	bool m_threadsafe;
+	bool m_keepStatistics;
+	bool m_useThreadCaches;
+	size_t m_cacheSize;
+
+	uint8_t *volatile m_pGlobalFreeBlocks[RTPPOOLMEMMGR_NUMSIZECLASSES];
+	RTPPoolMemoryStatistics m_statistics[RTPPOOLMEMMGR_MAXMEMTYPES+2]; // the last entry holds the totals
+
+#if defined(RTP_HAVE_PTHREAD_KEY) && defined(RTP_HAVE_SYNC_BUILTINS)
+	ThreadCache *GetThreadCache();
+	void FlushThreadCache(ThreadCache *cache, int sizeclass, size_t numtokeep);
+	static void ThreadCacheDestructor(void *cache);
+
+	pthread_key_t m_cacheKey;
+	ThreadCache *volatile m_pThreadCaches;
+#endif // RTP_HAVE_PTHREAD_KEY && RTP_HAVE_SYNC_BUILTINS
+#ifdef RTP_SUPPORT_THREAD
+	jthread::JMutex m_mutex;
+#endif // RTP_SUPPORT_THREAD
+};
+
+} // end namespace
+
+#endif // RTPPOOLMEMORYMANAGER_H
+
@@ -44,6 +44,7 @@
 #include "rtptypes.h"
 #include "rtpmemoryobject.h"
 #include "rtpstructs.h"
+#include "rtpslabpool.h"
 
 namespace jrtplib
 {
@@ -72,6 +73,23 @@ public:
 	 *  based on the header information the packet type will be determined.
 	 */
 	RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *address,RTPTime &recvtime,RTPMemoryManager *mgr = 0);
+
+	/** Creates an instance which stores \c datalen bytes of data that were received in \c slab.
+	 *  Creates an instance which stores \c datalen bytes of data that were received in \c slab,
+	 *  taking over the caller's reference to the slab. Both the data and the sender address are
+	 *  the ones stored in the slab, nothing is copied. The time at which the packet was received is
+	 *  set to \c recvtime and the flag which indicates whether this data is RTP or RTCP data is set
+	 *  to \c rtp. A memory manager can be installed as well.
+	 */
+	RTPRawPacket(RTPReceiveSlab *slab,size_t datalen,RTPTime &recvtime,bool rtp,RTPMemoryManager *mgr = 0);
+
+	/** Creates an instance which stores the \c datalen bytes at \c data, which are located somewhere in \c slab.
+	 *  Creates an instance which stores the \c datalen bytes at \c data, which are located somewhere
+	 *  in \c slab. This is similar to the previous constructor, but allows several packets to share
+	 *  the same slab, each holding its own reference to it, e.g. when a stream of framed packets is
+	 *  read into a single buffer.
+	 */
+	RTPRawPacket(RTPReceiveSlab *slab,uint8_t *data,size_t datalen,RTPTime &recvtime,bool rtp,RTPMemoryManager *mgr = 0);
 	~RTPRawPacket();
 	
 	/** Returns the pointer to the data which is contained in this packet. */
@@ -98,6 +116,14 @@ public:
 	 */
 	void ZeroData()															{ packetdata = 0; packetdatalength = 0; }
 
+	/** If the data currently stored in this packet is located in a receive slab, that slab is returned.
+	 *  If the data currently stored in this packet is located in a receive slab, that slab is returned,
+	 *  otherwise the function returns null. A class that obtains the data using RTPRawPacket::ZeroData
+	 *  must then add a reference to the slab, and release this reference instead of deleting the data
+	 *  when it's no longer needed. This is what the RTPPacket and RTCPCompoundPacket classes do.
+	 */
+	RTPReceiveSlab *GetDataSlab() const										{ return (packetdata && IsSlabData(packetdata))?slab:0; }
+
 	/** Allocates a number of bytes for RTP or RTCP data using the memory manager that
 	 *  was used for this raw packet instance, can be useful if the RTPRawPacket::SetData
 	 *  function will be used. */
@@ -112,12 +138,15 @@ public:
 	void SetSenderAddress(RTPAddress *address);
 private:
 	void DeleteData();
+	bool IsSlabData(uint8_t *data) const									{ return (slab && data >= slab->GetData() && data < slab->GetData()+slab->GetSize()); }
+	bool IsSlabAddress(RTPAddress *address) const							{ return (slab && address == slab->GetAddress()); }
 
 	uint8_t *packetdata;
 	size_t packetdatalength;
 	RTPTime receivetime;
 	RTPAddress *senderaddress;
 	bool isrtp;
+	RTPReceiveSlab *slab;
 };
 
 inline RTPRawPacket::RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *address,RTPTime &recvtime,bool rtp,RTPMemoryManager *mgr):RTPMemoryObject(mgr),receivetime(recvtime)
@@ -126,6 +155,7 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *addre
 	packetdatalength = datalen;
 	senderaddress = address;
 	isrtp = rtp;
+	slab = 0;
 }
 
 inline RTPRawPacket::RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *address,RTPTime &recvtime,RTPMemoryManager *mgr):RTPMemoryObject(mgr),receivetime(recvtime)
@@ -133,6 +163,7 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *addre
 	packetdata = data;
 	packetdatalength = datalen;
 	senderaddress = address;
+	slab = 0;
 
 	isrtp = true;
 	if (datalen >= sizeof(RTCPCommonHeader))
@@ -145,6 +176,24 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data,size_t datalen,RTPAddress *addre
 	}
 }
 
+inline RTPRawPacket::RTPRawPacket(RTPReceiveSlab *slab,size_t datalen,RTPTime &recvtime,bool rtp,RTPMemoryManager *mgr):RTPMemoryObject(mgr),receivetime(recvtime)
+{
+	packetdata = slab->GetData();
+	packetdatalength = datalen;
+	senderaddress = slab->GetAddress();
+	isrtp = rtp;
+	RTPRawPacket::slab = slab;
+}
+
+inline RTPRawPacket::RTPRawPacket(RTPReceiveSlab *slab,uint8_t *data,size_t datalen,RTPTime &recvtime,bool rtp,RTPMemoryManager *mgr):RTPMemoryObject(mgr),receivetime(recvtime)
+{
+	packetdata = data;
+	packetdatalength = datalen;
+	senderaddress = slab->GetAddress();
+	isrtp = rtp;
+	RTPRawPacket::slab = slab;
+}
+
 inline RTPRawPacket::~RTPRawPacket()
 {
 	DeleteData();
@@ -152,13 +201,16 @@ inline RTPRawPacket::~RTPRawPacket()
 
 inline void RTPRawPacket::DeleteData()
 {
-	if (packetdata)
+	if (packetdata && !IsSlabData(packetdata))
 		RTPDeleteByteArray(packetdata,GetMemoryManager());
-	if (senderaddress)
+	if (senderaddress && !IsSlabAddress(senderaddress))
 		RTPDelete(senderaddress,GetMemoryManager());
+	if (slab)
+		slab->Release();
 
 	packetdata = 0;
 	senderaddress = 0;
+	slab = 0;
 }
 
 inline uint8_t *RTPRawPacket::AllocateBytes(bool isrtp, int recvlen) const
@@ -169,7 +221,7 @@ inline uint8_t *RTPRawPacket::AllocateBytes(bool isrtp, int recvlen) const
 
 inline void RTPRawPacket::SetData(uint8_t *data, size_t datalen)
 {
-	if (packetdata)
+	if (packetdata && !IsSlabData(packetdata))
 		RTPDeleteByteArray(packetdata,GetMemoryManager());
 
 	packetdata = data;
@@ -178,7 +230,7 @@ inline void RTPRawPacket::SetData(uint8_t *data, size_t datalen)
 
 inline void RTPRawPacket::SetSenderAddress(RTPAddress *address)
 {
-	if (senderaddress)
+	if (senderaddress && !IsSlabAddress(senderaddress))
 		RTPDelete(senderaddress, GetMemoryManager());
 
 	senderaddress = address;
@@ -0,0 +1,655 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtpreactor.h"
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_EPOLL)
+
+#include "rtpsession.h"
+#include "rtptransmitter.h"
+#include "rtpudpv4transmitter.h"
+#ifdef RTP_SUPPORT_IPV6
+#include "rtpudpv6transmitter.h"
+#endif // RTP_SUPPORT_IPV6
+#include "rtperrors.h"
+#include "rtppollthread.h"
+#include <jthread/jthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "rtpdebug.h"
+
+// Keys 0 and 1 in the epoll set are reserved, a session socket uses (id<<1)|socketindex
+// with id >= 1
+#define RTPREACTOR_KEY_ABORT									0
+#define RTPREACTOR_KEY_TIMER									1
+
+namespace jrtplib
+{
+
+struct RTPReactor::SessionEntry
+{
+	RTPSession *session;
+	uint64_t id;
+	SocketType sockets[2];
+	bool armed[2];
+	int numsockets;
+	bool busy;
+	pthread_t pollthread; // the worker that's polling the session, if 'busy' is set
+	bool pending;
+	bool removing;
+	bool deferreddelete; // removed from within a callback, the worker deletes the entry
+	bool scheduled;
+	size_t slot;
+	size_t rounds;
+	WheelSlot::iterator wheelpos;
+};
+
+class RTPReactorWorker : public jthread::JThread
+{
+	JRTPLIB_NO_COPY(RTPReactorWorker)
+public:
+	RTPReactorWorker(RTPReactor &reactor) : m_reactor(reactor)						{ }
+	
+	void *Thread()
+	{
+		JThread::ThreadStarted();
+		m_reactor.WorkerLoop();
+		return 0;
+	}
+
+	void WaitForStop()
+	{
+		RTPWaitForThreadStop(*this,"RTPReactor","worker thread");
+	}
+private:
+	RTPReactor &m_reactor;
+};
+
+RTPReactor::RTPReactor(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_running = false;
+	m_stop = false;
+	m_epollFd = -1;
+	m_timerFd = -1;
+	m_nextId = 1;
+	m_wheelPos = 0;
+	m_resolution = 0;
+}
+
+RTPReactor::~RTPReactor()
+{
+	Stop();
+}
+
+int RTPReactor::Start(int numworkers, const RTPTime &timerresolution)
+{
+	if (m_running)
+		return ERR_RTP_REACTOR_ALREADYRUNNING;
+	if (numworkers < 1)
+		return ERR_RTP_REACTOR_ILLEGALNUMBEROFWORKERS;
+	if (timerresolution.GetDouble() <= 0)
+		return ERR_RTP_REACTOR_ILLEGALTIMERRESOLUTION;
+
+	if (!m_mutex.IsInitialized())
+	{
+		if (m_mutex.Init() < 0)
+			return ERR_RTP_REACTOR_CANTINITMUTEX;
+	}
+
+	int status;
+
+	if ((status = m_abortDesc.Init()) < 0)
+		return status;
+
+	if ((m_epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+	{
+		CloseDescriptors();
+		return ERR_RTP_REACTOR_CANTCREATEEPOLL;
+	}
+
+	if ((m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) < 0)
+	{
+		CloseDescriptors();
+		return ERR_RTP_REACTOR_CANTCREATETIMER;
+	}
+
+	struct itimerspec tspec;
+
+	tspec.it_interval.tv_sec = timerresolution.GetSeconds();
+	tspec.it_interval.tv_nsec = timerresolution.GetMicroSeconds()*1000;
+	tspec.it_value = tspec.it_interval;
+	if (timerfd_settime(m_timerFd, 0, &tspec, 0) < 0)
+	{
+		CloseDescriptors();
+		return ERR_RTP_REACTOR_CANTCREATETIMER;
+	}
+
+	// The abort descriptor is level triggered and never read, so that once
+	// it's signalled every worker wakes up
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN;
+	ev.data.u64 = RTPREACTOR_KEY_ABORT;
+	if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_abortDesc.GetAbortSocket(), &ev) < 0)
+	{
+		CloseDescriptors();
+		return ERR_RTP_REACTOR_CANTCREATEEPOLL;
+	}
+
+	ev.events = EPOLLIN|EPOLLONESHOT;
+	ev.data.u64 = RTPREACTOR_KEY_TIMER;
+	if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timerFd, &ev) < 0)
+	{
+		CloseDescriptors();
+		return ERR_RTP_REACTOR_CANTCREATETIMER;
+	}
+
+	m_resolution = timerresolution.GetDouble();
+	m_wheel.assign(RTPREACTOR_WHEELSIZE, WheelSlot());
+	m_wheelPos = 0;
+	m_stop = false;
+
+	for (int i = 0 ; i < numworkers ; i++)
+	{
+		RTPReactorWorker *worker = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPREACTORWORKER) RTPReactorWorker(*this);
+		
+		if (worker == 0)
+			status = ERR_RTP_OUTOFMEM;
+		else
+		{
+			m_workers.push_back(worker);
+			if (worker->Start() < 0)
+				status = ERR_RTP_REACTOR_CANTSTARTTHREAD;
+		}
+
+		if (status < 0)
+		{
+			m_running = true;
+			Stop();
+			return status;
+		}
+	}
+
+	m_running = true;
+	return 0;
+}
+
+void RTPReactor::Stop()
+{
+	if (!m_running)
+		return;
+
+	m_mutex.Lock();
+	m_stop = true;
+	m_mutex.Unlock();
+
+	m_abortDesc.SendAbortSignal();
+
+	for (size_t i = 0 ; i < m_workers.size() ; i++)
+	{
+		m_workers[i]->WaitForStop();
+		RTPDelete(m_workers[i],GetMemoryManager());
+	}
+	m_workers.clear();
+
+	ClearSessions();
+	CloseDescriptors();
+	m_stop = false;
+	m_running = false;
+}
+
+int RTPReactor::AddSession(RTPSession &sess)
+{
+	if (!m_running)
+		return ERR_RTP_REACTOR_NOTRUNNING;
+
+	if (!sess.IsActive())
+		return ERR_RTP_SESSION_NOTCREATED;
+	if (sess.IsUsingPollThread())
+		return ERR_RTP_SESSION_USINGPOLLTHREAD;
+
+	RTPTransmissionInfo *inf = sess.GetTransmissionInfo();
+	SocketType rtpsock, rtcpsock;
+
+	if (inf == 0)
+		return ERR_RTP_REACTOR_UNSUPPORTEDTRANSMITTER;
+
+	switch (inf->GetTransmissionProtocol())
+	{
+	case RTPTransmitter::IPv4UDPProto:
+		rtpsock = static_cast<RTPUDPv4TransmissionInfo *>(inf)->GetRTPSocket();
+		rtcpsock = static_cast<RTPUDPv4TransmissionInfo *>(inf)->GetRTCPSocket();
+		break;
+#ifdef RTP_SUPPORT_IPV6
+	case RTPTransmitter::IPv6UDPProto:
+		rtpsock = static_cast<RTPUDPv6TransmissionInfo *>(inf)->GetRTPSocket();
+		rtcpsock = static_cast<RTPUDPv6TransmissionInfo *>(inf)->GetRTCPSocket();
+		break;
+#endif // RTP_SUPPORT_IPV6
+	default:
+		sess.DeleteTransmissionInfo(inf);
+		return ERR_RTP_REACTOR_UNSUPPORTEDTRANSMITTER;
+	}
+	sess.DeleteTransmissionInfo(inf);
+
+	// Must be obtained before locking the reactor mutex, the session's own
+	// mutexes are never locked while holding it
+	RTPTime delay = sess.GetRTCPDelay();
+
+	m_mutex.Lock();
+
+	if (m_sessionIndex.find(&sess) != m_sessionIndex.end())
+	{
+		m_mutex.Unlock();
+		return ERR_RTP_REACTOR_SESSIONALREADYADDED;
+	}
+
+	SessionEntry *entry = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPREACTORSESSIONENTRY) SessionEntry;
+	if (entry == 0)
+	{
+		m_mutex.Unlock();
+		return ERR_RTP_OUTOFMEM;
+	}
+
+	entry->session = &sess;
+	entry->id = m_nextId++;
+	entry->sockets[0] = rtpsock;
+	entry->sockets[1] = rtcpsock;
+	entry->numsockets = (rtpsock == rtcpsock)?1:2;
+	entry->busy = false;
+	entry->pending = false;
+	entry->removing = false;
+	entry->deferreddelete = false;
+	entry->scheduled = false;
+	entry->slot = 0;
+	entry->rounds = 0;
+
+	for (int i = 0 ; i < entry->numsockets ; i++)
+	{
+		struct epoll_event ev;
+
+		ev.events = EPOLLIN|EPOLLONESHOT;
+		ev.data.u64 = (entry->id << 1)|(uint64_t)i;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, entry->sockets[i], &ev) < 0)
+		{
+			for (int j = 0 ; j < i ; j++)
+				epoll_ctl(m_epollFd, EPOLL_CTL_DEL, entry->sockets[j], &ev);
+			RTPDelete(entry,GetMemoryManager());
+			m_mutex.Unlock();
+			return ERR_RTP_REACTOR_CANTADDSOCKET;
+		}
+		entry->armed[i] = true;
+	}
+
+	m_sessions[entry->id] = entry;
+	m_sessionIndex[&sess] = entry;
+	Schedule(entry, delay);
+
+	m_mutex.Unlock();
+	return 0;
+}
+
+int RTPReactor::RemoveSession(RTPSession &sess)
+{
+	if (!m_running)
+		return ERR_RTP_REACTOR_NOTRUNNING;
+
+	m_mutex.Lock();
+
+	std::map<RTPSession *, SessionEntry *>::iterator it = m_sessionIndex.find(&sess);
+
+	if (it == m_sessionIndex.end())
+	{
+		m_mutex.Unlock();
+		return ERR_RTP_REACTOR_SESSIONNOTFOUND;
+	}
+
+	SessionEntry *entry = it->second;
+
+	if (entry->deferreddelete)
+	{
+		// Removed from within a callback, wait until the worker is done with it
+		while (m_sessionIndex.find(&sess) != m_sessionIndex.end())
+		{
+			m_mutex.Unlock();
+			RTPTime::Wait(RTPTime(0,1000));
+			m_mutex.Lock();
+		}
+		m_mutex.Unlock();
+		return 0;
+	}
+
+	UnregisterSession(entry);
+
+	if (entry->busy && pthread_equal(entry->pollthread, pthread_self()))
+	{
+		// Called from a callback of the session itself: waiting for the worker
+		// would deadlock, let it delete the entry once it's done
+		entry->deferreddelete = true;
+		m_mutex.Unlock();
+		return 0;
+	}
+
+	m_sessionIndex.erase(it);
+
+	// A worker that's polling the session still uses the entry
+	while (entry->busy)
+	{
+		m_mutex.Unlock();
+		RTPTime::Wait(RTPTime(0,1000));
+		m_mutex.Lock();
+	}
+
+	m_mutex.Unlock();
+
+	RTPDelete(entry,GetMemoryManager());
+	return 0;
+}
+
+// Makes sure the workers won't dispatch the session anymore; the mutex must be held
+void RTPReactor::UnregisterSession(SessionEntry *entry)
+{
+	m_sessions.erase(entry->id);
+
+	for (int i = 0 ; i < entry->numsockets ; i++)
+	{
+		struct epoll_event ev; // needed for pre 2.6.9 kernels
+
+		epoll_ctl(m_epollFd, EPOLL_CTL_DEL, entry->sockets[i], &ev);
+	}
+	Unschedule(entry);
+	entry->removing = true;
+}
+
+size_t RTPReactor::GetNumberOfSessions()
+{
+	if (!m_running)
+		return 0;
+
+	m_mutex.Lock();
+	size_t num = m_sessions.size();
+	m_mutex.Unlock();
+	return num;
+}
+
+void RTPReactor::WorkerLoop()
+{
+	struct epoll_event events[RTPREACTOR_MAXEVENTS];
+	std::vector<uint64_t> due;
+	
+	while (true)
+	{
+		m_mutex.Lock();
+		bool stop = m_stop;
+		m_mutex.Unlock();
+
+		if (stop)
+			break;
+
+		int num = epoll_wait(m_epollFd, events, RTPREACTOR_MAXEVENTS, -1);
+
+		if (num < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (int i = 0 ; i < num ; i++)
+		{
+			uint64_t key = events[i].data.u64;
+
+			if (key == RTPREACTOR_KEY_ABORT)
+				continue; // the stop flag is checked at the start of the loop
+			if (key == RTPREACTOR_KEY_TIMER)
+			{
+				ProcessTimer(due);
+				for (size_t j = 0 ; j < due.size() ; j++)
+					DispatchSession(due[j], -1);
+			}
+			else
+				DispatchSession(key >> 1, (int)(key & 1));
+		}
+	}
+}
+
+void RTPReactor::ProcessTimer(std::vector<uint64_t> &due)
+{
+	uint64_t expirations = 0;
+	
+	due.clear();
+
+	if (read(m_timerFd, &expirations, sizeof(uint64_t)) != (ssize_t)sizeof(uint64_t))
+		expirations = 0;
+
+	m_mutex.Lock();
+
+	// After a long stall, going around the wheel once is enough to pick
+	// up everything that's due
+	if (expirations > RTPREACTOR_WHEELSIZE)
+		expirations = RTPREACTOR_WHEELSIZE;
+
+	for (uint64_t i = 0 ; i < expirations ; i++)
+	{
+		m_wheelPos = (m_wheelPos+1)%RTPREACTOR_WHEELSIZE;
+
+		WheelSlot &slot = m_wheel[m_wheelPos];
+		WheelSlot::iterator it = slot.begin();
+
+		while (it != slot.end())
+		{
+			SessionEntry *entry = *it;
+
+			if (entry->rounds > 0)
+			{
+				entry->rounds--;
+				++it;
+			}
+			else
+			{
+				due.push_back(entry->id);
+				entry->scheduled = false;
+				it = slot.erase(it);
+			}
+		}
+	}
+
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN|EPOLLONESHOT;
+	ev.data.u64 = RTPREACTOR_KEY_TIMER;
+	epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_timerFd, &ev);
+
+	m_mutex.Unlock();
+}
+
+void RTPReactor::DispatchSession(uint64_t id, int sockidx)
+{
+	m_mutex.Lock();
+
+	std::map<uint64_t, SessionEntry *>::iterator it = m_sessions.find(id);
+
+	if (it == m_sessions.end())
+	{
+		m_mutex.Unlock();
+		return;
+	}
+
+	SessionEntry *entry = it->second;
+
+	if (sockidx >= 0)
+		entry->armed[sockidx] = false;
+	if (entry->busy)
+	{
+		// The worker that's polling the session will poll it again
+		entry->pending = true;
+		m_mutex.Unlock();
+		return;
+	}
+	entry->busy = true;
+	entry->pollthread = pthread_self();
+	Unschedule(entry);
+
+	m_mutex.Unlock();
+
+	RTPSession *sess = entry->session;
+	bool done = false;
+	bool deleteentry = false;
+
+	while (!done)
+	{
+		int status;
+
+		if ((status = sess->Poll()) < 0)
+			sess->OnPollThreadError(status);
+		else
+			sess->OnPollThreadStep();
+
+		RTPTime delay = sess->GetRTCPDelay();
+
+		m_mutex.Lock();
+		if (entry->pending && !entry->removing)
+			entry->pending = false;
+		else
+		{
+			if (!entry->removing)
+			{
+				Schedule(entry, delay);
+				RearmSockets(entry);
+			}
+			entry->pending = false;
+			entry->busy = false;
+			done = true;
+
+			if (entry->deferreddelete)
+			{
+				m_sessionIndex.erase(sess);
+				deleteentry = true;
+			}
+		}
+		m_mutex.Unlock();
+	}
+
+	if (deleteentry)
+		RTPDelete(entry,GetMemoryManager());
+}
+
+void RTPReactor::Schedule(SessionEntry *entry, const RTPTime &delay)
+{
+	double d = delay.GetDouble();
+	size_t ticks = 1;
+	
+	if (d > 0)
+	{
+		double t = d/m_resolution;
+
+		// Limit this to an hour worth of ticks to avoid overflows
+		if (t > 3600.0/m_resolution)
+			t = 3600.0/m_resolution;
+		ticks = (size_t)t + 1;
+	}
+
+	entry->slot = (m_wheelPos + ticks)%RTPREACTOR_WHEELSIZE;
+	entry->rounds = (ticks-1)/RTPREACTOR_WHEELSIZE;
+	entry->wheelpos = m_wheel[entry->slot].insert(m_wheel[entry->slot].end(), entry);
+	entry->scheduled = true;
+}
+
+void RTPReactor::Unschedule(SessionEntry *entry)
+{
+	if (!entry->scheduled)
+		return;
+	m_wheel[entry->slot].erase(entry->wheelpos);
+	entry->scheduled = false;
+}
+
+void RTPReactor::RearmSockets(SessionEntry *entry)
+{
+	for (int i = 0 ; i < entry->numsockets ; i++)
+	{
+		if (entry->armed[i])
+			continue;
+
+		struct epoll_event ev;
+
+		ev.events = EPOLLIN|EPOLLONESHOT;
+		ev.data.u64 = (entry->id << 1)|(uint64_t)i;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, entry->sockets[i], &ev) == 0)
+			entry->armed[i] = true;
+	}
+}
+
+void RTPReactor::ClearSessions()
+{
+	std::map<RTPSession *, SessionEntry *>::iterator it;
+
+	// The workers have stopped, so this also contains the entries they
+	// would still have deleted
+	for (it = m_sessionIndex.begin() ; it != m_sessionIndex.end() ; it++)
+	{
+		SessionEntry *entry = it->second;
+
+		if (!entry->removing)
+		{
+			for (int i = 0 ; i < entry->numsockets ; i++)
+			{
+				struct epoll_event ev;
+
+				epoll_ctl(m_epollFd, EPOLL_CTL_DEL, entry->sockets[i], &ev);
+			}
+		}
+		RTPDelete(entry,GetMemoryManager());
+	}
+	m_sessionIndex.clear();
+	m_sessions.clear();
+	m_wheel.clear();
+}
+
+void RTPReactor::CloseDescriptors()
+{
+	if (m_timerFd >= 0)
+		close(m_timerFd);
+	if (m_epollFd >= 0)
+		close(m_epollFd);
+	m_timerFd = -1;
+	m_epollFd = -1;
+	m_abortDesc.Destroy();
+}
+
+} // end namespace
+
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_EPOLL
+
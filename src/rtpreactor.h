@@ -0,0 +1,157 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpreactor.h
+ */
+
+#ifndef RTPREACTOR_H
+
+#define RTPREACTOR_H
+
+#include "rtpconfig.h"
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_EPOLL)
+
+#include "rtpmemoryobject.h"
+#include "rtpabortdescriptors.h"
+#include "rtptimeutilities.h"
+#include <jthread/jmutex.h>
+#include <list>
+#include <map>
+#include <vector>
+
+#define RTPREACTOR_DEFAULTWORKERS								2
+#define RTPREACTOR_DEFAULTTIMERRESOLUTION						RTPTime(0,10000)
+#define RTPREACTOR_WHEELSIZE									1024
+#define RTPREACTOR_MAXEVENTS									64
+
+namespace jrtplib
+{
+
+class RTPSession;
+class RTPReactorWorker;
+
+/** Drives a number of RTP sessions from a single epoll set and a small pool of worker threads.
+ *  Drives a number of RTP sessions from a single epoll set and a small pool of worker threads.
+ *  Instead of giving every RTPSession its own poll thread, the sockets of all registered sessions
+ *  are monitored by one epoll instance and a session is only polled when one of its sockets
+ *  becomes readable, or when an RTCP compound packet needs to be sent. The RTCP transmission
+ *  times of all sessions are kept in a single timer wheel, which is advanced by a timer descriptor
+ *  in the same epoll set.
+ *
+ *  The sessions that are added must use one of the UDP transmitters, must have been created
+ *  without a poll thread (see RTPSessionParams::SetUsePollThread) and must be thread safe
+ *  (RTPSessionParams::SetNeedThreadSafety), since they are polled from the worker threads while
+ *  the application keeps using them. A session is never polled by more than one worker at the
+ *  same time. The session's RTPSession::OnPollThreadStep and RTPSession::OnPollThreadError
+ *  callbacks are invoked from the worker threads, just like they would be from a poll thread.
+ *  From within the callbacks of a session, only RemoveSession may be called, for that session.
+ *
+ *  A session must be removed from the reactor before it is destroyed. This is an
+ *  experimental Linux-only feature.
+ */
+class JRTPLIB_IMPORTEXPORT RTPReactor : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPReactor)
+public:
+	RTPReactor(RTPMemoryManager *mgr = 0);
+	~RTPReactor();
+
+	/** Starts the reactor.
+	 *  Starts the reactor using \c numworkers worker threads. The RTCP timer wheel is advanced
+	 *  every \c timerresolution, which determines how accurately the RTCP transmission times
+	 *  are followed.
+	 */
+	int Start(int numworkers = RTPREACTOR_DEFAULTWORKERS, const RTPTime &timerresolution = RTPREACTOR_DEFAULTTIMERRESOLUTION);
+
+	/** Stops the worker threads and removes all sessions from the reactor. */
+	void Stop();
+
+	/** Returns \c true if the reactor has been started. */
+	bool IsRunning() const											{ return m_running; }
+
+	/** Registers the sockets of \c sess with the reactor, after which the session will be
+	 *  polled by the worker threads. */
+	int AddSession(RTPSession &sess);
+
+	/** Removes \c sess from the reactor, waiting for a worker that's currently polling it to finish.
+	 *  Removes \c sess from the reactor, waiting for a worker that's currently polling it to finish.
+	 *  When this is called from one of the session's callbacks on the worker thread that's polling
+	 *  it (e.g. when a BYE packet is received), the function returns right away and the worker
+	 *  finishes the removal once it's done with the session. In that case, the session may only be
+	 *  destroyed after calling RemoveSession for it again from another thread, which then waits
+	 *  for the worker and returns 0.
+	 */
+	int RemoveSession(RTPSession &sess);
+
+	/** Returns the number of sessions that are currently registered. */
+	size_t GetNumberOfSessions();
+private:
+	struct SessionEntry;
+	typedef std::list<SessionEntry *> WheelSlot;
+
+	void WorkerLoop();
+	void ProcessTimer(std::vector<uint64_t> &due);
+	void DispatchSession(uint64_t id, int sockidx);
+	void Schedule(SessionEntry *entry, const RTPTime &delay);
+	void Unschedule(SessionEntry *entry);
+	void RearmSockets(SessionEntry *entry);
+	void UnregisterSession(SessionEntry *entry);
+	void ClearSessions();
+	void CloseDescriptors();
+	
+	bool m_running;
+	bool m_stop;
+	int m_epollFd;
+	int m_timerFd;
+	RTPAbortDescriptors m_abortDesc;
+	jthread::JMutex m_mutex;
+	std::vector<RTPReactorWorker *> m_workers;
+
+	uint64_t m_nextId;
+	std::map<uint64_t, SessionEntry *> m_sessions; // the sessions which can still be dispatched
+	std::map<RTPSession *, SessionEntry *> m_sessionIndex; // all entries, including ones that are being removed
+
+	std::vector<WheelSlot> m_wheel;
+	size_t m_wheelPos;
+	double m_resolution;
+
+	friend class RTPReactorWorker;
+};
+
+} // end namespace
+
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_EPOLL
+
+#endif // RTPREACTOR_H
+
@@ -35,11 +35,12 @@
 #ifdef RTP_SUPPORT_SRTP
 
 #include "rtprawpacket.h"
+#include "rtpmemorymanager.h"
 #ifdef RTP_SUPPORT_THREAD
+#include "rtppollthread.h"
 #include <jthread/jmutexautolock.h>
 #endif
 #include <srtp/srtp.h>
-#include <iostream>
 #include <vector>
 
 using namespace std;
@@ -50,6 +51,117 @@ using namespace jthread;
 namespace jrtplib
 {
 
+// A receive context, together with the thread that uses it to decrypt the
+// packets that were assigned to it (the first context is used directly by
+// the polling thread and does not start its worker).
+
+class RTPSecureSessionReceiveShard
+#ifdef RTP_SUPPORT_THREAD
+	: public JThread
+#endif // RTP_SUPPORT_THREAD
+{
+	JRTPLIB_NO_COPY(RTPSecureSessionReceiveShard)
+public:
+	RTPSecureSessionReceiveShard(RTPSecureSession &session) : m_session(session)
+	{
+		m_pContext = 0;
+#ifdef RTP_SUPPORT_THREAD
+		m_hasJob = false;
+		m_stop = false;
+#endif // RTP_SUPPORT_THREAD
+	}
+
+	~RTPSecureSessionReceiveShard()
+	{
+#ifdef RTP_SUPPORT_THREAD
+		StopWorker();
+#endif // RTP_SUPPORT_THREAD
+		if (m_pContext)
+			srtp_dealloc(m_pContext);
+	}
+
+#ifdef RTP_SUPPORT_THREAD
+	int StartWorker()
+	{
+		int status;
+
+		if (!m_jobMutex.IsInitialized())
+		{
+			if (m_jobMutex.Init() < 0)
+				return ERR_RTP_SECURESESSION_CANTINITMUTEX;
+		}
+		if ((status = m_wakeSignal.Init()) < 0)
+			return status;
+		if (JThread::Start() < 0)
+			return ERR_RTP_SECURESESSION_CANTSTARTTHREAD;
+		return 0;
+	}
+
+	void StopWorker()
+	{
+		if (!m_wakeSignal.IsInitialized())
+			return;
+
+		m_jobMutex.Lock();
+		m_stop = true;
+		m_jobMutex.Unlock();
+		m_wakeSignal.SendAbortSignal();
+
+		RTPWaitForThreadStop(*this,"RTPSecureSession","decryption thread");
+		m_wakeSignal.Destroy();
+	}
+
+	void PostJob()
+	{
+		m_jobMutex.Lock();
+		m_hasJob = true;
+		m_jobMutex.Unlock();
+		m_wakeSignal.SendAbortSignal();
+	}
+
+	void *Thread()
+	{
+		JThread::ThreadStarted();
+
+		while (true)
+		{
+			// Blocks until PostJob or StopWorker writes a byte
+			m_wakeSignal.ReadSignallingByte();
+
+			m_jobMutex.Lock();
+			bool stop = m_stop;
+			bool hasJob = m_hasJob;
+			m_hasJob = false;
+			m_jobMutex.Unlock();
+
+			if (stop)
+				break;
+			if (!hasJob)
+				continue;
+
+			m_session.DecryptShard(this);
+
+			m_session.m_batchMutex.Lock();
+			m_session.m_batchPending--;
+			m_session.m_batchMutex.Unlock();
+			m_session.m_batchDoneSignal.SendAbortSignal();
+		}
+		return 0;
+	}
+
+	JMutex m_contextLock;
+#endif // RTP_SUPPORT_THREAD
+	srtp_ctx_t *m_pContext;
+	std::vector<int> m_packetIndices;
+private:
+	RTPSecureSession &m_session;
+#ifdef RTP_SUPPORT_THREAD
+	JMutex m_jobMutex;
+	RTPAbortDescriptors m_wakeSignal;
+	bool m_hasJob, m_stop;
+#endif // RTP_SUPPORT_THREAD
+};
+
 // SRTP library needs to be initialized already!
 
 RTPSecureSession::RTPSecureSession(RTPRandom *rnd, RTPMemoryManager *mgr) : RTPSession(rnd, mgr)
@@ -57,12 +169,19 @@ RTPSecureSession::RTPSecureSession(RTPRandom *rnd, RTPMemoryManager *mgr) : RTPS
 	// Make sure the OnChange... functions will be called
 	SetChangeIncomingData(true);
 	SetChangeOutgoingData(true);
+	// Leave room for the authentication tag so RTP data can be protected in place
+	SetOutgoingRTPDataTrailerReserve(SRTP_MAX_TRAILER_LEN);
 	m_pSRTPContext = 0;
 	m_lastSRTPError = 0;
+	m_pBatchPackets = 0;
+#ifdef RTP_SUPPORT_THREAD
+	m_batchPending = 0;
+#endif // RTP_SUPPORT_THREAD
 }
 
 RTPSecureSession::~RTPSecureSession()
 {
+	DestroyReceiveShards();
 	if (m_pSRTPContext)
 		srtp_dealloc(m_pSRTPContext);
 }
@@ -93,6 +212,101 @@ int RTPSecureSession::InitializeSRTPContext()
 	return 0;
 }
 
+int RTPSecureSession::InitializeSRTPReceiveContexts(int numcontexts)
+{
+	if (numcontexts < 1)
+		return ERR_RTP_SECURESESSION_ILLEGALNUMBEROFRECEIVECONTEXTS;
+	if (!m_receiveShards.empty())
+		return ERR_RTP_SECURESESSION_RECEIVECONTEXTSALREADYINITIALIZED;
+
+#ifdef RTP_SUPPORT_THREAD
+	int status;
+
+	if (!m_batchMutex.IsInitialized())
+	{
+		if (m_batchMutex.Init() < 0)
+			return ERR_RTP_SECURESESSION_CANTINITMUTEX;
+	}
+	if (numcontexts > 1 && !m_batchDoneSignal.IsInitialized())
+	{
+		if ((status = m_batchDoneSignal.Init()) < 0)
+			return status;
+	}
+#endif // RTP_SUPPORT_THREAD
+
+	for (int i = 0 ; i < numcontexts ; i++)
+	{
+		RTPSecureSessionReceiveShard *pShard = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_SRTPRECEIVESHARD) RTPSecureSessionReceiveShard(*this);
+		if (pShard == 0)
+		{
+			DestroyReceiveShards();
+			return ERR_RTP_OUTOFMEM;
+		}
+		m_receiveShards.push_back(pShard);
+
+		err_status_t result = srtp_create(&pShard->m_pContext, NULL);
+		if (result != err_status_ok)
+		{
+			pShard->m_pContext = 0;
+			DestroyReceiveShards();
+			SetLastLibSRTPError((int)result);
+			return ERR_RTP_SECURESESSION_CANTINITIALIZE_SRTPCONTEXT;
+		}
+
+#ifdef RTP_SUPPORT_THREAD
+		if (pShard->m_contextLock.Init() < 0)
+		{
+			DestroyReceiveShards();
+			return ERR_RTP_SECURESESSION_CANTINITMUTEX;
+		}
+		// The first context is used by the thread that polls for data
+		if (i > 0 && (status = pShard->StartWorker()) < 0)
+		{
+			DestroyReceiveShards();
+			return status;
+		}
+#endif // RTP_SUPPORT_THREAD
+	}
+	return 0;
+}
+
+void RTPSecureSession::DestroyReceiveShards()
+{
+	for (size_t i = 0 ; i < m_receiveShards.size() ; i++)
+		RTPDelete(m_receiveShards[i],GetMemoryManager());
+	m_receiveShards.clear();
+}
+
+int RTPSecureSession::GetSRTPReceiveContextIndex(uint32_t ssrc) const
+{
+	if (m_receiveShards.empty())
+		return 0;
+	return (int)(ssrc%(uint32_t)m_receiveShards.size());
+}
+
+srtp_ctx_t *RTPSecureSession::LockSRTPReceiveContext(int idx)
+{
+	if (idx < 0 || idx >= (int)m_receiveShards.size())
+		return 0;
+
+	RTPSecureSessionReceiveShard *pShard = m_receiveShards[idx];
+#ifdef RTP_SUPPORT_THREAD
+	pShard->m_contextLock.Lock();
+#endif // RTP_SUPPORT_THREAD
+	return pShard->m_pContext;
+}
+
+int RTPSecureSession::UnlockSRTPReceiveContext(int idx)
+{
+	if (idx < 0 || idx >= (int)m_receiveShards.size())
+		return ERR_RTP_SECURESESSION_INVALIDRECEIVECONTEXTINDEX;
+
+#ifdef RTP_SUPPORT_THREAD
+	m_receiveShards[idx]->m_contextLock.Unlock();
+#endif // RTP_SUPPORT_THREAD
+	return 0;
+}
+
 int RTPSecureSession::GetLastLibSRTPError()
 {
 #ifdef RTP_SUPPORT_THREAD
@@ -209,7 +423,59 @@ int RTPSecureSession::OnChangeRTPOrRTCPData(const void *origdata, size_t origlen
 	return 0;
 }
 
-int RTPSecureSession::decryptRawPacket(RTPRawPacket *rawpack, int *srtpError)
+int RTPSecureSession::ProtectRTPPackets(uint8_t *packets[], size_t lengths[], int numpackets)
+{
+	srtp_ctx_t *pCtx = LockSRTPContext();
+	if (pCtx == 0)
+	{
+		for (int i = 0 ; i < numpackets ; i++)
+			lengths[i] = 0;
+		return ERR_RTP_SECURESESSION_CONTEXTNOTINITIALIZED;
+	}
+
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		int status = 0;
+		int dataLength = (int)lengths[i];
+
+		if ((status = encryptData(packets[i], dataLength, true)) < 0)
+		{
+			UnlockSRTPContext();
+
+			// The packets that were protected already can still be sent, the
+			// others must not be
+			for (int j = i ; j < numpackets ; j++)
+				lengths[j] = 0;
+			return status;
+		}
+		lengths[i] = (size_t)dataLength;
+	}
+
+	UnlockSRTPContext();
+	return 0;
+}
+
+int RTPSecureSession::OnChangeRTPDataInPlace(uint8_t *packets[], size_t lengths[], const size_t buffersizes[], int numpackets, bool *changed)
+{
+	*changed = false;
+
+	// If any of the buffers is too small, let everything go through the copying 
+	// OnChangeRTPOrRTCPData instead
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		if (lengths[i] + SRTP_MAX_TRAILER_LEN > buffersizes[i])
+			return 0;
+	}
+
+	// Also on error, the packets that were protected before it occurred are
+	// sent; the lengths of the others are set to zero
+	int status = ProtectRTPPackets(packets, lengths, numpackets);
+
+	*changed = true;
+	return status;
+}
+
+int RTPSecureSession::decryptRawPacket(srtp_ctx_t *pCtx, RTPRawPacket *rawpack, int *srtpError)
 {
 	*srtpError = 0;
 
@@ -221,7 +487,7 @@ int RTPSecureSession::decryptRawPacket(RTPRawPacket *rawpack, int *srtpError)
 		if (dataLength < (int)sizeof(uint32_t)*3)
 			return ERR_RTP_SECURESESSION_NOTENOUGHDATATODECRYPT;
 
-		err_status_t result = srtp_unprotect(m_pSRTPContext, (void*)pData, &dataLength);
+		err_status_t result = srtp_unprotect(pCtx, (void*)pData, &dataLength);
 		if (result != err_status_ok)
 		{
 			*srtpError = result;
@@ -233,7 +499,7 @@ int RTPSecureSession::decryptRawPacket(RTPRawPacket *rawpack, int *srtpError)
 		if (dataLength < (int)sizeof(uint32_t)*2)
 			return ERR_RTP_SECURESESSION_NOTENOUGHDATATODECRYPT;
 
-		err_status_t result = srtp_unprotect_rtcp(m_pSRTPContext, (void *)pData, &dataLength);
+		err_status_t result = srtp_unprotect_rtcp(pCtx, (void *)pData, &dataLength);
 		if (result != err_status_ok)
 		{
 			*srtpError = result;
@@ -252,24 +518,127 @@ bool RTPSecureSession::OnChangeIncomingData(RTPRawPacket *rawpack)
 	if (!rawpack)
 		return false;
 
-	srtp_ctx_t *pCtx = LockSRTPContext();
-	if (pCtx == 0)
+	int8_t keep = 0;
+	OnChangeIncomingDataBatch(&rawpack, &keep, 1);
+	return (keep != 0);
+}
+
+void RTPSecureSession::OnChangeIncomingDataBatch(RTPRawPacket *rawpacks[], int8_t keep[], int numpackets)
+{
+	m_batchStatus.resize(numpackets);
+	m_batchSRTPErrors.resize(numpackets);
+
+	if (m_receiveShards.empty())
 	{
-		OnErrorChangeIncomingData(ERR_RTP_SECURESESSION_CONTEXTNOTINITIALIZED, 0);
-		return false;
+		// Everything is decrypted using the main context, which then only
+		// needs to be locked once for the entire batch
+
+		srtp_ctx_t *pCtx = LockSRTPContext();
+
+		for (int i = 0 ; i < numpackets ; i++)
+		{
+			m_batchSRTPErrors[i] = 0;
+			if (pCtx == 0)
+				m_batchStatus[i] = ERR_RTP_SECURESESSION_CONTEXTNOTINITIALIZED;
+			else
+				m_batchStatus[i] = decryptRawPacket(pCtx, rawpacks[i], &m_batchSRTPErrors[i]);
+		}
+		if (pCtx)
+			UnlockSRTPContext();
 	}
+	else
+	{
+		// Divide the packets over the receive contexts based on their SSRC, so
+		// the packets of a specific SSRC are decrypted in order by the same context
 
-	int srtpErr = 0;
-	int status = decryptRawPacket(rawpack, &srtpErr);
-	UnlockSRTPContext();
+		size_t numShards = m_receiveShards.size();
+
+		for (size_t j = 0 ; j < numShards ; j++)
+			m_receiveShards[j]->m_packetIndices.clear();
+
+		for (int i = 0 ; i < numpackets ; i++)
+		{
+			const uint8_t *pData = rawpacks[i]->GetData();
+			size_t dataLength = rawpacks[i]->GetDataLength();
+			size_t ssrcOffset = (rawpacks[i]->IsRTP())?8:4;
+			uint32_t ssrc = 0;
+
+			// Too short packets will fail to decrypt anyway
+			if (dataLength >= ssrcOffset + sizeof(uint32_t))
+				ssrc = ((uint32_t)pData[ssrcOffset] << 24) | ((uint32_t)pData[ssrcOffset+1] << 16) |
+				       ((uint32_t)pData[ssrcOffset+2] << 8) | (uint32_t)pData[ssrcOffset+3];
+
+			m_receiveShards[GetSRTPReceiveContextIndex(ssrc)]->m_packetIndices.push_back(i);
+			m_batchSRTPErrors[i] = 0;
+		}
+
+		m_pBatchPackets = rawpacks;
+
+#ifdef RTP_SUPPORT_THREAD
+		int numJobs = 0;
+
+		for (size_t j = 1 ; j < numShards ; j++)
+		{
+			if (!m_receiveShards[j]->m_packetIndices.empty())
+				numJobs++;
+		}
+
+		m_batchMutex.Lock();
+		m_batchPending = numJobs;
+		m_batchMutex.Unlock();
+
+		for (size_t j = 1 ; j < numShards ; j++)
+		{
+			if (!m_receiveShards[j]->m_packetIndices.empty())
+				m_receiveShards[j]->PostJob();
+		}
 
-	if (status < 0)
+		DecryptShard(m_receiveShards[0]);
+
+		// Each worker sends one byte when it's done; the pending count protects
+		// against a read that was interrupted
+		for (int received = 0 ; ; received++)
+		{
+			m_batchMutex.Lock();
+			int pending = m_batchPending;
+			m_batchMutex.Unlock();
+
+			if (pending == 0 && received >= numJobs)
+				break;
+			m_batchDoneSignal.ReadSignallingByte();
+		}
+#else
+		for (size_t j = 0 ; j < numShards ; j++)
+			DecryptShard(m_receiveShards[j]);
+#endif // RTP_SUPPORT_THREAD
+
+		m_pBatchPackets = 0;
+	}
+
+	// Report the errors from this thread, in the order the packets were received
+	for (int i = 0 ; i < numpackets ; i++)
 	{
-		OnErrorChangeIncomingData(status, srtpErr);
-		return false;
+		if (m_batchStatus[i] < 0)
+		{
+			keep[i] = 0;
+			OnErrorChangeIncomingData(m_batchStatus[i], m_batchSRTPErrors[i]);
+		}
+		else
+			keep[i] = 1;
+	}
+}
+
+void RTPSecureSession::DecryptShard(RTPSecureSessionReceiveShard *pShard)
+{
+#ifdef RTP_SUPPORT_THREAD
+	JMutexAutoLock l(pShard->m_contextLock);
+#endif // RTP_SUPPORT_THREAD
+
+	for (size_t i = 0 ; i < pShard->m_packetIndices.size() ; i++)
+	{
+		int idx = pShard->m_packetIndices[i];
+		m_batchStatus[idx] = decryptRawPacket(pShard->m_pContext, m_pBatchPackets[idx], &m_batchSRTPErrors[idx]);
 	}
-	
-	return true;
 }
 
 void RTPSecureSession::OnSentRTPOrRTCPData(void *senddata, size_t sendlen, bool isrtp)
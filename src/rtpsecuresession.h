@@ -44,6 +44,9 @@
 
 #include "rtpsession.h"
 
+#include "rtpabortdescriptors.h"
+#include <vector>
+
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jthread.h>
 #endif // RTP_SUPPORT_THREAD
@@ -54,6 +57,7 @@ namespace jrtplib
 {
 
 class RTPCrypt;
+class RTPSecureSessionReceiveShard;
 
 // SRTP library needs to be initialized already!
 
@@ -63,6 +67,8 @@ class RTPCrypt;
  *  The class sets the RTPSession::SetChangeIncomingData and RTPSession::SetChangeOutgoingData
  *  flags, and implements RTPSession::OnChangeIncomingData, RTPSession::OnChangeRTPOrRTCPData
  *  and RTPSession::OnSentRTPOrRTCPData so that encryption and decryption is applied to packets.
+ *  Outgoing RTP packets are encrypted in place in the session's packet buffer, through
+ *  RTPSession::OnChangeRTPDataInPlace; only RTCP packets are still copied before encryption.
  *  The encryption and decryption will be done using [libsrtp](https://github.com/cisco/libsrtp),
  *  which must be available at compile time.
  *
@@ -72,6 +78,16 @@ class RTPCrypt;
  *  available. After you're done using the context yourself (to set encryption parameters for
  *  SSRCs), you **must** release it again using RTPSecureSession::UnlockSRTPContext.
  *
+ *  By default, incoming packets are decrypted using that same context. For sessions with many
+ *  participants, RTPSecureSession::InitializeSRTPReceiveContexts can be used to create a number
+ *  of separate receive contexts instead, each of which is responsible for the SSRCs for which
+ *  RTPSecureSession::GetSRTPReceiveContextIndex returns its index. The packets of a single poll
+ *  are then decrypted in parallel by worker threads, one per receive context, so that all
+ *  packets of a specific SSRC are still handled by the same context, in order. The keys for
+ *  incoming streams must then be set in the receive contexts (obtained with
+ *  RTPSecureSession::LockSRTPReceiveContext), while the original context is only used for
+ *  the outgoing data.
+ *
  *  See `example7.cpp` for an example of how to use this class.
  */
 class JRTPLIB_IMPORTEXPORT RTPSecureSession : public RTPSession
@@ -97,6 +113,37 @@ protected:
 	 *  RTPSecureSession::LockSRTPContext. */
 	int UnlockSRTPContext();
 
+	/** Creates \c numcontexts separate `libsrtp` contexts to decrypt incoming data.
+	 *  Creates \c numcontexts separate `libsrtp` contexts to decrypt incoming data, and if
+	 *  thread support is available, starts \c numcontexts-1 worker threads so that the
+	 *  contexts can be used in parallel (the thread which polls for incoming data uses one 
+	 *  context as well). Note that the streams for incoming data need to be added to these
+	 *  contexts, see RTPSecureSession::LockSRTPReceiveContext. This must be called before the
+	 *  session receives data; in case of an error it may be useful to inspect
+	 *  RTPSecureSession::GetLastLibSRTPError.
+	 */
+	int InitializeSRTPReceiveContexts(int numcontexts);
+
+	/** Returns the number of receive contexts that were created using 
+	 *  RTPSecureSession::InitializeSRTPReceiveContexts. */
+	int GetNumberOfSRTPReceiveContexts() const									{ return (int)m_receiveShards.size(); }
+
+	/** Returns the index of the receive context that decrypts the data of SSRC \c ssrc. */
+	int GetSRTPReceiveContextIndex(uint32_t ssrc) const;
+
+	/** Locks and returns the receive context with index \c idx, which needs to be released
+	 *  again using RTPSecureSession::UnlockSRTPReceiveContext. 
+	 *  Locks and returns the receive context with index \c idx, which needs to be released
+	 *  again using RTPSecureSession::UnlockSRTPReceiveContext. The stream of an incoming SSRC
+	 *  must be added to the context with index RTPSecureSession::GetSRTPReceiveContextIndex;
+	 *  a policy for any inbound SSRC must be added to all receive contexts.
+	 */
+	srtp_ctx_t *LockSRTPReceiveContext(int idx);
+
+	/** Releases the lock on the receive context with index \c idx that was obtained
+	 *  in RTPSecureSession::LockSRTPReceiveContext. */
+	int UnlockSRTPReceiveContext(int idx);
+
 	/** Returns (and clears) the last error that was encountered when using a
 	 *  `libsrtp` based function. */
 	int GetLastLibSRTPError();
@@ -108,18 +155,44 @@ protected:
 	 *  called; implement it in a derived class to receive notification of this. */
 	virtual void OnErrorChangeIncomingData(int errcode, int libsrtperrorcode);
 
+	/** Encrypts \c numpackets RTP packets in their own buffers.
+	 *  Encrypts \c numpackets RTP packets in their own buffers, locking the SRTP context only
+	 *  once for the entire batch. Each buffer in \c packets must have room for at least 
+	 *  `SRTP_MAX_TRAILER_LEN` bytes after the packet data of length \c lengths[i]; on success, 
+	 *  \c lengths is updated to contain the lengths of the protected packets. If protecting a
+	 *  packet fails, the packets before it keep their protected lengths and the length of that
+	 *  packet and all following ones is set to zero: the protected packets should still be sent,
+	 *  since the SRTP state already accounts for them, while the others must be dropped.
+	 */
+	int ProtectRTPPackets(uint8_t *packets[], size_t lengths[], int numpackets);
+
 	int OnChangeRTPOrRTCPData(const void *origdata, size_t origlen, bool isrtp, void **senddata, size_t *sendlen);
+	int OnChangeRTPDataInPlace(uint8_t *packets[], size_t lengths[], const size_t buffersizes[], int numpackets, bool *changed);
 	bool OnChangeIncomingData(RTPRawPacket *rawpack);
+	void OnChangeIncomingDataBatch(RTPRawPacket *rawpacks[], int8_t keep[], int numpackets);
 	void OnSentRTPOrRTCPData(void *senddata, size_t sendlen, bool isrtp);
 private:
 	int encryptData(uint8_t *pData, int &dataLength, bool rtp);
-	int decryptRawPacket(RTPRawPacket *rawpack, int *srtpError);
+	int decryptRawPacket(srtp_ctx_t *pCtx, RTPRawPacket *rawpack, int *srtpError);
+	void DecryptShard(RTPSecureSessionReceiveShard *pShard);
+	void DestroyReceiveShards();
 
 	srtp_ctx_t *m_pSRTPContext;
 	int m_lastSRTPError;
 #ifdef RTP_SUPPORT_THREAD
 	jthread::JMutex m_srtpLock;
 #endif // RTP_SUPPORT_THREAD
+
+	std::vector<RTPSecureSessionReceiveShard *> m_receiveShards;
+	RTPRawPacket **m_pBatchPackets;
+	std::vector<int> m_batchStatus, m_batchSRTPErrors;
+#ifdef RTP_SUPPORT_THREAD
+	RTPAbortDescriptors m_batchDoneSignal;
+	jthread::JMutex m_batchMutex;
+	int m_batchPending;
+#endif // RTP_SUPPORT_THREAD
+
+	friend class RTPSecureSessionReceiveShard;
 };
 
 inline void RTPSecureSession::OnErrorChangeIncomingData(int, int) { }
@@ -94,6 +94,8 @@ RTPSession::RTPSession(RTPRandom *r,RTPMemoryManager *mgr)
 	// can already change them
 	m_changeIncomingData = false;
 	m_changeOutgoingData = false;
+	m_outgoingTrailerReserve = 0;
+	m_incomingBatchPos = 0;
 
 	created = false;
 	timeinit.Dummy();
@@ -210,7 +212,7 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 
 	// Initialize packet builder
 	
-	if ((status = packetbuilder.Init(maxpacksize)) < 0)
+	if ((status = packetbuilder.Init(maxpacksize,m_outgoingTrailerReserve)) < 0)
 	{
 		if (deletetransmitter)
 			RTPDelete(rtptrans,GetMemoryManager());
@@ -227,6 +229,9 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 
 #endif // RTP_SUPPORT_PROBATION
 
+	sources.SetReorderDepth(sessparams.GetReorderDepth());
+	sources.SetReorderPackets(sessparams.GetReorderPackets());
+
 	// Add our own ssrc to the source table
 	
 	if ((status = sources.CreateOwnSSRC(packetbuilder.GetSSRC())) < 0)
@@ -426,6 +431,7 @@ void RTPSession::Destroy()
 		RTPDelete(pollthread,GetMemoryManager());
 #endif // RTP_SUPPORT_THREAD
 	
+	ClearIncomingBatch();
 	if (deletetransmitter)
 		RTPDelete(rtptrans,GetMemoryManager());
 	packetbuilder.Destroy();
@@ -508,6 +514,7 @@ void RTPSession::BYEDestroy(const RTPTime &maxwaittime,const void *reason,size_t
 		}
 	}
 	
+	ClearIncomingBatch();
 	if (deletetransmitter)
 		RTPDelete(rtptrans,GetMemoryManager());
 	packetbuilder.Destroy();
@@ -606,7 +613,7 @@ int RTPSession::SendPacket(const void *data,size_t len)
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket(packetbuilder.GetPacketLength())) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -636,7 +643,7 @@ int RTPSession::SendPacket(const void *data,size_t len,
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket(packetbuilder.GetPacketLength())) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -666,7 +673,7 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket(packetbuilder.GetPacketLength())) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -697,7 +704,86 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket(packetbuilder.GetPacketLength())) < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+	BUILDER_UNLOCK
+
+	SOURCES_LOCK
+	sources.SentRTPPacket();
+	SOURCES_UNLOCK
+	PACKSENT_LOCK
+	sentpackets = true;
+	PACKSENT_UNLOCK
+	return 0;
+}
+
+int RTPSession::SendPacketIov(const RTPIOVec *payload,int numparts)
+{
+	return PrivateSendPacketIov(payload,numparts,true,0,false,0);
+}
+
+int RTPSession::SendPacketIov(const RTPIOVec *payload,int numparts,
+                  uint8_t pt,bool mark,uint32_t timestampinc)
+{
+	return PrivateSendPacketIov(payload,numparts,false,pt,mark,timestampinc);
+}
+
+int RTPSession::PrivateSendPacketIov(const RTPIOVec *payload,int numparts,bool usedefaults,
+                         uint8_t pt,bool mark,uint32_t timestampinc)
+{
+	int status;
+
+	if (!created)
+		return ERR_RTP_SESSION_NOTCREATED;
+	if (numparts < 0 || numparts > RTP_MAXIOVECS-1) // one entry is needed for the header
+		return ERR_RTP_SESSION_TOOMANYPAYLOADPARTS;
+
+	size_t len = 0;
+	for (int i = 0 ; i < numparts ; i++)
+		len += payload[i].len;
+
+	BUILDER_LOCK
+	if (usedefaults)
+		status = packetbuilder.BuildPacketHeader(len);
+	else
+		status = packetbuilder.BuildPacketHeader(len,pt,mark,timestampinc);
+	if (status < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+
+	size_t hdrlen = packetbuilder.GetPacketLength();
+
+	if (m_changeOutgoingData)
+	{
+		// The packet needs to be modified (e.g. encrypted) anyway, so we'll
+		// gather the payload behind the header, where the builder made room
+		// for it, and let it be changed in place
+		uint8_t *pData = packetbuilder.GetPacket()+hdrlen;
+
+		for (int i = 0 ; i < numparts ; i++)
+		{
+			if (payload[i].len > 0)
+				memcpy(pData,payload[i].data,payload[i].len);
+			pData += payload[i].len;
+		}
+		status = SendBuiltRTPPacket(hdrlen+len);
+	}
+	else
+	{
+		RTPIOVec iov[RTP_MAXIOVECS];
+
+		iov[0].data = packetbuilder.GetPacket();
+		iov[0].len = hdrlen;
+		for (int i = 0 ; i < numparts ; i++)
+			iov[i+1] = payload[i];
+		status = rtptrans->SendRTPDataIov(iov,numparts+1);
+	}
+	if (status < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -713,6 +799,124 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 	return 0;
 }
 
+int RTPSession::SendPackets(const RTPIOVec *payloads,int numpackets,bool markonlast)
+{
+	return PrivateSendPackets(payloads,numpackets,true,0,markonlast,0);
+}
+
+int RTPSession::SendPackets(const RTPIOVec *payloads,int numpackets,
+                uint8_t pt,bool markonlast,uint32_t timestampinc)
+{
+	return PrivateSendPackets(payloads,numpackets,false,pt,markonlast,timestampinc);
+}
+
+int RTPSession::PrivateSendPackets(const RTPIOVec *payloads,int numpackets,bool usedefaults,
+                       uint8_t pt,bool markonlast,uint32_t timestampinc)
+{
+	int status;
+
+	if (!created)
+		return ERR_RTP_SESSION_NOTCREATED;
+	if (numpackets <= 0)
+		return 0;
+
+	BUILDER_LOCK
+	// If the packets need to be changed (e.g. encrypted), the payloads are
+	// copied behind the headers so that this can be done in place
+	if (usedefaults)
+		status = packetbuilder.BuildPacketBatch(payloads,numpackets,markonlast,m_changeOutgoingData);
+	else
+		status = packetbuilder.BuildPacketBatch(payloads,numpackets,pt,markonlast,timestampinc,m_changeOutgoingData);
+	if (status < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+
+	uint8_t **packets = packetbuilder.GetBatchPackets();
+	size_t *lengths = packetbuilder.GetBatchPacketLengths();
+	int numiov = 0;
+	int numsent = 0;
+	int changestatus = 0;
+	bool changed = false;
+
+	if (m_changeOutgoingData)
+	{
+		status = OnChangeRTPDataInPlace(packets,lengths,packetbuilder.GetBatchPacketBufferSizes(),numpackets,&changed);
+		if (status < 0)
+		{
+			if (!changed)
+			{
+				BUILDER_UNLOCK
+				return status;
+			}
+
+			// Some packets were changed before the error occurred; they are
+			// still sent, the error is returned afterwards
+			changestatus = status;
+			status = 0;
+		}
+	}
+
+	if (!m_changeOutgoingData || changed)
+	{
+		if (m_outgoingBatchIOV.size() < (size_t)numpackets*2)
+		{
+			m_outgoingBatchIOV.resize(numpackets*2);
+			m_outgoingBatchNumIOV.resize(numpackets);
+		}
+
+		int num = 0;
+		for (int i = 0 ; i < numpackets ; i++)
+		{
+			if (changed) // the packets are complete now, but some may need to be skipped
+			{
+				if (lengths[i] == 0)
+					continue;
+				m_outgoingBatchIOV[numiov].data = packets[i];
+				m_outgoingBatchIOV[numiov].len = lengths[i];
+				m_outgoingBatchNumIOV[num] = 1;
+				numiov++;
+			}
+			else
+			{
+				m_outgoingBatchIOV[numiov].data = packets[i];
+				m_outgoingBatchIOV[numiov].len = lengths[i];
+				m_outgoingBatchIOV[numiov+1] = payloads[i];
+				m_outgoingBatchNumIOV[num] = 2;
+				numiov += 2;
+			}
+			num++;
+		}
+		if (num > 0)
+			status = rtptrans->SendRTPDataBatch(&(m_outgoingBatchIOV[0]),&(m_outgoingBatchNumIOV[0]),num);
+		numsent = num;
+	}
+	else
+	{
+		for (int i = 0 ; status >= 0 && i < numpackets ; i++)
+			status = SendRTPData(packets[i],lengths[i]);
+		numsent = numpackets;
+	}
+	if (status < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+	BUILDER_UNLOCK
+
+	if (changestatus < 0 && numsent == 0) // none of the packets could be changed
+		return changestatus;
+
+	SOURCES_LOCK
+	sources.SentRTPPacket();
+	SOURCES_UNLOCK
+	PACKSENT_LOCK
+	sentpackets = true;
+	PACKSENT_UNLOCK
+	return changestatus;
+}
+
 #ifdef RTP_SUPPORT_SENDAPP
 
 int RTPSession::SendRTCPAPPPacket(uint8_t subtype, const uint8_t name[4], const void *appdata, size_t appdatalen)
@@ -1113,6 +1317,17 @@ RTPPacket *RTPSession::GetNextPacket()
 	return sources.GetNextPacket();
 }
 
+RTPPacket *RTPSession::GetPlayoutPacket(const RTPTime &now,uint32_t *lost)
+{
+	if (!created)
+	{
+		if (lost)
+			*lost = 0;
+		return 0;
+	}
+	return sources.GetPlayoutPacket(now,lost);
+}
+
 uint16_t RTPSession::GetNextSequenceNumber() const
 {
     return packetbuilder.GetSequenceNumber();
@@ -1376,19 +1591,25 @@ int RTPSession::ProcessPolledData()
 	RTPRawPacket *rawpack;
 	int status;
 	
-	SOURCES_LOCK
-	while ((rawpack = rtptrans->GetNextPacket()) != 0)
+	if (m_changeIncomingData)
 	{
-		if (m_changeIncomingData)
+		// Provide a way to change incoming data, for decryption for example. This
+		// is done for all available packets at once, before locking the sources.
+
+		ClearIncomingBatch(); // in case an error caused packets to be left behind
+		while ((rawpack = rtptrans->GetNextPacket()) != 0)
+			m_incomingBatch.push_back(rawpack);
+
+		if (!m_incomingBatch.empty())
 		{
-			// Provide a way to change incoming data, for decryption for example
-			if (!OnChangeIncomingData(rawpack))
-			{
-				RTPDelete(rawpack,GetMemoryManager());
-				continue;
-			}
+			m_incomingBatchKeep.resize(m_incomingBatch.size());
+			OnChangeIncomingDataBatch(&(m_incomingBatch[0]), &(m_incomingBatchKeep[0]), (int)m_incomingBatch.size());
 		}
+	}
 
+	SOURCES_LOCK
+	while ((rawpack = GetNextPolledPacket()) != 0)
+	{
 		sources.ClearOwnCollisionFlag();
 
 		// since our sources instance also uses the scheduler (analysis of incoming packets)
@@ -1680,6 +1901,62 @@ int RTPSession::SendRTPData(const void *data, size_t len)
 	return status;
 }
 
+RTPRawPacket *RTPSession::GetNextPolledPacket()
+{
+	if (!m_changeIncomingData)
+		return rtptrans->GetNextPacket();
+
+	while (m_incomingBatchPos < m_incomingBatch.size())
+	{
+		size_t idx = m_incomingBatchPos++;
+		RTPRawPacket *rawpack = m_incomingBatch[idx];
+
+		if (m_incomingBatchKeep[idx])
+			return rawpack;
+		RTPDelete(rawpack,GetMemoryManager());
+	}
+	m_incomingBatch.clear();
+	m_incomingBatchPos = 0;
+	return 0;
+}
+
+void RTPSession::ClearIncomingBatch()
+{
+	for (size_t i = m_incomingBatchPos ; i < m_incomingBatch.size() ; i++)
+		RTPDelete(m_incomingBatch[i],GetMemoryManager());
+	m_incomingBatch.clear();
+	m_incomingBatchPos = 0;
+}
+
+void RTPSession::OnChangeIncomingDataBatch(RTPRawPacket *rawpacks[], int8_t keep[], int numpackets)
+{
+	for (int i = 0 ; i < numpackets ; i++)
+		keep[i] = (OnChangeIncomingData(rawpacks[i]))?1:0;
+}
+
+int RTPSession::SendBuiltRTPPacket(size_t len)
+{
+	uint8_t *pData = packetbuilder.GetPacket();
+
+	if (!m_changeOutgoingData)
+		return rtptrans->SendRTPData(pData, len);
+
+	// Give a derived class the chance to modify the packet in the builder's
+	// buffer, which avoids an allocation and copy per packet
+
+	size_t bufSize = packetbuilder.GetPacketBufferSize();
+	bool changed = false;
+	int status = OnChangeRTPDataInPlace(&pData, &len, &bufSize, 1, &changed);
+	if (status < 0)
+		return status;
+
+	if (!changed)
+		return SendRTPData(pData, len);
+	if (len == 0)
+		return 0;
+	return rtptrans->SendRTPData(pData, len);
+}
+
 int RTPSession::SendRTCPData(const void *data, size_t len)
 {
 	if (!m_changeOutgoingData)
@@ -50,6 +50,7 @@
 #include "rtcpcompoundpacketbuilder.h"
 #include "rtpmemoryobject.h"
 #include <list>
+#include <vector>
 
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jmutex.h>	
@@ -64,6 +65,7 @@ class RTPTransmissionParams;
 class RTPAddress;
 class RTPSourceData;
 class RTPPacket;
+class RTPPacketView;
 class RTPPollThread;
 class RTPTransmissionInfo;
 class RTCPCompoundPacket;
@@ -122,6 +124,9 @@ public:
 
 	/** Returns whether the session has been created or not. */
 	bool IsActive();
+
+	/** Returns \c true if the session was created with its own poll thread (see RTPSessionParams::SetUsePollThread). */
+	bool IsUsingPollThread() const										{ return usingpollthread; }
 	
 	/** Returns our own SSRC. */
 	uint32_t GetLocalSSRC();
@@ -179,6 +184,41 @@ public:
 	int SendPacketEx(const void *data,size_t len,
 	                  uint8_t pt,bool mark,uint32_t timestampinc,
 	                  uint16_t hdrextID,const void *hdrextdata,size_t numhdrextwords);
+
+	/** Sends the RTP packet with a payload consisting of the \c numparts parts described by \c payload.
+	 *  Sends the RTP packet with a payload consisting of the \c numparts parts described by \c payload,
+	 *  which can be at most RTP_MAXIOVECS-1. Only the RTP header is built in the packet builder's buffer,
+	 *  the payload parts are passed on to the transmitter as they are, so that e.g. a payload that's
+	 *  stored in a (shared) frame buffer doesn't need to be copied first. The used payload type, marker and
+	 *  timestamp increment will be those that have been set using the \c SetDefault member functions.
+	 */
+	int SendPacketIov(const RTPIOVec *payload,int numparts);
+
+	/** Sends the RTP packet with a payload consisting of the \c numparts parts described by \c payload.
+	 *  It will use payload type \c pt, marker \c mark and after the packet has been built, the 
+	 *  timestamp will be incremented by \c timestampinc. See the other RTPSession::SendPacketIov
+	 *  function for more information.
+	 */
+	int SendPacketIov(const RTPIOVec *payload,int numparts,
+	                  uint8_t pt,bool mark,uint32_t timestampinc);
+
+	/** Sends a batch of \c numpackets RTP packets, e.g. all packets of a video frame, at once.
+	 *  Sends a batch of \c numpackets RTP packets at once, the payload of the i-th packet being described
+	 *  by \c payloads[i]. The headers are built in one pass, the locks are taken only once and the packets
+	 *  are passed on to the transmitter as a batch (the UDP transmitters use 'sendmmsg' if available). All
+	 *  packets get the same timestamp and the default payload type; if \c markonlast is set the marker bit
+	 *  of the last packet is set. Afterwards, the timestamp is incremented with the default timestamp
+	 *  increment.
+	 */
+	int SendPackets(const RTPIOVec *payloads,int numpackets,bool markonlast);
+
+	/** Sends a batch of \c numpackets RTP packets, e.g. all packets of a video frame, at once.
+	 *  It will use payload type \c pt and after the packets have been built, the timestamp will be
+	 *  incremented by \c timestampinc. See the other RTPSession::SendPackets function for more 
+	 *  information.
+	 */
+	int SendPackets(const RTPIOVec *payloads,int numpackets,
+	                uint8_t pt,bool markonlast,uint32_t timestampinc);
 #ifdef RTP_SUPPORT_SENDAPP
 	/** If sending of RTCP APP packets was enabled at compile time, this function creates a compound packet 
 	 *  containing an RTCP APP packet and sends it immediately. 
@@ -283,6 +323,8 @@ public:
 	/** Starts the iteration over the participants by going to the first member in the table. 
 	 *  Starts the iteration over the participants by going to the first member in the table.
 	 *  If a member was found, the function returns \c true, otherwise it returns \c false.
+	 *  Removing a member changes the order in which the others are visited, see 
+	 *  RTPSources::GotoFirstSource.
 	 */
 	bool GotoFirstSource();
 
@@ -338,6 +380,14 @@ public:
 	 */
 	RTPPacket *GetNextPacket();
 
+	/** Extracts the next packet of the current participant if it's time to play it out.
+	 *  Extracts the next packet of the current participant if its playout time, as determined by the 
+	 *  participant's adaptive jitter buffer, has come at time \c now (see RTPSourceData::GetPlayoutPacket).
+	 *  Returns NULL otherwise. If \c lost is not NULL, the number of packets which were lost just before 
+	 *  the returned one is stored in it. The packet should be freed using the DeletePacket member function.
+	 */
+	RTPPacket *GetPlayoutPacket(const RTPTime &now,uint32_t *lost = 0);
+
     /** Returns the Sequence Number that will be used in the next SendPacket function call. */
     uint16_t GetNextSequenceNumber() const;
 
@@ -584,14 +634,52 @@ protected:
 	 *  here. */
 	virtual void OnSentRTPOrRTCPData(void *senddata, size_t sendlen, bool isrtp);
 
+	/** Reserves \c reserve bytes after each RTP packet that is built by the session.
+	 *  Reserves \c reserve bytes after each RTP packet that is built by the session, so that
+	 *  RTPSession::OnChangeRTPDataInPlace can grow the packets without copying them (e.g. to
+	 *  append an authentication tag). Like the SetChange... flags, this must be set before
+	 *  the session is created, typically in the constructor of a derived class.
+	 */
+	void SetOutgoingRTPDataTrailerReserve(size_t reserve)				{ m_outgoingTrailerReserve = reserve; }
+
+	/** If RTPSession::SetChangeOutgoingData was set to true, this is called first for outgoing RTP packets, allowing them to be changed in place.
+	 *  If RTPSession::SetChangeOutgoingData was set to true, this function is called with 
+	 *  \c numpackets RTP packets, before RTPSession::OnChangeRTPOrRTCPData is considered. Packet \c i
+	 *  is stored in \c packets[i] with length \c lengths[i], in a buffer that can hold
+	 *  \c buffersizes[i] bytes (see RTPSession::SetOutgoingRTPDataTrailerReserve). If the packets
+	 *  are modified in their own buffers, the new lengths must be stored in \c lengths and
+	 *  \c changed must be set to `true`, in which case they are sent as they are; a length of 
+	 *  zero means that the packet will not be sent. If \c changed is left at `false`, which is
+	 *  what the default implementation does, the packets are passed to 
+	 *  RTPSession::OnChangeRTPOrRTCPData one by one instead. If an error is returned while
+	 *  \c changed is `true`, the packets with a non-zero length are still sent before the
+	 *  error is returned to the caller; this way, packets that were already encrypted
+	 *  (advancing the encryption state) aren't lost.
+	 */
+	virtual int OnChangeRTPDataInPlace(uint8_t *packets[], size_t lengths[], const size_t buffersizes[], int numpackets, bool *changed);
+
 	/** By overriding this function, the raw incoming data can be inspected
 	 *  and modified (e.g. for encryption).
 	 *  By overriding this function, the raw incoming data can be inspected
 	 *  and modified (e.g. for encryption). If the function returns `false`,
-	 *  the packet is discarded.
+	 *  the packet is discarded. It is called from RTPSession::OnChangeIncomingDataBatch,
+	 *  outside of the lock on the source table, so another thread may be accessing
+	 *  the sources at the same time. To inspect the sources from within this function,
+	 *  RTPSession::BeginDataAccess and RTPSession::EndDataAccess must be used.
 	 */
 	virtual bool OnChangeIncomingData(RTPRawPacket *rawpack);
 
+	/** Allows all packets that were obtained in a single poll to be inspected and modified at once.
+	 *  If RTPSession::SetChangeIncomingData was set to true, all packets that are available in
+	 *  the transmitter after polling are first collected and passed to this function, before the
+	 *  source table is locked. For each of the \c numpackets packets in \c rawpacks, the 
+	 *  corresponding entry in \c keep must be set to 1 if the packet is to be processed further,
+	 *  or to 0 if it should be discarded. The packets that are kept are then processed in the
+	 *  order in which they were received. The default implementation calls 
+	 *  RTPSession::OnChangeIncomingData for each packet.
+	 */
+	virtual void OnChangeIncomingDataBatch(RTPRawPacket *rawpacks[], int8_t keep[], int numpackets);
+
 	/** Allows you to use an RTP packet from the specified source directly.
 	 *  Allows you to use an RTP packet from the specified source directly. If 
 	 *  `ispackethandled` is set to `true`, the packet will no longer be stored in this
@@ -603,6 +691,15 @@ protected:
 	 *  really suited to actually do something with the data.
 	 */
 	virtual void OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack, bool isonprobation, bool *ispackethandled);
+
+	/** Allows you to use a validated RTP packet from the specified source without an RTPPacket instance being created.
+	 *  This function is called right before RTPSession::OnValidatedRTPPacket, at a moment when 
+	 *  the packet is only described by \c view, which refers to the received data and is only 
+	 *  valid during this call. If `ispackethandled` is set to `true`, OnValidatedRTPPacket is not 
+	 *  called and the packet is not stored in the source's packet list; in that case no memory 
+	 *  needs to be allocated for the packet at all.
+	 */
+	virtual void OnValidatedRTPPacketView(RTPSourceData *srcdat, const RTPPacketView &view, bool isonprobation, bool *ispackethandled);
 private:
 	int InternalCreate(const RTPSessionParams &sessparams);
 	int CreateCNAME(uint8_t *buffer,size_t *bufferlength,bool resolve);
@@ -611,6 +708,13 @@ private:
 	RTPRandom *GetRandomNumberGenerator(RTPRandom *r);
 	int SendRTPData(const void *data, size_t len);
 	int SendRTCPData(const void *data, size_t len);
+	int SendBuiltRTPPacket(size_t len);
+	int PrivateSendPacketIov(const RTPIOVec *payload,int numparts,bool usedefaults,
+	                         uint8_t pt,bool mark,uint32_t timestampinc);
+	int PrivateSendPackets(const RTPIOVec *payloads,int numpackets,bool usedefaults,
+	                       uint8_t pt,bool markonlast,uint32_t timestampinc);
+	RTPRawPacket *GetNextPolledPacket();
+	void ClearIncomingBatch();
 
 	RTPRandom *rtprnd;
 	bool deletertprnd;
@@ -632,6 +736,12 @@ private:
 	bool sentpackets;
 
 	bool m_changeIncomingData, m_changeOutgoingData;
+	size_t m_outgoingTrailerReserve;
+	std::vector<RTPRawPacket *> m_incomingBatch;
+	std::vector<int8_t> m_incomingBatchKeep;
+	size_t m_incomingBatchPos;
+	std::vector<RTPIOVec> m_outgoingBatchIOV; // only used while the builder lock is held
+	std::vector<int> m_outgoingBatchNumIOV;
 
 	RTPSessionSources sources;
 	RTPPacketBuilder packetbuilder;
@@ -646,6 +756,7 @@ private:
 	jthread::JMutex sourcesmutex,buildermutex,schedmutex,packsentmutex;
 
 	friend class RTPPollThread;
+	friend class RTPReactor;
 #endif // RTP_SUPPORT_THREAD
 	friend class RTPSessionSources;
 	friend class RTCPSessionPacketBuilder;
@@ -686,8 +797,10 @@ inline int RTPSession::OnChangeRTPOrRTCPData(const void *, size_t, bool, void **
 	return ERR_RTP_RTPSESSION_CHANGEREQUESTEDBUTNOTIMPLEMENTED;
 }
 inline void RTPSession::OnSentRTPOrRTCPData(void *, size_t, bool)                                       { }
+inline int RTPSession::OnChangeRTPDataInPlace(uint8_t *[], size_t [], const size_t [], int, bool *changed) { *changed = false; return 0; }
 inline bool RTPSession::OnChangeIncomingData(RTPRawPacket *)                                            { return true; }
 inline void RTPSession::OnValidatedRTPPacket(RTPSourceData *, RTPPacket *, bool, bool *)                { }
+inline void RTPSession::OnValidatedRTPPacketView(RTPSourceData *, const RTPPacketView &, bool, bool *)  { }
 
 } // end namespace
 
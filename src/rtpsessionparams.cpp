@@ -57,6 +57,8 @@ RTPSessionParams::RTPSessionParams() : mininterval(0,0)
 #ifdef RTP_SUPPORT_PROBATION
 	probationtype = RTPSources::ProbationStore;
 #endif // RTP_SUPPORT_PROBATION
+	reorderdepth = RTP_DEFAULTREORDERDEPTH;
+	reorderpackets = true;
 
 	mininterval = RTPTime(RTCP_DEFAULTMININTERVAL);
 	sessionbandwidth = RTP_DEFAULTSESSIONBANDWIDTH;
@@ -118,6 +118,22 @@ public:
 	RTPSources::ProbationType GetProbationType() const			{ return probationtype; }
 #endif // RTP_SUPPORT_PROBATION
 
+	/** Sets the number of RTP packets that can be queued for each source (see RTPPacketRing). */
+	void SetReorderDepth(size_t depth)							{ reorderdepth = depth; }
+
+	/** Returns the number of RTP packets that can be queued for each source (default is 1024). */
+	size_t GetReorderDepth() const								{ return reorderdepth; }
+
+	/** Sets a flag indicating if the queued RTP packets should be ordered by sequence number.
+	 *  Sets a flag indicating if the queued RTP packets should be ordered by sequence number. If 
+	 *  set to \c false, the packets of a source are returned in the order in which they were
+	 *  received, which is useful if the application does its own jitter buffering.
+	 */
+	void SetReorderPackets(bool f)								{ reorderpackets = f; }
+
+	/** Returns \c true if the queued RTP packets are ordered by sequence number (the default). */
+	bool GetReorderPackets() const								{ return reorderpackets; }
+
 	/** Sets the session bandwidth in bytes per second. */
 	void SetSessionBandwidth(double sessbw)						{ sessionbandwidth = sessbw; }
 
@@ -228,6 +244,8 @@ private:
 #ifdef RTP_SUPPORT_PROBATION
 	RTPSources::ProbationType probationtype;
 #endif // RTP_SUPPORT_PROBATION
+	size_t reorderdepth;
+	bool reorderpackets;
 	
 	double sessionbandwidth;
 	double controlfrac;
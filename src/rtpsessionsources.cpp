@@ -115,6 +115,11 @@ void RTPSessionSources::OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *r
 	rtpsession.OnValidatedRTPPacket(srcdat, rtppack, isonprobation, ispackethandled);
 }
 
+void RTPSessionSources::OnValidatedRTPPacketView(RTPSourceData *srcdat, const RTPPacketView &view, bool isonprobation, bool *ispackethandled)
+{
+	rtpsession.OnValidatedRTPPacketView(srcdat, view, isonprobation, ispackethandled);
+}
+
 void RTPSessionSources::OnRTCPSenderReport(RTPSourceData *srcdat)
 {
 	rtpsession.OnRTCPSenderReport(srcdat);
@@ -75,6 +75,7 @@ private:
 	                           const RTPAddress *senderaddress);
 	void OnNoteTimeout(RTPSourceData *srcdat);
 	void OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack, bool isonprobation, bool *ispackethandled);
+	void OnValidatedRTPPacketView(RTPSourceData *srcdat, const RTPPacketView &view, bool isonprobation, bool *ispackethandled);
 	void OnRTCPSenderReport(RTPSourceData *srcdat);
 	void OnRTCPReceiverReport(RTPSourceData *srcdat);
 	void OnRTCPSDESItem(RTPSourceData *srcdat, RTCPSDESPacket::ItemType t,
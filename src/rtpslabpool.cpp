@@ -0,0 +1,273 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtpslabpool.h"
+#include "rtpaddress.h"
+#include "rtperrors.h"
+
+#include "rtpdebug.h"
+
+namespace jrtplib
+{
+
+RTPReceiveSlab::RTPReceiveSlab(RTPSlabPool *pool, uint8_t *data)
+{
+	m_pPool = pool;
+	m_pData = data;
+	m_size = pool->GetSlabSize();
+	m_pAddress = 0;
+	m_refCount = 0;
+	m_external = false;
+	m_pReleaseFunction = 0;
+	m_pReleaseArg = 0;
+}
+
+RTPSlabPool::RTPSlabPool(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_slabSize = 0;
+	m_maxFreeSlabs = 0;
+	m_refCount = 1; // the creator's reference
+	m_created = false;
+#ifdef RTP_SUPPORT_THREAD
+	m_threadsafe = false;
+#endif // RTP_SUPPORT_THREAD
+}
+
+RTPSlabPool::~RTPSlabPool()
+{
+	std::vector<RTPReceiveSlab *>::const_iterator it;
+
+	for (it = m_freeSlabs.begin() ; it != m_freeSlabs.end() ; ++it)
+		DeleteSlab(*it);
+	for (it = m_freeExternalSlabs.begin() ; it != m_freeExternalSlabs.end() ; ++it)
+		DeleteSlab(*it);
+	m_freeSlabs.clear();
+	m_freeExternalSlabs.clear();
+}
+
+int RTPSlabPool::Create(size_t slabsize, size_t maxfreeslabs, bool threadsafe)
+{
+	if (m_created)
+		return ERR_RTP_SLABPOOL_ALREADYCREATED;
+	if (slabsize == 0)
+		return ERR_RTP_SLABPOOL_ILLEGALSLABSIZE;
+
+#ifdef RTP_SUPPORT_THREAD
+	m_threadsafe = threadsafe;
+	if (m_threadsafe)
+	{
+		if (m_mutex.Init() < 0)
+			return ERR_RTP_SLABPOOL_CANTINITMUTEX;
+	}
+#else
+	if (threadsafe)
+		return ERR_RTP_NOTHREADSUPPORT;
+#endif // RTP_SUPPORT_THREAD
+
+	m_slabSize = slabsize;
+	m_maxFreeSlabs = maxfreeslabs;
+	m_freeSlabs.reserve(maxfreeslabs);
+	m_freeExternalSlabs.reserve(maxfreeslabs);
+	m_created = true;
+	return 0;
+}
+
+RTPReceiveSlab *RTPSlabPool::AcquireSlab()
+{
+	RTPReceiveSlab *slab = 0;
+
+	Lock();
+	if (!m_freeSlabs.empty())
+	{
+		slab = m_freeSlabs.back();
+		m_freeSlabs.pop_back();
+	}
+	else
+	{
+		uint8_t *data = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RECEIVESLAB) uint8_t[m_slabSize];
+		if (data != 0)
+		{
+			slab = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRECEIVESLAB) RTPReceiveSlab(this,data);
+			if (slab == 0)
+				RTPDeleteByteArray(data,GetMemoryManager());
+		}
+	}
+
+	if (slab != 0)
+	{
+		slab->m_refCount = 1;
+		m_refCount++; // each slab that's in use keeps the pool alive
+	}
+	Unlock();
+	return slab;
+}
+
+RTPReceiveSlab *RTPSlabPool::WrapExternalData(uint8_t *data, size_t size, RTPReceiveSlabReleaseFunction release, void *releasearg)
+{
+	RTPReceiveSlab *slab = 0;
+
+	Lock();
+	if (!m_freeExternalSlabs.empty())
+	{
+		slab = m_freeExternalSlabs.back();
+		m_freeExternalSlabs.pop_back();
+	}
+	else
+	{
+		slab = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRECEIVESLAB) RTPReceiveSlab(this,0);
+		if (slab != 0)
+			slab->m_external = true;
+	}
+
+	if (slab != 0)
+	{
+		slab->m_pData = data;
+		slab->m_size = size;
+		slab->m_pReleaseFunction = release;
+		slab->m_pReleaseArg = releasearg;
+		slab->m_refCount = 1;
+		m_refCount++; // each slab that's in use keeps the pool alive
+	}
+	Unlock();
+	return slab;
+}
+
+void RTPSlabPool::Release()
+{
+	bool deletepool;
+
+	Lock();
+	m_refCount--;
+	deletepool = (m_refCount == 0);
+	if (!deletepool)
+	{
+		// No new slabs will be acquired, so there's no point in keeping
+		// released ones around
+		std::vector<RTPReceiveSlab *>::const_iterator it;
+
+		for (it = m_freeSlabs.begin() ; it != m_freeSlabs.end() ; ++it)
+			DeleteSlab(*it);
+		for (it = m_freeExternalSlabs.begin() ; it != m_freeExternalSlabs.end() ; ++it)
+			DeleteSlab(*it);
+		m_freeSlabs.clear();
+		m_freeExternalSlabs.clear();
+		m_maxFreeSlabs = 0;
+	}
+	Unlock();
+
+	if (deletepool)
+		RTPDelete(this,GetMemoryManager());
+}
+
+void RTPSlabPool::AddSlabReference(RTPReceiveSlab *slab)
+{
+	Lock();
+	slab->m_refCount++;
+	Unlock();
+}
+
+void RTPSlabPool::ReleaseSlab(RTPReceiveSlab *slab)
+{
+	bool deletepool = false;
+	RTPReceiveSlabReleaseFunction release = 0;
+	uint8_t *releasedata = 0;
+	size_t releasesize = 0;
+	void *releasearg = 0;
+
+	Lock();
+	slab->m_refCount--;
+	if (slab->m_refCount == 0)
+	{
+		if (slab->m_external)
+		{
+			// The owner's callback is only called after unlocking, in case it
+			// wraps new data right away
+			release = slab->m_pReleaseFunction;
+			releasedata = slab->m_pData;
+			releasesize = slab->m_size;
+			releasearg = slab->m_pReleaseArg;
+			slab->m_pData = 0;
+			slab->m_size = 0;
+			slab->m_pReleaseFunction = 0;
+			slab->m_pReleaseArg = 0;
+
+			if (m_freeExternalSlabs.size() < m_maxFreeSlabs)
+				m_freeExternalSlabs.push_back(slab);
+			else
+				DeleteSlab(slab);
+		}
+		else
+		{
+			if (m_freeSlabs.size() < m_maxFreeSlabs)
+				m_freeSlabs.push_back(slab);
+			else
+				DeleteSlab(slab);
+		}
+
+		m_refCount--;
+		deletepool = (m_refCount == 0);
+	}
+	Unlock();
+
+	if (release)
+		release(releasedata, releasesize, releasearg);
+	if (deletepool)
+		RTPDelete(this,GetMemoryManager());
+}
+
+void RTPSlabPool::DeleteSlab(RTPReceiveSlab *slab)
+{
+	if (slab->m_pAddress)
+		RTPDelete(slab->m_pAddress,GetMemoryManager());
+	if (!slab->m_external)
+		RTPDeleteByteArray(slab->m_pData,GetMemoryManager());
+	RTPDelete(slab,GetMemoryManager());
+}
+
+void RTPSlabPool::Lock()
+{
+#ifdef RTP_SUPPORT_THREAD
+	if (m_threadsafe)
+		m_mutex.Lock();
+#endif // RTP_SUPPORT_THREAD
+}
+
+void RTPSlabPool::Unlock()
+{
+#ifdef RTP_SUPPORT_THREAD
+	if (m_threadsafe)
+		m_mutex.Unlock();
+#endif // RTP_SUPPORT_THREAD
+}
+
+} // end namespace
+
@@ -0,0 +1,191 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpslabpool.h
+ */
+
+#ifndef RTPSLABPOOL_H
+
+#define RTPSLABPOOL_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtpmemoryobject.h"
+#include <vector>
+#ifdef RTP_SUPPORT_THREAD
+	#include <jthread/jmutex.h>
+#endif // RTP_SUPPORT_THREAD
+
+namespace jrtplib
+{
+
+class RTPAddress;
+class RTPSlabPool;
+
+/** Type of the function that's called when a slab created by RTPSlabPool::WrapExternalData 
+ *  is no longer used, so that the owner of the data can reclaim it. */
+typedef void (*RTPReceiveSlabReleaseFunction)(uint8_t *data, size_t size, void *releasearg);
+
+/** A fixed-size receive buffer which is handed out by an RTPSlabPool instance.
+ *  A fixed-size receive buffer which is handed out by an RTPSlabPool instance. A transmitter
+ *  can read a datagram directly into the slab and pass it on to an RTPRawPacket instance, from
+ *  which the RTPPacket or RTCPCompoundPacket instance can adopt the data without copying it.
+ *  Besides the data buffer, a slab can also hold the RTPAddress instance describing the sender
+ *  of the datagram, so that this object can be reused as well. The slab is reference counted: 
+ *  each object that uses it holds a reference, and when the last one is released, the slab
+ *  returns to the pool it came from.
+ */
+class JRTPLIB_IMPORTEXPORT RTPReceiveSlab
+{
+	JRTPLIB_NO_COPY(RTPReceiveSlab)
+public:
+	/** Used by RTPSlabPool to create a slab that uses \c data as its buffer, you
+	 *  should not need this yourself. */
+	RTPReceiveSlab(RTPSlabPool *pool, uint8_t *data);
+
+	/** Used by RTPSlabPool to dispose of a slab, you should not need this yourself. */
+	~RTPReceiveSlab()																	{ }
+
+	/** Returns a pointer to the data buffer of this slab. */
+	uint8_t *GetData() const															{ return m_pData; }
+
+	/** Returns the size of the data buffer of this slab. */
+	size_t GetSize() const;
+
+	/** Returns the address instance that's stored in this slab, or null if none was set yet. */
+	RTPAddress *GetAddress() const														{ return m_pAddress; }
+
+	/** Stores \c address in this slab, which then becomes the owner of the instance; it
+	 *  will be deleted (using the pool's memory manager) when the slab itself is deleted. */
+	void SetAddress(RTPAddress *address)												{ m_pAddress = address; }
+
+	/** Adds a reference to this slab. */
+	void AddReference();
+
+	/** Releases a reference to this slab, when this was the last one the slab
+	 *  is returned to its pool. */
+	void Release();
+private:
+	friend class RTPSlabPool;
+
+	RTPSlabPool *m_pPool;
+	uint8_t *m_pData;
+	size_t m_size;
+	RTPAddress *m_pAddress;
+	int m_refCount;
+	bool m_external;
+	RTPReceiveSlabReleaseFunction m_pReleaseFunction;
+	void *m_pReleaseArg;
+};
+
+/** A pool of fixed-size receive slabs.
+ *  A pool of fixed-size receive slabs, used by the UDP transmitters to read incoming 
+ *  datagrams without having to allocate and copy a buffer for each of them. Slabs are
+ *  allocated when needed, and up to a specified number of released slabs is kept for 
+ *  reuse. The pool itself is reference counted too: the creator holds one reference, 
+ *  and each slab that's in use holds another one. This way, packets that still use a
+ *  slab remain valid after the transmitter that received them has been destroyed.
+ */
+class JRTPLIB_IMPORTEXPORT RTPSlabPool : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPSlabPool)
+public:
+	/** Creates an instance which will use memory manager \c mgr to allocate the slabs,
+	 *  the creator of the instance holds the first reference. */
+	RTPSlabPool(RTPMemoryManager *mgr = 0);
+
+	/** Used to dispose of the pool when the last reference was released, use
+	 *  RTPSlabPool::Release instead. */
+	~RTPSlabPool();
+
+	/** Initializes the pool to hand out slabs of \c slabsize bytes, and to keep at
+	 *  most \c maxfreeslabs released slabs for reuse. If \c threadsafe is \c true, 
+	 *  slabs can be acquired and released from different threads. */
+	int Create(size_t slabsize, size_t maxfreeslabs, bool threadsafe);
+
+	/** Returns the size of the slabs handed out by this pool. */
+	size_t GetSlabSize() const															{ return m_slabSize; }
+
+	/** Returns a slab with a single reference, or null if no memory was available. */
+	RTPReceiveSlab *AcquireSlab();
+
+	/** Returns a slab with a single reference which uses the \c size bytes at \c data as its buffer.
+	 *  Returns a slab with a single reference which uses the \c size bytes at \c data as its buffer,
+	 *  or null if no memory was available. The data is not copied and remains owned by the caller,
+	 *  but must stay valid until the last reference to the slab is released, at which point 
+	 *  \c release is called with \c data, \c size and \c releasearg. Note that this can happen
+	 *  in any thread that releases a reference. As with the other slabs, the address instance
+	 *  stored in the slab is reused.
+	 */
+	RTPReceiveSlab *WrapExternalData(uint8_t *data, size_t size, RTPReceiveSlabReleaseFunction release, void *releasearg);
+
+	/** Releases the creator's reference to the pool. */
+	void Release();
+private:
+	friend class RTPReceiveSlab;
+
+	void AddSlabReference(RTPReceiveSlab *slab);
+	void ReleaseSlab(RTPReceiveSlab *slab);
+	void DeleteSlab(RTPReceiveSlab *slab);
+	void Lock();
+	void Unlock();
+
+	size_t m_slabSize, m_maxFreeSlabs;
+	std::vector<RTPReceiveSlab *> m_freeSlabs, m_freeExternalSlabs;
+	int m_refCount;
+	bool m_created;
+#ifdef RTP_SUPPORT_THREAD
+	jthread::JMutex m_mutex;
+	bool m_threadsafe;
+#endif // RTP_SUPPORT_THREAD
+};
+
+inline size_t RTPReceiveSlab::GetSize() const
+{
+	return m_size;
+}
+
+inline void RTPReceiveSlab::AddReference()
+{
+	m_pPool->AddSlabReference(this);
+}
+
+inline void RTPReceiveSlab::Release()
+{
+	m_pPool->ReleaseSlab(this);
+}
+
+} // end namespace
+
+#endif // RTPSLABPOOL_H
+
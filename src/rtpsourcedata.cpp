@@ -75,7 +75,7 @@
 namespace jrtplib
 {
 
-void RTPSourceStats::ProcessPacket(RTPPacket *pack,const RTPTime &receivetime,double tsunit,
+void RTPSourceStats::ProcessPacket(RTPPacketView *pack,const RTPTime &receivetime,double tsunit,
                                    bool ownpacket,bool *accept,bool applyprobation,bool *onprobation)
 {
 	JRTPLIB_UNUSED(applyprobation); // possibly unused
@@ -260,7 +260,28 @@ jitter = (uint32_t)djitter;
 	}
 }
 
-RTPSourceData::RTPSourceData(uint32_t s, RTPMemoryManager *mgr) : RTPMemoryObject(mgr),SDESinf(mgr),byetime(0,0)
+// Kept for code that still passes an RTPPacket instance; the statistics are
+// calculated on a view of the packet's data, the extended sequence number is
+// copied back afterwards
+void RTPSourceStats::ProcessPacket(RTPPacket *pack,const RTPTime &receivetime,double tsunit,
+                                   bool ownpacket,bool *accept,bool applyprobation,bool *onprobation)
+{
+	RTPPacketView view;
+
+	if (view.Parse(pack->GetPacketData(),pack->GetPacketLength(),receivetime) < 0)
+	{
+		*accept = false;
+		*onprobation = false;
+		return;
+	}
+	view.SetExtendedSequenceNumber(pack->GetExtendedSequenceNumber());
+
+	ProcessPacket(&view,receivetime,tsunit,ownpacket,accept,applyprobation,onprobation);
+
+	pack->SetExtendedSequenceNumber(view.GetExtendedSequenceNumber());
+}
+
+RTPSourceData::RTPSourceData(uint32_t s, RTPMemoryManager *mgr) : RTPMemoryObject(mgr),packetring(mgr),SDESinf(mgr),byetime(0,0)
 {
 	ssrc = s;
 	issender = false;
@@ -289,6 +310,18 @@ RTPSourceData::~RTPSourceData()
 		RTPDelete(rtcpaddr,GetMemoryManager());
 }
 
+RTPPacket *RTPSourceData::GetPlayoutPacket(const RTPTime &now,uint32_t *lost)
+{
+	if (lost)
+		*lost = 0;
+	if (!validated)
+		return 0;
+
+	double tsunit = (timestampunit < 0)?INF_GetEstimatedTimestampUnit():timestampunit;
+
+	return jitterbuffer.GetPlayoutPacket(packetring,now,tsunit,stats.GetJitter(),lost);
+}
+
 double RTPSourceData::INF_GetEstimatedTimestampUnit() const
 {
 	if (!SRprevinf.HasInfo())
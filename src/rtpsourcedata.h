@@ -41,11 +41,13 @@
 #include "rtpconfig.h"
 #include "rtptimeutilities.h"
 #include "rtppacket.h"
+#include "rtppacketview.h"
 #include "rtcpsdesinfo.h"
 #include "rtptypes.h"
 #include "rtpsources.h"
 #include "rtpmemoryobject.h"
-#include <list>
+#include "rtppacketring.h"
+#include "rtpjitterbuffer.h"
 
 namespace jrtplib
 {
@@ -104,6 +106,7 @@ class JRTPLIB_IMPORTEXPORT RTPSourceStats
 {
 public:
 	RTPSourceStats();
+	void ProcessPacket(RTPPacketView *pack,const RTPTime &receivetime,double tsunit,bool ownpacket,bool *accept,bool applyprobation,bool *onprobation);
 	void ProcessPacket(RTPPacket *pack,const RTPTime &receivetime,double tsunit,bool ownpacket,bool *accept,bool applyprobation,bool *onprobation);
 
 	bool HasSentData() const						{ return sentdata; }
@@ -173,11 +176,24 @@ public:
 	/** Extracts the first packet of this participants RTP packet queue. */
 	RTPPacket *GetNextPacket();
 
+	/** Extracts the first packet of this participant's RTP packet queue if it's time to play it out.
+	 *  Extracts the first packet of this participant's RTP packet queue if its playout time, as 
+	 *  determined by the participant's adaptive jitter buffer (see RTPJitterBuffer), has come at 
+	 *  time \c now; otherwise NULL is returned. Packets which arrive too late are dropped. If \c lost 
+	 *  is not NULL, the number of packets which were lost just before the returned one is stored in 
+	 *  it. The playout times can only be calculated when the timestamp unit of the participant is
+	 *  known (see RTPSourceData::SetTimestampUnit), until then the packets are returned immediately.
+	 */
+	RTPPacket *GetPlayoutPacket(const RTPTime &now,uint32_t *lost = 0);
+
+	/** Sets the parameters of the participant's jitter buffer (see RTPJitterBuffer::SetParameters). */
+	void SetPlayoutParameters(double jittermultiplier,const RTPTime &mindelay,const RTPTime &maxdelay)	{ jitterbuffer.SetParameters(jittermultiplier,mindelay,maxdelay); }
+
 	/** Clears the participant's RTP packet list. */
 	void FlushPackets();
 
 	/** Returns \c true if there are RTP packets which can be extracted. */
-	bool HasData() const							{ if (!validated) return false; return packetlist.empty()?false:true; }
+	bool HasData() const							{ if (!validated) return false; return packetring.IsEmpty()?false:true; }
 
 	/** Returns the SSRC identifier for this member. */
 	uint32_t GetSSRC() const						{ return ssrc; }
@@ -360,6 +376,15 @@ public:
 	/** Returns the current jitter value for this participant. */
 	uint32_t INF_GetJitter() const						{ return stats.GetJitter(); }
 
+	/** Returns the delay which the jitter buffer currently adds to the playout times (see GetPlayoutPacket). */
+	RTPTime INF_GetPlayoutDelay() const					{ return jitterbuffer.GetTargetDelay(); }
+
+	/** Returns the number of packets which GetPlayoutPacket dropped because they arrived too late. */
+	uint32_t INF_GetNumberOfLatePackets() const				{ return jitterbuffer.GetNumberOfLatePackets(); }
+
+	/** Returns the number of packets which GetPlayoutPacket found to be missing. */
+	uint32_t INF_GetNumberOfPlayoutLostPackets() const			{ return jitterbuffer.GetNumberOfLostPackets(); }
+
 	/** Returns the time at which something was last heard from this member. */
 	RTPTime INF_GetLastMessageTime() const					{ return stats.GetLastMessageTime(); }
 
@@ -427,7 +452,8 @@ public:
 	virtual void Dump();
 #endif // RTPDEBUG
 protected:
-	std::list<RTPPacket *> packetlist;
+	RTPPacketRing packetring;
+	RTPJitterBuffer jitterbuffer;
 
 	uint32_t ssrc;
 	bool ownssrc;
@@ -456,22 +482,12 @@ inline RTPPacket *RTPSourceData::GetNextPacket()
 	if (!validated)
 		return 0;
 
-	RTPPacket *p;
-
-	if (packetlist.empty())
-		return 0;
-	p = *(packetlist.begin());
-	packetlist.pop_front();
-	return p;
+	return packetring.GetNextPacket();
 }
 
 inline void RTPSourceData::FlushPackets()
 {
-	std::list<RTPPacket *>::const_iterator it;
-
-	for (it = packetlist.begin() ; it != packetlist.end() ; ++it)
-		RTPDelete(*it,GetMemoryManager());
-	packetlist.clear();
+	packetring.Clear();
 }
 
 } // end namespace
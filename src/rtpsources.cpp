@@ -33,6 +33,8 @@
 #include "rtpsources.h"
 #include "rtperrors.h"
 #include "rtprawpacket.h"
+#include "rtppacket.h"
+#include "rtppacketview.h"
 #include "rtpinternalsourcedata.h"
 #include "rtptimeutilities.h"
 #include "rtpdefines.h"
@@ -44,6 +46,7 @@
 #include "rtcpsrpacket.h"
 #include "rtcprrpacket.h"
 #include "rtptransmitter.h"
+#include <algorithm>
 
 #ifdef RTPDEBUG
 	#include <iostream>
@@ -62,6 +65,12 @@ RTPSources::RTPSources(ProbationType probtype,RTPMemoryManager *mgr) : RTPMemory
 	sendercount = 0;
 	activecount = 0;
 	owndata = 0;
+	nexttimeoutserial = 0;
+	firstreportsource = 0;
+	lastreportsource = 0;
+	curreportsource = 0;
+	reorderdepth = RTP_DEFAULTREORDERDEPTH;
+	reorderpackets = true;
 #ifdef RTP_SUPPORT_PROBATION
 	probationtype = probtype;
 #endif // RTP_SUPPORT_PROBATION
@@ -89,6 +98,13 @@ void RTPSources::ClearSourceList()
 		sourcelist.GotoNextElement();
 	}
 	sourcelist.Clear();
+	membertimeouts.clear();
+	sendertimeouts.clear();
+	byetimeouts.clear();
+	notetimeouts.clear();
+	firstreportsource = 0;
+	lastreportsource = 0;
+	curreportsource = 0;
 	owndata = 0;
 	totalcount = 0;
 	sendercount = 0;
@@ -138,6 +154,7 @@ int RTPSources::DeleteOwnSSRC()
 	if (owndata->IsActive())
 		activecount--;
 
+	RemoveReportSource(owndata);
 	OnRemoveSource(owndata);
 	
 	RTPDelete(owndata,GetMemoryManager());
@@ -154,7 +171,10 @@ void RTPSources::SentRTPPacket()
 	
 	owndata->SentRTPPacket();
 	if (!prevsender && owndata->IsSender())
+	{
 		sendercount++;
+		QueueSenderTimeout(owndata);
+	}
 }
 
 int RTPSources::ProcessRawPacket(RTPRawPacket *rawpack,RTPTransmitter *rtptrans,bool acceptownpackets)
@@ -176,28 +196,11 @@ int RTPSources::ProcessRawPacket(RTPRawPacket *rawpack,RTPTransmitter *rtptrans[
 	
 	if (rawpack->IsRTP()) // RTP packet
 	{
-		RTPPacket *rtppack;
+		RTPPacketView view;
 		
-		// First, we'll see if the packet can be parsed
-		rtppack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPPACKET) RTPPacket(*rawpack,GetMemoryManager());
-		if (rtppack == 0)
-			return ERR_RTP_OUTOFMEM;
-		if ((status = rtppack->GetCreationError()) < 0)
-		{
-			if (status == ERR_RTP_PACKET_INVALIDPACKET)
-			{
-				RTPDelete(rtppack,GetMemoryManager());
-				rtppack = 0;
-			}
-			else
-			{
-				RTPDelete(rtppack,GetMemoryManager());
-				return status;
-			}
-		}
-				
-		// Check if the packet was valid
-		if (rtppack != 0)
+		// First, we'll see if the packet can be parsed. This doesn't allocate
+		// anything, invalid packets are simply ignored
+		if (view.Parse(*rawpack) >= 0)
 		{
 			bool stored = false;
 			bool ownpacket = false;
@@ -218,25 +221,16 @@ int RTPSources::ProcessRawPacket(RTPRawPacket *rawpack,RTPTransmitter *rtptrans[
 				if (acceptownpackets)
 				{
 					// sender addres for own packets has to be NULL!
-					if ((status = ProcessRTPPacket(rtppack,rawpack->GetReceiveTime(),0,&stored)) < 0)
-					{
-						if (!stored)
-							RTPDelete(rtppack,GetMemoryManager());
+					// An RTPPacket instance is only created if the packet is stored
+					if ((status = ProcessRTPPacket(view,0,rawpack,0,&stored)) < 0)
 						return status;
-					}
 				}
 			}
 			else 
 			{
-				if ((status = ProcessRTPPacket(rtppack,rawpack->GetReceiveTime(),senderaddress,&stored)) < 0)
-				{
-					if (!stored)
-						RTPDelete(rtppack,GetMemoryManager());
+				if ((status = ProcessRTPPacket(view,0,rawpack,senderaddress,&stored)) < 0)
 					return status;
-				}
 			}
-			if (!stored)
-				RTPDelete(rtppack,GetMemoryManager());
 		}
 	}
 	else // RTCP packet
@@ -289,17 +283,42 @@ int RTPSources::ProcessRawPacket(RTPRawPacket *rawpack,RTPTransmitter *rtptrans[
 }
 
 int RTPSources::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,const RTPAddress *senderaddress,bool *stored)
+{
+	RTPPacketView view;
+	int status;
+
+	*stored = false;
+
+	// The packet has been parsed already, so this only describes its data
+	if ((status = view.Parse(rtppack->GetPacketData(),rtppack->GetPacketLength(),receivetime)) < 0)
+		return status;
+	view.SetExtendedSequenceNumber(rtppack->GetExtendedSequenceNumber());
+
+	return ProcessRTPPacket(view,rtppack,0,senderaddress,stored);
+}
+
+// Either rtppack is the packet described by view, or it is null and rawpack contains
+// the data of view; in that case an RTPPacket instance is only created if the packet
+// needs to be stored
+int RTPSources::ProcessRTPPacket(RTPPacketView &view,RTPPacket *rtppack,RTPRawPacket *rawpack,const RTPAddress *senderaddress,bool *stored)
 {
 	uint32_t ssrc;
 	RTPInternalSourceData *srcdat;
 	int status;
 	bool created;
 
-	OnRTPPacket(rtppack,receivetime,senderaddress);
+	if (rtppack)
+		OnRTPPacket(rtppack,view.GetReceiveTime(),senderaddress);
+	else
+	{
+		// Temporary instance which just refers to the data of the raw packet
+		RTPPacket packwrapper(view,GetMemoryManager());
+		OnRTPPacket(&packwrapper,view.GetReceiveTime(),senderaddress);
+	}
 
 	*stored = false;
 	
-	ssrc = rtppack->GetSSRC();
+	ssrc = view.GetSSRC();
 	if ((status = ObtainSourceDataInstance(ssrc,&srcdat,&created)) < 0)
 		return status;
 
@@ -318,26 +337,31 @@ int RTPSources::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,c
 	bool prevactive = srcdat->IsActive();
 	
 	uint32_t CSRCs[RTP_MAXCSRCS];
-	int numCSRCs = rtppack->GetCSRCCount();
+	int numCSRCs = view.GetCSRCCount();
 	if (numCSRCs > RTP_MAXCSRCS) // shouldn't happen, but better to check than go out of bounds
 		numCSRCs = RTP_MAXCSRCS;
 
 	for (int i = 0 ; i < numCSRCs ; i++)
-		CSRCs[i] = rtppack->GetCSRC(i);
+		CSRCs[i] = view.GetCSRC(i);
 
 	// The packet comes from a valid source, we can process it further now
 	// The following function should delete rtppack itself if something goes
 	// wrong
-	if ((status = srcdat->ProcessRTPPacket(rtppack,receivetime,stored,this)) < 0)
+	if ((status = srcdat->ProcessRTPPacket(view,rtppack,rawpack,stored,this)) < 0)
 		return status;
 
 	// NOTE: we cannot use 'rtppack' anymore since it may have been deleted in
 	//       OnValidatedRTPPacket
 
 	if (!prevsender && srcdat->IsSender())
+	{
 		sendercount++;
+		QueueSenderTimeout(srcdat);
+	}
 	if (!prevactive && srcdat->IsActive())
 		activecount++;
+	if (srcdat->INF_HasSentData())
+		AddReportSource(srcdat);
 
 	if (created)
 		OnNewSource(srcdat);
@@ -653,6 +677,17 @@ RTPPacket *RTPSources::GetNextPacket()
 	return pack;
 }
 
+RTPPacket *RTPSources::GetPlayoutPacket(const RTPTime &now,uint32_t *lost)
+{
+	if (lost)
+		*lost = 0;
+	if (!sourcelist.HasCurrentElement())
+		return 0;
+	
+	RTPInternalSourceData *srcdat = sourcelist.GetCurrentElement();
+	return srcdat->GetPlayoutPacket(now,lost);
+}
+
 int RTPSources::ProcessRTCPSenderInfo(uint32_t ssrc,const RTPNTPTime &ntptime,uint32_t rtptime,
                           uint32_t packetcount,uint32_t octetcount,const RTPTime &receivetime,
 			  const RTPAddress *senderaddress)
@@ -749,6 +784,11 @@ int RTPSources::ProcessSDESNormalItem(uint32_t ssrc,RTCPSDESPacket::ItemType t,s
 	status = srcdat->ProcessSDESItem(sdesid,(const uint8_t *)itemdata,itemlength,receivetime,&cnamecollis);
 	if (!prevactive && srcdat->IsActive())
 		activecount++;
+	if (sdesid == RTCP_SDES_ID_NOTE && status >= 0 && !srcdat->notetimeoutqueued)
+	{
+		srcdat->notetimeoutqueued = true;
+		QueueTimeout(notetimeouts,srcdat->INF_GetLastSDESNoteTime(),srcdat);
+	}
 	
 	// Call the callback
 	if (created)
@@ -811,6 +851,11 @@ int RTPSources::ProcessBYE(uint32_t ssrc,size_t reasonlength,const void *reasond
 	srcdat->ProcessBYEPacket((const uint8_t *)reasondata,reasonlength,receivetime);
 	if (prevactive && !srcdat->IsActive())
 		activecount--;
+	if (srcdat->ReceivedBYE() && !srcdat->byetimeoutqueued)
+	{
+		srcdat->byetimeoutqueued = true;
+		QueueTimeout(byetimeouts,srcdat->GetBYETime(),srcdat);
+	}
 	
 	// Call the callback
 	if (created)
@@ -833,6 +878,7 @@ int RTPSources::ObtainSourceDataInstance(uint32_t ssrc,RTPInternalSourceData **s
 #endif // RTP_SUPPORT_PROBATION
 		if (srcdat2 == 0)
 			return ERR_RTP_OUTOFMEM;
+		srcdat2->SetPacketQueueParameters(reorderdepth,reorderpackets);
 		if ((status = sourcelist.AddElement(ssrc,srcdat2)) < 0)
 		{
 			RTPDelete(srcdat2,GetMemoryManager());
@@ -841,6 +887,9 @@ int RTPSources::ObtainSourceDataInstance(uint32_t ssrc,RTPInternalSourceData **s
 		*srcdat = srcdat2;
 		*created = true;
 		totalcount++;
+
+		srcdat2->timeoutserial = nexttimeoutserial++;
+		QueueTimeout(membertimeouts,srcdat2->INF_GetLastMessageTime(),srcdat2);
 	}
 	else
 	{
@@ -927,6 +976,7 @@ void RTPSources::Timeout(const RTPTime &curtime,const RTPTime &timeoutdelay)
 				activecount--;
 			
 			sourcelist.DeleteCurrentElement();
+			RemoveReportSource(srcdat);
 
 			OnTimeout(srcdat);
 			OnRemoveSource(srcdat);
@@ -1046,6 +1096,7 @@ void RTPSources::BYETimeout(const RTPTime &curtime,const RTPTime &timeoutdelay)
 				if (srcdat->IsActive())
 					activecount--;
 				sourcelist.DeleteCurrentElement();
+				RemoveReportSource(srcdat);
 				OnBYETimeout(srcdat);
 				OnRemoveSource(srcdat);
 				RTPDelete(srcdat,GetMemoryManager());
@@ -1154,9 +1205,6 @@ void RTPSources::NoteTimeout(const RTPTime &curtime,const RTPTime &timeoutdelay)
 	
 void RTPSources::MultipleTimeouts(const RTPTime &curtime,const RTPTime &sendertimeout,const RTPTime &byetimeout,const RTPTime &generaltimeout,const RTPTime &notetimeout)
 {
-	int newtotalcount = 0;
-	int newsendercount = 0;
-	int newactivecount = 0;
 	RTPTime senderchecktime = curtime;
 	RTPTime byechecktime = curtime;
 	RTPTime generaltchecktime = curtime;
@@ -1165,122 +1213,209 @@ void RTPSources::MultipleTimeouts(const RTPTime &curtime,const RTPTime &senderti
 	byechecktime -= byetimeout;
 	generaltchecktime -= generaltimeout;
 	notechecktime -= notetimeout;
-	
-	sourcelist.GotoFirstElement();
-	while (sourcelist.HasCurrentElement())
-	{
-		RTPInternalSourceData *srcdat = sourcelist.GetCurrentElement();
-		bool deleted,issender,isactive;
-		bool byetimeout,normaltimeout,notetimeout;
-		
-		size_t notelen;
-		
-		issender = srcdat->IsSender();
-		isactive = srcdat->IsActive();
-		deleted = false;
-		byetimeout = false;
-		normaltimeout = false;
-		notetimeout = false;
 
-        	srcdat->SDES_GetNote(&notelen);
-		if (notelen != 0) // Note has been set
-		{
-			RTPTime notetime = srcdat->INF_GetLastSDESNoteTime();
-			
-			if (notechecktime > notetime)
-			{
-				notetimeout = true;
-				srcdat->ClearNote();
-			}
-		}
+	RTPInternalSourceData *srcdat;
 
-		if (srcdat->ReceivedBYE())
-		{
-			RTPTime byetime = srcdat->GetBYETime();
+	// The BYE timeouts are handled first, so that a source which both sent a BYE
+	// packet and timed out is reported as a BYE timeout
 
-			if ((srcdat != owndata) && (byechecktime > byetime))
-			{
-				sourcelist.DeleteCurrentElement();
-				deleted = true;
-				byetimeout = true;
-			}
+	while (PopTimeout(byetimeouts,byechecktime,&srcdat))
+	{
+		if (srcdat == 0)
+			continue;
+		if (srcdat == owndata || !srcdat->ReceivedBYE())
+		{
+			srcdat->byetimeoutqueued = false;
+			continue;
 		}
 
-		if (!deleted)
-		{
-			RTPTime lastmsgtime = srcdat->INF_GetLastMessageTime();
+		RTPTime byetime = srcdat->GetBYETime();
 
-			if ((srcdat != owndata) && (lastmsgtime < generaltchecktime))
-			{
-				sourcelist.DeleteCurrentElement();
-				deleted = true;
-				normaltimeout = true;
-			}
-		}
-		
-		if (!deleted)
-		{
-			newtotalcount++;
-			
-			if (issender)
-			{
-				RTPTime lastrtppacktime = srcdat->INF_GetLastRTPPacketTime();
+		if (byechecktime > byetime)
+			RemoveTimedOutSource(srcdat,true);
+		else
+			QueueTimeout(byetimeouts,byetime,srcdat);
+	}
 
-				if (lastrtppacktime < senderchecktime)
-				{
-					srcdat->ClearSenderFlag();
-					sendercount--;
-				}
-				else
-					newsendercount++;
-			}
+	while (PopTimeout(membertimeouts,generaltchecktime,&srcdat))
+	{
+		if (srcdat == 0 || srcdat == owndata)
+			continue;
 
-			if (isactive)
-				newactivecount++;
+		RTPTime lastmsgtime = srcdat->INF_GetLastMessageTime();
 
-			if (notetimeout)
-				OnNoteTimeout(srcdat);
+		if (lastmsgtime < generaltchecktime)
+			RemoveTimedOutSource(srcdat,false);
+		else
+			QueueTimeout(membertimeouts,lastmsgtime,srcdat);
+	}
 
-			sourcelist.GotoNextElement();
-		}
-		else // deleted entry
+	while (PopTimeout(sendertimeouts,senderchecktime,&srcdat))
+	{
+		if (srcdat == 0)
+			continue;
+		if (!srcdat->IsSender())
 		{
-			if (issender)
-				sendercount--;
-			if (isactive)
-				activecount--;
-			totalcount--;
+			srcdat->sendertimeoutqueued = false;
+			continue;
+		}
 
-			if (byetimeout)
-				OnBYETimeout(srcdat);
-			if (normaltimeout)
-				OnTimeout(srcdat);
-			OnRemoveSource(srcdat);
-			RTPDelete(srcdat,GetMemoryManager());
+		RTPTime lastrtppacktime = srcdat->INF_GetLastRTPPacketTime();
+
+		if (lastrtppacktime < senderchecktime)
+		{
+			srcdat->ClearSenderFlag();
+			srcdat->sendertimeoutqueued = false;
+			sendercount--;
 		}
-	}	
-	
-#ifdef RTPDEBUG
-	if (newtotalcount != totalcount)
-	{
-		SafeCountTotal();
-		std::cout << "New total count " << newtotalcount << " doesnt match old total count " << totalcount << std::endl;
+		else
+			QueueTimeout(sendertimeouts,lastrtppacktime,srcdat);
 	}
-	if (newsendercount != sendercount)
+
+	while (PopTimeout(notetimeouts,notechecktime,&srcdat))
 	{
-		SafeCountSenders();
-		std::cout << "New sender count " << newsendercount << " doesnt match old sender count " << sendercount << std::endl;
+		if (srcdat == 0)
+			continue;
+
+		size_t notelen;
+
+		srcdat->SDES_GetNote(&notelen);
+		if (notelen == 0) // Note has been cleared in the meantime
+		{
+			srcdat->notetimeoutqueued = false;
+			continue;
+		}
+
+		RTPTime notetime = srcdat->INF_GetLastSDESNoteTime();
+
+		if (notechecktime > notetime)
+		{
+			srcdat->ClearNote();
+			srcdat->notetimeoutqueued = false;
+			OnNoteTimeout(srcdat);
+		}
+		else
+			QueueTimeout(notetimeouts,notetime,srcdat);
 	}
-	if (newactivecount != activecount)
+}
+
+void RTPSources::QueueTimeout(TimeoutQueue &queue,const RTPTime &t,RTPInternalSourceData *srcdat)
+{
+	queue.push_back(TimeoutEntry(t,srcdat->GetSSRC(),srcdat->timeoutserial));
+	std::push_heap(queue.begin(),queue.end(),TimeoutEntryCompare());
+}
+
+void RTPSources::QueueSenderTimeout(RTPInternalSourceData *srcdat)
+{
+	if (srcdat->sendertimeoutqueued)
+		return;
+	srcdat->sendertimeoutqueued = true;
+	QueueTimeout(sendertimeouts,srcdat->INF_GetLastRTPPacketTime(),srcdat);
+}
+
+// Removes the first entry from the queue if its time lies before 'checktime'. If
+// the source it refers to still exists, it's stored in 'srcdat', otherwise 'srcdat'
+// is set to zero.
+bool RTPSources::PopTimeout(TimeoutQueue &queue,const RTPTime &checktime,RTPInternalSourceData **srcdat)
+{
+	if (queue.empty() || !(queue.front().time < checktime))
+		return false;
+
+	TimeoutEntry entry = queue.front();
+
+	std::pop_heap(queue.begin(),queue.end(),TimeoutEntryCompare());
+	queue.pop_back();
+
+	// The serial number makes sure that an entry of a source which has been
+	// deleted isn't used for a new source with the same SSRC
+	*srcdat = 0;
+	if (sourcelist.GotoElement(entry.ssrc) >= 0)
 	{
-		std::cout << "New active count " << newactivecount << " doesnt match old active count " << activecount << std::endl;
-		SafeCountActive();
+		RTPInternalSourceData *s = sourcelist.GetCurrentElement();
+
+		if (s->timeoutserial == entry.serial)
+			*srcdat = s;
 	}
-#endif // RTPDEBUG
-	
-	totalcount = newtotalcount; // just to play it safe
-	sendercount = newsendercount;
-	activecount = newactivecount;
+	return true;
+}
+
+void RTPSources::RemoveTimedOutSource(RTPInternalSourceData *srcdat,bool byetimeout)
+{
+	sourcelist.GotoElement(srcdat->GetSSRC());
+	sourcelist.DeleteCurrentElement();
+	RemoveReportSource(srcdat);
+
+	if (srcdat->IsSender())
+		sendercount--;
+	if (srcdat->IsActive())
+		activecount--;
+	totalcount--;
+
+	if (byetimeout)
+		OnBYETimeout(srcdat);
+	else
+		OnTimeout(srcdat);
+	OnRemoveSource(srcdat);
+	RTPDelete(srcdat,GetMemoryManager());
+}
+
+bool RTPSources::GotoNextReportSource()
+{
+	if (curreportsource == 0)
+		return false;
+	curreportsource = curreportsource->nextreportsource;
+	return (curreportsource != 0);
+}
+
+RTPSourceData *RTPSources::GetCurrentReportSourceInfo()
+{
+	return curreportsource;
+}
+
+bool RTPSources::DeleteCurrentReportSource()
+{
+	RTPInternalSourceData *srcdat = curreportsource;
+
+	if (srcdat == 0)
+		return false;
+	RemoveReportSource(srcdat);
+	return (curreportsource != 0);
+}
+
+void RTPSources::AddReportSource(RTPInternalSourceData *srcdat)
+{
+	if (srcdat->inreportlist)
+		return;
+
+	srcdat->prevreportsource = lastreportsource;
+	srcdat->nextreportsource = 0;
+	if (lastreportsource)
+		lastreportsource->nextreportsource = srcdat;
+	else
+		firstreportsource = srcdat;
+	lastreportsource = srcdat;
+	srcdat->inreportlist = true;
+}
+
+void RTPSources::RemoveReportSource(RTPInternalSourceData *srcdat)
+{
+	if (!srcdat->inreportlist)
+		return;
+
+	if (curreportsource == srcdat)
+		curreportsource = srcdat->nextreportsource;
+	if (srcdat->prevreportsource)
+		srcdat->prevreportsource->nextreportsource = srcdat->nextreportsource;
+	else
+		firstreportsource = srcdat->nextreportsource;
+	if (srcdat->nextreportsource)
+		srcdat->nextreportsource->prevreportsource = srcdat->prevreportsource;
+	else
+		lastreportsource = srcdat->prevreportsource;
+
+	srcdat->prevreportsource = 0;
+	srcdat->nextreportsource = 0;
+	srcdat->inreportlist = false;
 }
 
 #ifdef RTPDEBUG
@@ -40,10 +40,14 @@
 
 #include "rtpconfig.h"
 #include "rtpkeyhashtable.h"
+#include "rtpflatkeyhashtable.h"
 #include "rtcpsdespacket.h"
 #include "rtptypes.h"
 #include "rtpmemoryobject.h"
+#include "rtptimeutilities.h"
+#include <vector>
 
+// Deprecated: no longer used by RTPSources, only kept for source compatibility
 #define RTPSOURCES_HASHSIZE							8317
 
 namespace jrtplib
@@ -54,6 +58,12 @@ class JRTPLIB_IMPORTEXPORT RTPSources_GetHashIndex
 public:
 	static int GetIndex(const uint32_t &ssrc)				{ return ssrc%RTPSOURCES_HASHSIZE; }
 };
+
+class JRTPLIB_IMPORTEXPORT RTPSources_GetHash
+{
+public:
+	static uint32_t GetHash(const uint32_t &ssrc)				{ return ssrc; }
+};
 	
 class RTPNTPTime;
 class RTPTransmitter;
@@ -61,7 +71,7 @@ class RTCPAPPPacket;
 class RTPInternalSourceData;
 class RTPRawPacket;
 class RTPPacket;
-class RTPTime;
+class RTPPacketView;
 class RTPAddress;
 class RTPSourceData;
 
@@ -94,6 +104,15 @@ public:
 	void SetProbationType(ProbationType probtype)							{ probationtype = probtype; }
 #endif // RTP_SUPPORT_PROBATION
 
+	/** Sets the number of RTP packets that can be queued for a source to \c depth (see RTPPacketRing);
+	 *  this only affects sources which are created afterwards. */
+	void SetReorderDepth(size_t depth)										{ reorderdepth = depth; }
+
+	/** Specifies if the queued RTP packets of a source should be ordered by sequence number (the default)
+	 *  or should be kept in the order in which they were received; this only affects sources which are
+	 *  created afterwards. */
+	void SetReorderPackets(bool f)											{ reorderpackets = f; }
+
 	/** Creates an entry for our own SSRC identifier. */
 	int CreateOwnSSRC(uint32_t ssrc);
 
@@ -193,18 +212,25 @@ public:
 	/** Starts the iteration over the participants by going to the first member in the table.
 	 *  Starts the iteration over the participants by going to the first member in the table.
 	 *  If a member was found, the function returns \c true, otherwise it returns \c false.
+	 *  The members are visited in the order in which they were added, until one is deleted:
+	 *  the last member in the table is then moved into the place of the deleted one. This
+	 *  means that the order can change whenever a member is removed (e.g. because of a BYE
+	 *  packet or a timeout), so an iteration should not be continued across such changes and
+	 *  the order should not be relied upon.
 	 */
 	bool GotoFirstSource();
 
 	/** Sets the current source to be the next source in the table.
 	 *  Sets the current source to be the next source in the table. If we're already at the last source, 
-	 *  the function returns \c false, otherwise it returns \c true.
+	 *  the function returns \c false, otherwise it returns \c true. See GotoFirstSource for the order
+	 *  in which the sources are visited.
 	 */
 	bool GotoNextSource();
 
 	/** Sets the current source to be the previous source in the table.
 	 *  Sets the current source to be the previous source in the table. If we're at the first source, 
-	 *  the function returns \c false, otherwise it returns \c true.
+	 *  the function returns \c false, otherwise it returns \c true. See GotoFirstSource for the order
+	 *  in which the sources are visited.
 	 */
 	bool GotoPreviousSource();
 
@@ -243,12 +269,37 @@ public:
 	/** Extracts the next packet from the received packets queue of the current participant. */
 	RTPPacket *GetNextPacket();
 
+	/** Extracts the next packet of the current participant if it's time to play it out (see RTPSourceData::GetPlayoutPacket). */
+	RTPPacket *GetPlayoutPacket(const RTPTime &now,uint32_t *lost = 0);
+
 	/** Returns \c true if an entry for participant \c ssrc exists and \c false otherwise. */
 	bool GotEntry(uint32_t ssrc);
 
 	/** If present, it returns the RTPSourceData instance of the entry which was created by CreateOwnSSRC. */
 	RTPSourceData *GetOwnSourceInfo()								{ return (RTPSourceData *)owndata; }
 
+	/** Starts the iteration over the sources which may need an RTCP report block.
+	 *  Starts the iteration over the sources for which RTP data was received since they were
+	 *  last removed from this list using RTPSources::DeleteCurrentReportSource. The sources are
+	 *  kept in the order in which they were added, and this iteration doesn't affect the one
+	 *  over all sources. If a source was found, the function returns \c true, otherwise it
+	 *  returns \c false.
+	 */
+	bool GotoFirstReportSource()									{ curreportsource = firstreportsource; return (curreportsource != 0); }
+
+	/** Sets the current report source to be the next one, returns \c false if there is none. */
+	bool GotoNextReportSource();
+
+	/** Returns the RTPSourceData instance of the current report source. */
+	RTPSourceData *GetCurrentReportSourceInfo();
+
+	/** Removes the current source from the list of sources which may need a report block.
+	 *  Removes the current source from the list of sources which may need a report block; it
+	 *  will be added again when an RTP packet for it is processed. The next source becomes the 
+	 *  current one, and the function returns \c false if there is none.
+	 */
+	bool DeleteCurrentReportSource();
+
 	/** Assuming that the current time is \c curtime, time out the members from whom we haven't heard 
 	 *  during the previous time  interval \c timeoutdelay.
 	 */
@@ -271,7 +322,9 @@ public:
 
 	/** Combines the functions SenderTimeout, BYETimeout, Timeout and NoteTimeout.
 	 *  Combines the functions SenderTimeout, BYETimeout, Timeout and NoteTimeout. This is more efficient
-	 *  than calling all four functions since only one iteration is needed in this function.
+	 *  than calling all four functions: instead of iterating over the whole table, the sources are kept
+	 *  in queues ordered by the time of their last activity, so that only the sources which may have
+	 *  timed out need to be inspected.
 	 */
 	void MultipleTimeouts(const RTPTime &curtime,const RTPTime &sendertimeout,
 			      const RTPTime &byetimeout,const RTPTime &generaltimeout,
@@ -363,18 +416,67 @@ protected:
 	 *  `ispackethandled` is set to `true`, the packet will no longer be stored in this
 	 *  source's packet list. */
 	virtual void OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack, bool isonprobation, bool *ispackethandled);
+
+	/** Allows you to use a validated RTP packet from the specified source before an RTPPacket instance is created for it.
+	 *  Allows you to use a validated RTP packet from the specified source before an RTPPacket instance 
+	 *  is created for it. The \c view only refers to the received data and is only valid during this 
+	 *  call. If `ispackethandled` is set to `true`, the packet is neither passed to OnValidatedRTPPacket 
+	 *  nor stored in this source's packet list, so that no memory needs to be allocated for it. */
+	virtual void OnValidatedRTPPacketView(RTPSourceData *srcdat, const RTPPacketView &view, bool isonprobation, bool *ispackethandled);
 private:
+	int ProcessRTPPacket(RTPPacketView &view,RTPPacket *rtppack,RTPRawPacket *rawpack,const RTPAddress *senderaddress,bool *stored);
 	void ClearSourceList();
 	int ObtainSourceDataInstance(uint32_t ssrc,RTPInternalSourceData **srcdat,bool *created);
 	int GetRTCPSourceData(uint32_t ssrc,const RTPAddress *senderaddress,RTPInternalSourceData **srcdat,bool *newsource);
 	bool CheckCollision(RTPInternalSourceData *srcdat,const RTPAddress *senderaddress,bool isrtp);
+
+	// An entry in one of the timeout queues. The time is the activity time of the
+	// source when the entry was queued; since this can only increase, a source
+	// can't time out before its entry reaches the front of the queue.
+	class TimeoutEntry
+	{
+	public:
+		TimeoutEntry(const RTPTime &t,uint32_t s,uint32_t n) : time(t),ssrc(s),serial(n)	{ }
+		
+		RTPTime time;
+		uint32_t ssrc;
+		uint32_t serial;
+	};
+
+	class TimeoutEntryCompare
+	{
+	public:
+		bool operator()(const TimeoutEntry &a,const TimeoutEntry &b) const			{ return a.time > b.time; }
+	};
+
+	typedef std::vector<TimeoutEntry> TimeoutQueue;
+
+	void QueueTimeout(TimeoutQueue &queue,const RTPTime &t,RTPInternalSourceData *srcdat);
+	bool PopTimeout(TimeoutQueue &queue,const RTPTime &checktime,RTPInternalSourceData **srcdat);
+	void QueueSenderTimeout(RTPInternalSourceData *srcdat);
+	void RemoveTimedOutSource(RTPInternalSourceData *srcdat,bool byetimeout);
+	void AddReportSource(RTPInternalSourceData *srcdat);
+	void RemoveReportSource(RTPInternalSourceData *srcdat);
 	
-	RTPKeyHashTable<const uint32_t,RTPInternalSourceData*,RTPSources_GetHashIndex,RTPSOURCES_HASHSIZE> sourcelist;
+	RTPFlatKeyHashTable<const uint32_t,RTPInternalSourceData*,RTPSources_GetHash> sourcelist;
+
+	TimeoutQueue membertimeouts;
+	TimeoutQueue sendertimeouts;
+	TimeoutQueue byetimeouts;
+	TimeoutQueue notetimeouts;
+	uint32_t nexttimeoutserial;
+
+	RTPInternalSourceData *firstreportsource;
+	RTPInternalSourceData *lastreportsource;
+	RTPInternalSourceData *curreportsource;
 	
 	int sendercount;
 	int totalcount;
 	int activecount;
 
+	size_t reorderdepth;
+	bool reorderpackets;
+
 #ifdef RTP_SUPPORT_PROBATION
 	ProbationType probationtype;
 #endif // RTP_SUPPORT_PROBATION
@@ -405,6 +507,7 @@ inline void RTPSources::OnUnknownPacketType(RTCPPacket *, const RTPTime &, const
 inline void RTPSources::OnUnknownPacketFormat(RTCPPacket *, const RTPTime &, const RTPAddress *)                    { }
 inline void RTPSources::OnNoteTimeout(RTPSourceData *)                                                              { }
 inline void RTPSources::OnValidatedRTPPacket(RTPSourceData *, RTPPacket *, bool, bool *)                            { }
+inline void RTPSources::OnValidatedRTPPacketView(RTPSourceData *, const RTPPacketView &, bool, bool *)              { }
 
 } // end namespace
 
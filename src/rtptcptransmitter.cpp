@@ -39,9 +39,14 @@
 #include "rtpsocketutilinternal.h"
 #include "rtpinternalutils.h"
 #include "rtpselect.h"
+#include "rtpslabpool.h"
 #include <stdio.h>
 #include <assert.h>
+#include <errno.h>
 #include <vector>
+#ifndef RTP_SOCKETTYPE_WINSOCK
+	#include <sys/uio.h>
+#endif // RTP_SOCKETTYPE_WINSOCK
 #ifdef RTPDEBUG
 	#include <iostream>
 #endif // RTPDEBUG
@@ -69,8 +74,9 @@ using namespace std;
 namespace jrtplib
 {
 
-RTPTCPTransmitter::RTPTCPTransmitter(RTPMemoryManager *mgr) : RTPTransmitter(mgr)
+RTPTCPTransmitter::RTPTCPTransmitter(RTPMemoryManager *mgr) : RTPTransmitter(mgr), m_coalescingDelay(0, 0)
 {
+	m_pSlabPool = 0;
 	m_created = false;
 	m_init = false;
 }
@@ -158,6 +164,38 @@ int RTPTCPTransmitter::Create(size_t maximumpacketsize, const RTPTransmissionPar
 		}
 	}
 
+	// The incoming data is read into slabs of this pool, a slab must be able to
+	// contain at least one packet of the maximum size with its length prefix
+#ifdef RTP_SUPPORT_THREAD
+	bool slabthreadsafe = m_threadsafe;
+#else
+	bool slabthreadsafe = false;
+#endif // RTP_SUPPORT_THREAD
+	size_t slabsize = params->GetReceiveBufferSize();
+
+	if (slabsize < RTPTCPTRANS_MAXPACKSIZE+2)
+		slabsize = RTPTCPTRANS_MAXPACKSIZE+2;
+
+	m_pSlabPool = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPSLABPOOL) RTPSlabPool(GetMemoryManager());
+	if (m_pSlabPool == 0)
+	{
+		m_abortDesc.Destroy(); // Doesn't do anything if not initialized
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_OUTOFMEM;
+	}
+	if ((status = m_pSlabPool->Create(slabsize, params->GetReceiveBufferPoolSize(), slabthreadsafe)) < 0)
+	{
+		m_pSlabPool->Release();
+		m_pSlabPool = 0;
+		m_abortDesc.Destroy();
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	m_coalescingSize = params->GetSendCoalescingSize();
+	m_coalescingDelay = params->GetSendCoalescingDelay();
+	m_maxSendBacklog = params->GetMaximumSendBacklog();
+
 	m_waitingForData = false;
 	m_created = true;
 	MAINMUTEX_UNLOCK 
@@ -179,6 +217,10 @@ void RTPTCPTransmitter::Destroy()
 	ClearDestSockets();
 	FlushPackets();
 	m_created = false;
+
+	// Packets that still use one of the slabs keep the pool alive
+	m_pSlabPool->Release();
+	m_pSlabPool = 0;
 	
 	if (m_waitingForData)
 	{
@@ -294,6 +336,11 @@ int RTPTCPTransmitter::Poll()
 	int status = 0;
 
 	vector<SocketType> errSockets;
+	vector<SocketType> sendErrSockets;
+
+	// Data which was collected for too long, or which could not be sent
+	// earlier, is sent first
+	FlushExpiredSendBuffers(sendErrSockets);
 
 	while (it != end)
 	{
@@ -317,6 +364,8 @@ int RTPTCPTransmitter::Poll()
 	}
 	MAINMUTEX_UNLOCK
 
+	for (size_t i = 0 ; i < sendErrSockets.size() ; i++)
+		OnSendError(sendErrSockets[i]);
 	for (size_t i = 0 ; i < errSockets.size() ; i++)
 		OnReceiveError(errSockets[i]);
 
@@ -439,12 +488,27 @@ int RTPTCPTransmitter::AbortWait()
 
 int RTPTCPTransmitter::SendRTPData(const void *data,size_t len)	
 {
-	return SendRTPRTCPData(data, len);
+	RTPIOVec iov;
+
+	iov.data = data;
+	iov.len = len;
+	return SendRTPRTCPData(&iov, 1);
 }
 
 int RTPTCPTransmitter::SendRTCPData(const void *data,size_t len)
 {
-	return SendRTPRTCPData(data, len);
+	RTPIOVec iov;
+
+	iov.data = data;
+	iov.len = len;
+	return SendRTPRTCPData(&iov, 1);
+}
+
+int RTPTCPTransmitter::SendRTPDataIov(const RTPIOVec *iov,int numiov)
+{
+	if (numiov > RTP_MAXIOVECS)
+		return RTPTransmitter::SendRTPDataIov(iov, numiov);
+	return SendRTPRTCPData(iov, numiov);
 }
 
 int RTPTCPTransmitter::AddDestination(const RTPAddress &addr)
@@ -532,10 +596,10 @@ int RTPTCPTransmitter::DeleteDestination(const RTPAddress &addr)
 		return ERR_RTP_TCPTRANS_SOCKETNOTFOUNDINDESTINATIONS;
 	}
 
-	// Clean up possibly allocated memory
-	uint8_t *pBuf = it->second.ExtractDataBuffer();
-	if (pBuf)
-		RTPDeleteByteArray(pBuf, GetMemoryManager());
+	// Release the receive buffer
+	RTPReceiveSlab *pSlab = it->second.ExtractReceiveSlab();
+	if (pSlab)
+		pSlab->Release();
 
 	m_destSockets.erase(it);
 
@@ -697,66 +761,141 @@ int RTPTCPTransmitter::PollSocket(SocketType sock, SocketData &sdata)
 #else 
 	size_t len;
 #endif // RTP_SOCKETTYPE_WINSOCK
-	bool dataavailable;
 	
-	do
+	while (true)
 	{
 		len = 0;
 		RTPIOCTL(sock, FIONREAD, &len);
 
 		if (len <= 0) 
-			dataavailable = false;
-		else
-			dataavailable = true;
+			break;
 		
-		if (dataavailable)
+		int status = PrepareReceiveSlab(sock, sdata);
+		if (status < 0)
+			return status;
+
+		// Read as much as is available and fits in the slab with a single call
+		size_t space = sdata.m_pRecvSlab->GetSize()-sdata.m_recvEnd;
+		size_t num = (size_t)len;
+
+		if (num > space)
+			num = space;
+
+		RTPTime curtime = RTPTime::CurrentTime();
+		int r = (int)recv(sock, (char *)(sdata.m_pRecvSlab->GetData()+sdata.m_recvEnd), (int)num, 0);
+		if (r < 0)
+			return ERR_RTP_TCPTRANS_ERRORINRECV;
+		if (r == 0) // shouldn't happen since data was available
+			break;
+
+		sdata.m_recvEnd += (size_t)r;
+
+		if ((status = ExtractFrames(sdata, curtime)) < 0)
+			return status;
+	}
+
+	return 0;
+}
+
+// Makes sure that there's a slab with room for more data, and in which the
+// frame that's currently incomplete can be completed. Packets only refer to
+// the data before m_recvStart, so reading on at m_recvEnd is always safe; a
+// new slab is only needed when the current one is full.
+int RTPTCPTransmitter::PrepareReceiveSlab(SocketType sock, SocketData &sdata)
+{
+	RTPReceiveSlab *pSlab = sdata.m_pRecvSlab;
+	size_t pending = 0;
+
+	if (pSlab)
+	{
+		size_t slabsize = pSlab->GetSize();
+		bool fits = (sdata.m_recvEnd < slabsize);
+
+		pending = sdata.m_recvEnd-sdata.m_recvStart;
+		if (fits && pending >= 2)
 		{
-			RTPTime curtime = RTPTime::CurrentTime();
-			int relevantLen = RTPTCPTRANS_MAXPACKSIZE+2;
-			
-			if ((int)len < relevantLen)
-				relevantLen = (int)len;
-
-			bool complete = false;
-			int status = sdata.ProcessAvailableBytes(sock, relevantLen, complete, GetMemoryManager());
-			if (status < 0)
-				return status;
-			
-			if (complete)
-			{
-				uint8_t *pBuf = sdata.ExtractDataBuffer();
-				if (pBuf)
-				{
-					int dataLength = sdata.m_dataLength;
-					sdata.Reset();
-
-					RTPTCPAddress *pAddr = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPADDRESS) RTPTCPAddress(sock);
-					if (pAddr == 0)
-						return ERR_RTP_OUTOFMEM;
-
-					bool isrtp = true;
-					if (dataLength > (int)sizeof(RTCPCommonHeader))
-					{
-						RTCPCommonHeader *rtcpheader = (RTCPCommonHeader *)pBuf;
-						uint8_t packettype = rtcpheader->packettype;
-
-						if (packettype >= 200 && packettype <= 204)
-							isrtp = false;
-					}
-						
-					RTPRawPacket *pPack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(pBuf, dataLength, pAddr, curtime, isrtp, GetMemoryManager());
-					if (pPack == 0)
-					{
-						RTPDelete(pAddr,GetMemoryManager());
-						RTPDeleteByteArray(pBuf,GetMemoryManager());
-						return ERR_RTP_OUTOFMEM;
-					}
-					m_rawpacketlist.push_back(pPack);	
-				}
-			}
+			uint8_t *pData = pSlab->GetData()+sdata.m_recvStart;
+			size_t framelen = (((size_t)pData[0]) << 8) | ((size_t)pData[1]);
+
+			if (sdata.m_recvStart+2+framelen > slabsize)
+				fits = false;
+		}
+		if (fits)
+			return 0;
+	}
+
+	// Start using a new slab, containing the part of the frame which has already
+	// been received
+	RTPReceiveSlab *pNewSlab = m_pSlabPool->AcquireSlab();
+	if (pNewSlab == 0)
+		return ERR_RTP_OUTOFMEM;
+
+	RTPTCPAddress *pAddr = static_cast<RTPTCPAddress *>(pNewSlab->GetAddress());
+	if (pAddr == 0 || pAddr->GetSocket() != sock)
+	{
+		RTPTCPAddress *pNewAddr = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPADDRESS) RTPTCPAddress(sock);
+		if (pNewAddr == 0)
+		{
+			pNewSlab->Release();
+			return ERR_RTP_OUTOFMEM;
+		}
+		if (pAddr)
+			RTPDelete(pAddr, GetMemoryManager());
+		pNewSlab->SetAddress(pNewAddr);
+	}
+
+	if (pending > 0)
+		memcpy(pNewSlab->GetData(), pSlab->GetData()+sdata.m_recvStart, pending);
+	if (pSlab)
+		pSlab->Release();
+
+	sdata.m_pRecvSlab = pNewSlab;
+	sdata.m_recvStart = 0;
+	sdata.m_recvEnd = pending;
+	return 0;
+}
+
+// Creates a raw packet for each complete frame in the received data, each of
+// these refers to the data in the slab
+int RTPTCPTransmitter::ExtractFrames(SocketData &sdata, const RTPTime &curtime)
+{
+	RTPReceiveSlab *pSlab = sdata.m_pRecvSlab;
+	uint8_t *pSlabData = pSlab->GetData();
+
+	while (sdata.m_recvEnd-sdata.m_recvStart >= 2)
+	{
+		uint8_t *pFrame = pSlabData+sdata.m_recvStart;
+		size_t dataLength = (((size_t)pFrame[0]) << 8) | ((size_t)pFrame[1]);
+
+		if (sdata.m_recvEnd-sdata.m_recvStart < dataLength+2) // not complete yet
+			break;
+
+		sdata.m_recvStart += dataLength+2;
+		if (dataLength == 0) // nothing to process
+			continue;
+
+		uint8_t *pBuf = pFrame+2;
+		bool isrtp = true;
+		if (dataLength > sizeof(RTCPCommonHeader))
+		{
+			RTCPCommonHeader *rtcpheader = (RTCPCommonHeader *)pBuf;
+			uint8_t packettype = rtcpheader->packettype;
+
+			if (packettype >= 200 && packettype <= 204)
+				isrtp = false;
 		}
-	} while (dataavailable);
 
+		RTPTime recvtime = curtime;
+		pSlab->AddReference(); // this reference is taken over by the raw packet
+
+		RTPRawPacket *pPack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(pSlab, pBuf, dataLength, recvtime, isrtp, GetMemoryManager());
+		if (pPack == 0)
+		{
+			pSlab->Release();
+			return ERR_RTP_OUTOFMEM;
+		}
+		m_rawpacketlist.push_back(pPack);	
+	}
 	return 0;
 }
 
@@ -767,8 +906,13 @@ void RTPTCPTransmitter::Dump()
 }
 #endif // RTPDEBUG
 
-int RTPTCPTransmitter::SendRTPRTCPData(const void *data, size_t len)
+int RTPTCPTransmitter::SendRTPRTCPData(const RTPIOVec *iov, int numiov)
 {
+	size_t len = 0;
+
+	for (int i = 0 ; i < numiov ; i++)
+		len += iov[i].len;
+
 	if (!m_init)
 		return ERR_RTP_TCPTRANS_NOTINIT;
 
@@ -789,29 +933,27 @@ int RTPTCPTransmitter::SendRTPRTCPData(const void *data, size_t len)
 	std::map<SocketType, SocketData>::iterator end = m_destSockets.end();
 
 	vector<SocketType> errSockets;
-	int flags = 0;
-#ifdef RTP_HAVE_MSG_NOSIGNAL
-	flags = MSG_NOSIGNAL;
-#endif // RTP_HAVE_MSG_NOSIGNAL
+	vector<SocketType> overflowSockets;
+	RTPTime curtime = (m_coalescingSize > 0)?RTPTime::CurrentTime():RTPTime(0, 0);
 
 	while (it != end)
 	{
-		uint8_t lengthBytes[2] = { (uint8_t)((len >> 8)&0xff), (uint8_t)(len&0xff) };
 		SocketType sock = it->first;
+		bool overflow = false;
 
-		if (send(sock,(const char *)lengthBytes,2,flags) < 0 ||
-			send(sock,(const char *)data,len,flags) < 0)
+		if (SendFrame(sock, it->second, iov, numiov, len, curtime, overflow) < 0)
 			errSockets.push_back(sock);
+		else if (overflow)
+			overflowSockets.push_back(sock);
 		++it;
 	}
 	
 	MAINMUTEX_UNLOCK
 
-	if (errSockets.size() != 0)
-	{
-		for (size_t i = 0 ; i < errSockets.size() ; i++)
-			OnSendError(errSockets[i]);
-	}
+	for (size_t i = 0 ; i < errSockets.size() ; i++)
+		OnSendError(errSockets[i]);
+	for (size_t i = 0 ; i < overflowSockets.size() ; i++)
+		OnSendBufferOverflow(overflowSockets[i]);
 
 	// Don't return an error code to avoid the poll thread exiting
 	// due to one closed connection for example
@@ -819,118 +961,318 @@ int RTPTCPTransmitter::SendRTPRTCPData(const void *data, size_t len)
 	return 0;
 }
 
-int RTPTCPTransmitter::ValidateSocket(SocketType)
+int RTPTCPTransmitter::FlushSendBuffers()
 {
-	// TODO: should we even do a check (for a TCP socket)? 
+	if (!m_init)
+		return ERR_RTP_TCPTRANS_NOTINIT;
+
+	MAINMUTEX_LOCK
+	
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_TCPTRANS_NOTCREATED;
+	}
+
+	std::map<SocketType, SocketData>::iterator it = m_destSockets.begin();
+	std::map<SocketType, SocketData>::iterator end = m_destSockets.end();
+	vector<SocketType> errSockets;
+	RTPTime curtime = RTPTime::CurrentTime();
+
+	while (it != end)
+	{
+		if (it->second.GetPendingBytes() > 0)
+		{
+			if (FlushSocket(it->first, it->second, 0, 0, 0, curtime) < 0)
+				errSockets.push_back(it->first);
+		}
+		++it;
+	}
+
+	MAINMUTEX_UNLOCK
+
+	for (size_t i = 0 ; i < errSockets.size() ; i++)
+		OnSendError(errSockets[i]);
+
 	return 0;
 }
 
-void RTPTCPTransmitter::ClearDestSockets()
+void RTPTCPTransmitter::FlushExpiredSendBuffers(std::vector<SocketType> &errSockets)
 {
 	std::map<SocketType, SocketData>::iterator it = m_destSockets.begin();
 	std::map<SocketType, SocketData>::iterator end = m_destSockets.end();
+	RTPTime curtime(0, 0);
+	bool gottime = false;
 
 	while (it != end)
 	{
-		uint8_t *pBuf = it->second.ExtractDataBuffer();
-		if (pBuf)
-			RTPDeleteByteArray(pBuf, GetMemoryManager());
+		SocketData &sdata = it->second;
+
+		if (sdata.GetPendingBytes() > 0)
+		{
+			if (!gottime)
+			{
+				curtime = RTPTime::CurrentTime();
+				gottime = true;
+			}
+
+			RTPTime diff = curtime;
+			diff -= sdata.m_sendBufferTime;
 
+			if (diff >= m_coalescingDelay)
+			{
+				if (FlushSocket(it->first, sdata, 0, 0, 0, curtime) < 0)
+					errSockets.push_back(it->first);
+			}
+		}
 		++it;
 	}
-	m_destSockets.clear();
 }
 
-RTPTCPTransmitter::SocketData::SocketData()
+// Adds the packet, consisting of the 'numiov' parts in 'iov' which have a total
+// length 'len', with its length prefix to the data for a socket, and sends the
+// data if enough has been collected. If the packet had to be discarded because
+// too much data is pending, 'overflow' is set to true.
+int RTPTCPTransmitter::SendFrame(SocketType sock, SocketData &sdata, const RTPIOVec *iov, int numiov, size_t len, 
+                                 const RTPTime &curtime, bool &overflow)
 {
-	Reset();
-}
+	size_t framelen = len+2;
+	size_t pending = sdata.GetPendingBytes();
 
-void RTPTCPTransmitter::SocketData::Reset()
-{
-	m_lengthBufferOffset = 0;
-	m_dataLength = 0; 
-	m_dataBufferOffset = 0;
-	m_pDataBuffer = 0;
-}
+	if (pending > 0 && pending+framelen > m_maxSendBacklog)
+	{
+		// The receiver isn't keeping up, first try to send what's still pending
+		int status = FlushSocket(sock, sdata, 0, 0, 0, curtime);
+		if (status < 0)
+			return status;
 
-RTPTCPTransmitter::SocketData::~SocketData()
-{
-	assert(m_pDataBuffer == 0); // Should be deleted externally to avoid storing a memory manager in the class
+		pending = sdata.GetPendingBytes();
+		if (pending > 0 && pending+framelen > m_maxSendBacklog)
+		{
+			overflow = true;
+			return 0;
+		}
+	}
+
+	if (pending+framelen < m_coalescingSize)
+	{
+		bool expired = false;
+
+		if (pending > 0)
+		{
+			RTPTime diff = curtime;
+			diff -= sdata.m_sendBufferTime;
+			if (diff >= m_coalescingDelay)
+				expired = true;
+		}
+
+		if (!expired) // just collect the packet
+		{
+			if (pending == 0)
+			{
+				sdata.m_sendBuffer.clear();
+				sdata.m_sendBufferOffset = 0;
+				sdata.m_sendBufferTime = curtime;
+			}
+			AppendFrame(sdata.m_sendBuffer, iov, numiov, len, 0);
+			return 0;
+		}
+	}
+
+	return FlushSocket(sock, sdata, iov, numiov, len, curtime);
 }
 
-int RTPTCPTransmitter::SocketData::ProcessAvailableBytes(SocketType sock, int availLen, bool &complete, RTPMemoryManager *pMgr)
+// Appends the packet in 'iov' with its length prefix to 'buffer', leaving out
+// the first 'skip' bytes of the resulting frame
+void RTPTCPTransmitter::AppendFrame(std::vector<uint8_t> &buffer, const RTPIOVec *iov, int numiov, size_t len, size_t skip)
 {
-	JRTPLIB_UNUSED(pMgr); // possibly unused
+	uint8_t lengthBytes[2] = { (uint8_t)((len >> 8)&0xff), (uint8_t)(len&0xff) };
+
+	if (skip < 2)
+	{
+		buffer.insert(buffer.end(), lengthBytes+skip, lengthBytes+2);
+		skip = 0;
+	}
+	else
+		skip -= 2;
 
-	const int numLengthBuffer = 2;
-	if (m_lengthBufferOffset < numLengthBuffer) // first we need to get the length
+	for (int i = 0 ; i < numiov ; i++)
 	{
-		assert(m_pDataBuffer == 0);
-		int num = numLengthBuffer-m_lengthBufferOffset;
-		if (num > availLen)
-			num = availLen;
+		const uint8_t *pData = (const uint8_t *)iov[i].data;
 
-		int r = 0;
-		if (num > 0)
+		if (skip >= iov[i].len)
 		{
-			r = (int)recv(sock, (char *)(m_lengthBuffer+m_lengthBufferOffset), num, 0);
-			if (r < 0)
-				return ERR_RTP_TCPTRANS_ERRORINRECV;
+			skip -= iov[i].len;
+			continue;
 		}
+		buffer.insert(buffer.end(), pData+skip, pData+iov[i].len);
+		skip = 0;
+	}
+}
 
-		m_lengthBufferOffset += r;
-		availLen -= r;
+// Sends the data which is pending for the socket, followed by the packet in 'iov'
+// (if not null) and its length prefix, using a single call. Whatever the socket
+// couldn't accept without blocking is kept in the send buffer.
+int RTPTCPTransmitter::FlushSocket(SocketType sock, SocketData &sdata, const RTPIOVec *iov, int numiov, size_t len, const RTPTime &curtime)
+{
+	uint8_t lengthBytes[2] = { (uint8_t)((len >> 8)&0xff), (uint8_t)(len&0xff) };
+	size_t pending = sdata.GetPendingBytes();
+	size_t framelen = (iov)?(len+2):0;
+	size_t total = pending+framelen;
+	const uint8_t *bufs[2+RTP_MAXIOVECS];
+	size_t lengths[2+RTP_MAXIOVECS];
+	int numbufs = 0;
+
+	if (total == 0)
+		return 0;
 
-		assert(m_lengthBufferOffset <= numLengthBuffer);
-		if (m_lengthBufferOffset == numLengthBuffer) // we can constuct a length
+	if (pending > 0)
+	{
+		bufs[numbufs] = &(sdata.m_sendBuffer[sdata.m_sendBufferOffset]);
+		lengths[numbufs] = pending;
+		numbufs++;
+	}
+	if (iov)
+	{
+		bufs[numbufs] = lengthBytes;
+		lengths[numbufs] = 2;
+		numbufs++;
+		for (int i = 0 ; i < numiov ; i++)
 		{
-			int l = 0;
-			for (int i = numLengthBuffer-1, shift = 0 ; i >= 0 ; i--, shift += 8)
-				l |= ((int)m_lengthBuffer[i]) << shift;
+			if (iov[i].len == 0)
+				continue;
+			bufs[numbufs] = (const uint8_t *)iov[i].data;
+			lengths[numbufs] = iov[i].len;
+			numbufs++;
+		}
+	}
 
-			m_dataLength = l;
-			m_dataBufferOffset = 0;
+	size_t sent = 0;
 
-			//cout << "Expecting " << m_dataLength << " bytes" << endl;
+#ifdef RTP_SOCKETTYPE_WINSOCK
+	WSABUF wsabufs[2+RTP_MAXIOVECS];
+	DWORD numsent = 0;
 
-			// avoid allocation of length 0
-			if (l == 0)
-				l = 1;
+	for (int i = 0 ; i < numbufs ; i++)
+	{
+		wsabufs[i].buf = (char *)bufs[i];
+		wsabufs[i].len = (ULONG)lengths[i];
+	}
 
-			// We don't yet know if it's an RTP or RTCP packet, so we'll stick to RTP
-			m_pDataBuffer = RTPNew(pMgr, RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET) uint8_t[l];
-			if (m_pDataBuffer == 0)
-				return ERR_RTP_OUTOFMEM;
-		}
+	if (WSASend(sock, wsabufs, (DWORD)numbufs, &numsent, 0, 0, 0) != 0)
+	{
+		if (WSAGetLastError() != WSAEWOULDBLOCK)
+			return ERR_RTP_TCPTRANS_ERRORINSEND;
+		numsent = 0;
+	}
+	sent = (size_t)numsent;
+#else
+	struct iovec msgiov[2+RTP_MAXIOVECS];
+	struct msghdr msg;
+	int flags = 0;
+
+#ifdef RTP_HAVE_MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif // RTP_HAVE_MSG_NOSIGNAL
+#ifdef RTP_HAVE_MSG_DONTWAIT
+	flags |= MSG_DONTWAIT; // a slow receiver must not block the other connections
+#endif // RTP_HAVE_MSG_DONTWAIT
+
+	for (int i = 0 ; i < numbufs ; i++)
+	{
+		msgiov[i].iov_base = (void *)bufs[i];
+		msgiov[i].iov_len = lengths[i];
 	}
 
-	if (m_lengthBufferOffset == numLengthBuffer && m_pDataBuffer) // the last one is to make sure we didn't run out of memory
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_iov = msgiov;
+	msg.msg_iovlen = numbufs;
+
+	ssize_t status;
+
+	do
 	{
-		if (m_dataBufferOffset < m_dataLength)
-		{
-			int num = m_dataLength-m_dataBufferOffset;
-			if (num > availLen)
-				num = availLen;
+		status = sendmsg(sock, &msg, flags);
+	} while (status < 0 && errno == EINTR);
 
-			int r = 0;
-			if (num > 0)
-			{
-				r = (int)recv(sock, (char *)(m_pDataBuffer+m_dataBufferOffset), num, 0);
-				if (r < 0)
-					return ERR_RTP_TCPTRANS_ERRORINRECV;
-			}
+	if (status < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return ERR_RTP_TCPTRANS_ERRORINSEND;
+		status = 0;
+	}
+	sent = (size_t)status;
+#endif // RTP_SOCKETTYPE_WINSOCK
+
+	// Keep the data that has not been sent yet
+
+	if (sent < pending)
+	{
+		sdata.m_sendBufferOffset += sent;
+		if (iov)
+			AppendFrame(sdata.m_sendBuffer, iov, numiov, len, 0);
 
-			m_dataBufferOffset += r;
-			availLen -= r;
+		// Don't let the part that was already sent take up too much space
+		if (sdata.m_sendBufferOffset > sdata.m_sendBuffer.size()/2)
+		{
+			sdata.m_sendBuffer.erase(sdata.m_sendBuffer.begin(), sdata.m_sendBuffer.begin()+sdata.m_sendBufferOffset);
+			sdata.m_sendBufferOffset = 0;
 		}
+		return 0;
+	}
 
-		if (m_dataBufferOffset == m_dataLength)
-			complete = true;
+	sent -= pending;
+	sdata.m_sendBuffer.clear();
+	sdata.m_sendBufferOffset = 0;
+
+	if (sent < framelen) // part of the packet still needs to be sent
+	{
+		AppendFrame(sdata.m_sendBuffer, iov, numiov, len, sent);
+		sdata.m_sendBufferTime = curtime;
 	}
 	return 0;
 }
 
+int RTPTCPTransmitter::ValidateSocket(SocketType)
+{
+	// TODO: should we even do a check (for a TCP socket)? 
+	return 0;
+}
+
+void RTPTCPTransmitter::ClearDestSockets()
+{
+	std::map<SocketType, SocketData>::iterator it = m_destSockets.begin();
+	std::map<SocketType, SocketData>::iterator end = m_destSockets.end();
+
+	while (it != end)
+	{
+		RTPReceiveSlab *pSlab = it->second.ExtractReceiveSlab();
+		if (pSlab)
+			pSlab->Release();
+
+		++it;
+	}
+	m_destSockets.clear();
+}
+
+RTPTCPTransmitter::SocketData::SocketData() : m_sendBufferTime(0, 0)
+{
+	Reset();
+	m_sendBufferOffset = 0;
+}
+
+void RTPTCPTransmitter::SocketData::Reset()
+{
+	m_pRecvSlab = 0;
+	m_recvStart = 0;
+	m_recvEnd = 0;
+}
+
+RTPTCPTransmitter::SocketData::~SocketData()
+{
+	assert(m_pRecvSlab == 0); // Should be released externally
+}
+
 } // end namespace
 
 
@@ -42,6 +42,7 @@
 #include "rtptransmitter.h"
 #include "rtpsocketutil.h"
 #include "rtpabortdescriptors.h"
+#include "rtptimeutilities.h"
 #include <map>
 #include <list>
 #include <vector>
@@ -53,6 +54,14 @@
 namespace jrtplib
 {
 
+class RTPSlabPool;
+class RTPReceiveSlab;
+
+#define RTPTCPTRANS_DEFAULTCOALESCINGDELAY			0.010
+#define RTPTCPTRANS_DEFAULTMAXSENDBACKLOG			(256*1024)
+#define RTPTCPTRANS_RECEIVEBUFFERSIZE				(128*1024)
+#define RTPTCPTRANS_RECEIVEBUFFERPOOLSIZE			16
+
 /** Parameters for the TCP transmitter. */
 class JRTPLIB_IMPORTEXPORT RTPTCPTransmissionParams : public RTPTransmissionParams
 {
@@ -68,13 +77,69 @@ public:
 	 *  which can be useful when creating your own poll thread for multiple
 	 *  sessions. */
 	RTPAbortDescriptors *GetCreatedAbortDescriptors() const		{ return m_pAbortDesc; }
+
+	/** Sets the number of bytes that may be collected for a connection before they are sent.
+	 *  Sets the number of bytes that may be collected for a connection before they are sent. Using
+	 *  a value larger than zero allows several framed packets to be sent with a single call,
+	 *  resulting in fewer system calls and larger TCP segments. The default is zero, which 
+	 *  causes each packet to be sent right away.
+	 */
+	void SetSendCoalescingSize(size_t s)						{ m_coalescingSize = s; }
+
+	/** Returns the number of bytes that may be collected for a connection before they are sent (default is zero). */
+	size_t GetSendCoalescingSize() const						{ return m_coalescingSize; }
+
+	/** Sets the maximum time that collected data is kept before it is sent.
+	 *  Sets the maximum time that collected data is kept before it is sent, only relevant if
+	 *  the coalescing size is larger than zero. The data is sent when the next packet is sent
+	 *  or in the first call to RTPTransmitter::Poll after this delay. Defaults to 10 ms.
+	 */
+	void SetSendCoalescingDelay(const RTPTime &t)				{ m_coalescingDelay = t; }
+
+	/** Returns the maximum time that collected data is kept before it is sent (default is 10 ms). */
+	RTPTime GetSendCoalescingDelay() const						{ return m_coalescingDelay; }
+
+	/** Sets the maximum number of bytes that may be pending for a connection.
+	 *  Sets the maximum number of bytes that may be pending for a connection. If the receiver
+	 *  can't keep up, the data which couldn't be sent yet is kept and sent later on, instead of
+	 *  waiting until the socket can accept it. When this amount of data is pending, new packets
+	 *  for the connection are discarded and RTPTCPTransmitter::OnSendBufferOverflow is called.
+	 *  Defaults to 256 kB.
+	 */
+	void SetMaximumSendBacklog(size_t s)						{ m_maxSendBacklog = s; }
+
+	/** Returns the maximum number of bytes that may be pending for a connection (default is 256 kB). */
+	size_t GetMaximumSendBacklog() const						{ return m_maxSendBacklog; }
+
+	/** Sets the size of the buffers into which the incoming data of a connection is read.
+	 *  Sets the size of the buffers into which the incoming data of a connection is read, and the
+	 *  number of unused buffers that is kept for reuse. The incoming data is read in large chunks,
+	 *  and the received packets refer to the data in these buffers instead of copying it. A buffer
+	 *  can only be reused when none of the packets that were read into it is still in use. The
+	 *  size is at least large enough to hold a packet of the maximum size, and defaults to 128 kB.
+	 */
+	void SetReceiveBufferSize(size_t s, size_t maxfreebuffers = RTPTCPTRANS_RECEIVEBUFFERPOOLSIZE) { m_recvBufferSize = s; m_recvBufferPoolSize = maxfreebuffers; }
+
+	/** Returns the size of the buffers into which the incoming data is read. */
+	size_t GetReceiveBufferSize() const							{ return m_recvBufferSize; }
+
+	/** Returns the number of unused receive buffers that is kept for reuse. */
+	size_t GetReceiveBufferPoolSize() const						{ return m_recvBufferPoolSize; }
 private:
 	RTPAbortDescriptors *m_pAbortDesc;
+	size_t m_coalescingSize;
+	RTPTime m_coalescingDelay;
+	size_t m_maxSendBacklog;
+	size_t m_recvBufferSize, m_recvBufferPoolSize;
 };
 
-inline RTPTCPTransmissionParams::RTPTCPTransmissionParams() : RTPTransmissionParams(RTPTransmitter::TCPProto)	
+inline RTPTCPTransmissionParams::RTPTCPTransmissionParams() : RTPTransmissionParams(RTPTransmitter::TCPProto), m_coalescingDelay(RTPTCPTRANS_DEFAULTCOALESCINGDELAY)
 { 
 	m_pAbortDesc = 0;
+	m_coalescingSize = 0;
+	m_maxSendBacklog = RTPTCPTRANS_DEFAULTMAXSENDBACKLOG;
+	m_recvBufferSize = RTPTCPTRANS_RECEIVEBUFFERSIZE;
+	m_recvBufferPoolSize = RTPTCPTRANS_RECEIVEBUFFERPOOLSIZE;
 }
 
 /** Additional information about the TCP transmitter. */
@@ -108,6 +173,14 @@ public:
  *
  *  To get notified of an error when sending over or receiving from a socket, override the
  *  RTPTCPTransmitter::OnSendError and RTPTCPTransmitter::OnReceiveError member functions.
+ *
+ *  The incoming data of a connection is read in large chunks, from which all complete framed
+ *  packets are taken at once; the resulting RTPRawPacket instances refer to the data in the
+ *  receive buffer instead of copying it (see RTPTCPTransmissionParams::SetReceiveBufferSize).
+ *  Each framed packet is sent together with its length prefix in a single vectored send call.
+ *  Optionally, several packets can be collected for a connection and sent together (see
+ *  RTPTCPTransmissionParams::SetSendCoalescingSize). If a receiver can't keep up, the data that
+ *  could not be sent is kept and sent later, so that the other connections are not held up.
  */
 class JRTPLIB_IMPORTEXPORT RTPTCPTransmitter : public RTPTransmitter
 {
@@ -132,6 +205,7 @@ public:
 	
 	int SendRTPData(const void *data,size_t len);	
 	int SendRTCPData(const void *data,size_t len);
+	int SendRTPDataIov(const RTPIOVec *iov,int numiov);
 
 	int AddDestination(const RTPAddress &addr);
 	int DeleteDestination(const RTPAddress &addr);
@@ -153,6 +227,9 @@ public:
 	
 	bool NewDataAvailable();
 	RTPRawPacket *GetNextPacket();
+
+	/** Sends the data which has been collected for the connections right away. */
+	int FlushSendBuffers();
 #ifdef RTPDEBUG
 	void Dump();
 #endif // RTPDEBUG
@@ -161,6 +238,8 @@ protected:
 	virtual void OnSendError(SocketType sock);
 	/** By overriding this function you can be notified of an error when receiving from a socket. */
 	virtual void OnReceiveError(SocketType sock);
+	/** Is called when a packet was discarded because too much data is still pending for socket \c sock. */
+	virtual void OnSendBufferOverflow(SocketType sock);
 private:
 	class SocketData
 	{
@@ -169,19 +248,32 @@ private:
 		~SocketData();
 		void Reset();
 
-		uint8_t m_lengthBuffer[2];
-		int m_lengthBufferOffset;
-		int m_dataLength;
-		int m_dataBufferOffset;
-		uint8_t *m_pDataBuffer;
+		// Incoming data is read into m_pRecvSlab, the bytes from m_recvStart up to
+		// m_recvEnd have not been handed out as packets yet
+		RTPReceiveSlab *m_pRecvSlab;
+		size_t m_recvStart;
+		size_t m_recvEnd;
+
+		RTPReceiveSlab *ExtractReceiveSlab() { RTPReceiveSlab *pTmp = m_pRecvSlab; Reset(); return pTmp; }
+
+		// Outgoing data that still needs to be sent: the bytes of m_sendBuffer starting
+		// at m_sendBufferOffset, of which the oldest were added at m_sendBufferTime
+		std::vector<uint8_t> m_sendBuffer;
+		size_t m_sendBufferOffset;
+		RTPTime m_sendBufferTime;
 
-		uint8_t *ExtractDataBuffer() { uint8_t *pTmp = m_pDataBuffer; m_pDataBuffer = 0; return pTmp; }
-		int ProcessAvailableBytes(SocketType sock, int availLen, bool &complete, RTPMemoryManager *pMgr);
+		size_t GetPendingBytes() const { return m_sendBuffer.size()-m_sendBufferOffset; }
 	};
 
-	int SendRTPRTCPData(const void *data,size_t len);	
+	int SendRTPRTCPData(const RTPIOVec *iov,int numiov);
+	int SendFrame(SocketType sock, SocketData &sdata, const RTPIOVec *iov, int numiov, size_t len, const RTPTime &curtime, bool &overflow);
+	int FlushSocket(SocketType sock, SocketData &sdata, const RTPIOVec *iov, int numiov, size_t len, const RTPTime &curtime);
+	static void AppendFrame(std::vector<uint8_t> &buffer, const RTPIOVec *iov, int numiov, size_t len, size_t skip);
+	void FlushExpiredSendBuffers(std::vector<SocketType> &errSockets);
 	void FlushPackets();
 	int PollSocket(SocketType sock, SocketData &sdata);
+	int PrepareReceiveSlab(SocketType sock, SocketData &sdata);
+	int ExtractFrames(SocketData &sdata, const RTPTime &curtime);
 	void ClearDestSockets();
 	int ValidateSocket(SocketType s);
 
@@ -194,6 +286,10 @@ private:
 	std::vector<int8_t> m_tmpFlags;
 	std::vector<uint8_t> m_localHostname;
 	size_t m_maxPackSize;
+	size_t m_coalescingSize;
+	RTPTime m_coalescingDelay;
+	size_t m_maxSendBacklog;
+	RTPSlabPool *m_pSlabPool;
 	
 	std::list<RTPRawPacket*> m_rawpacketlist;
 
@@ -208,6 +304,7 @@ private:
 
 inline void RTPTCPTransmitter::OnSendError(SocketType) { }
 inline void RTPTCPTransmitter::OnReceiveError(SocketType) { }
+inline void RTPTCPTransmitter::OnSendBufferOverflow(SocketType) { }
 
 } // end namespace
 
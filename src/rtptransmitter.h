@@ -42,6 +42,8 @@
 #include "rtptypes.h"
 #include "rtpmemoryobject.h"
 #include "rtptimeutilities.h"
+#include "rtperrors.h"
+#include <string.h>
 
 namespace jrtplib
 {
@@ -52,6 +54,16 @@ class RTPTransmissionParams;
 class RTPTime;
 class RTPTransmissionInfo;
 
+/** Describes one of the consecutive parts of a packet that's passed to RTPTransmitter::SendRTPDataIov. */
+struct JRTPLIB_IMPORTEXPORT RTPIOVec
+{
+	/** The data of this part. */
+	const void *data;
+
+	/** The length of this part. */
+	size_t len;
+};
+
 /** Abstract class from which actual transmission components should be derived.
  *  Abstract class from which actual transmission components should be derived.
  *  The abstract class RTPTransmitter specifies the interface for
@@ -160,6 +172,22 @@ public:
 	/** Send a packet with length \c len containing \c data to all RTCP addresses of the current destination list. */
 	virtual int SendRTCPData(const void *data,size_t len) = 0;
 
+	/** Send a packet consisting of the \c numiov parts in \c iov to all RTP addresses of the current destination list.
+	 *  Send a packet consisting of the \c numiov parts in \c iov to all RTP addresses of the current
+	 *  destination list, which saves copying the parts into a single buffer (e.g. the header and
+	 *  the payload of an RTP packet) if the transmitter can send them in a single call. The default
+	 *  implementation does combine the parts and calls RTPTransmitter::SendRTPData.
+	 */
+	virtual int SendRTPDataIov(const RTPIOVec *iov,int numiov);
+
+	/** Sends a batch of \c numpackets RTP packets to all RTP addresses of the current destination list.
+	 *  Sends a batch of \c numpackets RTP packets to all RTP addresses of the current destination list. 
+	 *  The i-th packet consists of the next \c numiov[i] parts in \c iov. A transmitter can override
+	 *  this to send the entire batch with a single call; the default implementation calls 
+	 *  RTPTransmitter::SendRTPDataIov for each packet.
+	 */
+	virtual int SendRTPDataBatch(const RTPIOVec *iov,const int numiov[],int numpackets);
+
 	/** Adds the address specified by \c addr to the list of destinations. */
 	virtual int AddDestination(const RTPAddress &addr) = 0;
 
@@ -220,6 +248,42 @@ public:
 #endif // RTPDEBUG
 };
 
+inline int RTPTransmitter::SendRTPDataIov(const RTPIOVec *iov,int numiov)
+{
+	size_t len = 0;
+
+	for (int i = 0 ; i < numiov ; i++)
+		len += iov[i].len;
+
+	uint8_t *buf = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RTPPACKET) uint8_t[len+1];
+	if (buf == 0)
+		return ERR_RTP_OUTOFMEM;
+
+	size_t offset = 0;
+	for (int i = 0 ; i < numiov ; i++)
+	{
+		if (iov[i].len > 0)
+			memcpy(buf+offset,iov[i].data,iov[i].len);
+		offset += iov[i].len;
+	}
+
+	int status = SendRTPData(buf,len);
+	RTPDeleteByteArray(buf,GetMemoryManager());
+	return status;
+}
+
+inline int RTPTransmitter::SendRTPDataBatch(const RTPIOVec *iov,const int numiov[],int numpackets)
+{
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		int status = SendRTPDataIov(iov,numiov[i]);
+		if (status < 0)
+			return status;
+		iov += numiov[i];
+	}
+	return 0;
+}
+
 /** Base class for transmission parameters.
  *  This class is an abstract class which will have a specific implementation for a 
  *  specific kind of transmission component. All actual implementations inherit the
@@ -0,0 +1,324 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtpudpbatch.h"
+
+#if defined(RTP_HAVE_RECVMMSG) || defined(RTP_HAVE_SENDMMSG)
+
+#include "rtperrors.h"
+#include <errno.h>
+
+#include "rtpdebug.h"
+
+// Linux doesn't accept more than this number of messages in a single call
+#define RTPUDPBATCH_MAXMESSAGES									1024
+
+namespace jrtplib
+{
+
+#ifdef RTP_HAVE_RECVMMSG
+
+RTPUDPReceiveBatch::RTPUDPReceiveBatch(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_numPackets = 0;
+	m_packetSize = 0;
+	m_pBuffer = 0;
+	m_pHeaders = 0;
+	m_pIOVecs = 0;
+	m_pAddresses = 0;
+}
+
+RTPUDPReceiveBatch::~RTPUDPReceiveBatch()
+{
+	Destroy();
+}
+
+int RTPUDPReceiveBatch::Create(size_t numpackets, size_t packetsize, bool externalbuffers)
+{
+	Destroy();
+
+	if (numpackets == 0 || packetsize == 0)
+		return 0;
+
+	// Everything is stored in a single memory block: first the source addresses
+	// (which have the strictest alignment requirements), then the message headers,
+	// the I/O vectors and finally the packet buffers themselves (unless these
+	// are supplied by the caller).
+	size_t addrsize = numpackets*sizeof(struct sockaddr_storage);
+	size_t hdrsize = numpackets*sizeof(struct mmsghdr);
+	size_t iovsize = numpackets*sizeof(struct iovec);
+	size_t totalsize = addrsize + hdrsize + iovsize + ((externalbuffers)?0:numpackets*packetsize);
+
+	uint8_t *pBlock = RTPNew(GetMemoryManager(),RTPMEM_TYPE_BUFFER_RECEIVEBATCH) uint8_t[totalsize];
+	if (pBlock == 0)
+		return ERR_RTP_OUTOFMEM;
+
+	m_pAddresses = (struct sockaddr_storage *)pBlock;
+	m_pHeaders = (struct mmsghdr *)(pBlock + addrsize);
+	m_pIOVecs = (struct iovec *)(pBlock + addrsize + hdrsize);
+	m_pBuffer = (externalbuffers)?0:(pBlock + addrsize + hdrsize + iovsize);
+	m_numPackets = numpackets;
+	m_packetSize = packetsize;
+
+	memset(m_pHeaders, 0, hdrsize);
+	for (size_t i = 0 ; i < m_numPackets ; i++)
+	{
+		m_pIOVecs[i].iov_base = (m_pBuffer)?(m_pBuffer + i*m_packetSize):0;
+		m_pIOVecs[i].iov_len = (m_pBuffer)?m_packetSize:0;
+		m_pHeaders[i].msg_hdr.msg_iov = m_pIOVecs + i;
+		m_pHeaders[i].msg_hdr.msg_iovlen = 1;
+		m_pHeaders[i].msg_hdr.msg_name = m_pAddresses + i;
+	}
+	return 0;
+}
+
+void RTPUDPReceiveBatch::Destroy()
+{
+	if (m_pAddresses)
+		RTPDeleteByteArray((uint8_t *)m_pAddresses, GetMemoryManager());
+
+	m_numPackets = 0;
+	m_packetSize = 0;
+	m_pBuffer = 0;
+	m_pHeaders = 0;
+	m_pIOVecs = 0;
+	m_pAddresses = 0;
+}
+
+void RTPUDPReceiveBatch::SetPacketBuffer(size_t idx, uint8_t *buffer, size_t size)
+{
+	m_pIOVecs[idx].iov_base = buffer;
+	m_pIOVecs[idx].iov_len = size;
+}
+
+int RTPUDPReceiveBatch::Receive(SocketType sock)
+{
+	if (m_numPackets == 0)
+		return 0;
+
+	for (size_t i = 0 ; i < m_numPackets ; i++)
+	{
+		m_pHeaders[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+		m_pHeaders[i].msg_hdr.msg_flags = 0;
+		m_pHeaders[i].msg_len = 0;
+	}
+
+	int status;
+
+	do
+	{
+		status = recvmmsg(sock, m_pHeaders, (unsigned int)m_numPackets, MSG_DONTWAIT, 0);
+	} while (status < 0 && errno == EINTR);
+
+	// Like the 'recvfrom' based code in the transmitters, errors are not
+	// reported: either there's no more data (EAGAIN), or it's something like
+	// a pending ICMP error which has now been cleared.
+	if (status < 0)
+		return 0;
+	return status;
+}
+
+#endif // RTP_HAVE_RECVMMSG
+
+#ifdef RTP_HAVE_SENDMMSG
+
+RTPUDPSendBatch::RTPUDPSendBatch(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_numIOV = 0;
+	m_headersValid = true;
+}
+
+RTPUDPSendBatch::~RTPUDPSendBatch()
+{
+}
+
+void RTPUDPSendBatch::Clear()
+{
+	m_addresses.clear();
+	m_headers.clear();
+	m_failures.clear();
+	m_headersValid = true;
+}
+
+void RTPUDPSendBatch::AddDestination(const struct sockaddr *addr, size_t addrlen)
+{
+	struct sockaddr_storage storage;
+	struct mmsghdr hdr;
+
+	memset(&storage, 0, sizeof(struct sockaddr_storage));
+	memcpy(&storage, addr, addrlen);
+	memset(&hdr, 0, sizeof(struct mmsghdr));
+	hdr.msg_hdr.msg_namelen = addrlen;
+
+	m_addresses.push_back(storage);
+	m_headers.push_back(hdr);
+	m_headersValid = false; // the address vector may have been reallocated
+}
+
+void RTPUDPSendBatch::DeleteDestination(size_t idx)
+{
+	size_t last = m_addresses.size() - 1;
+
+	// The header at 'idx' keeps pointing to the same address entry, so the
+	// headers remain valid
+	if (idx != last)
+	{
+		m_addresses[idx] = m_addresses[last];
+		m_headers[idx].msg_hdr.msg_namelen = m_headers[last].msg_hdr.msg_namelen;
+	}
+	m_addresses.pop_back();
+	m_headers.pop_back();
+}
+
+size_t RTPUDPSendBatch::Send(SocketType sock, const RTPIOVec *iov, int numiov)
+{
+	size_t num = m_headers.size();
+
+	if (!m_headersValid || numiov != m_numIOV)
+	{
+		for (size_t i = 0 ; i < num ; i++)
+		{
+			m_headers[i].msg_hdr.msg_name = &(m_addresses[i]);
+			m_headers[i].msg_hdr.msg_iov = m_iov;
+			m_headers[i].msg_hdr.msg_iovlen = numiov;
+		}
+		m_headersValid = true;
+		m_numIOV = numiov;
+	}
+
+	for (int i = 0 ; i < numiov ; i++)
+	{
+		m_iov[i].iov_base = (void *)iov[i].data;
+		m_iov[i].iov_len = iov[i].len;
+	}
+	m_failures.clear();
+	SendMessages(sock, m_headers, num);
+	return m_failures.size();
+}
+
+size_t RTPUDPSendBatch::SendPackets(SocketType sock, const RTPIOVec *iov, const int numiov[], int numpackets)
+{
+	size_t numdests = m_addresses.size();
+	size_t num = numdests*(size_t)numpackets;
+	size_t totaliov = 0;
+
+	m_failures.clear();
+	if (num == 0)
+		return 0;
+
+	for (int i = 0 ; i < numpackets ; i++)
+		totaliov += (size_t)numiov[i];
+
+	if (m_packetHeaders.size() < num)
+		m_packetHeaders.resize(num);
+	if (m_packetIOV.size() < totaliov)
+		m_packetIOV.resize(totaliov);
+
+	for (size_t i = 0 ; i < totaliov ; i++)
+	{
+		m_packetIOV[i].iov_base = (void *)iov[i].data;
+		m_packetIOV[i].iov_len = iov[i].len;
+	}
+
+	// Each destination receives the packets in order
+	size_t idx = 0;
+	size_t iovoffset = 0;
+
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		for (size_t j = 0 ; j < numdests ; j++, idx++)
+		{
+			struct msghdr &hdr = m_packetHeaders[idx].msg_hdr;
+
+			memset(&(m_packetHeaders[idx]), 0, sizeof(struct mmsghdr));
+			hdr.msg_name = &(m_addresses[j]);
+			hdr.msg_namelen = m_headers[j].msg_hdr.msg_namelen;
+			hdr.msg_iov = &(m_packetIOV[iovoffset]);
+			hdr.msg_iovlen = numiov[i];
+		}
+		iovoffset += (size_t)numiov[i];
+	}
+
+	if (SendMessages(sock, m_packetHeaders, num) == 0)
+		return 0;
+
+	// Convert the failed message indices into destination indices
+	m_destFailed.assign(numdests, 0);
+	for (size_t i = 0 ; i < m_failures.size() ; i++)
+		m_destFailed[m_failures[i]%numdests] = 1;
+
+	m_failures.clear();
+	for (size_t j = 0 ; j < numdests ; j++)
+	{
+		if (m_destFailed[j])
+			m_failures.push_back(j);
+	}
+	return m_failures.size();
+}
+
+// Sends the first 'num' messages in 'headers', the indices of the messages that
+// could not be sent are added to m_failures
+size_t RTPUDPSendBatch::SendMessages(SocketType sock, std::vector<struct mmsghdr> &headers, size_t num)
+{
+	size_t numfailed = 0;
+	size_t offset = 0;
+
+	while (offset < num)
+	{
+		size_t count = num - offset;
+		if (count > RTPUDPBATCH_MAXMESSAGES)
+			count = RTPUDPBATCH_MAXMESSAGES;
+
+		int status = sendmmsg(sock, &(headers[offset]), (unsigned int)count, 0);
+		if (status < 0 && errno == EINTR)
+			continue;
+
+		if (status <= 0)
+		{
+			// The message at 'offset' could not be sent, skip it and
+			// continue with the rest of the messages
+			m_failures.push_back(offset);
+			numfailed++;
+			offset++;
+		}
+		else
+			offset += (size_t)status;
+	}
+	return numfailed;
+}
+
+#endif // RTP_HAVE_SENDMMSG
+
+} // end namespace
+
+#endif // RTP_HAVE_RECVMMSG || RTP_HAVE_SENDMMSG
+
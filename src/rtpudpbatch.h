@@ -0,0 +1,181 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpudpbatch.h
+ */
+
+#ifndef RTPUDPBATCH_H
+
+#define RTPUDPBATCH_H
+
+#include "rtpconfig.h"
+#include "rtptypes.h"
+#include "rtpmemoryobject.h"
+#include "rtpsocketutil.h"
+#include "rtpdefines.h"
+#include "rtptransmitter.h"
+
+#if defined(RTP_HAVE_RECVMMSG) || defined(RTP_HAVE_SENDMMSG)
+
+#include "rtpsocketutilinternal.h"
+#include <vector>
+
+namespace jrtplib
+{
+
+#ifdef RTP_HAVE_RECVMMSG
+
+/** Helper class for the UDP transmitters, used to read a number of datagrams
+ *  in a single 'recvmmsg' call.
+ *  Helper class for the UDP transmitters, used to read a number of datagrams
+ *  in a single 'recvmmsg' call. All buffers, I/O vectors and source address
+ *  storage are allocated once in RTPUDPReceiveBatch::Create, so that the receive
+ *  path itself does not need to allocate anything. The same class is used for
+ *  both IPv4 and IPv6 sockets: the source addresses are stored in a
+ *  'sockaddr_storage' structure.
+ */
+class RTPUDPReceiveBatch : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPUDPReceiveBatch)
+public:
+	RTPUDPReceiveBatch(RTPMemoryManager *mgr);
+	~RTPUDPReceiveBatch();
+
+	/** Allocates room for \c numpackets datagrams of at most \c packetsize bytes each; if
+	 *  \c externalbuffers is \c true, no packet buffers are allocated and each of them must be
+	 *  set using RTPUDPReceiveBatch::SetPacketBuffer before calling RTPUDPReceiveBatch::Receive. */
+	int Create(size_t numpackets, size_t packetsize, bool externalbuffers = false);
+
+	/** Releases the allocated buffers. */
+	void Destroy();
+
+	/** Returns the number of datagrams that can be read in a single call. */
+	size_t GetBatchSize() const												{ return m_numPackets; }
+
+	/** Reads as many datagrams as are available on \c sock (up to the batch size)
+	 *  without blocking, and returns the number of datagrams that were read. */
+	int Receive(SocketType sock);
+
+	/** Makes entry \c idx of the receive ring use \c buffer, which can hold \c size bytes. */
+	void SetPacketBuffer(size_t idx, uint8_t *buffer, size_t size);
+
+	/** Returns a pointer to the data of datagram \c idx of the last receive call. */
+	uint8_t *GetPacketData(size_t idx) const								{ return (uint8_t *)m_pIOVecs[idx].iov_base; }
+
+	/** Returns the length of datagram \c idx of the last receive call. */
+	size_t GetPacketLength(size_t idx) const								{ return (size_t)m_pHeaders[idx].msg_len; }
+
+	/** Returns \c true if datagram \c idx did not fit in its buffer and was truncated. */
+	bool IsTruncated(size_t idx) const										{ return (m_pHeaders[idx].msg_hdr.msg_flags & MSG_TRUNC) != 0; }
+
+	/** Returns the address from which datagram \c idx was received. */
+	const struct sockaddr *GetSourceAddress(size_t idx) const				{ return (const struct sockaddr *)(m_pAddresses + idx); }
+private:
+	size_t m_numPackets, m_packetSize;
+	uint8_t *m_pBuffer;
+	struct mmsghdr *m_pHeaders;
+	struct iovec *m_pIOVecs;
+	struct sockaddr_storage *m_pAddresses;
+};
+
+#endif // RTP_HAVE_RECVMMSG
+
+#ifdef RTP_HAVE_SENDMMSG
+
+/** Helper class for the UDP transmitters, used to send the same packet to a
+ *  number of destinations using a single 'sendmmsg' call.
+ *  Helper class for the UDP transmitters, used to send the same packet to a
+ *  number of destinations using a single 'sendmmsg' call. The message headers
+ *  are built once from the destination addresses and are reused for every packet
+ *  until RTPUDPSendBatch::Clear is called; only the I/O vectors that all headers
+ *  share are updated for each packet.
+ */
+class RTPUDPSendBatch : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPUDPSendBatch)
+public:
+	RTPUDPSendBatch(RTPMemoryManager *mgr);
+	~RTPUDPSendBatch();
+
+	/** Removes all destinations. */
+	void Clear();
+
+	/** Adds the socket address \c addr with length \c addrlen to the list of destinations. */
+	void AddDestination(const struct sockaddr *addr, size_t addrlen);
+
+	/** Removes the destination at index \c idx, the last destination is moved into its place
+	 *  (like in RTPFlatKeyHashTable, so both can be kept in the same order). */
+	void DeleteDestination(size_t idx);
+
+	/** Returns the number of destinations. */
+	size_t GetNumberOfDestinations() const									{ return m_addresses.size(); }
+
+	/** Sends the packet consisting of the \c numiov (at most RTP_MAXIOVECS) parts in \c iov to all
+	 *  destinations using socket \c sock, and returns the number of destinations the data could 
+	 *  not be sent to. */
+	size_t Send(SocketType sock, const RTPIOVec *iov, int numiov);
+
+	/** Sends \c numpackets packets to all destinations using socket \c sock with as few 'sendmmsg' calls as
+	 *  possible, the i-th packet consisting of the next \c numiov[i] (at most RTP_MAXIOVECS) parts in \c iov.
+	 *  Returns the number of destinations to which one or more packets could not be sent. */
+	size_t SendPackets(SocketType sock, const RTPIOVec *iov, const int numiov[], int numpackets);
+
+	/** Returns the number of failed destinations in the last RTPUDPSendBatch::Send call. */
+	size_t GetNumberOfFailures() const										{ return m_failures.size(); }
+
+	/** Returns the index (in the order in which they were added) of the \c idx-th 
+	 *  failed destination in the last RTPUDPSendBatch::Send call; these indices are 
+	 *  in increasing order. */
+	size_t GetFailedDestination(size_t idx) const							{ return m_failures[idx]; }
+private:
+	size_t SendMessages(SocketType sock, std::vector<struct mmsghdr> &headers, size_t num);
+
+	std::vector<struct sockaddr_storage> m_addresses;
+	std::vector<struct mmsghdr> m_headers;
+	std::vector<size_t> m_failures;
+	std::vector<struct mmsghdr> m_packetHeaders; // one for each packet and destination in SendPackets
+	std::vector<struct iovec> m_packetIOV;
+	std::vector<uint8_t> m_destFailed;
+	struct iovec m_iov[RTP_MAXIOVECS];
+	int m_numIOV;
+	bool m_headersValid;
+};
+
+#endif // RTP_HAVE_SENDMMSG
+
+} // end namespace
+
+#endif // RTP_HAVE_RECVMMSG || RTP_HAVE_SENDMMSG
+
+#endif // RTPUDPBATCH_H
+
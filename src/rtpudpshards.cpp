@@ -0,0 +1,373 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+#include "rtpudpshards.h"
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+
+#include "rtperrors.h"
+#include "rtpslabpool.h"
+#include "rtpselect.h"
+#include "rtpsocketutilinternal.h"
+#include "rtppollthread.h"
+#include <jthread/jthread.h>
+#include <linux/filter.h>
+#include <errno.h>
+
+#include "rtpdebug.h"
+
+// The number of unused slabs that are kept for reuse, for each shard thread
+#define RTPUDPSHARDS_SLABPOOLSIZE								256
+// The maximum number of datagrams a shard thread reads before queueing them
+#define RTPUDPSHARDS_READBATCHSIZE								64
+
+using namespace jthread;
+
+namespace jrtplib
+{
+
+// An additional socket in the SO_REUSEPORT group, together with the thread
+// that reads its datagrams.
+
+class RTPUDPReceiveShard : public JThread
+{
+	JRTPLIB_NO_COPY(RTPUDPReceiveShard)
+public:
+	RTPUDPReceiveShard(RTPUDPReceiveShards &owner, SocketType sock, RTPSlabPool *pool) : m_owner(owner)
+	{
+		m_sock = sock;
+		m_pSlabPool = pool;
+	}
+
+	~RTPUDPReceiveShard()
+	{
+		StopWorker();
+		RTPCLOSE(m_sock);
+	}
+
+	int StartWorker()
+	{
+		int status;
+
+		if ((status = m_stopSignal.Init()) < 0)
+			return status;
+		if (JThread::Start() < 0)
+			return ERR_RTP_UDPSHARDS_CANTSTARTTHREAD;
+		return 0;
+	}
+
+	void StopWorker()
+	{
+		if (!m_stopSignal.IsInitialized())
+			return;
+
+		m_stopSignal.SendAbortSignal();
+
+		RTPWaitForThreadStop(*this,"RTPUDPReceiveShards","receive thread");
+		m_stopSignal.Destroy();
+		m_owner.ReleaseDatagrams(m_datagrams);
+	}
+
+	void *Thread()
+	{
+		JThread::ThreadStarted();
+
+		SocketType socks[2] = { m_sock, m_stopSignal.GetAbortSocket() };
+
+		while (true)
+		{
+			int8_t readflags[2] = { 0, 0 };
+
+			if (RTPSelect(socks, readflags, 2, RTPTime(-1)) < 0)
+				break;
+			if (readflags[1]) // StopWorker was called
+				break;
+			if (!readflags[0])
+				continue;
+
+			ReadDatagrams();
+			if (!m_datagrams.empty())
+				m_owner.QueueDatagrams(m_datagrams);
+		}
+		return 0;
+	}
+private:
+	void ReadDatagrams()
+	{
+		RTPTime curtime = RTPTime::CurrentTime();
+
+		while (m_datagrams.size() < RTPUDPSHARDS_READBATCHSIZE)
+		{
+			RTPReceiveSlab *slab = m_pSlabPool->AcquireSlab();
+			if (slab == 0)
+				break;
+
+			RTPUDPReceiveShards::Datagram dgram;
+			RTPSOCKLENTYPE fromlen = sizeof(struct sockaddr_storage);
+			int recvlen;
+
+			do
+			{
+				recvlen = recvfrom(m_sock,slab->GetData(),slab->GetSize(),MSG_DONTWAIT|MSG_TRUNC,(struct sockaddr *)&dgram.m_srcAddr,&fromlen);
+			} while (recvlen < 0 && errno == EINTR);
+
+			if (recvlen < 0) // the socket has been drained
+			{
+				slab->Release();
+				break;
+			}
+
+			// make sure a packet of length zero is not queued, and ignore
+			// datagrams that didn't fit in a slab
+			if (recvlen == 0 || (size_t)recvlen > slab->GetSize())
+			{
+				slab->Release();
+				continue;
+			}
+
+			dgram.m_pSlab = slab;
+			dgram.m_length = (size_t)recvlen;
+			dgram.m_recvTime = curtime;
+			m_datagrams.push_back(dgram);
+		}
+	}
+
+	RTPUDPReceiveShards &m_owner;
+	SocketType m_sock;
+	RTPSlabPool *m_pSlabPool;
+	RTPAbortDescriptors m_stopSignal;
+	std::vector<RTPUDPReceiveShards::Datagram> m_datagrams;
+};
+
+RTPUDPReceiveShards::RTPUDPReceiveShards(RTPMemoryManager *mgr) : RTPMemoryObject(mgr)
+{
+	m_pSlabPool = 0;
+	m_signalled = false;
+	m_created = false;
+}
+
+RTPUDPReceiveShards::~RTPUDPReceiveShards()
+{
+	Destroy();
+}
+
+bool RTPUDPReceiveShards::PrepareSocket(SocketType sock)
+{
+	int on = 1;
+
+	if (setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0)
+		return false;
+	return true;
+}
+
+int RTPUDPReceiveShards::Create(SocketType rtpsock, size_t numshards, bool steerbyssrc, int recvbufsize, size_t slabsize)
+{
+	if (m_created)
+		return ERR_RTP_UDPSHARDS_ALREADYCREATED;
+
+	if (numshards < 2)
+		return 0;
+
+	struct sockaddr_storage bindaddr;
+	RTPSOCKLENTYPE addrlen = sizeof(struct sockaddr_storage);
+	int status;
+
+	if (getsockname(rtpsock,(struct sockaddr *)&bindaddr,&addrlen) != 0)
+		return ERR_RTP_UDPSHARDS_CANTGETSOCKETADDRESS;
+
+	if (!m_queueMutex.IsInitialized())
+	{
+		if (m_queueMutex.Init() < 0)
+			return ERR_RTP_UDPSHARDS_CANTINITMUTEX;
+	}
+	if ((status = m_signal.Init()) < 0)
+		return status;
+	m_signalled = false;
+
+	// The slabs are released by the thread that deletes the packets
+	m_pSlabPool = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPSLABPOOL) RTPSlabPool(GetMemoryManager());
+	if (m_pSlabPool == 0)
+	{
+		m_signal.Destroy();
+		return ERR_RTP_OUTOFMEM;
+	}
+	if ((status = m_pSlabPool->Create(slabsize,RTPUDPSHARDS_SLABPOOLSIZE*(numshards-1),true)) < 0)
+	{
+		m_pSlabPool->Release();
+		m_pSlabPool = 0;
+		m_signal.Destroy();
+		return status;
+	}
+	m_created = true;
+
+	// The sockets are added to the SO_REUSEPORT group in the order in which they're
+	// bound, so the index in the group is the shard number
+	for (size_t i = 1 ; i < numshards ; i++)
+	{
+		SocketType sock = socket(bindaddr.ss_family,SOCK_DGRAM,0);
+		if (sock == RTPSOCKERR)
+		{
+			Destroy();
+			return ERR_RTP_UDPSHARDS_CANTCREATESOCKET;
+		}
+		if (!PrepareSocket(sock) || setsockopt(sock,SOL_SOCKET,SO_RCVBUF,(const char *)&recvbufsize,sizeof(int)) != 0)
+		{
+			RTPCLOSE(sock);
+			Destroy();
+			return ERR_RTP_UDPSHARDS_CANTSETSOCKETOPTION;
+		}
+		if (bind(sock,(struct sockaddr *)&bindaddr,addrlen) != 0)
+		{
+			RTPCLOSE(sock);
+			Destroy();
+			return ERR_RTP_UDPSHARDS_CANTBINDSOCKET;
+		}
+
+		RTPUDPReceiveShard *pShard = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPUDPRECEIVESHARD) RTPUDPReceiveShard(*this,sock,m_pSlabPool);
+		if (pShard == 0)
+		{
+			RTPCLOSE(sock);
+			Destroy();
+			return ERR_RTP_OUTOFMEM;
+		}
+		m_shards.push_back(pShard);
+	}
+
+	if (steerbyssrc)
+	{
+		// Selects the socket using the SSRC modulo the number of shards; the
+		// SSRC of an RTCP packet (when multiplexing) is at a different offset.
+		// If the datagram is too short, the program returns zero.
+		struct sock_filter code[8] = 
+		{
+			{ BPF_LD|BPF_B|BPF_ABS, 0, 0, 1 },				// (marker and) payload type or packet type
+			{ BPF_JMP|BPF_JGE|BPF_K, 0, 3, 200 },
+			{ BPF_JMP|BPF_JGT|BPF_K, 2, 0, 204 },
+			{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 4 },				// SSRC of the RTCP packet's sender
+			{ BPF_JMP|BPF_JA, 0, 0, 1 },
+			{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 8 },				// SSRC of the RTP packet
+			{ BPF_ALU|BPF_MOD|BPF_K, 0, 0, (uint32_t)numshards },
+			{ BPF_RET|BPF_A, 0, 0, 0 }
+		};
+		struct sock_fprog prog;
+
+		prog.len = 8;
+		prog.filter = code;
+		if (setsockopt(rtpsock,SOL_SOCKET,SO_ATTACH_REUSEPORT_CBPF,(const char *)&prog,sizeof(struct sock_fprog)) != 0)
+		{
+			Destroy();
+			return ERR_RTP_UDPSHARDS_CANTATTACHFILTER;
+		}
+	}
+
+	// Only start reading when all sockets are in place
+	for (size_t i = 0 ; i < m_shards.size() ; i++)
+	{
+		if ((status = m_shards[i]->StartWorker()) < 0)
+		{
+			Destroy();
+			return status;
+		}
+	}
+	return 0;
+}
+
+void RTPUDPReceiveShards::Destroy()
+{
+	if (!m_created)
+		return;
+
+	for (size_t i = 0 ; i < m_shards.size() ; i++)
+		RTPDelete(m_shards[i],GetMemoryManager());
+	m_shards.clear();
+
+	// The ones in m_collected were handed to the transmitter
+	ReleaseDatagrams(m_queue);
+	m_collected.clear();
+
+	// Packets that still use one of the slabs keep the pool alive
+	m_pSlabPool->Release();
+	m_pSlabPool = 0;
+	m_signal.Destroy();
+	m_signalled = false;
+	m_created = false;
+}
+
+const std::vector<RTPUDPReceiveShards::Datagram> &RTPUDPReceiveShards::CollectDatagrams()
+{
+	m_collected.clear();
+
+	m_queueMutex.Lock();
+	m_collected.swap(m_queue);
+	if (m_signalled)
+	{
+		m_signal.ReadSignallingByte();
+		m_signalled = false;
+	}
+	m_queueMutex.Unlock();
+
+	return m_collected;
+}
+
+void RTPUDPReceiveShards::QueueDatagrams(std::vector<Datagram> &datagrams)
+{
+	m_queueMutex.Lock();
+
+	// If the transmitter isn't being polled, don't keep reading into memory
+	// indefinitely but drop the datagrams, as the kernel would have done
+	if (m_queue.size() < RTPUDPSHARDS_MAXQUEUEDDATAGRAMS)
+	{
+		m_queue.insert(m_queue.end(),datagrams.begin(),datagrams.end());
+		datagrams.clear();
+		if (!m_signalled)
+		{
+			m_signal.SendAbortSignal();
+			m_signalled = true;
+		}
+	}
+
+	m_queueMutex.Unlock();
+
+	ReleaseDatagrams(datagrams);
+}
+
+void RTPUDPReceiveShards::ReleaseDatagrams(std::vector<Datagram> &datagrams)
+{
+	for (size_t i = 0 ; i < datagrams.size() ; i++)
+		datagrams[i].m_pSlab->Release();
+	datagrams.clear();
+}
+
+} // end namespace
+
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+
@@ -0,0 +1,136 @@
+/*
+
+  This file is a part of JRTPLIB
+  Copyright (c) 1999-2017 Jori Liesenborgs
+
+  Contact: jori.liesenborgs@gmail.com
+
+  This library was developed at the Expertise Centre for Digital Media
+  (http://www.edm.uhasselt.be), a research center of the Hasselt University
+  (http://www.uhasselt.be). The library is based upon work done for 
+  my thesis at the School for Knowledge Technology (Belgium/The Netherlands).
+
+  Permission is hereby granted, free of charge, to any person obtaining a
+  copy of this software and associated documentation files (the "Software"),
+  to deal in the Software without restriction, including without limitation
+  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+  and/or sell copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+  IN THE SOFTWARE.
+
+*/
+
+/**
+ * \file rtpudpshards.h
+ */
+
+#ifndef RTPUDPSHARDS_H
+
+#define RTPUDPSHARDS_H
+
+#include "rtpconfig.h"
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+
+#include "rtptypes.h"
+#include "rtpmemoryobject.h"
+#include "rtpsocketutil.h"
+#include "rtptimeutilities.h"
+#include "rtpabortdescriptors.h"
+#include <jthread/jmutex.h>
+#include <sys/socket.h>
+#include <vector>
+
+#define RTPUDPSHARDS_MAXQUEUEDDATAGRAMS							4096
+
+namespace jrtplib
+{
+
+class RTPReceiveSlab;
+class RTPSlabPool;
+class RTPUDPReceiveShard;
+
+/** Helper class for the UDP transmitters, used to spread the datagrams arriving on the RTP
+ *  port over several sockets, each of which is read by its own thread.
+ *  Helper class for the UDP transmitters, used to spread the datagrams arriving on the RTP
+ *  port over several sockets, each of which is read by its own thread. The additional sockets
+ *  are bound to the same address as the transmitter's RTP socket using 'SO_REUSEPORT', so that
+ *  the kernel distributes the incoming datagrams over this group of sockets. The transmitter's
+ *  own socket is the first shard and is read by the thread that polls the transmitter; each 
+ *  other shard has a thread that reads its datagrams into receive slabs and queues them until
+ *  the transmitter collects them. If requested, a classic BPF program is attached to the group
+ *  that selects the socket based on the SSRC in the RTP header (or in the RTCP header when
+ *  RTCP is multiplexed), so that all packets of a source are received by the same shard and
+ *  stay in order.
+ */
+class RTPUDPReceiveShards : public RTPMemoryObject
+{
+	JRTPLIB_NO_COPY(RTPUDPReceiveShards)
+public:
+	/** Describes a datagram that was received by one of the shard threads. */
+	class Datagram
+	{
+	public:
+		Datagram() : m_recvTime(0)												{ m_pSlab = 0; m_length = 0; }
+
+		RTPReceiveSlab *m_pSlab;
+		size_t m_length;
+		struct sockaddr_storage m_srcAddr;
+		RTPTime m_recvTime;
+	};
+
+	RTPUDPReceiveShards(RTPMemoryManager *mgr = 0);
+	~RTPUDPReceiveShards();
+
+	/** Allows \c sock to be part of a group of receive shards, this must be done before the socket is bound. */
+	static bool PrepareSocket(SocketType sock);
+
+	/** Creates \c numshards-1 additional sockets bound to the same address as \c rtpsock, which must 
+	 *  have been passed to RTPUDPReceiveShards::PrepareSocket, and starts their threads. If \c steerbyssrc
+	 *  is set, packets are assigned to a shard based on their SSRC. The receive buffer of each socket
+	 *  is set to \c recvbufsize bytes, and the datagrams are read into slabs of \c slabsize bytes. */
+	int Create(SocketType rtpsock, size_t numshards, bool steerbyssrc, int recvbufsize, size_t slabsize);
+
+	/** Stops the threads, closes the additional sockets and releases the datagrams that are still queued. */
+	void Destroy();
+
+	/** Returns the number of shards, including the transmitter's own RTP socket. */
+	size_t GetNumberOfShards() const												{ return m_shards.size()+1; }
+
+	/** Returns a socket that becomes readable when datagrams have been queued by the shard threads. */
+	SocketType GetSignalSocket() const												{ return m_signal.GetAbortSocket(); }
+
+	/** Takes the datagrams that were queued by the shard threads, the caller becomes responsible for
+	 *  the slab reference of each of them. The returned vector remains valid until the next call. */
+	const std::vector<Datagram> &CollectDatagrams();
+private:
+	friend class RTPUDPReceiveShard;
+
+	void QueueDatagrams(std::vector<Datagram> &datagrams);
+	void ReleaseDatagrams(std::vector<Datagram> &datagrams);
+
+	std::vector<RTPUDPReceiveShard *> m_shards;
+	RTPSlabPool *m_pSlabPool;
+	jthread::JMutex m_queueMutex;
+	std::vector<Datagram> m_queue, m_collected;
+	RTPAbortDescriptors m_signal;
+	bool m_signalled;
+	bool m_created;
+};
+
+} // end namespace
+
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+
+#endif // RTPUDPSHARDS_H
+
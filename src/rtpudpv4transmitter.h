@@ -43,25 +43,37 @@
 #include "rtpipv4destination.h"
 #include "rtphashtable.h"
 #include "rtpkeyhashtable.h"
+#include "rtpflathashtable.h"
+#include "rtpflatkeyhashtable.h"
 #include "rtpsocketutil.h"
 #include "rtpabortdescriptors.h"
 #include <list>
+#include <vector>
 
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jmutex.h>
 #endif // RTP_SUPPORT_THREAD
 
-#define RTPUDPV4TRANS_HASHSIZE									8317
+#define RTPUDPV4TRANS_HASHSIZE									8317 // deprecated, only kept for source compatibility
 #define RTPUDPV4TRANS_DEFAULTPORTBASE								5000
 
 #define RTPUDPV4TRANS_RTPRECEIVEBUFFER							32768
 #define RTPUDPV4TRANS_RTCPRECEIVEBUFFER							32768
 #define RTPUDPV4TRANS_RTPTRANSMITBUFFER							32768
 #define RTPUDPV4TRANS_RTCPTRANSMITBUFFER						32768
+#define RTPUDPV4TRANS_RECVBATCHPACKSIZE							2048
+#define RTPUDPV4TRANS_RECVSLABSIZE								2048
+#define RTPUDPV4TRANS_RECVSLABPOOLSIZE							256
 
 namespace jrtplib
 {
 
+class RTPUDPReceiveBatch;
+class RTPUDPSendBatch;
+class RTPSlabPool;
+class RTPReceiveSlab;
+class RTPUDPReceiveShards;
+
 /** Parameters for the UDP over IPv4 transmitter. */
 class JRTPLIB_IMPORTEXPORT RTPUDPv4TransmissionParams : public RTPTransmissionParams
 {
@@ -138,6 +150,70 @@ public:
 	 *  to let the transmitter create its own instance. */
 	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc) { m_pAbortDesc = desc; }
 
+	/** Enables batched reception of incoming datagrams.
+	 *  When \c numpackets is not zero and the platform provides the 'recvmmsg' call, up to \c numpackets 
+	 *  datagrams are read from a socket with a single system call, into a receive ring that is allocated 
+	 *  when the transmitter is created. Each entry in this ring can hold \c packetsize bytes; larger 
+	 *  datagrams are discarded. Setting \c numpackets to zero (the default) disables this mode, and on 
+	 *  platforms without 'recvmmsg' the regular receive code is always used.
+	 */
+	void SetReceiveBatchSize(size_t numpackets, size_t packetsize = RTPUDPV4TRANS_RECVBATCHPACKSIZE) { recvbatchsize = numpackets; recvbatchpacksize = packetsize; }
+
+	/** Enables or disables sending each packet to all destinations with a single 'sendmmsg' call.
+	 *  Enables or disables sending each packet to all destinations with a single 'sendmmsg' call
+	 *  instead of calling 'sendto' for each destination. The message headers for the destination
+	 *  list are only rebuilt when the list changes. On platforms without 'sendmmsg' this setting
+	 *  has no effect. Note that a batch of packets (see RTPSession::SendPackets) is always sent
+	 *  using 'sendmmsg' if it's available.
+	 */
+	void SetSendBatching(bool f)								{ sendbatching = f; }
+
+	/** Enables or disables sending runs of equally sized packets using UDP generic segmentation offload.
+	 *  When enabled, consecutive packets of the same length in a batch of packets (see RTPSession::SendPackets)
+	 *  are passed to the kernel as a single 'UDP_SEGMENT' datagram for each destination, which the kernel
+	 *  (or the network card) splits into the individual datagrams. The last packet of such a run may be
+	 *  shorter than the others. If the platform or the network device doesn't support this, the packets
+	 *  are sent in the usual way.
+	 */
+	void SetSendSegmentation(bool f)							{ sendsegmentation = f; }
+
+	/** Enables or disables receiving coalesced datagrams on the RTP socket using UDP generic receive offload.
+	 *  When enabled, the kernel is asked to merge consecutive datagrams of the same size from the same
+	 *  sender into a single buffer (the 'UDP_GRO' socket option), so that a burst of packets can be read
+	 *  with a single system call. The buffer is then split into the original datagrams, each of which
+	 *  becomes an RTPRawPacket that refers to its part of the shared buffer without copying it. If the
+	 *  platform doesn't support this, the datagrams are received in the usual way. Since a buffer can
+	 *  only be reused when all packets in it have been deleted, this is best combined with a timely
+	 *  processing of the incoming packets.
+	 */
+	void SetReceiveCoalescing(bool f)							{ recvcoalescing = f; }
+
+	/** Spreads the datagrams arriving on the RTP port over \c numshards sockets, each read by its own thread.
+	 *  When \c numshards is larger than one, the RTP socket is opened with 'SO_REUSEPORT' and \c numshards-1
+	 *  additional sockets are bound to the same port, so that the kernel distributes the incoming datagrams
+	 *  over them. The transmitter's own RTP socket is read by the thread that polls the transmitter, while
+	 *  each additional socket has a thread that reads its datagrams into receive slabs (of the size that's
+	 *  set using SetZeroCopyReceive) and queues them; these threads also wake up a call to 
+	 *  RTPTransmitter::WaitForIncomingData, so this is meant to be used with a poll thread. The queued 
+	 *  datagrams are then processed by the session as usual. If \c steerbyssrc is \c true, the socket is
+	 *  selected by a BPF program using the SSRC of the packet, so that the packets of a source are always
+	 *  received by the same thread and stay in order; otherwise the kernel selects a socket based on the 
+	 *  addresses and ports of the datagram. This requires the port base to be set explicitly and only
+	 *  works on Linux, elsewhere a single socket is used.
+	 */
+	void SetReceiveSharding(size_t numshards, bool steerbyssrc = true)	{ recvshards = numshards; recvshardsteering = steerbyssrc; }
+
+	/** Enables or disables receiving datagrams directly into pooled receive slabs.
+	 *  When enabled, incoming datagrams are read directly into fixed-size slabs of \c slabsize bytes 
+	 *  that are taken from a pool owned by the transmitter. The RTPRawPacket instance, and later the 
+	 *  RTPPacket or RTCPCompoundPacket instance, then uses the slab without copying the data, and the 
+	 *  sender's address is stored in the slab as well. When the packet is deleted, the slab returns to 
+	 *  the pool, which keeps at most \c maxfreeslabs of them for reuse. Datagrams that are larger than 
+	 *  a slab are discarded; when batched reception is enabled as well, the size of a slab also
+	 *  replaces the packet size of the receive ring.
+	 */
+	void SetZeroCopyReceive(bool f, size_t slabsize = RTPUDPV4TRANS_RECVSLABSIZE, size_t maxfreeslabs = RTPUDPV4TRANS_RECVSLABPOOLSIZE) { zerocopyrecv = f; recvslabsize = slabsize; recvslabpoolsize = maxfreeslabs; }
+
 	/** Returns the RTP socket's send buffer size. */
 	int GetRTPSendBuffer() const								{ return rtpsendbuf; }
 
@@ -167,6 +243,37 @@ public:
 	 *  which can be useful when creating your own poll thread for multiple
 	 *  sessions. */
 	RTPAbortDescriptors *GetCreatedAbortDescriptors() const		{ return m_pAbortDesc; }
+
+	/** Returns the maximum number of datagrams that will be read in a single call, or
+	 *  zero if batched reception is disabled. */
+	size_t GetReceiveBatchSize() const							{ return recvbatchsize; }
+
+	/** Returns the maximum size of a datagram that can be received in batched mode. */
+	size_t GetReceiveBatchPacketSize() const					{ return recvbatchpacksize; }
+
+	/** Returns \c true if packets will be sent to all destinations using a single 'sendmmsg' call. */
+	bool GetSendBatching() const								{ return sendbatching; }
+
+	/** Returns \c true if runs of equally sized packets will be sent using UDP generic segmentation offload. */
+	bool GetSendSegmentation() const							{ return sendsegmentation; }
+
+	/** Returns \c true if coalesced datagrams will be received on the RTP socket using UDP generic receive offload. */
+	bool GetReceiveCoalescing() const							{ return recvcoalescing; }
+
+	/** Returns the number of sockets the datagrams arriving on the RTP port are spread over. */
+	size_t GetReceiveShards() const								{ return recvshards; }
+
+	/** Returns \c true if the datagrams arriving on the RTP port are assigned to a socket based on their SSRC. */
+	bool GetReceiveShardSteering() const						{ return recvshardsteering; }
+
+	/** Returns \c true if datagrams will be received directly into pooled receive slabs. */
+	bool GetZeroCopyReceive() const								{ return zerocopyrecv; }
+
+	/** Returns the size of the receive slabs. */
+	size_t GetReceiveSlabSize() const							{ return recvslabsize; }
+
+	/** Returns the maximum number of unused receive slabs that are kept for reuse. */
+	size_t GetReceiveSlabPoolSize() const						{ return recvslabpoolsize; }
 private:
 	uint16_t portbase;
 	uint32_t bindIP, mcastifaceIP;
@@ -182,6 +289,15 @@ private:
 	bool useexistingsockets;
 
 	RTPAbortDescriptors *m_pAbortDesc;
+
+	size_t recvbatchsize, recvbatchpacksize;
+	bool sendbatching;
+	bool sendsegmentation;
+	bool recvcoalescing;
+	size_t recvshards;
+	bool recvshardsteering;
+	bool zerocopyrecv;
+	size_t recvslabsize, recvslabpoolsize;
 };
 
 inline RTPUDPv4TransmissionParams::RTPUDPv4TransmissionParams() : RTPTransmissionParams(RTPTransmitter::IPv4UDPProto)	
@@ -201,6 +317,16 @@ inline RTPUDPv4TransmissionParams::RTPUDPv4TransmissionParams() : RTPTransmissio
 	rtpsock = 0;
 	rtcpsock = 0;
 	m_pAbortDesc = 0;
+	recvbatchsize = 0;
+	recvbatchpacksize = RTPUDPV4TRANS_RECVBATCHPACKSIZE;
+	sendbatching = false;
+	sendsegmentation = false;
+	recvcoalescing = false;
+	recvshards = 1;
+	recvshardsteering = true;
+	zerocopyrecv = false;
+	recvslabsize = RTPUDPV4TRANS_RECVSLABSIZE;
+	recvslabpoolsize = RTPUDPV4TRANS_RECVSLABPOOLSIZE;
 }
 
 /** Additional information about the UDP over IPv4 transmitter. */
@@ -233,6 +359,9 @@ private:
 	uint16_t m_rtpPort, m_rtcpPort;
 };
 	
+// Deprecated: the GetHashIndex classes are no longer used by the transmitter,
+// they are only kept for source compatibility
+
 class JRTPLIB_IMPORTEXPORT RTPUDPv4Trans_GetHashIndex_IPv4Dest
 {
 public:
@@ -245,6 +374,18 @@ public:
 	static int GetIndex(const uint32_t &k)									{ return k%RTPUDPV4TRANS_HASHSIZE; }
 };
 
+class JRTPLIB_IMPORTEXPORT RTPUDPv4Trans_GetHash_IPv4Dest
+{
+public:
+	static uint32_t GetHash(const RTPIPv4Destination &d)							{ return d.GetIP()^(((uint32_t)d.GetRTPPort_NBO())<<16); }
+};
+
+class JRTPLIB_IMPORTEXPORT RTPUDPv4Trans_GetHash_uint32_t
+{
+public:
+	static uint32_t GetHash(const uint32_t &k)								{ return k; }
+};
+
 #define RTPUDPV4TRANS_HEADERSIZE						(20+8)
 	
 /** An UDP over IPv4 transmission component.
@@ -277,6 +418,8 @@ public:
 	
 	int SendRTPData(const void *data,size_t len);	
 	int SendRTCPData(const void *data,size_t len);
+	int SendRTPDataIov(const RTPIOVec *iov,int numiov);
+	int SendRTPDataBatch(const RTPIOVec *iov,const int numiov[],int numpackets);
 
 	int AddDestination(const RTPAddress &addr);
 	int DeleteDestination(const RTPAddress &addr);
@@ -301,13 +444,28 @@ public:
 #ifdef RTPDEBUG
 	void Dump();
 #endif // RTPDEBUG
+
+	/** Stores the destinations to which the last RTP or RTCP packet could not be sent in \c dests. */
+	void GetLastSendFailures(std::list<RTPIPv4Destination> &dests);
 private:
 	int CreateLocalIPList();
 	bool GetLocalIPList_Interfaces();
 	void GetLocalIPList_DNS();
 	void AddLoopbackAddress();
 	void FlushPackets();
+	void DeleteReceiveBatch();
+	void DeleteSlabPool();
+	void DeleteReceiveShards();
+	void DeleteSendBatches();
+	void SendBatched(bool rtp,const RTPIOVec *iov,const int numiov[],int numpackets);
+	void AddBatchDestination(const RTPIPv4Destination &dest);
+	void DeleteBatchDestination(size_t pos);
+	void SendSegmented(const RTPIOVec *iov,const int numiov[],int numpackets);
 	int PollSocket(bool rtp);
+	int PollSocketBatched(bool rtp);
+	int PollSocketCoalesced();
+	int PollShards();
+	int ProcessReceivedData(const uint8_t *data,size_t len,RTPReceiveSlab *slab,uint32_t srcip,uint16_t srcport,RTPTime &recvtime,bool rtp);
 	int ProcessAddAcceptIgnoreEntry(uint32_t ip,uint16_t port);
 	int ProcessDeleteAcceptIgnoreEntry(uint32_t ip,uint16_t port);
 #ifdef RTP_SUPPORT_IPV4MULTICAST
@@ -329,9 +487,9 @@ private:
 	uint8_t *localhostname;
 	size_t localhostnamelength;
 	
-	RTPHashTable<const RTPIPv4Destination,RTPUDPv4Trans_GetHashIndex_IPv4Dest,RTPUDPV4TRANS_HASHSIZE> destinations;
+	RTPFlatHashTable<const RTPIPv4Destination,RTPUDPv4Trans_GetHash_IPv4Dest> destinations;
 #ifdef RTP_SUPPORT_IPV4MULTICAST
-	RTPHashTable<const uint32_t,RTPUDPv4Trans_GetHashIndex_uint32_t,RTPUDPV4TRANS_HASHSIZE> multicastgroups;
+	RTPFlatHashTable<const uint32_t,RTPUDPv4Trans_GetHash_uint32_t> multicastgroups;
 #endif // RTP_SUPPORT_IPV4MULTICAST
 	std::list<RTPRawPacket*> rawpacketlist;
 
@@ -347,12 +505,23 @@ private:
 		std::list<uint16_t> portlist;
 	};
 
-	RTPKeyHashTable<const uint32_t,PortInfo*,RTPUDPv4Trans_GetHashIndex_uint32_t,RTPUDPV4TRANS_HASHSIZE> acceptignoreinfo;
+	RTPFlatKeyHashTable<const uint32_t,PortInfo*,RTPUDPv4Trans_GetHash_uint32_t> acceptignoreinfo;
 
 	bool closesocketswhendone;
 	RTPAbortDescriptors m_abortDesc;
 	RTPAbortDescriptors *m_pAbortDesc; // in case an external one was specified
 
+	RTPUDPReceiveBatch *m_pRecvBatch; // only used when batched reception is enabled
+	RTPUDPSendBatch *m_pRTPSendBatch, *m_pRTCPSendBatch; // only available if 'sendmmsg' is supported
+	bool m_sendBatching; // use the batches for single packets as well
+	bool m_sendSegmentation; // cleared if it turns out that GSO isn't supported
+	bool m_sendBatchesValid;
+	RTPSlabPool *m_pSlabPool; // only used when zero-copy reception is enabled
+	RTPSlabPool *m_pGROSlabPool; // only used when coalesced reception is enabled
+	RTPUDPReceiveShards *m_pRecvShards; // only used when receive sharding is enabled
+	std::vector<RTPReceiveSlab *> m_batchSlabs; // slabs currently attached to the receive ring
+	std::vector<RTPIPv4Destination> m_sendFailures; // reserved for all destinations, so recording a failure doesn't allocate
+
 #ifdef RTP_SUPPORT_THREAD
 	jthread::JMutex mainmutex,waitmutex;
 	int threadsafe;
@@ -46,13 +46,31 @@
 #include "rtpsocketutilinternal.h"
 #include "rtpinternalutils.h"
 #include "rtpselect.h"
+#include "rtpudpbatch.h"
+#include "rtpslabpool.h"
+#include "rtpudpshards.h"
 #include <stdio.h>
+#include <errno.h>
+#if defined(RTP_HAVE_UDP_SEGMENT) || defined(RTP_HAVE_UDP_GRO)
+	#include <netinet/udp.h>
+#endif // RTP_HAVE_UDP_SEGMENT || RTP_HAVE_UDP_GRO
 
 #include "rtpdebug.h"
 
 #define RTPUDPV6TRANS_MAXPACKSIZE							65535
+#define RTPUDPV6TRANS_GSOMAXSEGMENTS							64
+#define RTPUDPV6TRANS_GROBUFFERSIZE							65535
+#define RTPUDPV6TRANS_GROSLABPOOLSIZE							8
+#define RTPUDPV6TRANS_GSOMAXSIZE							65527
 #define RTPUDPV6TRANS_IFREQBUFSIZE							8192
 
+// Makes 'recvfrom' return the real length of a datagram that didn't fit in the buffer
+#if defined(MSG_TRUNC) && !defined(RTP_SOCKETTYPE_WINSOCK)
+	#define RTPUDPV6TRANS_RECVTRUNCFLAG							MSG_TRUNC
+#else
+	#define RTPUDPV6TRANS_RECVTRUNCFLAG							0
+#endif // MSG_TRUNC && !RTP_SOCKETTYPE_WINSOCK
+
 #define RTPUDPV6TRANS_IS_MCASTADDR(x)							(x.s6_addr[0] == 0xFF)
 
 #define RTPUDPV6TRANS_MCASTMEMBERSHIP(socket,type,mcastip,status)	{\
@@ -91,6 +109,12 @@ RTPUDPv6Transmitter::RTPUDPv6Transmitter(RTPMemoryManager *mgr) : RTPTransmitter
 {
 	created = false;
 	init = false;
+	m_pRecvBatch = 0;
+	m_pSlabPool = 0;
+	m_pGROSlabPool = 0;
+	m_pRecvShards = 0;
+	m_pRTPSendBatch = 0;
+	m_pRTCPSendBatch = 0;
 }
 
 RTPUDPv6Transmitter::~RTPUDPv6Transmitter()
@@ -220,6 +244,17 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 	bindIP = params->GetBindIP();
 	mcastifidx = params->GetMulticastInterfaceIndex();
 	
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+	// Allow the sockets of the other receive shards to be bound to the same port
+	if (params->GetReceiveShards() > 1 && !RTPUDPReceiveShards::PrepareSocket(rtpsock))
+	{
+		RTPCLOSE(rtpsock);
+		RTPCLOSE(rtcpsock);
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_UDPSHARDS_CANTSETSOCKETOPTION;
+	}
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+
 	memset(&addr,0,sizeof(struct sockaddr_in6));
 	addr.sin6_family = AF_INET6;
 	addr.sin6_port = htons(params->GetPortbase());
@@ -288,11 +323,175 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 		MAINMUTEX_UNLOCK
 		return ERR_RTP_UDPV6TRANS_SPECIFIEDSIZETOOBIG;
 	}
+
+	m_pSlabPool = 0;
+	m_pGROSlabPool = 0;
+	if (params->GetZeroCopyReceive())
+	{
+#ifdef RTP_SUPPORT_THREAD
+		bool slabthreadsafe = (threadsafe)?true:false;
+#else
+		bool slabthreadsafe = false;
+#endif // RTP_SUPPORT_THREAD
+
+		m_pSlabPool = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPSLABPOOL) RTPSlabPool(GetMemoryManager());
+		if (m_pSlabPool == 0)
+		{
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return ERR_RTP_OUTOFMEM;
+		}
+		if ((status = m_pSlabPool->Create(params->GetReceiveSlabSize(),params->GetReceiveSlabPoolSize(),slabthreadsafe)) < 0)
+		{
+			DeleteSlabPool();
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+	}
+
+#ifdef RTP_HAVE_UDP_GRO
+	if (params->GetReceiveCoalescing())
+	{
+		// If the kernel doesn't accept the option, datagrams are simply
+		// received in the usual way
+		int on = 1;
+
+		if (setsockopt(rtpsock,SOL_UDP,UDP_GRO,(const char *)&on,sizeof(int)) == 0)
+		{
+#ifdef RTP_SUPPORT_THREAD
+			bool slabthreadsafe = (threadsafe)?true:false;
+#else
+			bool slabthreadsafe = false;
+#endif // RTP_SUPPORT_THREAD
+
+			m_pGROSlabPool = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPSLABPOOL) RTPSlabPool(GetMemoryManager());
+			if (m_pGROSlabPool == 0)
+			{
+				DeleteSlabPool();
+				RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+				MAINMUTEX_UNLOCK
+				return ERR_RTP_OUTOFMEM;
+			}
+			if ((status = m_pGROSlabPool->Create(RTPUDPV6TRANS_GROBUFFERSIZE,RTPUDPV6TRANS_GROSLABPOOLSIZE,slabthreadsafe)) < 0)
+			{
+				DeleteSlabPool();
+				RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+				MAINMUTEX_UNLOCK
+				return status;
+			}
+		}
+	}
+#endif // RTP_HAVE_UDP_GRO
+
+	m_pRecvShards = 0;
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+	if (params->GetReceiveShards() > 1)
+	{
+		m_pRecvShards = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPUDPRECEIVESHARDS) RTPUDPReceiveShards(GetMemoryManager());
+		if (m_pRecvShards == 0)
+		{
+			DeleteSlabPool();
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return ERR_RTP_OUTOFMEM;
+		}
+		if ((status = m_pRecvShards->Create(rtpsock,params->GetReceiveShards(),params->GetReceiveShardSteering(),params->GetRTPReceiveBuffer(),params->GetReceiveSlabSize())) < 0)
+		{
+			DeleteReceiveShards();
+			DeleteSlabPool();
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+	}
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+
+	m_pRecvBatch = 0;
+#ifdef RTP_HAVE_RECVMMSG
+	if (params->GetReceiveBatchSize() > 0)
+	{
+		m_pRecvBatch = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPUDPRECEIVEBATCH) RTPUDPReceiveBatch(GetMemoryManager());
+		if (m_pRecvBatch == 0)
+		{
+			DeleteReceiveShards();
+			DeleteSlabPool();
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return ERR_RTP_OUTOFMEM;
+		}
+		// When receive slabs are used, these will be attached to the receive ring
+		if (m_pSlabPool)
+			status = m_pRecvBatch->Create(params->GetReceiveBatchSize(),m_pSlabPool->GetSlabSize(),true);
+		else
+			status = m_pRecvBatch->Create(params->GetReceiveBatchSize(),params->GetReceiveBatchPacketSize());
+		if (status < 0)
+		{
+			RTPDelete(m_pRecvBatch,GetMemoryManager());
+			m_pRecvBatch = 0;
+			DeleteReceiveShards();
+			DeleteSlabPool();
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+		m_batchSlabs.resize(m_pRecvBatch->GetBatchSize(),0);
+	}
+#endif // RTP_HAVE_RECVMMSG
+
+	m_pRTPSendBatch = 0;
+	m_pRTCPSendBatch = 0;
+	m_sendBatching = false;
+#ifdef RTP_HAVE_SENDMMSG
+	// A batch of RTP packets is always sent using 'sendmmsg', single packets
+	// only if batched sending was enabled
+	m_pRTPSendBatch = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPUDPSENDBATCH) RTPUDPSendBatch(GetMemoryManager());
+	m_pRTCPSendBatch = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPUDPSENDBATCH) RTPUDPSendBatch(GetMemoryManager());
+	if (m_pRTPSendBatch == 0 || m_pRTCPSendBatch == 0)
+	{
+		DeleteSendBatches();
+		DeleteReceiveBatch();
+		DeleteReceiveShards();
+		DeleteSlabPool();
+		RTPCLOSE(rtpsock);
+		RTPCLOSE(rtcpsock);
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_OUTOFMEM;
+	}
+	m_sendBatching = params->GetSendBatching();
+#endif // RTP_HAVE_SENDMMSG
+
+	m_sendSegmentation = false;
+#ifdef RTP_HAVE_UDP_SEGMENT
+	if (params->GetSendSegmentation())
+	{
+		// Only use GSO if the kernel knows about it
+		int segsize = 0;
+		RTPSOCKLENTYPE optlen = sizeof(int);
+
+		if (getsockopt(rtpsock,SOL_UDP,UDP_SEGMENT,(char *)&segsize,&optlen) == 0)
+			m_sendSegmentation = true;
+	}
+#endif // RTP_HAVE_UDP_SEGMENT
+	m_sendBatchesValid = false;
+	m_sendFailures.clear();
 	
 	if (!params->GetCreatedAbortDescriptors())
 	{
 		if ((status = m_abortDesc.Init()) < 0)
 		{
+			DeleteSendBatches();
+			DeleteReceiveBatch();
+			DeleteReceiveShards();
+			DeleteSlabPool();
 			RTPCLOSE(rtpsock);
 			RTPCLOSE(rtcpsock);
 			MAINMUTEX_UNLOCK
@@ -305,6 +504,10 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 		m_pAbortDesc = params->GetCreatedAbortDescriptors();
 		if (!m_pAbortDesc->IsInitialized())
 		{
+			DeleteSendBatches();
+			DeleteReceiveBatch();
+			DeleteReceiveShards();
+			DeleteSlabPool();
 			RTPCLOSE(rtpsock);
 			RTPCLOSE(rtcpsock);
 			MAINMUTEX_UNLOCK
@@ -352,6 +555,11 @@ void RTPUDPv6Transmitter::Destroy()
 	multicastgroups.Clear();
 #endif // RTP_SUPPORT_IPV6MULTICAST
 	FlushPackets();
+	DeleteReceiveShards();
+	DeleteReceiveBatch();
+	DeleteSlabPool();
+	DeleteSendBatches();
+	m_sendFailures.clear();
 	ClearAcceptIgnoreInfo();
 	localIPs.clear();
 	created = false;
@@ -591,6 +799,8 @@ int RTPUDPv6Transmitter::Poll()
 	status = PollSocket(true); // poll RTP socket
 	if (status >= 0)
 		status = PollSocket(false); // poll RTCP socket
+	if (m_pRecvShards && status >= 0)
+		status = PollShards();
 	MAINMUTEX_UNLOCK
 	return status;
 }
@@ -614,18 +824,28 @@ int RTPUDPv6Transmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavai
 	}
 	
 	SocketType abortSocket = m_pAbortDesc->GetAbortSocket();
-	SocketType socks[3] = { rtpsock, rtcpsock, abortSocket };
-	int8_t readflags[3] = { 0, 0, 0 };
+	SocketType socks[4] = { rtpsock, rtcpsock, abortSocket, 0 };
+	int8_t readflags[4] = { 0, 0, 0, 0 };
 	const int idxRTP = 0;
 	const int idxRTCP = 1;
 	const int idxAbort = 2;
+	const int idxShards = 3;
+	size_t numsocks = 3;
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+	if (m_pRecvShards) // the shard threads signal when they've queued datagrams
+	{
+		socks[idxShards] = m_pRecvShards->GetSignalSocket();
+		numsocks = 4;
+	}
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
 
 	waitingfordata = true;
 	
 	WAITMUTEX_LOCK
 	MAINMUTEX_UNLOCK
 
-	int status = RTPSelect(socks, readflags, 3, delay);
+	int status = RTPSelect(socks, readflags, numsocks, delay);
 	if (status < 0)
 	{
 		MAINMUTEX_LOCK
@@ -650,7 +870,7 @@ int RTPUDPv6Transmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavai
 	
 	if (dataavailable != 0)
 	{
-		if (readflags[idxRTP] || readflags[idxRTCP])
+		if (readflags[idxRTP] || readflags[idxRTCP] || readflags[idxShards])
 			*dataavailable = true;
 		else
 			*dataavailable = false;
@@ -684,6 +904,140 @@ int RTPUDPv6Transmitter::AbortWait()
 	return 0;
 }
 
+// Sends the packet consisting of the 'numiov' parts in 'iov' to 'addr' with a
+// single call, returns a negative value on failure
+static int SendToIov(SocketType sock,const RTPIOVec *iov,int numiov,const struct sockaddr *addr,RTPSOCKLENTYPE addrlen)
+{
+#ifdef RTP_SOCKETTYPE_WINSOCK
+	WSABUF wsabufs[RTP_MAXIOVECS];
+	DWORD numsent = 0;
+
+	for (int i = 0 ; i < numiov ; i++)
+	{
+		wsabufs[i].buf = (char *)iov[i].data;
+		wsabufs[i].len = (ULONG)iov[i].len;
+	}
+	if (WSASendTo(sock,wsabufs,(DWORD)numiov,&numsent,0,addr,addrlen,0,0) != 0)
+		return -1;
+	return 0;
+#else
+	struct iovec msgiov[RTP_MAXIOVECS];
+	struct msghdr msg;
+
+	for (int i = 0 ; i < numiov ; i++)
+	{
+		msgiov[i].iov_base = (void *)iov[i].data;
+		msgiov[i].iov_len = iov[i].len;
+	}
+
+	memset(&msg,0,sizeof(struct msghdr));
+	msg.msg_name = (void *)addr;
+	msg.msg_namelen = addrlen;
+	msg.msg_iov = msgiov;
+	msg.msg_iovlen = numiov;
+
+	if (sendmsg(sock,&msg,0) < 0)
+		return -1;
+	return 0;
+#endif // RTP_SOCKETTYPE_WINSOCK
+}
+
+#ifdef RTP_HAVE_UDP_SEGMENT
+
+static size_t GetIovLength(const RTPIOVec *iov,int numiov)
+{
+	size_t len = 0;
+
+	for (int i = 0 ; i < numiov ; i++)
+		len += iov[i].len;
+	return len;
+}
+
+// Sends a batch of packets to 'addr', each run of equally sized packets (of which
+// the last one may be shorter) as a single GSO datagram. If the kernel or the
+// network device turns out not to support this, 'gso' is cleared and the packets
+// are sent one by one. Returns a negative value if some packets couldn't be sent.
+static int SendToSegmented(SocketType sock,const RTPIOVec *iov,const int numiov[],int numpackets,const struct sockaddr *addr,RTPSOCKLENTYPE addrlen,bool &gso)
+{
+	struct iovec msgiov[RTPUDPV6TRANS_GSOMAXSEGMENTS*RTP_MAXIOVECS];
+	char control[CMSG_SPACE(sizeof(uint16_t))];
+	int result = 0;
+	int i = 0;
+
+	while (i < numpackets)
+	{
+		// Determine the run of packets that starts here
+		size_t seglen = GetIovLength(iov,numiov[i]);
+		size_t total = seglen;
+		int runiov = numiov[i];
+		int end = i+1;
+
+		while (gso && end < numpackets && end-i < RTPUDPV6TRANS_GSOMAXSEGMENTS)
+		{
+			size_t len = GetIovLength(iov+runiov,numiov[end]);
+
+			if (len > seglen || len == 0 || total+len > RTPUDPV6TRANS_GSOMAXSIZE)
+				break;
+			total += len;
+			runiov += numiov[end];
+			end++;
+			if (len < seglen) // only the last segment may be shorter
+				break;
+		}
+
+		bool sendseparately = true;
+
+		if (end-i > 1)
+		{
+			struct msghdr msg;
+
+			for (int j = 0 ; j < runiov ; j++)
+			{
+				msgiov[j].iov_base = (void *)iov[j].data;
+				msgiov[j].iov_len = iov[j].len;
+			}
+
+			memset(&msg,0,sizeof(struct msghdr));
+			msg.msg_name = (void *)addr;
+			msg.msg_namelen = addrlen;
+			msg.msg_iov = msgiov;
+			msg.msg_iovlen = runiov;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+
+			struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+			cm->cmsg_level = SOL_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			uint16_t segsize = (uint16_t)seglen;
+			memcpy(CMSG_DATA(cm),&segsize,sizeof(uint16_t));
+
+			if (sendmsg(sock,&msg,0) >= 0)
+				sendseparately = false;
+			else if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+				gso = false; // e.g. no checksum offload on the device, don't try this again
+		}
+
+		if (sendseparately)
+		{
+			const RTPIOVec *pIOV = iov;
+
+			for (int j = i ; j < end ; j++)
+			{
+				if (SendToIov(sock,pIOV,numiov[j],addr,addrlen) < 0)
+					result = -1;
+				pIOV += numiov[j];
+			}
+		}
+
+		iov += runiov;
+		i = end;
+	}
+	return result;
+}
+
+#endif // RTP_HAVE_UDP_SEGMENT
+
 int RTPUDPv6Transmitter::SendRTPData(const void *data,size_t len)	
 {
 	if (!init)
@@ -702,11 +1056,26 @@ int RTPUDPv6Transmitter::SendRTPData(const void *data,size_t len)
 		return ERR_RTP_UDPV6TRANS_SPECIFIEDSIZETOOBIG;
 	}
 	
-	destinations.GotoFirstElement();
-	while (destinations.HasCurrentElement())
+	m_sendFailures.clear();
+
+	if (m_sendBatching)
 	{
-		sendto(rtpsock,(const char *)data,len,0,(const struct sockaddr *)destinations.GetCurrentElement().GetRTPSockAddr(),sizeof(struct sockaddr_in6));
-		destinations.GotoNextElement();
+		RTPIOVec iov;
+		int numiov = 1;
+
+		iov.data = data;
+		iov.len = len;
+		SendBatched(true,&iov,&numiov,1);
+	}
+	else
+	{
+		destinations.GotoFirstElement();
+		while (destinations.HasCurrentElement())
+		{
+			if (sendto(rtpsock,(const char *)data,len,0,(const struct sockaddr *)destinations.GetCurrentElement().GetRTPSockAddr(),sizeof(struct sockaddr_in6)) < 0)
+				m_sendFailures.push_back(destinations.GetCurrentElement());
+			destinations.GotoNextElement();
+		}
 	}
 	
 	MAINMUTEX_UNLOCK
@@ -731,11 +1100,134 @@ int RTPUDPv6Transmitter::SendRTCPData(const void *data,size_t len)
 		return ERR_RTP_UDPV6TRANS_SPECIFIEDSIZETOOBIG;
 	}
 	
-	destinations.GotoFirstElement();
-	while (destinations.HasCurrentElement())
+	m_sendFailures.clear();
+
+	if (m_sendBatching)
 	{
-		sendto(rtcpsock,(const char *)data,len,0,(const struct sockaddr *)destinations.GetCurrentElement().GetRTCPSockAddr(),sizeof(struct sockaddr_in6));
-		destinations.GotoNextElement();
+		RTPIOVec iov;
+		int numiov = 1;
+
+		iov.data = data;
+		iov.len = len;
+		SendBatched(false,&iov,&numiov,1);
+	}
+	else
+	{
+		destinations.GotoFirstElement();
+		while (destinations.HasCurrentElement())
+		{
+			if (sendto(rtcpsock,(const char *)data,len,0,(const struct sockaddr *)destinations.GetCurrentElement().GetRTCPSockAddr(),sizeof(struct sockaddr_in6)) < 0)
+				m_sendFailures.push_back(destinations.GetCurrentElement());
+			destinations.GotoNextElement();
+		}
+	}
+	
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv6Transmitter::SendRTPDataIov(const RTPIOVec *iov,int numiov)
+{
+	if (numiov > RTP_MAXIOVECS)
+		return RTPTransmitter::SendRTPDataIov(iov,numiov);
+	if (!init)
+		return ERR_RTP_UDPV6TRANS_NOTINIT;
+
+	size_t len = 0;
+	for (int i = 0 ; i < numiov ; i++)
+		len += iov[i].len;
+
+	MAINMUTEX_LOCK
+	
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_UDPV6TRANS_NOTCREATED;
+	}
+	if (len > maxpacksize)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_UDPV6TRANS_SPECIFIEDSIZETOOBIG;
+	}
+	
+	m_sendFailures.clear();
+
+	if (m_sendBatching)
+		SendBatched(true,iov,&numiov,1);
+	else
+	{
+		destinations.GotoFirstElement();
+		while (destinations.HasCurrentElement())
+		{
+			if (SendToIov(rtpsock,iov,numiov,(const struct sockaddr *)destinations.GetCurrentElement().GetRTPSockAddr(),sizeof(struct sockaddr_in6)) < 0)
+				m_sendFailures.push_back(destinations.GetCurrentElement());
+			destinations.GotoNextElement();
+		}
+	}
+	
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv6Transmitter::SendRTPDataBatch(const RTPIOVec *iov,const int numiov[],int numpackets)
+{
+	if (!init)
+		return ERR_RTP_UDPV6TRANS_NOTINIT;
+
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		if (numiov[i] > RTP_MAXIOVECS)
+			return RTPTransmitter::SendRTPDataBatch(iov,numiov,numpackets);
+	}
+
+	MAINMUTEX_LOCK
+	
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return ERR_RTP_UDPV6TRANS_NOTCREATED;
+	}
+
+	// Check the sizes first, so that either all packets or none are sent
+	const RTPIOVec *pIOV = iov;
+	for (int i = 0 ; i < numpackets ; i++)
+	{
+		size_t len = 0;
+
+		for (int j = 0 ; j < numiov[i] ; j++, pIOV++)
+			len += pIOV->len;
+		if (len > maxpacksize)
+		{
+			MAINMUTEX_UNLOCK
+			return ERR_RTP_UDPV6TRANS_SPECIFIEDSIZETOOBIG;
+		}
+	}
+	
+	m_sendFailures.clear();
+
+	if (m_sendSegmentation && numpackets > 1)
+		SendSegmented(iov,numiov,numpackets);
+	else if (m_pRTPSendBatch)
+		SendBatched(true,iov,numiov,numpackets);
+	else
+	{
+		destinations.GotoFirstElement();
+		while (destinations.HasCurrentElement())
+		{
+			const struct sockaddr *addr = (const struct sockaddr *)destinations.GetCurrentElement().GetRTPSockAddr();
+			bool failed = false;
+
+			pIOV = iov;
+			for (int i = 0 ; i < numpackets ; i++)
+			{
+				if (SendToIov(rtpsock,pIOV,numiov[i],addr,sizeof(struct sockaddr_in6)) < 0)
+					failed = true;
+				pIOV += numiov[i];
+			}
+			if (failed)
+				m_sendFailures.push_back(destinations.GetCurrentElement());
+			destinations.GotoNextElement();
+		}
 	}
 	
 	MAINMUTEX_UNLOCK
@@ -763,6 +1255,11 @@ int RTPUDPv6Transmitter::AddDestination(const RTPAddress &addr)
 	RTPIPv6Address &address = (RTPIPv6Address &)addr;
 	RTPIPv6Destination dest(address.GetIP(),address.GetPort());
 	int status = destinations.AddElement(dest);
+	if (status >= 0)
+	{
+		AddBatchDestination(dest);
+		m_sendFailures.reserve(destinations.GetNumberOfElements());
+	}
 
 	MAINMUTEX_UNLOCK
 	return status;
@@ -788,7 +1285,14 @@ int RTPUDPv6Transmitter::DeleteDestination(const RTPAddress &addr)
 	
 	RTPIPv6Address &address = (RTPIPv6Address &)addr;	
 	RTPIPv6Destination dest(address.GetIP(),address.GetPort());
-	int status = destinations.DeleteElement(dest);
+	int status = destinations.GotoElement(dest);
+	if (status >= 0)
+	{
+		size_t pos = destinations.GetCurrentPosition();
+
+		destinations.DeleteCurrentElement();
+		DeleteBatchDestination(pos);
+	}
 	
 	MAINMUTEX_UNLOCK
 	return status;
@@ -801,7 +1305,10 @@ void RTPUDPv6Transmitter::ClearDestinations()
 	
 	MAINMUTEX_LOCK
 	if (created)
+	{
 		destinations.Clear();
+		m_sendBatchesValid = false;
+	}
 	MAINMUTEX_UNLOCK
 }
 
@@ -1202,6 +1709,18 @@ RTPRawPacket *RTPUDPv6Transmitter::GetNextPacket()
 	return p;
 }
 
+void RTPUDPv6Transmitter::GetLastSendFailures(std::list<RTPIPv6Destination> &dests)
+{
+	dests.clear();
+	if (!init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (created)
+		dests.assign(m_sendFailures.begin(),m_sendFailures.end());
+	MAINMUTEX_UNLOCK
+}
+
 // Here the private functions start...
 
 
@@ -1231,6 +1750,146 @@ void RTPUDPv6Transmitter::FlushPackets()
 	rawpacketlist.clear();
 }
 
+void RTPUDPv6Transmitter::DeleteReceiveBatch()
+{
+#ifdef RTP_HAVE_RECVMMSG
+	if (m_pRecvBatch)
+		RTPDelete(m_pRecvBatch,GetMemoryManager());
+#endif // RTP_HAVE_RECVMMSG
+	m_pRecvBatch = 0;
+
+	for (size_t i = 0 ; i < m_batchSlabs.size() ; i++)
+	{
+		if (m_batchSlabs[i])
+			m_batchSlabs[i]->Release();
+	}
+	m_batchSlabs.clear();
+}
+
+void RTPUDPv6Transmitter::DeleteSlabPool()
+{
+	// Packets that still use one of the slabs keep the pool alive
+	if (m_pSlabPool)
+		m_pSlabPool->Release();
+	if (m_pGROSlabPool)
+		m_pGROSlabPool->Release();
+	m_pSlabPool = 0;
+	m_pGROSlabPool = 0;
+}
+
+void RTPUDPv6Transmitter::DeleteReceiveShards()
+{
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+	if (m_pRecvShards)
+		RTPDelete(m_pRecvShards,GetMemoryManager());
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+	m_pRecvShards = 0;
+}
+
+void RTPUDPv6Transmitter::DeleteSendBatches()
+{
+#ifdef RTP_HAVE_SENDMMSG
+	if (m_pRTPSendBatch)
+		RTPDelete(m_pRTPSendBatch,GetMemoryManager());
+	if (m_pRTCPSendBatch)
+		RTPDelete(m_pRTCPSendBatch,GetMemoryManager());
+#endif // RTP_HAVE_SENDMMSG
+	m_pRTPSendBatch = 0;
+	m_pRTCPSendBatch = 0;
+}
+
+void RTPUDPv6Transmitter::SendSegmented(const RTPIOVec *iov,const int numiov[],int numpackets)
+{
+#ifdef RTP_HAVE_UDP_SEGMENT
+	destinations.GotoFirstElement();
+	while (destinations.HasCurrentElement())
+	{
+		const struct sockaddr *addr = (const struct sockaddr *)destinations.GetCurrentElement().GetRTPSockAddr();
+
+		if (SendToSegmented(rtpsock,iov,numiov,numpackets,addr,sizeof(struct sockaddr_in6),m_sendSegmentation) < 0)
+			m_sendFailures.push_back(destinations.GetCurrentElement());
+		destinations.GotoNextElement();
+	}
+#else
+	JRTPLIB_UNUSED(iov);
+	JRTPLIB_UNUSED(numiov);
+	JRTPLIB_UNUSED(numpackets);
+#endif // RTP_HAVE_UDP_SEGMENT
+}
+
+void RTPUDPv6Transmitter::SendBatched(bool rtp,const RTPIOVec *iov,const int numiov[],int numpackets)
+{
+#ifdef RTP_HAVE_SENDMMSG
+	if (!m_sendBatchesValid) // the destination list changed, rebuild the message headers
+	{
+		m_pRTPSendBatch->Clear();
+		m_pRTCPSendBatch->Clear();
+
+		destinations.GotoFirstElement();
+		while (destinations.HasCurrentElement())
+		{
+			const RTPIPv6Destination &dest = destinations.GetCurrentElement();
+
+			m_pRTPSendBatch->AddDestination((const struct sockaddr *)dest.GetRTPSockAddr(),sizeof(struct sockaddr_in6));
+			m_pRTCPSendBatch->AddDestination((const struct sockaddr *)dest.GetRTCPSockAddr(),sizeof(struct sockaddr_in6));
+			destinations.GotoNextElement();
+		}
+		m_sendBatchesValid = true;
+	}
+
+	RTPUDPSendBatch *pBatch = (rtp)?m_pRTPSendBatch:m_pRTCPSendBatch;
+
+	SocketType sock = (rtp)?rtpsock:rtcpsock;
+	size_t numfailed;
+
+	if (numpackets == 1)
+		numfailed = pBatch->Send(sock,iov,numiov[0]);
+	else
+		numfailed = pBatch->SendPackets(sock,iov,numiov,numpackets);
+	if (numfailed == 0)
+		return;
+
+	// The message headers are in the same order as the destination table
+	for (size_t i = 0 ; i < pBatch->GetNumberOfFailures() ; i++)
+		m_sendFailures.push_back(destinations.GetElementAt(pBatch->GetFailedDestination(i)));
+#else
+	JRTPLIB_UNUSED(rtp);
+	JRTPLIB_UNUSED(iov);
+	JRTPLIB_UNUSED(numiov);
+	JRTPLIB_UNUSED(numpackets);
+#endif // RTP_HAVE_SENDMMSG
+}
+
+// The destinations are added to and removed from the message headers in the same
+// way as in the destination table, so both stay in the same order and the headers
+// don't need to be rebuilt
+
+void RTPUDPv6Transmitter::AddBatchDestination(const RTPIPv6Destination &dest)
+{
+#ifdef RTP_HAVE_SENDMMSG
+	if (m_pRTPSendBatch && m_sendBatchesValid)
+	{
+		m_pRTPSendBatch->AddDestination((const struct sockaddr *)dest.GetRTPSockAddr(),sizeof(struct sockaddr_in6));
+		m_pRTCPSendBatch->AddDestination((const struct sockaddr *)dest.GetRTCPSockAddr(),sizeof(struct sockaddr_in6));
+	}
+#else
+	JRTPLIB_UNUSED(dest);
+#endif // RTP_HAVE_SENDMMSG
+}
+
+void RTPUDPv6Transmitter::DeleteBatchDestination(size_t pos)
+{
+#ifdef RTP_HAVE_SENDMMSG
+	if (m_pRTPSendBatch && m_sendBatchesValid)
+	{
+		m_pRTPSendBatch->DeleteDestination(pos);
+		m_pRTCPSendBatch->DeleteDestination(pos);
+	}
+#else
+	JRTPLIB_UNUSED(pos);
+#endif // RTP_HAVE_SENDMMSG
+}
+
 int RTPUDPv6Transmitter::PollSocket(bool rtp)
 {
 	RTPSOCKLENTYPE fromlen;
@@ -1245,7 +1904,13 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 #endif // RTP_SOCKETTYPE_WINSOCK
 	struct sockaddr_in6 srcaddr;
 	bool dataavailable;
+	RTPReceiveSlab *slab = 0;
 	
+	if (rtp && m_pGROSlabPool)
+		return PollSocketCoalesced();
+	if (m_pRecvBatch)
+		return PollSocketBatched(rtp);
+
 	if (rtp)
 		sock = rtpsock;
 	else
@@ -1273,42 +1938,30 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 	{
 		RTPTime curtime = RTPTime::CurrentTime();
 		fromlen = sizeof(struct sockaddr_in6);
-		recvlen = recvfrom(sock,packetbuffer,RTPUDPV6TRANS_MAXPACKSIZE,0,(struct sockaddr *)&srcaddr,&fromlen);
-		if (recvlen > 0)
+		if (m_pSlabPool)
 		{
-			bool acceptdata;
+			// Read the datagram directly into a receive slab; a slab that's
+			// not passed on to a raw packet is used for the next datagram
+			if (slab == 0 && (slab = m_pSlabPool->AcquireSlab()) == 0)
+				return ERR_RTP_OUTOFMEM;
 
-			// got data, process it
-			if (receivemode == RTPTransmitter::AcceptAll)
-				acceptdata = true;
-			else
-				acceptdata = ShouldAcceptData(srcaddr.sin6_addr,ntohs(srcaddr.sin6_port));
-			
-			if (acceptdata)
+			recvlen = recvfrom(sock,(char *)slab->GetData(),(int)slab->GetSize(),RTPUDPV6TRANS_RECVTRUNCFLAG,(struct sockaddr *)&srcaddr,&fromlen);
+			if (recvlen > 0 && (size_t)recvlen <= slab->GetSize()) // larger datagrams were truncated
 			{
-				RTPRawPacket *pack;
-				RTPIPv6Address *addr;
-				uint8_t *datacopy;
-
-				addr = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPADDRESS) RTPIPv6Address(srcaddr.sin6_addr,ntohs(srcaddr.sin6_port));
-				if (addr == 0)
-					return ERR_RTP_OUTOFMEM;
-				datacopy = RTPNew(GetMemoryManager(),(rtp)?RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET:RTPMEM_TYPE_BUFFER_RECEIVEDRTCPPACKET) uint8_t[recvlen];
-				if (datacopy == 0)
-				{
-					RTPDelete(addr,GetMemoryManager());
-					return ERR_RTP_OUTOFMEM;
-				}
-				memcpy(datacopy,packetbuffer,recvlen);
-				
-				pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,recvlen,addr,curtime,rtp,GetMemoryManager());
-				if (pack == 0)
-				{
-					RTPDelete(addr,GetMemoryManager());
-					RTPDeleteByteArray(datacopy,GetMemoryManager());
-					return ERR_RTP_OUTOFMEM;
-				}
-				rawpacketlist.push_back(pack);	
+				int status = ProcessReceivedData(slab->GetData(),recvlen,slab,srcaddr.sin6_addr,ntohs(srcaddr.sin6_port),curtime,rtp);
+				slab = 0;
+				if (status < 0)
+					return status;
+			}
+		}
+		else
+		{
+			recvlen = recvfrom(sock,packetbuffer,RTPUDPV6TRANS_MAXPACKSIZE,0,(struct sockaddr *)&srcaddr,&fromlen);
+			if (recvlen > 0)
+			{
+				int status = ProcessReceivedData((const uint8_t *)packetbuffer,recvlen,0,srcaddr.sin6_addr,ntohs(srcaddr.sin6_port),curtime,rtp);
+				if (status < 0)
+					return status;
 			}
 		}
 		len = 0;
@@ -1319,7 +1972,11 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 			int8_t isset = 0;
 			int status = RTPSelect(&sock, &isset, 1, RTPTime(0));
 			if (status < 0)
+			{
+				if (slab)
+					slab->Release();
 				return status;
+			}
 
 			if (isset)
 				dataavailable = true;
@@ -1329,6 +1986,256 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 		else
 			dataavailable = true;
 	}
+
+	if (slab)
+		slab->Release();
+	return 0;
+}
+
+int RTPUDPv6Transmitter::PollSocketBatched(bool rtp)
+{
+#ifdef RTP_HAVE_RECVMMSG
+	SocketType sock = (rtp)?rtpsock:rtcpsock;
+	int numpackets;
+
+	// The datagrams are read with MSG_DONTWAIT, so there's no need for the
+	// FIONREAD/select combination to find out if more data is available.
+	do
+	{
+		if (m_pSlabPool)
+		{
+			// Attach a slab to each entry of the receive ring that doesn't have
+			// one anymore because it was passed on to a raw packet
+			for (size_t i = 0 ; i < m_batchSlabs.size() ; i++)
+			{
+				if (m_batchSlabs[i] == 0)
+				{
+					if ((m_batchSlabs[i] = m_pSlabPool->AcquireSlab()) == 0)
+						return ERR_RTP_OUTOFMEM;
+					m_pRecvBatch->SetPacketBuffer(i,m_batchSlabs[i]->GetData(),m_batchSlabs[i]->GetSize());
+				}
+			}
+		}
+
+		numpackets = m_pRecvBatch->Receive(sock);
+		if (numpackets <= 0)
+			break;
+
+		RTPTime curtime = RTPTime::CurrentTime();
+
+		for (int i = 0 ; i < numpackets ; i++)
+		{
+			size_t recvlen = m_pRecvBatch->GetPacketLength(i);
+
+			// make sure a packet of length zero is not queued, and ignore
+			// packets that didn't fit in the receive ring
+			if (recvlen == 0 || m_pRecvBatch->IsTruncated(i))
+				continue;
+
+			const struct sockaddr_in6 *srcaddr = (const struct sockaddr_in6 *)m_pRecvBatch->GetSourceAddress(i);
+			if (srcaddr->sin6_family != AF_INET6)
+				continue;
+
+			RTPReceiveSlab *slab = 0;
+
+			if (m_pSlabPool)
+			{
+				slab = m_batchSlabs[i];
+				m_batchSlabs[i] = 0;
+			}
+
+			int status = ProcessReceivedData(m_pRecvBatch->GetPacketData(i),recvlen,slab,srcaddr->sin6_addr,ntohs(srcaddr->sin6_port),curtime,rtp);
+			if (status < 0)
+				return status;
+		}
+	} while ((size_t)numpackets == m_pRecvBatch->GetBatchSize()); // a partial batch means the socket has been drained
+
+	return 0;
+#else
+	JRTPLIB_UNUSED(rtp);
+	return 0;
+#endif // RTP_HAVE_RECVMMSG
+}
+
+int RTPUDPv6Transmitter::PollSocketCoalesced()
+{
+#ifdef RTP_HAVE_UDP_GRO
+	// The datagrams are read with MSG_DONTWAIT, so there's no need for the
+	// FIONREAD/select combination to find out if more data is available.
+	while (true)
+	{
+		RTPReceiveSlab *slab = m_pGROSlabPool->AcquireSlab();
+		if (slab == 0)
+			return ERR_RTP_OUTOFMEM;
+
+		struct sockaddr_in6 srcaddr;
+		struct iovec iov;
+		char control[CMSG_SPACE(sizeof(int))];
+		struct msghdr msg;
+		int recvlen;
+
+		iov.iov_base = slab->GetData();
+		iov.iov_len = slab->GetSize();
+		memset(&msg,0,sizeof(struct msghdr));
+		msg.msg_name = &srcaddr;
+		msg.msg_namelen = sizeof(struct sockaddr_in6);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		do
+		{
+			recvlen = (int)recvmsg(rtpsock,&msg,MSG_DONTWAIT);
+		} while (recvlen < 0 && errno == EINTR);
+
+		if (recvlen < 0) // the socket has been drained
+		{
+			slab->Release();
+			break;
+		}
+
+		// make sure a packet of length zero is not queued, and ignore
+		// datagrams that didn't fit in the buffer
+		if (recvlen == 0 || (msg.msg_flags & MSG_TRUNC) || srcaddr.sin6_family != AF_INET6)
+		{
+			slab->Release();
+			continue;
+		}
+
+		// Without a segment size, this is just a single datagram
+		size_t segsize = (size_t)recvlen;
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg) ; cmsg != 0 ; cmsg = CMSG_NXTHDR(&msg,cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			{
+				int gsosize;
+
+				memcpy(&gsosize,CMSG_DATA(cmsg),sizeof(int));
+				if (gsosize > 0)
+					segsize = (size_t)gsosize;
+			}
+		}
+
+		// Each datagram in the buffer becomes a raw packet holding its own
+		// reference to the slab, only the last one can be shorter
+		RTPTime curtime = RTPTime::CurrentTime();
+
+		for (size_t offset = 0 ; offset < (size_t)recvlen ; offset += segsize)
+		{
+			size_t len = ((size_t)recvlen-offset < segsize)?((size_t)recvlen-offset):segsize;
+
+			slab->AddReference();
+			int status = ProcessReceivedData(slab->GetData()+offset,len,slab,srcaddr.sin6_addr,ntohs(srcaddr.sin6_port),curtime,true);
+			if (status < 0)
+			{
+				slab->Release();
+				return status;
+			}
+		}
+		slab->Release();
+	}
+#endif // RTP_HAVE_UDP_GRO
+	return 0;
+}
+
+int RTPUDPv6Transmitter::PollShards()
+{
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_REUSEPORT_CBPF)
+	const std::vector<RTPUDPReceiveShards::Datagram> &datagrams = m_pRecvShards->CollectDatagrams();
+	int status = 0;
+
+	// Each datagram holds a slab reference, which is passed on to the raw packet
+	for (size_t i = 0 ; i < datagrams.size() ; i++)
+	{
+		const RTPUDPReceiveShards::Datagram &dgram = datagrams[i];
+		const struct sockaddr_in6 *srcaddr = (const struct sockaddr_in6 *)&dgram.m_srcAddr;
+		RTPTime recvtime = dgram.m_recvTime;
+
+		if (status < 0 || srcaddr->sin6_family != AF_INET6)
+		{
+			dgram.m_pSlab->Release();
+			continue;
+		}
+		status = ProcessReceivedData(dgram.m_pSlab->GetData(),dgram.m_length,dgram.m_pSlab,srcaddr->sin6_addr,ntohs(srcaddr->sin6_port),recvtime,true);
+	}
+	return status;
+#else
+	return 0;
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_REUSEPORT_CBPF
+}
+
+int RTPUDPv6Transmitter::ProcessReceivedData(const uint8_t *data,size_t recvlen,RTPReceiveSlab *slab,const in6_addr &srcip,uint16_t srcport,RTPTime &recvtime,bool rtp)
+{
+	bool acceptdata;
+
+	// got data, process it
+	if (receivemode == RTPTransmitter::AcceptAll)
+		acceptdata = true;
+	else
+		acceptdata = ShouldAcceptData(srcip,srcport);
+	
+	if (!acceptdata)
+	{
+		if (slab)
+			slab->Release();
+		return 0;
+	}
+
+	RTPRawPacket *pack;
+
+	if (slab) // the data is already in the slab, and the address instance is reused
+	{
+		RTPIPv6Address *addr = (RTPIPv6Address *)slab->GetAddress();
+
+		if (addr == 0)
+		{
+			addr = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPADDRESS) RTPIPv6Address(srcip,srcport);
+			if (addr == 0)
+			{
+				slab->Release();
+				return ERR_RTP_OUTOFMEM;
+			}
+			slab->SetAddress(addr);
+		}
+		else
+		{
+			addr->SetIP(srcip);
+			addr->SetPort(srcport);
+		}
+
+		pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(slab,(uint8_t *)data,recvlen,recvtime,rtp,GetMemoryManager());
+		if (pack == 0)
+		{
+			slab->Release();
+			return ERR_RTP_OUTOFMEM;
+		}
+		rawpacketlist.push_back(pack);
+		return 0;
+	}
+
+	RTPIPv6Address *addr;
+	uint8_t *datacopy;
+
+	addr = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPADDRESS) RTPIPv6Address(srcip,srcport);
+	if (addr == 0)
+		return ERR_RTP_OUTOFMEM;
+	datacopy = RTPNew(GetMemoryManager(),(rtp)?RTPMEM_TYPE_BUFFER_RECEIVEDRTPPACKET:RTPMEM_TYPE_BUFFER_RECEIVEDRTCPPACKET) uint8_t[recvlen];
+	if (datacopy == 0)
+	{
+		RTPDelete(addr,GetMemoryManager());
+		return ERR_RTP_OUTOFMEM;
+	}
+	memcpy(datacopy,data,recvlen);
+	
+	pack = RTPNew(GetMemoryManager(),RTPMEM_TYPE_CLASS_RTPRAWPACKET) RTPRawPacket(datacopy,recvlen,addr,recvtime,rtp,GetMemoryManager());
+	if (pack == 0)
+	{
+		RTPDelete(addr,GetMemoryManager());
+		RTPDeleteByteArray(datacopy,GetMemoryManager());
+		return ERR_RTP_OUTOFMEM;
+	}
+	rawpacketlist.push_back(pack);	
 	return 0;
 }
 
@@ -46,26 +46,38 @@
 #include "rtpipv6destination.h"
 #include "rtphashtable.h"
 #include "rtpkeyhashtable.h"
+#include "rtpflathashtable.h"
+#include "rtpflatkeyhashtable.h"
 #include "rtpsocketutil.h"
 #include "rtpabortdescriptors.h"
 #include <string.h>
 #include <list>
+#include <vector>
 
 #ifdef RTP_SUPPORT_THREAD
 	#include <jthread/jmutex.h>
 #endif // RTP_SUPPORT_THREAD
 
-#define RTPUDPV6TRANS_HASHSIZE										8317
+#define RTPUDPV6TRANS_HASHSIZE										8317 // deprecated, only kept for source compatibility
 #define RTPUDPV6TRANS_DEFAULTPORTBASE								5000
 
 #define RTPUDPV6TRANS_RTPRECEIVEBUFFER							32768
 #define RTPUDPV6TRANS_RTCPRECEIVEBUFFER							32768
 #define RTPUDPV6TRANS_RTPTRANSMITBUFFER							32768
 #define RTPUDPV6TRANS_RTCPTRANSMITBUFFER						32768
+#define RTPUDPV6TRANS_RECVBATCHPACKSIZE							2048
+#define RTPUDPV6TRANS_RECVSLABSIZE								2048
+#define RTPUDPV6TRANS_RECVSLABPOOLSIZE							256
 
 namespace jrtplib
 {
 
+class RTPUDPReceiveBatch;
+class RTPUDPSendBatch;
+class RTPSlabPool;
+class RTPReceiveSlab;
+class RTPUDPReceiveShards;
+
 /** Parameters for the UDP over IPv6 transmitter. */
 class JRTPLIB_IMPORTEXPORT RTPUDPv6TransmissionParams : public RTPTransmissionParams
 {
@@ -125,6 +137,70 @@ public:
 	 *  to let the transmitter create its own instance. */
 	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc) { m_pAbortDesc = desc; }
 
+	/** Enables batched reception of incoming datagrams.
+	 *  When \c numpackets is not zero and the platform provides the 'recvmmsg' call, up to \c numpackets 
+	 *  datagrams are read from a socket with a single system call, into a receive ring that is allocated 
+	 *  when the transmitter is created. Each entry in this ring can hold \c packetsize bytes; larger 
+	 *  datagrams are discarded. Setting \c numpackets to zero (the default) disables this mode, and on 
+	 *  platforms without 'recvmmsg' the regular receive code is always used.
+	 */
+	void SetReceiveBatchSize(size_t numpackets, size_t packetsize = RTPUDPV6TRANS_RECVBATCHPACKSIZE) { recvbatchsize = numpackets; recvbatchpacksize = packetsize; }
+
+	/** Enables or disables sending each packet to all destinations with a single 'sendmmsg' call.
+	 *  Enables or disables sending each packet to all destinations with a single 'sendmmsg' call
+	 *  instead of calling 'sendto' for each destination. The message headers for the destination
+	 *  list are only rebuilt when the list changes. On platforms without 'sendmmsg' this setting
+	 *  has no effect. Note that a batch of packets (see RTPSession::SendPackets) is always sent
+	 *  using 'sendmmsg' if it's available.
+	 */
+	void SetSendBatching(bool f)								{ sendbatching = f; }
+
+	/** Enables or disables sending runs of equally sized packets using UDP generic segmentation offload.
+	 *  When enabled, consecutive packets of the same length in a batch of packets (see RTPSession::SendPackets)
+	 *  are passed to the kernel as a single 'UDP_SEGMENT' datagram for each destination, which the kernel
+	 *  (or the network card) splits into the individual datagrams. The last packet of such a run may be
+	 *  shorter than the others. If the platform or the network device doesn't support this, the packets
+	 *  are sent in the usual way.
+	 */
+	void SetSendSegmentation(bool f)							{ sendsegmentation = f; }
+
+	/** Enables or disables receiving coalesced datagrams on the RTP socket using UDP generic receive offload.
+	 *  When enabled, the kernel is asked to merge consecutive datagrams of the same size from the same
+	 *  sender into a single buffer (the 'UDP_GRO' socket option), so that a burst of packets can be read
+	 *  with a single system call. The buffer is then split into the original datagrams, each of which
+	 *  becomes an RTPRawPacket that refers to its part of the shared buffer without copying it. If the
+	 *  platform doesn't support this, the datagrams are received in the usual way. Since a buffer can
+	 *  only be reused when all packets in it have been deleted, this is best combined with a timely
+	 *  processing of the incoming packets.
+	 */
+	void SetReceiveCoalescing(bool f)							{ recvcoalescing = f; }
+
+	/** Spreads the datagrams arriving on the RTP port over \c numshards sockets, each read by its own thread.
+	 *  When \c numshards is larger than one, the RTP socket is opened with 'SO_REUSEPORT' and \c numshards-1
+	 *  additional sockets are bound to the same port, so that the kernel distributes the incoming datagrams
+	 *  over them. The transmitter's own RTP socket is read by the thread that polls the transmitter, while
+	 *  each additional socket has a thread that reads its datagrams into receive slabs (of the size that's
+	 *  set using SetZeroCopyReceive) and queues them; these threads also wake up a call to 
+	 *  RTPTransmitter::WaitForIncomingData, so this is meant to be used with a poll thread. The queued 
+	 *  datagrams are then processed by the session as usual. If \c steerbyssrc is \c true, the socket is
+	 *  selected by a BPF program using the SSRC of the packet, so that the packets of a source are always
+	 *  received by the same thread and stay in order; otherwise the kernel selects a socket based on the 
+	 *  addresses and ports of the datagram. This requires the port base to be set explicitly and only
+	 *  works on Linux, elsewhere a single socket is used.
+	 */
+	void SetReceiveSharding(size_t numshards, bool steerbyssrc = true)	{ recvshards = numshards; recvshardsteering = steerbyssrc; }
+
+	/** Enables or disables receiving datagrams directly into pooled receive slabs.
+	 *  When enabled, incoming datagrams are read directly into fixed-size slabs of \c slabsize bytes 
+	 *  that are taken from a pool owned by the transmitter. The RTPRawPacket instance, and later the 
+	 *  RTPPacket or RTCPCompoundPacket instance, then uses the slab without copying the data, and the 
+	 *  sender's address is stored in the slab as well. When the packet is deleted, the slab returns to 
+	 *  the pool, which keeps at most \c maxfreeslabs of them for reuse. Datagrams that are larger than 
+	 *  a slab are discarded; when batched reception is enabled as well, the size of a slab also
+	 *  replaces the packet size of the receive ring.
+	 */
+	void SetZeroCopyReceive(bool f, size_t slabsize = RTPUDPV6TRANS_RECVSLABSIZE, size_t maxfreeslabs = RTPUDPV6TRANS_RECVSLABPOOLSIZE) { zerocopyrecv = f; recvslabsize = slabsize; recvslabpoolsize = maxfreeslabs; }
+
 	/** Returns the RTP socket's send buffer size. */
 	int GetRTPSendBuffer() const								{ return rtpsendbuf; }
 
@@ -141,6 +217,37 @@ public:
 	 *  which can be useful when creating your own poll thread for multiple
 	 *  sessions. */
 	RTPAbortDescriptors *GetCreatedAbortDescriptors() const		{ return m_pAbortDesc; }
+
+	/** Returns the maximum number of datagrams that will be read in a single call, or
+	 *  zero if batched reception is disabled. */
+	size_t GetReceiveBatchSize() const							{ return recvbatchsize; }
+
+	/** Returns the maximum size of a datagram that can be received in batched mode. */
+	size_t GetReceiveBatchPacketSize() const					{ return recvbatchpacksize; }
+
+	/** Returns \c true if packets will be sent to all destinations using a single 'sendmmsg' call. */
+	bool GetSendBatching() const								{ return sendbatching; }
+
+	/** Returns \c true if runs of equally sized packets will be sent using UDP generic segmentation offload. */
+	bool GetSendSegmentation() const							{ return sendsegmentation; }
+
+	/** Returns \c true if coalesced datagrams will be received on the RTP socket using UDP generic receive offload. */
+	bool GetReceiveCoalescing() const							{ return recvcoalescing; }
+
+	/** Returns the number of sockets the datagrams arriving on the RTP port are spread over. */
+	size_t GetReceiveShards() const								{ return recvshards; }
+
+	/** Returns \c true if the datagrams arriving on the RTP port are assigned to a socket based on their SSRC. */
+	bool GetReceiveShardSteering() const						{ return recvshardsteering; }
+
+	/** Returns \c true if datagrams will be received directly into pooled receive slabs. */
+	bool GetZeroCopyReceive() const								{ return zerocopyrecv; }
+
+	/** Returns the size of the receive slabs. */
+	size_t GetReceiveSlabSize() const							{ return recvslabsize; }
+
+	/** Returns the maximum number of unused receive slabs that are kept for reuse. */
+	size_t GetReceiveSlabPoolSize() const						{ return recvslabpoolsize; }
 private:
 	uint16_t portbase;
 	in6_addr bindIP;
@@ -151,6 +258,15 @@ private:
 	int rtcpsendbuf, rtcprecvbuf;
 
 	RTPAbortDescriptors *m_pAbortDesc;
+
+	size_t recvbatchsize, recvbatchpacksize;
+	bool sendbatching;
+	bool sendsegmentation;
+	bool recvcoalescing;
+	size_t recvshards;
+	bool recvshardsteering;
+	bool zerocopyrecv;
+	size_t recvslabsize, recvslabpoolsize;
 };
 
 inline RTPUDPv6TransmissionParams::RTPUDPv6TransmissionParams()
@@ -168,6 +284,16 @@ inline RTPUDPv6TransmissionParams::RTPUDPv6TransmissionParams()
 	rtcprecvbuf = RTPUDPV6TRANS_RTCPRECEIVEBUFFER; 
 
 	m_pAbortDesc = 0;
+	recvbatchsize = 0;
+	recvbatchpacksize = RTPUDPV6TRANS_RECVBATCHPACKSIZE;
+	sendbatching = false;
+	sendsegmentation = false;
+	recvcoalescing = false;
+	recvshards = 1;
+	recvshardsteering = true;
+	zerocopyrecv = false;
+	recvslabsize = RTPUDPV6TRANS_RECVSLABSIZE;
+	recvslabpoolsize = RTPUDPV6TRANS_RECVSLABPOOLSIZE;
 }
 
 /** Additional information about the UDP over IPv6 transmitter. */
@@ -200,6 +326,9 @@ private:
 	uint16_t m_rtpPort, m_rtcpPort;
 };
 		
+// Deprecated: the GetHashIndex classes are no longer used by the transmitter,
+// they are only kept for source compatibility
+
 class JRTPLIB_IMPORTEXPORT RTPUDPv6Trans_GetHashIndex_IPv6Dest
 {
 public:
@@ -212,6 +341,25 @@ public:
 	static int GetIndex(const in6_addr &ip)							{ return ((((uint32_t)ip.s6_addr[12])<<24)|(((uint32_t)ip.s6_addr[13])<<16)|(((uint32_t)ip.s6_addr[14])<<8)|((uint32_t)ip.s6_addr[15]))%RTPUDPV6TRANS_HASHSIZE; }
 };
 
+class JRTPLIB_IMPORTEXPORT RTPUDPv6Trans_GetHash_in6_addr
+{
+public:
+	static uint32_t GetHash(const in6_addr &ip)
+	{
+		uint32_t h = 0;
+
+		for (int i = 0 ; i < 16 ; i += 4)
+			h = (h*31)^((((uint32_t)ip.s6_addr[i])<<24)|(((uint32_t)ip.s6_addr[i+1])<<16)|(((uint32_t)ip.s6_addr[i+2])<<8)|((uint32_t)ip.s6_addr[i+3]));
+		return h;
+	}
+};
+
+class JRTPLIB_IMPORTEXPORT RTPUDPv6Trans_GetHash_IPv6Dest
+{
+public:
+	static uint32_t GetHash(const RTPIPv6Destination &d)				{ return RTPUDPv6Trans_GetHash_in6_addr::GetHash(d.GetIP())^(((uint32_t)d.GetRTPSockAddr()->sin6_port)<<16); }
+};
+
 #define RTPUDPV6TRANS_HEADERSIZE								(40+8)
 	
 /** An UDP over IPv6 transmitter.
@@ -244,6 +392,8 @@ public:
 	
 	int SendRTPData(const void *data,size_t len);	
 	int SendRTCPData(const void *data,size_t len);
+	int SendRTPDataIov(const RTPIOVec *iov,int numiov);
+	int SendRTPDataBatch(const RTPIOVec *iov,const int numiov[],int numpackets);
 
 	int AddDestination(const RTPAddress &addr);
 	int DeleteDestination(const RTPAddress &addr);
@@ -268,13 +418,28 @@ public:
 #ifdef RTPDEBUG
 	void Dump();
 #endif // RTPDEBUG
+
+	/** Stores the destinations to which the last RTP or RTCP packet could not be sent in \c dests. */
+	void GetLastSendFailures(std::list<RTPIPv6Destination> &dests);
 private:
 	int CreateLocalIPList();
 	bool GetLocalIPList_Interfaces();
 	void GetLocalIPList_DNS();
 	void AddLoopbackAddress();
 	void FlushPackets();
+	void DeleteReceiveBatch();
+	void DeleteSlabPool();
+	void DeleteReceiveShards();
+	void DeleteSendBatches();
+	void SendBatched(bool rtp,const RTPIOVec *iov,const int numiov[],int numpackets);
+	void AddBatchDestination(const RTPIPv6Destination &dest);
+	void DeleteBatchDestination(size_t pos);
+	void SendSegmented(const RTPIOVec *iov,const int numiov[],int numpackets);
 	int PollSocket(bool rtp);
+	int PollSocketBatched(bool rtp);
+	int PollSocketCoalesced();
+	int PollShards();
+	int ProcessReceivedData(const uint8_t *data,size_t len,RTPReceiveSlab *slab,const in6_addr &srcip,uint16_t srcport,RTPTime &recvtime,bool rtp);
 	int ProcessAddAcceptIgnoreEntry(in6_addr ip,uint16_t port);
 	int ProcessDeleteAcceptIgnoreEntry(in6_addr ip,uint16_t port);
 #ifdef RTP_SUPPORT_IPV6MULTICAST
@@ -297,9 +462,9 @@ private:
 	uint8_t *localhostname;
 	size_t localhostnamelength;
 	
-	RTPHashTable<const RTPIPv6Destination,RTPUDPv6Trans_GetHashIndex_IPv6Dest,RTPUDPV6TRANS_HASHSIZE> destinations;
+	RTPFlatHashTable<const RTPIPv6Destination,RTPUDPv6Trans_GetHash_IPv6Dest> destinations;
 #ifdef RTP_SUPPORT_IPV6MULTICAST
-	RTPHashTable<const in6_addr,RTPUDPv6Trans_GetHashIndex_in6_addr,RTPUDPV6TRANS_HASHSIZE> multicastgroups;
+	RTPFlatHashTable<const in6_addr,RTPUDPv6Trans_GetHash_in6_addr> multicastgroups;
 #endif // RTP_SUPPORT_IPV6MULTICAST
 	std::list<RTPRawPacket*> rawpacketlist;
 
@@ -315,10 +480,21 @@ private:
 		std::list<uint16_t> portlist;
 	};
 
-	RTPKeyHashTable<const in6_addr,PortInfo*,RTPUDPv6Trans_GetHashIndex_in6_addr,RTPUDPV6TRANS_HASHSIZE> acceptignoreinfo;
+	RTPFlatKeyHashTable<const in6_addr,PortInfo*,RTPUDPv6Trans_GetHash_in6_addr> acceptignoreinfo;
 	RTPAbortDescriptors m_abortDesc;
 	RTPAbortDescriptors *m_pAbortDesc;
 
+	RTPUDPReceiveBatch *m_pRecvBatch; // only used when batched reception is enabled
+	RTPUDPSendBatch *m_pRTPSendBatch, *m_pRTCPSendBatch; // only available if 'sendmmsg' is supported
+	bool m_sendBatching; // use the batches for single packets as well
+	bool m_sendSegmentation; // cleared if it turns out that GSO isn't supported
+	bool m_sendBatchesValid;
+	RTPSlabPool *m_pSlabPool; // only used when zero-copy reception is enabled
+	RTPSlabPool *m_pGROSlabPool; // only used when coalesced reception is enabled
+	RTPUDPReceiveShards *m_pRecvShards; // only used when receive sharding is enabled
+	std::vector<RTPReceiveSlab *> m_batchSlabs; // slabs currently attached to the receive ring
+	std::vector<RTPIPv6Destination> m_sendFailures; // reserved for all destinations, so recording a failure doesn't allocate
+
 #ifdef RTP_SUPPORT_THREAD
 	jthread::JMutex mainmutex,waitmutex;
 	int threadsafe;
@@ -0,0 +1,291 @@
+#include "rtpconfig.h"
+#include "rtpflatkeyhashtable.h"
+#include "rtpflathashtable.h"
+#include "rtperrors.h"
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+using namespace std;
+using namespace jrtplib;
+
+static bool ok = true;
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		cerr << "ERROR: " << RTPGetErrorString(rtperr) << endl;
+		exit(-1);
+	}
+}
+
+void check(bool cond, const string &what)
+{
+	if (!cond)
+	{
+		cerr << "FAILED: " << what << endl;
+		ok = false;
+	}
+}
+
+// Spreads the keys over the slots as usual
+class SpreadHash
+{
+public:
+	static uint32_t GetHash(const uint32_t &k)							{ return k; }
+};
+
+// Only a few different hash values, so there are long probe sequences
+class CollidingHash
+{
+public:
+	static uint32_t GetHash(const uint32_t &k)							{ return k%3; }
+};
+
+typedef RTPFlatKeyHashTable<const uint32_t,string,SpreadHash> SpreadTable;
+typedef RTPFlatKeyHashTable<const uint32_t,string,CollidingHash> CollidingTable;
+
+static string ElementFor(uint32_t k)
+{
+	// Long enough to be stored outside of the string object itself
+	return string("element for key ") + string(k%7+1,'x') + string(40,'y');
+}
+
+// Checks that the table contains exactly the keys in 'expected', both through
+// lookups and by iterating over it
+template<class Table>
+void CheckContents(Table &table, const map<uint32_t,string> &expected, const string &what)
+{
+	check(table.GetNumberOfElements() == expected.size(), what + ": number of elements");
+
+	for (map<uint32_t,string>::const_iterator it = expected.begin() ; it != expected.end() ; ++it)
+	{
+		if (!table.HasElement(it->first) || table.GotoElement(it->first) < 0)
+		{
+			check(false, what + ": key not found");
+			return;
+		}
+		check(table.GetCurrentKey() == it->first && table.GetCurrentElement() == it->second, what + ": wrong element");
+	}
+
+	set<uint32_t> visited;
+	size_t pos = 0;
+
+	table.GotoFirstElement();
+	while (table.HasCurrentElement())
+	{
+		check(table.GetCurrentPosition() == pos, what + ": position during iteration");
+		check(expected.find(table.GetCurrentKey()) != expected.end(), what + ": unexpected key");
+		check(visited.insert(table.GetCurrentKey()).second, what + ": key visited twice");
+		table.GotoNextElement();
+		pos++;
+	}
+	check(visited.size() == expected.size(), what + ": not all keys visited");
+
+	// Backwards as well
+	pos = 0;
+	table.GotoLastElement();
+	while (table.HasCurrentElement())
+	{
+		table.GotoPreviousElement();
+		pos++;
+	}
+	check(pos == expected.size(), what + ": backward iteration");
+}
+
+void TestAddAndGrow()
+{
+	SpreadTable table;
+	map<uint32_t,string> expected;
+	vector<uint32_t> order;
+
+	check(table.GotoElement(1) == ERR_RTP_KEYHASHTABLE_KEYNOTFOUND, "lookup in empty table");
+	check(table.DeleteElement(1) == ERR_RTP_KEYHASHTABLE_KEYNOTFOUND, "delete in empty table");
+	table.GotoFirstElement();
+	check(!table.HasCurrentElement(), "iteration over empty table");
+
+	// Enough elements to let the table grow several times
+	for (uint32_t i = 0 ; i < 5000 ; i++)
+	{
+		uint32_t k = i*2654435761U;
+
+		checkerror(table.AddElement(k, ElementFor(k)));
+		expected[k] = ElementFor(k);
+		order.push_back(k);
+	}
+	check(table.AddElement(order[123], "duplicate") == ERR_RTP_KEYHASHTABLE_KEYALREADYEXISTS, "adding a key twice");
+
+	CheckContents(table, expected, "add and grow");
+
+	// Without deletions, the elements are visited in the order they were added
+	size_t pos = 0;
+	bool inorder = true;
+
+	table.GotoFirstElement();
+	while (table.HasCurrentElement())
+	{
+		if (table.GetCurrentKey() != order[pos] || table.GetKeyAt(pos) != order[pos])
+			inorder = false;
+		table.GotoNextElement();
+		pos++;
+	}
+	check(inorder, "iteration order after adding");
+
+	table.Clear();
+	expected.clear();
+	CheckContents(table, expected, "clear");
+	checkerror(table.AddElement(7, ElementFor(7)));
+	expected[7] = ElementFor(7);
+	CheckContents(table, expected, "add after clear");
+}
+
+void TestDeleteDuringIteration()
+{
+	SpreadTable table;
+	map<uint32_t,string> expected;
+
+	for (uint32_t k = 0 ; k < 1000 ; k++)
+		checkerror(table.AddElement(k, ElementFor(k)));
+
+	// Deleting the current element makes the element that took its place the
+	// current one, which hasn't been visited yet
+	set<uint32_t> visited;
+
+	table.GotoFirstElement();
+	while (table.HasCurrentElement())
+	{
+		uint32_t k = table.GetCurrentKey();
+
+		check(visited.insert(k).second, "delete during iteration: key visited twice");
+		if (k%3 == 0)
+			checkerror(table.DeleteCurrentElement());
+		else
+		{
+			expected[k] = ElementFor(k);
+			table.GotoNextElement();
+		}
+	}
+	check(visited.size() == 1000, "delete during iteration: not all keys visited");
+	check(table.DeleteCurrentElement() == ERR_RTP_KEYHASHTABLE_NOCURRENTELEMENT, "delete without current element");
+
+	CheckContents(table, expected, "delete during iteration");
+
+	// Deleting the last element ends the iteration
+	table.GotoLastElement();
+	expected.erase(table.GetCurrentKey());
+	checkerror(table.DeleteCurrentElement());
+	check(!table.HasCurrentElement(), "deleting the last element");
+	CheckContents(table, expected, "delete last element");
+}
+
+void TestBackwardShiftDelete()
+{
+	// All keys end up in a few long probe sequences, so deleting from the middle
+	// of such a sequence has to move the following entries back
+	CollidingTable table;
+	map<uint32_t,string> expected;
+
+	for (uint32_t k = 0 ; k < 200 ; k++)
+	{
+		checkerror(table.AddElement(k, ElementFor(k)));
+		expected[k] = ElementFor(k);
+	}
+
+	for (uint32_t k = 1 ; k < 200 ; k += 4)
+	{
+		checkerror(table.DeleteElement(k));
+		expected.erase(k);
+		check(table.DeleteElement(k) == ERR_RTP_KEYHASHTABLE_KEYNOTFOUND, "deleting a key twice");
+	}
+	CheckContents(table, expected, "backward shift delete");
+
+	// Reuse the freed slots
+	for (uint32_t k = 1 ; k < 200 ; k += 4)
+	{
+		checkerror(table.AddElement(k+1000, ElementFor(k+1000)));
+		expected[k+1000] = ElementFor(k+1000);
+	}
+	CheckContents(table, expected, "add after backward shift delete");
+
+	// Pseudo random additions and deletions, compared to a map
+	uint32_t state = 12345;
+
+	for (int i = 0 ; i < 20000 ; i++)
+	{
+		state = state*1103515245U + 12345U;
+
+		uint32_t k = (state >> 8)%500;
+
+		if (expected.find(k) == expected.end())
+		{
+			checkerror(table.AddElement(k, ElementFor(k)));
+			expected[k] = ElementFor(k);
+		}
+		else
+		{
+			checkerror(table.DeleteElement(k));
+			expected.erase(k);
+		}
+	}
+	CheckContents(table, expected, "random additions and deletions");
+}
+
+void TestFlatHashTable()
+{
+	RTPFlatHashTable<const uint32_t,CollidingHash> table;
+	set<uint32_t> expected;
+
+	for (uint32_t k = 0 ; k < 100 ; k++)
+	{
+		checkerror(table.AddElement(k));
+		expected.insert(k);
+	}
+	check(table.AddElement(5) == ERR_RTP_HASHTABLE_ELEMENTALREADYEXISTS, "set: adding an element twice");
+
+	for (uint32_t k = 0 ; k < 100 ; k += 2)
+	{
+		checkerror(table.DeleteElement(k));
+		expected.erase(k);
+	}
+	check(table.DeleteElement(0) == ERR_RTP_HASHTABLE_ELEMENTNOTFOUND, "set: deleting an element twice");
+	check(table.GotoElement(0) == ERR_RTP_HASHTABLE_ELEMENTNOTFOUND, "set: lookup of deleted element");
+
+	check(table.GetNumberOfElements() == expected.size(), "set: number of elements");
+	for (uint32_t k = 0 ; k < 100 ; k++)
+		check(table.HasElement(k) == (expected.find(k) != expected.end()), "set: lookup");
+
+	size_t num = 0;
+
+	table.GotoFirstElement();
+	while (table.HasCurrentElement())
+	{
+		check(table.GetCurrentElement() == table.GetElementAt(table.GetCurrentPosition()), "set: element position");
+		check(expected.find(table.GetCurrentElement()) != expected.end(), "set: unexpected element");
+		if (table.GetCurrentElement()%5 == 0)
+		{
+			expected.erase(table.GetCurrentElement());
+			checkerror(table.DeleteCurrentElement());
+		}
+		else
+			table.GotoNextElement();
+		num++;
+	}
+	check(num == 50, "set: delete during iteration");
+	check(table.GetNumberOfElements() == expected.size(), "set: number of elements after deleting");
+	check(table.DeleteCurrentElement() == ERR_RTP_HASHTABLE_NOCURRENTELEMENT, "set: delete without current element");
+}
+
+int main(void)
+{
+	TestAddAndGrow();
+	TestDeleteDuringIteration();
+	TestBackwardShiftDelete();
+	TestFlatHashTable();
+
+	cout << (ok?"OK":"FAILED") << endl;
+	return (ok)?0:-1;
+}
@@ -0,0 +1,200 @@
+#include "rtpconfig.h"
+#include "rtpreactor.h"
+#include "rtpsession.h"
+#include "rtpsessionparams.h"
+#include "rtpudpv4transmitter.h"
+#include "rtpipv4address.h"
+#include "rtperrors.h"
+#include "rtptimeutilities.h"
+#include <stdlib.h>
+#include <iostream>
+
+using namespace std;
+using namespace jrtplib;
+
+#if defined(RTP_SUPPORT_THREAD) && defined(RTP_HAVE_EPOLL)
+
+#include <jthread/jmutex.h>
+
+using namespace jthread;
+
+#define NUMSESSIONS			4
+#define NUMPACKETS			50
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		cerr << "ERROR: " << RTPGetErrorString(rtperr) << endl;
+		exit(-1);
+	}
+}
+
+// Counts the packets it receives, and removes itself from the reactor
+// from within a callback once it has received enough of them if requested
+
+class MyRTPSession : public RTPSession
+{
+public:
+	MyRTPSession() : m_pReactor(0), m_removeAfter(0), m_removeStatus(1), m_numPackets(0), m_numSteps(0)
+	{
+		m_mutex.Init();
+	}
+
+	void SetRemoveFromReactor(RTPReactor *pReactor, int numPackets)
+	{
+		m_pReactor = pReactor;
+		m_removeAfter = numPackets;
+	}
+
+	int GetNumberOfPackets()			{ m_mutex.Lock(); int num = m_numPackets; m_mutex.Unlock(); return num; }
+	int GetNumberOfSteps()				{ m_mutex.Lock(); int num = m_numSteps; m_mutex.Unlock(); return num; }
+	int GetRemoveStatus()				{ m_mutex.Lock(); int status = m_removeStatus; m_mutex.Unlock(); return status; }
+protected:
+	void OnRTPPacket(RTPPacket *pack, const RTPTime &receivetime, const RTPAddress *senderaddress)
+	{
+		m_mutex.Lock();
+		m_numPackets++;
+		m_mutex.Unlock();
+	}
+
+	void OnPollThreadStep()
+	{
+		m_mutex.Lock();
+		m_numSteps++;
+		bool remove = (m_pReactor != 0 && m_removeStatus > 0 && m_numPackets >= m_removeAfter);
+		m_mutex.Unlock();
+
+		if (remove)
+		{
+			// Runs on the worker thread that's polling this session
+			int status = m_pReactor->RemoveSession(*this);
+
+			m_mutex.Lock();
+			m_removeStatus = status;
+			m_mutex.Unlock();
+		}
+	}
+
+	void OnPollThreadError(int errcode)
+	{
+		cerr << "Poll error: " << RTPGetErrorString(errcode) << endl;
+	}
+private:
+	JMutex m_mutex;
+	RTPReactor *m_pReactor;
+	int m_removeAfter;
+	int m_removeStatus;
+	int m_numPackets;
+	int m_numSteps;
+};
+
+int main(void)
+{
+	RTPReactor reactor;
+	MyRTPSession sessions[NUMSESSIONS];
+	int status, i;
+	bool ok = true;
+
+	checkerror(reactor.Start(2, RTPTime(0,5000)));
+
+	for (i = 0 ; i < NUMSESSIONS ; i++)
+	{
+		RTPUDPv4TransmissionParams transparams;
+		RTPSessionParams sessparams;
+
+		sessparams.SetOwnTimestampUnit(1.0/8000.0);
+		sessparams.SetAcceptOwnPackets(true);
+		sessparams.SetUsePollThread(false); // the reactor polls the session
+		sessparams.SetNeedThreadSafety(true);
+		sessparams.SetCNAME(std::string("reactortest"));
+		transparams.SetPortbase(0); // let the OS choose the ports
+		if (i == 0)
+			transparams.SetRTCPMultiplexing(true);
+
+		checkerror(sessions[i].Create(sessparams, &transparams));
+
+		// Each session sends its packets to itself
+		RTPUDPv4TransmissionInfo *inf = static_cast<RTPUDPv4TransmissionInfo *>(sessions[i].GetTransmissionInfo());
+		RTPIPv4Address addr(0x7f000001, inf->GetRTPPort(), inf->GetRTCPPort());
+		sessions[i].DeleteTransmissionInfo(inf);
+
+		checkerror(sessions[i].AddDestination(addr));
+		checkerror(reactor.AddSession(sessions[i]));
+	}
+
+	status = reactor.AddSession(sessions[0]);
+	cout << "Adding a session twice: " << RTPGetErrorString(status) << endl;
+	if (status != ERR_RTP_REACTOR_SESSIONALREADYADDED)
+		ok = false;
+
+	// The last session removes itself from a callback after half of the packets
+	sessions[NUMSESSIONS-1].SetRemoveFromReactor(&reactor, NUMPACKETS/2);
+
+	for (int k = 0 ; k < NUMPACKETS ; k++)
+	{
+		for (i = 0 ; i < NUMSESSIONS ; i++)
+			checkerror(sessions[i].SendPacket((void *)"1234567890", 10, 0, false, 160));
+		RTPTime::Wait(RTPTime(0,10000));
+	}
+	RTPTime::Wait(RTPTime(0,500000));
+
+	// Remove the second session from this thread
+	checkerror(reactor.RemoveSession(sessions[1]));
+	status = reactor.RemoveSession(sessions[1]);
+	cout << "Removing a session twice: " << RTPGetErrorString(status) << endl;
+	if (status != ERR_RTP_REACTOR_SESSIONNOTFOUND)
+		ok = false;
+
+	// The last session removed itself, calling this again waits until the
+	// worker is done with it
+	status = reactor.RemoveSession(sessions[NUMSESSIONS-1]);
+	cout << "Removal from within a callback: " << sessions[NUMSESSIONS-1].GetRemoveStatus() << ", after that: " << status << endl;
+	if (sessions[NUMSESSIONS-1].GetRemoveStatus() != 0 || !(status == 0 || status == ERR_RTP_REACTOR_SESSIONNOTFOUND))
+		ok = false;
+
+	cout << "Sessions left in reactor: " << reactor.GetNumberOfSessions() << endl;
+	if (reactor.GetNumberOfSessions() != NUMSESSIONS-2)
+		ok = false;
+
+	for (i = 0 ; i < NUMSESSIONS ; i++)
+	{
+		cout << "Session " << i << ": received " << sessions[i].GetNumberOfPackets() << " packets in "
+		     << sessions[i].GetNumberOfSteps() << " poll steps" << endl;
+		if (i != NUMSESSIONS-1 && sessions[i].GetNumberOfPackets() != NUMPACKETS)
+			ok = false;
+	}
+
+	// Removed sessions are no longer polled
+	int numremoved = sessions[1].GetNumberOfSteps();
+	int numself = sessions[NUMSESSIONS-1].GetNumberOfSteps();
+
+	for (i = 0 ; i < NUMSESSIONS ; i++)
+		checkerror(sessions[i].SendPacket((void *)"1234567890", 10, 0, false, 160));
+	RTPTime::Wait(RTPTime(0,200000));
+	if (sessions[1].GetNumberOfSteps() != numremoved || sessions[NUMSESSIONS-1].GetNumberOfSteps() != numself)
+	{
+		cout << "A removed session was still polled" << endl;
+		ok = false;
+	}
+
+	// Stopping the reactor removes the remaining sessions
+	reactor.Stop();
+	cout << "Sessions left after stopping: " << reactor.GetNumberOfSessions() << endl;
+
+	for (i = 0 ; i < NUMSESSIONS ; i++)
+		sessions[i].BYEDestroy(RTPTime(1,0), 0, 0);
+
+	cout << (ok?"OK":"FAILED") << endl;
+	return (ok)?0:-1;
+}
+
+#else
+
+int main(void)
+{
+	cerr << "Thread and epoll support are needed for this test" << endl;
+	return 0;
+}
+
+#endif // RTP_SUPPORT_THREAD && RTP_HAVE_EPOLL
@@ -0,0 +1,317 @@
+#include "rtpconfig.h"
+#include "rtpsources.h"
+#include "rtpsourcedata.h"
+#include "rtppacket.h"
+#include "rtppacketbuilder.h"
+#include "rtcppacketbuilder.h"
+#include "rtcpcompoundpacket.h"
+#include "rtcpsrpacket.h"
+#include "rtcprrpacket.h"
+#include "rtcpsdespacket.h"
+#include "rtprawpacket.h"
+#include "rtpipv4address.h"
+#include "rtprandomrand48.h"
+#include "rtptimeutilities.h"
+#include "rtperrors.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <set>
+#include <vector>
+#include <map>
+
+using namespace std;
+using namespace jrtplib;
+
+// Creates, times out and deletes sources, and checks for which of them report
+// blocks are added to the RTCP packets, and which sources are in the list of
+// sources that may need a report block
+
+#define FIRSTSENDER				0x1000
+#define FIRSTMEMBER				0x2000
+
+static bool ok = true;
+static map<uint32_t,uint16_t> seqnrs;
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		cerr << "ERROR: " << RTPGetErrorString(rtperr) << endl;
+		exit(-1);
+	}
+}
+
+string ToString(const set<uint32_t> &ssrcs)
+{
+	string s;
+
+	for (set<uint32_t>::const_iterator it = ssrcs.begin() ; it != ssrcs.end() ; ++it)
+	{
+		char str[16];
+
+		snprintf(str, sizeof(str), "%s0x%x", (it == ssrcs.begin())?"":" ", (unsigned int)*it);
+		s += str;
+	}
+	return "{" + s + "}";
+}
+
+void check(const set<uint32_t> &ssrcs, const set<uint32_t> &expected, const string &what)
+{
+	if (ssrcs != expected)
+	{
+		cerr << "FAILED: " << what << ": got " << ToString(ssrcs) << ", expected " << ToString(expected) << endl;
+		ok = false;
+	}
+}
+
+set<uint32_t> Range(uint32_t first, uint32_t num)
+{
+	set<uint32_t> ssrcs;
+
+	for (uint32_t i = 0 ; i < num ; i++)
+		ssrcs.insert(first+i);
+	return ssrcs;
+}
+
+// Lets the source table process an RTP packet from 'ssrc'
+void ReceiveRTP(RTPSources &sources, uint32_t ssrc)
+{
+	uint8_t payload[20];
+	uint16_t seqnr = seqnrs[ssrc]++;
+
+	memset(payload, 0, sizeof(payload));
+
+	RTPPacket pack(0, payload, sizeof(payload), seqnr, 160*(uint32_t)seqnr, ssrc, false, 0, 0, false, 0, 0, 0, 1500);
+	checkerror(pack.GetCreationError());
+
+	uint8_t *data = new uint8_t[pack.GetPacketLength()];
+
+	memcpy(data, pack.GetPacketData(), pack.GetPacketLength());
+
+	RTPTime receivetime = RTPTime::CurrentTime();
+	RTPRawPacket rawpack(data, pack.GetPacketLength(), new RTPIPv4Address(0x7f000001, (uint16_t)(5000+(ssrc&0xfff)*2)), receivetime, true);
+
+	checkerror(sources.ProcessRawPacket(&rawpack, (RTPTransmitter *)0, false));
+}
+
+void ReceiveRTP(RTPSources &sources, const set<uint32_t> &ssrcs)
+{
+	for (set<uint32_t>::const_iterator it = ssrcs.begin() ; it != ssrcs.end() ; ++it)
+		ReceiveRTP(sources, *it);
+}
+
+// A member that only sends RTCP
+void ReceiveSDES(RTPSources &sources, uint32_t ssrc)
+{
+	RTPIPv4Address addr(0x7f000001, (uint16_t)(5001+(ssrc&0xfff)*2));
+
+	checkerror(sources.ProcessSDESNormalItem(ssrc, RTCPSDESPacket::CNAME, 6, "member", RTPTime::CurrentTime(), &addr));
+}
+
+// Builds the next RTCP compound packet and returns the sources for which it
+// contains a report block; if 'order' is set, they're also appended to it in
+// the order of the report blocks
+set<uint32_t> BuildReportBlocks(RTCPPacketBuilder &builder, vector<uint32_t> *order = 0)
+{
+	RTCPCompoundPacket *compound;
+	RTCPPacket *pack;
+	set<uint32_t> ssrcs;
+
+	// Only RTP packets received after the previous RTCP packet cause a report block
+	RTPTime::Wait(RTPTime(0, 2000));
+
+	checkerror(builder.BuildNextPacket(&compound));
+	compound->GotoFirstPacket();
+	while ((pack = compound->GetNextPacket()) != 0)
+	{
+		int num = 0;
+
+		for (int i = 0 ; ; i++)
+		{
+			uint32_t ssrc;
+
+			if (pack->GetPacketType() == RTCPPacket::SR)
+			{
+				num = static_cast<RTCPSRPacket *>(pack)->GetReceptionReportCount();
+				if (i >= num)
+					break;
+				ssrc = static_cast<RTCPSRPacket *>(pack)->GetSSRC(i);
+			}
+			else if (pack->GetPacketType() == RTCPPacket::RR)
+			{
+				num = static_cast<RTCPRRPacket *>(pack)->GetReceptionReportCount();
+				if (i >= num)
+					break;
+				ssrc = static_cast<RTCPRRPacket *>(pack)->GetSSRC(i);
+			}
+			else
+				break;
+
+			if (order)
+				order->push_back(ssrc);
+			if (!ssrcs.insert(ssrc).second)
+			{
+				cerr << "FAILED: two report blocks for the same source in one compound packet" << endl;
+				ok = false;
+			}
+		}
+	}
+	delete compound;
+
+	RTPTime::Wait(RTPTime(0, 2000));
+	return ssrcs;
+}
+
+// Returns the sources in the report list, checking that the sources of the
+// table are in it only once
+set<uint32_t> GetReportSources(RTPSources &sources)
+{
+	set<uint32_t> ssrcs;
+
+	if (sources.GotoFirstReportSource())
+	{
+		do
+		{
+			RTPSourceData *srcdat = sources.GetCurrentReportSourceInfo();
+
+			if (!ssrcs.insert(srcdat->GetSSRC()).second)
+			{
+				cerr << "FAILED: source in the report list twice" << endl;
+				ok = false;
+			}
+			if (!sources.GotEntry(srcdat->GetSSRC()))
+			{
+				cerr << "FAILED: source in the report list isn't in the source table" << endl;
+				ok = false;
+			}
+		} while (sources.GotoNextReportSource());
+	}
+	return ssrcs;
+}
+
+int main(void)
+{
+	RTPSources sources(RTPSources::NoProbation);
+	RTPRandomRand48 rnd(1);
+	RTPPacketBuilder packetbuilder(rnd);
+	set<uint32_t> none;
+
+	checkerror(packetbuilder.Init(1400));
+	checkerror(sources.CreateOwnSSRC(packetbuilder.GetSSRC()));
+
+	RTCPPacketBuilder builder(sources, packetbuilder);
+
+	checkerror(builder.Init(65000, 1.0/8000.0, "reportsourcetest", 16));
+
+	// Members that only send RTCP never need a report block
+	for (uint32_t i = 0 ; i < 10 ; i++)
+		ReceiveSDES(sources, FIRSTMEMBER+i);
+	check(GetReportSources(sources), none, "report list with only RTCP members");
+
+	// Senders are added to the report list when their RTP data arrives
+	ReceiveRTP(sources, Range(FIRSTSENDER, 5));
+	check(GetReportSources(sources), Range(FIRSTSENDER, 5), "report list after RTP data");
+	check(BuildReportBlocks(builder), Range(FIRSTSENDER, 5), "report blocks for new senders");
+
+	// Without new RTP data, there are no report blocks, and the senders are
+	// dropped from the report list
+	check(BuildReportBlocks(builder), none, "report blocks without new RTP data");
+	check(GetReportSources(sources), none, "report list without new RTP data");
+
+	// Only the sources which sent RTP data since the previous RTCP packet are reported
+	set<uint32_t> active;
+
+	active.insert(FIRSTSENDER+1);
+	active.insert(FIRSTSENDER+3);
+	ReceiveRTP(sources, active);
+	check(GetReportSources(sources), active, "report list for some senders");
+	check(BuildReportBlocks(builder), active, "report blocks for some senders");
+
+	// Sources which time out are removed from the report list
+	set<uint32_t> remaining;
+
+	ReceiveRTP(sources, Range(FIRSTSENDER, 5));
+	RTPTime::Wait(RTPTime(0, 100000));
+	remaining.insert(FIRSTSENDER+4);
+	ReceiveRTP(sources, remaining);
+	sources.Timeout(RTPTime::CurrentTime(), RTPTime(0, 50000));
+	for (uint32_t i = 0 ; i < 4 ; i++)
+	{
+		if (sources.GotEntry(FIRSTSENDER+i))
+		{
+			cerr << "FAILED: source didn't time out" << endl;
+			ok = false;
+		}
+	}
+	check(GetReportSources(sources), remaining, "report list after timeout");
+	check(BuildReportBlocks(builder), remaining, "report blocks after timeout");
+
+	// A source which is deleted after a BYE packet leaves the report list as
+	// well, and is added again as a new source when it sends RTP data again
+	RTPIPv4Address byeaddr(0x7f000001, (uint16_t)(5001+((FIRSTSENDER+4)&0xfff)*2));
+
+	ReceiveRTP(sources, FIRSTSENDER+4);
+	checkerror(sources.ProcessBYE(FIRSTSENDER+4, 0, 0, RTPTime::CurrentTime(), &byeaddr));
+	RTPTime::Wait(RTPTime(0, 10000));
+	sources.BYETimeout(RTPTime::CurrentTime(), RTPTime(0, 5000));
+	if (sources.GotEntry(FIRSTSENDER+4))
+	{
+		cerr << "FAILED: source wasn't deleted after BYE" << endl;
+		ok = false;
+	}
+	check(GetReportSources(sources), none, "report list after BYE");
+	check(BuildReportBlocks(builder), none, "report blocks after BYE");
+
+	ReceiveRTP(sources, FIRSTSENDER+4);
+	check(GetReportSources(sources), remaining, "report list after sending again");
+	check(BuildReportBlocks(builder), remaining, "report blocks after sending again");
+
+	// When not all report blocks fit in one RTCP packet, the next packets
+	// continue with the sources that weren't reported yet; only when all of
+	// them have been reported, the first ones are reported again
+	RTPPacketBuilder smallpacketbuilder(rnd);
+
+	checkerror(smallpacketbuilder.Init(1400));
+
+	RTPSources smallsources(RTPSources::NoProbation);
+
+	checkerror(smallsources.CreateOwnSSRC(smallpacketbuilder.GetSSRC()));
+
+	RTCPPacketBuilder smallbuilder(smallsources, smallpacketbuilder);
+
+	checkerror(smallbuilder.Init(600, 1.0/8000.0, "reportsourcetest", 16));
+
+	set<uint32_t> senders = Range(FIRSTSENDER, 100);
+	vector<uint32_t> order;
+	int numbuilds = 0;
+
+	while (order.size() < 2*senders.size() && numbuilds < 50)
+	{
+		ReceiveRTP(smallsources, senders);
+
+		set<uint32_t> blocks = BuildReportBlocks(smallbuilder, &order);
+
+		if (blocks.empty() || blocks.size() == senders.size())
+		{
+			cerr << "FAILED: expected some, but not all report blocks to fit" << endl;
+			ok = false;
+			break;
+		}
+		numbuilds++;
+	}
+
+	// Each run of 100 report blocks must cover all senders
+	for (size_t start = 0 ; start+senders.size() <= order.size() ; start += senders.size())
+	{
+		set<uint32_t> reported(order.begin()+start, order.begin()+start+senders.size());
+
+		check(reported, senders, "report blocks in consecutive small packets");
+	}
+	cout << order.size() << " report blocks in " << numbuilds << " RTCP packets" << endl;
+
+	cout << (ok?"OK":"FAILED") << endl;
+	return (ok)?0:-1;
+}
@@ -0,0 +1,398 @@
+#include "rtpconfig.h"
+#include "rtcpcompoundpacketbuilder.h"
+#include "rtcpsdespacket.h"
+#include "rtptimeutilities.h"
+#include "rtperrors.h"
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace jrtplib;
+
+// Builds a number of RTCP compound packets and compares them to the packets
+// that were produced by earlier versions of the builder
+
+static bool ok = true;
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		cerr << "ERROR: " << RTPGetErrorString(rtperr) << endl;
+		exit(-1);
+	}
+}
+
+void compare(RTCPCompoundPacketBuilder &builder, const uint8_t *expected, size_t expectedlen, const string &what)
+{
+	size_t len = builder.GetCompoundPacketLength();
+
+	if (len != expectedlen)
+	{
+		cerr << "FAILED: " << what << ": length is " << len << " instead of " << expectedlen << endl;
+		ok = false;
+		return;
+	}
+	for (size_t i = 0 ; i < len ; i++)
+	{
+		if (builder.GetCompoundPacketData()[i] != expected[i])
+		{
+			cerr << "FAILED: " << what << ": difference at byte " << i << endl;
+			ok = false;
+			return;
+		}
+	}
+	cout << what << ": " << len << " bytes OK" << endl;
+}
+
+// Expected results, as produced by the builder before it wrote the packets
+// directly into their final buffer
+
+static const uint8_t senderreport[152] =
+{
+	0x82, 0xc8, 0x00, 0x12, 0x11, 0x22, 0x33, 0x44, 0x01, 0x02, 0x03, 0x04,
+	0x05, 0x06, 0x07, 0x08, 0x0a, 0x0b, 0x0c, 0x0d, 0x00, 0x00, 0x00, 0x64,
+	0x00, 0x00, 0x3e, 0x80, 0xaa, 0xbb, 0xcc, 0xdd, 0x19, 0x00, 0x00, 0x03,
+	0x00, 0x01, 0x10, 0x00, 0x00, 0x00, 0x00, 0x28, 0x12, 0x34, 0x56, 0x78,
+	0x00, 0x01, 0x00, 0x00, 0x55, 0x66, 0x77, 0x88, 0x00, 0xff, 0xff, 0xfb,
+	0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x81, 0xca, 0x00, 0x08, 0x11, 0x22, 0x33, 0x44,
+	0x01, 0x09, 0x75, 0x73, 0x65, 0x72, 0x40, 0x68, 0x6f, 0x73, 0x74, 0x02,
+	0x04, 0x54, 0x65, 0x73, 0x74, 0x06, 0x07, 0x6a, 0x72, 0x74, 0x70, 0x6c,
+	0x69, 0x62, 0x00, 0x00, 0x83, 0xcc, 0x00, 0x04, 0x11, 0x22, 0x33, 0x44,
+	0x54, 0x45, 0x53, 0x54, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+	0x82, 0xcb, 0x00, 0x04, 0x11, 0x22, 0x33, 0x44, 0xaa, 0xbb, 0xcc, 0xdd,
+	0x07, 0x6c, 0x65, 0x61, 0x76, 0x69, 0x6e, 0x67
+};
+
+static const uint8_t minimalreport[20] =
+{
+	0x80, 0xc9, 0x00, 0x01, 0x01, 0x02, 0x03, 0x04, 0x81, 0xca, 0x00, 0x02,
+	0x01, 0x02, 0x03, 0x04, 0x01, 0x01, 0x61, 0x00
+};
+
+static const uint8_t largereport[856] =
+{
+	0x9f, 0xc9, 0x00, 0xbb, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0x10, 0x00,
+	0x00, 0xff, 0xff, 0xf0, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x01,
+	0x01, 0xff, 0xff, 0xf1, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x05,
+	0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x10, 0x02,
+	0x02, 0xff, 0xff, 0xf2, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00, 0x00, 0x0a,
+	0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x10, 0x03,
+	0x03, 0xff, 0xff, 0xf3, 0x00, 0x01, 0x00, 0x09, 0x00, 0x00, 0x00, 0x0f,
+	0x00, 0x00, 0x00, 0x15, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x10, 0x04,
+	0x04, 0xff, 0xff, 0xf4, 0x00, 0x01, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x14,
+	0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x10, 0x05,
+	0x05, 0xff, 0xff, 0xf5, 0x00, 0x01, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x19,
+	0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x00, 0x37, 0x00, 0x00, 0x10, 0x06,
+	0x06, 0xff, 0xff, 0xf6, 0x00, 0x01, 0x00, 0x12, 0x00, 0x00, 0x00, 0x1e,
+	0x00, 0x00, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x42, 0x00, 0x00, 0x10, 0x07,
+	0x07, 0xff, 0xff, 0xf7, 0x00, 0x01, 0x00, 0x15, 0x00, 0x00, 0x00, 0x23,
+	0x00, 0x00, 0x00, 0x31, 0x00, 0x00, 0x00, 0x4d, 0x00, 0x00, 0x10, 0x08,
+	0x08, 0xff, 0xff, 0xf8, 0x00, 0x01, 0x00, 0x18, 0x00, 0x00, 0x00, 0x28,
+	0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x10, 0x09,
+	0x09, 0xff, 0xff, 0xf9, 0x00, 0x01, 0x00, 0x1b, 0x00, 0x00, 0x00, 0x2d,
+	0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x63, 0x00, 0x00, 0x10, 0x0a,
+	0x0a, 0xff, 0xff, 0xfa, 0x00, 0x01, 0x00, 0x1e, 0x00, 0x00, 0x00, 0x32,
+	0x00, 0x00, 0x00, 0x46, 0x00, 0x00, 0x00, 0x6e, 0x00, 0x00, 0x10, 0x0b,
+	0x0b, 0xff, 0xff, 0xfb, 0x00, 0x01, 0x00, 0x21, 0x00, 0x00, 0x00, 0x37,
+	0x00, 0x00, 0x00, 0x4d, 0x00, 0x00, 0x00, 0x79, 0x00, 0x00, 0x10, 0x0c,
+	0x0c, 0xff, 0xff, 0xfc, 0x00, 0x01, 0x00, 0x24, 0x00, 0x00, 0x00, 0x3c,
+	0x00, 0x00, 0x00, 0x54, 0x00, 0x00, 0x00, 0x84, 0x00, 0x00, 0x10, 0x0d,
+	0x0d, 0xff, 0xff, 0xfd, 0x00, 0x01, 0x00, 0x27, 0x00, 0x00, 0x00, 0x41,
+	0x00, 0x00, 0x00, 0x5b, 0x00, 0x00, 0x00, 0x8f, 0x00, 0x00, 0x10, 0x0e,
+	0x0e, 0xff, 0xff, 0xfe, 0x00, 0x01, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x46,
+	0x00, 0x00, 0x00, 0x62, 0x00, 0x00, 0x00, 0x9a, 0x00, 0x00, 0x10, 0x0f,
+	0x0f, 0xff, 0xff, 0xff, 0x00, 0x01, 0x00, 0x2d, 0x00, 0x00, 0x00, 0x4b,
+	0x00, 0x00, 0x00, 0x69, 0x00, 0x00, 0x00, 0xa5, 0x00, 0x00, 0x10, 0x10,
+	0x10, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x30, 0x00, 0x00, 0x00, 0x50,
+	0x00, 0x00, 0x00, 0x70, 0x00, 0x00, 0x00, 0xb0, 0x00, 0x00, 0x10, 0x11,
+	0x11, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x33, 0x00, 0x00, 0x00, 0x55,
+	0x00, 0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0xbb, 0x00, 0x00, 0x10, 0x12,
+	0x12, 0x00, 0x00, 0x02, 0x00, 0x01, 0x00, 0x36, 0x00, 0x00, 0x00, 0x5a,
+	0x00, 0x00, 0x00, 0x7e, 0x00, 0x00, 0x00, 0xc6, 0x00, 0x00, 0x10, 0x13,
+	0x13, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x39, 0x00, 0x00, 0x00, 0x5f,
+	0x00, 0x00, 0x00, 0x85, 0x00, 0x00, 0x00, 0xd1, 0x00, 0x00, 0x10, 0x14,
+	0x14, 0x00, 0x00, 0x04, 0x00, 0x01, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x64,
+	0x00, 0x00, 0x00, 0x8c, 0x00, 0x00, 0x00, 0xdc, 0x00, 0x00, 0x10, 0x15,
+	0x15, 0x00, 0x00, 0x05, 0x00, 0x01, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x69,
+	0x00, 0x00, 0x00, 0x93, 0x00, 0x00, 0x00, 0xe7, 0x00, 0x00, 0x10, 0x16,
+	0x16, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x42, 0x00, 0x00, 0x00, 0x6e,
+	0x00, 0x00, 0x00, 0x9a, 0x00, 0x00, 0x00, 0xf2, 0x00, 0x00, 0x10, 0x17,
+	0x17, 0x00, 0x00, 0x07, 0x00, 0x01, 0x00, 0x45, 0x00, 0x00, 0x00, 0x73,
+	0x00, 0x00, 0x00, 0xa1, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x00, 0x10, 0x18,
+	0x18, 0x00, 0x00, 0x08, 0x00, 0x01, 0x00, 0x48, 0x00, 0x00, 0x00, 0x78,
+	0x00, 0x00, 0x00, 0xa8, 0x00, 0x00, 0x01, 0x08, 0x00, 0x00, 0x10, 0x19,
+	0x19, 0x00, 0x00, 0x09, 0x00, 0x01, 0x00, 0x4b, 0x00, 0x00, 0x00, 0x7d,
+	0x00, 0x00, 0x00, 0xaf, 0x00, 0x00, 0x01, 0x13, 0x00, 0x00, 0x10, 0x1a,
+	0x1a, 0x00, 0x00, 0x0a, 0x00, 0x01, 0x00, 0x4e, 0x00, 0x00, 0x00, 0x82,
+	0x00, 0x00, 0x00, 0xb6, 0x00, 0x00, 0x01, 0x1e, 0x00, 0x00, 0x10, 0x1b,
+	0x1b, 0x00, 0x00, 0x0b, 0x00, 0x01, 0x00, 0x51, 0x00, 0x00, 0x00, 0x87,
+	0x00, 0x00, 0x00, 0xbd, 0x00, 0x00, 0x01, 0x29, 0x00, 0x00, 0x10, 0x1c,
+	0x1c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x54, 0x00, 0x00, 0x00, 0x8c,
+	0x00, 0x00, 0x00, 0xc4, 0x00, 0x00, 0x01, 0x34, 0x00, 0x00, 0x10, 0x1d,
+	0x1d, 0x00, 0x00, 0x0d, 0x00, 0x01, 0x00, 0x57, 0x00, 0x00, 0x00, 0x91,
+	0x00, 0x00, 0x00, 0xcb, 0x00, 0x00, 0x01, 0x3f, 0x00, 0x00, 0x10, 0x1e,
+	0x1e, 0x00, 0x00, 0x0e, 0x00, 0x01, 0x00, 0x5a, 0x00, 0x00, 0x00, 0x96,
+	0x00, 0x00, 0x00, 0xd2, 0x00, 0x00, 0x01, 0x4a, 0x82, 0xc9, 0x00, 0x0d,
+	0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0x10, 0x1f, 0x1f, 0x00, 0x00, 0x0f,
+	0x00, 0x01, 0x00, 0x5d, 0x00, 0x00, 0x00, 0x9b, 0x00, 0x00, 0x00, 0xd9,
+	0x00, 0x00, 0x01, 0x55, 0x00, 0x00, 0x10, 0x20, 0x20, 0x00, 0x00, 0x10,
+	0x00, 0x01, 0x00, 0x60, 0x00, 0x00, 0x00, 0xa0, 0x00, 0x00, 0x00, 0xe0,
+	0x00, 0x00, 0x01, 0x60, 0x83, 0xca, 0x00, 0x09, 0x00, 0x00, 0x20, 0x00,
+	0x01, 0x01, 0x78, 0x00, 0x00, 0x00, 0x20, 0x01, 0x01, 0x02, 0x78, 0x79,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x02, 0x01, 0x03, 0x78, 0x79,
+	0x7a, 0x07, 0x04, 0x6e, 0x6f, 0x74, 0x65, 0x00, 0x81, 0xcb, 0x00, 0x01,
+	0x01, 0x02, 0x03, 0x04
+};
+
+static const uint8_t limitedreport[580] =
+{
+	0x97, 0xc9, 0x00, 0x8b, 0x01, 0x02, 0x03, 0x04, 0x00, 0x00, 0x30, 0x00,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x01,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x02,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x03,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x04,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x05,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x06,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x07,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x08,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x09,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0a,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0b,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0c,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0d,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0e,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x0f,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x10,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x11,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x12,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x13,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x14,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x15,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x30, 0x16,
+	0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x81, 0xca, 0x00, 0x04,
+	0x01, 0x02, 0x03, 0x04, 0x01, 0x07, 0x6c, 0x69, 0x6d, 0x69, 0x74, 0x65,
+	0x64, 0x00, 0x00, 0x00
+};
+
+#ifdef RTP_SUPPORT_SDESPRIV
+static const uint8_t privateitems[44] =
+{
+	0x80, 0xc9, 0x00, 0x01, 0x01, 0x02, 0x03, 0x04, 0x81, 0xca, 0x00, 0x08,
+	0x01, 0x02, 0x03, 0x04, 0x01, 0x04, 0x70, 0x72, 0x69, 0x76, 0x08, 0x0c,
+	0x06, 0x70, 0x72, 0x65, 0x66, 0x69, 0x78, 0x76, 0x61, 0x6c, 0x75, 0x65,
+	0x08, 0x02, 0x01, 0x70, 0x00, 0x00, 0x00, 0x00
+};
+#endif // RTP_SUPPORT_SDESPRIV
+
+// Sender report with report blocks, SDES, APP and BYE packets
+int BuildSenderReport(RTCPCompoundPacketBuilder &builder)
+{
+	int status;
+	const uint8_t name[4] = { 'T', 'E', 'S', 'T' };
+	const uint8_t appdata[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint32_t byessrcs[2] = { 0x11223344, 0xaabbccdd };
+
+	if ((status = builder.StartSenderReport(0x11223344, RTPNTPTime(0x01020304, 0x05060708), 0x0a0b0c0d, 100, 16000)) < 0)
+		return status;
+	if ((status = builder.AddReportBlock(0xaabbccdd, 25, 3, 0x00011000, 40, 0x12345678, 0x00010000)) < 0)
+		return status;
+	if ((status = builder.AddReportBlock(0x55667788, 0, -5, 0x0000ffff, 0, 0, 0)) < 0)
+		return status;
+	if ((status = builder.AddSDESSource(0x11223344)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, "user@host", 9)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::NAME, "Test", 4)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::TOOL, "jrtplib", 7)) < 0)
+		return status;
+	if ((status = builder.AddAPPPacket(3, 0x11223344, name, appdata, 8)) < 0)
+		return status;
+	if ((status = builder.AddBYEPacket(byessrcs, 2, "leaving", 7)) < 0)
+		return status;
+	return builder.EndBuild();
+}
+
+// The smallest useful compound packet: an empty receiver report and a CNAME
+int BuildMinimalReceiverReport(RTCPCompoundPacketBuilder &builder)
+{
+	int status;
+
+	if ((status = builder.StartReceiverReport(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESSource(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, "a", 1)) < 0)
+		return status;
+	return builder.EndBuild();
+}
+
+// More than 31 report blocks, so a second receiver report is needed, several
+// SDES chunks and a BYE packet without a reason
+int BuildLargeReceiverReport(RTCPCompoundPacketBuilder &builder)
+{
+	int status;
+	uint32_t byessrc = 0x01020304;
+
+	if ((status = builder.StartReceiverReport(0x01020304)) < 0)
+		return status;
+	for (uint32_t i = 0 ; i < 33 ; i++)
+	{
+		if ((status = builder.AddReportBlock(0x1000+i, (uint8_t)i, (int32_t)i-16, 0x10000+i*3, i*5, i*7, i*11)) < 0)
+			return status;
+	}
+	for (uint32_t i = 0 ; i < 3 ; i++)
+	{
+		char cname[16];
+
+		for (uint32_t j = 0 ; j <= i ; j++)
+			cname[j] = (char)('x'+j);
+		if ((status = builder.AddSDESSource(0x2000+i)) < 0)
+			return status;
+		if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, cname, (uint8_t)(i+1))) < 0)
+			return status;
+	}
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::NOTE, "note", 4)) < 0)
+		return status;
+	if ((status = builder.AddBYEPacket(&byessrc, 1, 0, 0)) < 0)
+		return status;
+	return builder.EndBuild();
+}
+
+// Report blocks are added until the maximum size of the packet is reached
+int BuildSizeLimitedReport(RTCPCompoundPacketBuilder &builder, int *numblocks)
+{
+	int status;
+
+	*numblocks = 0;
+	if ((status = builder.StartReceiverReport(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESSource(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, "limited", 7)) < 0)
+		return status;
+	while ((status = builder.AddReportBlock(0x3000+*numblocks, 1, 2, 3, 4, 5, 6)) >= 0)
+		(*numblocks)++;
+	if (status != ERR_RTP_RTCPCOMPPACKBUILDER_NOTENOUGHBYTESLEFT)
+		return status;
+	return builder.EndBuild();
+}
+
+#ifdef RTP_SUPPORT_SDESPRIV
+// SDES private items
+int BuildPrivateItems(RTCPCompoundPacketBuilder &builder)
+{
+	int status;
+
+	if ((status = builder.StartReceiverReport(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESSource(0x01020304)) < 0)
+		return status;
+	if ((status = builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, "priv", 4)) < 0)
+		return status;
+	if ((status = builder.AddSDESPrivateItem("prefix", 6, "value", 5)) < 0)
+		return status;
+	if ((status = builder.AddSDESPrivateItem("p", 1, 0, 0)) < 0)
+		return status;
+	return builder.EndBuild();
+}
+#endif // RTP_SUPPORT_SDESPRIV
+
+#define MAXPACKETSIZE 1400
+#define LIMITEDPACKETSIZE 600
+
+// Runs all builds using 'builder', which is cleared in between so that its
+// buffer gets reused; if 'external' is set, the packets are built in that buffer
+void BuildAll(RTCPCompoundPacketBuilder &builder, uint8_t *external, const string &what)
+{
+	int numblocks;
+
+	builder.ClearBuild();
+	checkerror((external)?builder.InitBuild(external, MAXPACKETSIZE):builder.InitBuild(MAXPACKETSIZE));
+	checkerror(BuildSenderReport(builder));
+	compare(builder, senderreport, sizeof(senderreport), what + "sender report");
+
+	builder.ClearBuild();
+	checkerror((external)?builder.InitBuild(external, MAXPACKETSIZE):builder.InitBuild(MAXPACKETSIZE));
+	checkerror(BuildMinimalReceiverReport(builder));
+	compare(builder, minimalreport, sizeof(minimalreport), what + "minimal receiver report");
+
+	builder.ClearBuild();
+	checkerror((external)?builder.InitBuild(external, MAXPACKETSIZE):builder.InitBuild(MAXPACKETSIZE));
+	checkerror(BuildLargeReceiverReport(builder));
+	compare(builder, largereport, sizeof(largereport), what + "large receiver report");
+
+	builder.ClearBuild();
+	checkerror((external)?builder.InitBuild(external, LIMITEDPACKETSIZE):builder.InitBuild(LIMITEDPACKETSIZE));
+	checkerror(BuildSizeLimitedReport(builder, &numblocks));
+	if (numblocks != 23)
+	{
+		cerr << "FAILED: " << what << "size limited report: " << numblocks << " report blocks instead of 23" << endl;
+		ok = false;
+	}
+	compare(builder, limitedreport, sizeof(limitedreport), what + "size limited report");
+
+#ifdef RTP_SUPPORT_SDESPRIV
+	builder.ClearBuild();
+	checkerror((external)?builder.InitBuild(external, MAXPACKETSIZE):builder.InitBuild(MAXPACKETSIZE));
+	checkerror(BuildPrivateItems(builder));
+	compare(builder, privateitems, sizeof(privateitems), what + "private items");
+#endif // RTP_SUPPORT_SDESPRIV
+}
+
+int main(void)
+{
+	uint8_t external[MAXPACKETSIZE];
+
+	// A new builder for each packet
+	{
+		RTCPCompoundPacketBuilder builder;
+		BuildAll(builder, 0, "");
+	}
+
+	// The same builder for all packets, twice, reusing its buffer
+	{
+		RTCPCompoundPacketBuilder builder;
+		BuildAll(builder, 0, "reused builder, ");
+		BuildAll(builder, 0, "reused builder, second time, ");
+	}
+
+	// Building into an external buffer
+	{
+		RTCPCompoundPacketBuilder builder;
+
+		memset(external, 0xff, sizeof(external));
+		BuildAll(builder, external, "external buffer, ");
+	}
+
+	cout << (ok?"OK":"FAILED") << endl;
+	return (ok)?0:-1;
+}
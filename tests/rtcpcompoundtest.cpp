@@ -0,0 +1,261 @@
+#include "rtpconfig.h"
+#include "rtcpcompoundpacket.h"
+#include "rtcpcompoundpacketbuilder.h"
+#include "rtcpsrpacket.h"
+#include "rtcprrpacket.h"
+#include "rtcpsdespacket.h"
+#include "rtcpapppacket.h"
+#include "rtcpbyepacket.h"
+#include "rtptimeutilities.h"
+#include "rtperrors.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace jrtplib;
+
+// Parses RTCP compound packets which contain more individual packets than
+// fit in the views stored inside an RTCPCompoundPacket, and checks the type
+// and contents of each of them
+
+#define SENDERSSRC				0x11223344
+#define NUMREPORTBLOCKS			33 // more than fit in one SR packet
+#define NUMSDESCHUNKS			3
+
+static bool ok = true;
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		cerr << "ERROR: " << RTPGetErrorString(rtperr) << endl;
+		exit(-1);
+	}
+}
+
+void check(bool cond, const string &what)
+{
+	if (!cond)
+	{
+		cerr << "FAILED: " << what << endl;
+		ok = false;
+	}
+}
+
+template<class T>
+void CheckReportBlock(T *pack, int index, uint32_t block)
+{
+	check(pack->GetSSRC(index) == 0x1000+block, "report block SSRC");
+	check(pack->GetFractionLost(index) == (uint8_t)block, "report block fraction lost");
+	check(pack->GetLostPacketCount(index) == (int32_t)block-16, "report block lost packets");
+	check(pack->GetExtendedHighestSequenceNumber(index) == 0x10000+block, "report block sequence number");
+	check(pack->GetJitter(index) == block*5, "report block jitter");
+	check(pack->GetLSR(index) == block*7, "report block LSR");
+	check(pack->GetDLSR(index) == block*11, "report block DLSR");
+}
+
+void Build(RTCPCompoundPacketBuilder &builder, int numapp, int numbye)
+{
+	const uint8_t name[4] = { 'N', 'A', 'M', 'E' };
+	uint8_t appdata[32];
+	uint32_t byessrcs[8];
+
+	for (int i = 0 ; i < 32 ; i++)
+		appdata[i] = (uint8_t)i;
+	for (int i = 0 ; i < 8 ; i++)
+		byessrcs[i] = 0x4000+i;
+
+	checkerror(builder.InitBuild(65000));
+	checkerror(builder.StartSenderReport(SENDERSSRC, RTPNTPTime(1, 2), 3, 4, 5));
+	for (uint32_t i = 0 ; i < NUMREPORTBLOCKS ; i++)
+		checkerror(builder.AddReportBlock(0x1000+i, (uint8_t)i, (int32_t)i-16, 0x10000+i, i*5, i*7, i*11));
+	for (uint32_t i = 0 ; i < NUMSDESCHUNKS ; i++)
+	{
+		checkerror(builder.AddSDESSource(0x2000+i));
+		checkerror(builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, "cname", (uint8_t)(i+1)));
+	}
+	for (int i = 0 ; i < numapp ; i++)
+		checkerror(builder.AddAPPPacket((uint8_t)i%32, 0x3000+i, name, appdata, (i%8)*4));
+	for (int i = 0 ; i < numbye ; i++)
+		checkerror(builder.AddBYEPacket(byessrcs, (uint8_t)(i%8+1), "reason", (uint8_t)(i%7)));
+	checkerror(builder.EndBuild());
+}
+
+void CheckPackets(RTCPCompoundPacket &compound, int numapp, int numbye, const string &what)
+{
+	// SR, RR with the remaining report blocks, SDES, then the APP and BYE packets
+	vector<RTCPPacket::PacketType> expected;
+
+	expected.push_back(RTCPPacket::SR);
+	expected.push_back(RTCPPacket::RR);
+	expected.push_back(RTCPPacket::SDES);
+	for (int i = 0 ; i < numapp ; i++)
+		expected.push_back(RTCPPacket::APP);
+	for (int i = 0 ; i < numbye ; i++)
+		expected.push_back(RTCPPacket::BYE);
+
+	check(compound.GetCreationError() >= 0, what + ": creation error");
+	check(compound.GetPacketCount() == expected.size(), what + ": number of packets");
+
+	// The views must describe consecutive packets which cover the entire compound packet
+	const RTCPPacketView *view;
+	size_t index = 0, offset = 0;
+
+	compound.GotoFirstPacketView();
+	while ((view = compound.GetNextPacketView()) != 0)
+	{
+		check(index < expected.size() && view->GetPacketType() == expected[index], what + ": packet type of view");
+		check(view->GetPacketOffset() == offset, what + ": packet offset of view");
+		offset += view->GetPacketLength();
+		index++;
+	}
+	check(index == expected.size(), what + ": number of views");
+	check(offset == compound.GetCompoundPacketLength(), what + ": packet lengths of views");
+
+	vector<RTCPPacket *> packets;
+	RTCPPacket *pack;
+	int appindex = 0, byeindex = 0;
+
+	index = 0;
+	compound.GotoFirstPacket();
+	while ((pack = compound.GetNextPacket()) != 0)
+	{
+		packets.push_back(pack);
+		if (index >= expected.size() || pack->GetPacketType() != expected[index] || !pack->IsKnownFormat())
+		{
+			check(false, what + ": packet type");
+			index++;
+			continue;
+		}
+
+		if (pack->GetPacketType() == RTCPPacket::SR)
+		{
+			RTCPSRPacket *p = static_cast<RTCPSRPacket *>(pack);
+
+			check(p->GetSenderSSRC() == SENDERSSRC, what + ": SR sender SSRC");
+			check(p->GetNTPTimestamp().GetMSW() == 1 && p->GetNTPTimestamp().GetLSW() == 2, what + ": SR NTP timestamp");
+			check(p->GetRTPTimestamp() == 3 && p->GetSenderPacketCount() == 4 && p->GetSenderOctetCount() == 5, what + ": SR sender info");
+			check(p->GetReceptionReportCount() == 31, what + ": SR report count");
+			for (int i = 0 ; i < p->GetReceptionReportCount() ; i++)
+				CheckReportBlock(p, i, i);
+		}
+		else if (pack->GetPacketType() == RTCPPacket::RR)
+		{
+			RTCPRRPacket *p = static_cast<RTCPRRPacket *>(pack);
+
+			check(p->GetSenderSSRC() == SENDERSSRC, what + ": RR sender SSRC");
+			check(p->GetReceptionReportCount() == NUMREPORTBLOCKS-31, what + ": RR report count");
+			for (int i = 0 ; i < p->GetReceptionReportCount() ; i++)
+				CheckReportBlock(p, i, i+31);
+		}
+		else if (pack->GetPacketType() == RTCPPacket::SDES)
+		{
+			RTCPSDESPacket *p = static_cast<RTCPSDESPacket *>(pack);
+			uint32_t chunk = 0;
+
+			check(p->GetChunkCount() == NUMSDESCHUNKS, what + ": SDES chunk count");
+			if (p->GotoFirstChunk())
+			{
+				do
+				{
+					check(p->GetChunkSSRC() == 0x2000+chunk, what + ": SDES chunk SSRC");
+					check(p->GotoFirstItem() && p->GetItemType() == RTCPSDESPacket::CNAME, what + ": SDES item type");
+					check(p->GetItemLength() == chunk+1 && memcmp(p->GetItemData(), "cname", chunk+1) == 0, what + ": SDES item");
+					check(!p->GotoNextItem(), what + ": SDES item count");
+					chunk++;
+				} while (p->GotoNextChunk());
+			}
+			check(chunk == NUMSDESCHUNKS, what + ": SDES chunks");
+		}
+		else if (pack->GetPacketType() == RTCPPacket::APP)
+		{
+			RTCPAPPPacket *p = static_cast<RTCPAPPPacket *>(pack);
+			size_t len = (appindex%8)*4;
+
+			check(p->GetSubType() == appindex%32 && p->GetSSRC() == (uint32_t)(0x3000+appindex), what + ": APP header");
+			check(memcmp(p->GetName(), "NAME", 4) == 0, what + ": APP name");
+			check(p->GetAPPDataLength() == len, what + ": APP data length");
+			for (size_t i = 0 ; i < len && i < p->GetAPPDataLength() ; i++)
+				check(p->GetAPPData()[i] == i, what + ": APP data");
+			appindex++;
+		}
+		else if (pack->GetPacketType() == RTCPPacket::BYE)
+		{
+			RTCPBYEPacket *p = static_cast<RTCPBYEPacket *>(pack);
+			size_t reasonlen = byeindex%7;
+
+			check(p->GetSSRCCount() == byeindex%8+1, what + ": BYE SSRC count");
+			for (int i = 0 ; i < p->GetSSRCCount() ; i++)
+				check(p->GetSSRC(i) == (uint32_t)(0x4000+i), what + ": BYE SSRC");
+			check(p->GetReasonLength() == reasonlen, what + ": BYE reason length");
+			if (reasonlen > 0)
+				check(p->GetReasonData() != 0 && memcmp(p->GetReasonData(), "reason", reasonlen) == 0, what + ": BYE reason");
+			byeindex++;
+		}
+		index++;
+	}
+	check(index == expected.size(), what + ": number of packets iterated");
+	check(appindex == numapp && byeindex == numbye, what + ": number of APP and BYE packets");
+
+	// A second iteration returns the same instances
+	index = 0;
+	compound.GotoFirstPacket();
+	while ((pack = compound.GetNextPacket()) != 0)
+	{
+		check(index < packets.size() && pack == packets[index], what + ": second iteration");
+		index++;
+	}
+	check(index == packets.size(), what + ": number of packets in second iteration");
+}
+
+void Test(int numapp, int numbye)
+{
+	RTCPCompoundPacketBuilder builder;
+	char str[64];
+
+	snprintf(str, sizeof(str), "compound packet with %d packets", 3+numapp+numbye);
+
+	string what(str);
+
+	Build(builder, numapp, numbye);
+
+	// The builder describes its own packets as well
+	CheckPackets(builder, numapp, numbye, what + " (builder)");
+
+	// Parse a copy, which is deleted by the compound packet
+	size_t len = builder.GetCompoundPacketLength();
+	uint8_t *data = new uint8_t[len];
+
+	memcpy(data, builder.GetCompoundPacketData(), len);
+
+	RTCPCompoundPacket compound(data, len);
+
+	CheckPackets(compound, numapp, numbye, what);
+	if (ok)
+		cout << what << ": OK" << endl;
+}
+
+int main(void)
+{
+	Test(4, 3);		// just a few more than the inline views
+	Test(20, 30);	// the array of views needs to grow a few times
+	Test(0, 0);		// for comparison, fits in the inline views
+
+	// Truncating the last packet makes the entire compound packet invalid,
+	// also when the views had to be allocated
+	RTCPCompoundPacketBuilder builder;
+
+	Build(builder, 10, 10);
+
+	RTCPCompoundPacket compound(builder.GetCompoundPacketData(), builder.GetCompoundPacketLength()-4, false);
+
+	check(compound.GetCreationError() == ERR_RTP_RTCPCOMPOUND_INVALIDPACKET, "truncated compound packet");
+	check(compound.GetPacketCount() == 0, "packets in invalid compound packet");
+
+	cout << (ok?"OK":"FAILED") << endl;
+	return (ok)?0:-1;
+}
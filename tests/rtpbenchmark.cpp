@@ -0,0 +1,685 @@
+/*
+  Microbenchmarks for the packet processing hot paths.
+
+  Each benchmark runs its operation repeatedly for a short while and reports
+  the time per operation and the number of heap allocations per operation.
+  No network traffic is involved: received packets are constructed in memory
+  or injected into a session that uses the external transmitter.
+
+  Usage: rtpbenchmark [name ...]
+  Without arguments, all benchmarks are run.
+*/
+
+#include "rtpsession.h"
+#include "rtpsessionparams.h"
+#include "rtpexternaltransmitter.h"
+#include "rtpsources.h"
+#include "rtpkeyhashtable.h"
+#include "rtpflatkeyhashtable.h"
+#include "rtpsourcedata.h"
+#include "rtppacket.h"
+#include "rtppacketview.h"
+#include "rtppacketbuilder.h"
+#include "rtprawpacket.h"
+#include "rtcpcompoundpacket.h"
+#include "rtcpcompoundpacketbuilder.h"
+#include "rtcppacketbuilder.h"
+#include "rtpipv4address.h"
+#include "rtprandom.h"
+#include "rtptimeutilities.h"
+#include "rtperrors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace jrtplib;
+
+// Count the heap allocations made by the library and the benchmark itself
+
+#if __cplusplus >= 201103L
+	#define BENCHMARK_THROW_BADALLOC
+	#define BENCHMARK_THROW_NOTHING noexcept
+#else
+	#define BENCHMARK_THROW_BADALLOC throw(std::bad_alloc)
+	#define BENCHMARK_THROW_NOTHING throw()
+#endif
+
+// GCC warns about mismatched allocation functions if it inlines the malloc
+// and free calls of the replacement operators at the call sites
+#ifdef __GNUC__
+	#define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+	#define BENCHMARK_NOINLINE
+#endif
+
+static size_t numallocations = 0;
+
+static void *CountedAllocate(size_t size)
+{
+	numallocations++;
+	void *p = malloc((size == 0)?1:size);
+	if (p == 0)
+		throw std::bad_alloc();
+	return p;
+}
+
+BENCHMARK_NOINLINE void *operator new(size_t size) BENCHMARK_THROW_BADALLOC
+{
+	return CountedAllocate(size);
+}
+
+BENCHMARK_NOINLINE void *operator new[](size_t size) BENCHMARK_THROW_BADALLOC
+{
+	return CountedAllocate(size);
+}
+
+BENCHMARK_NOINLINE void operator delete(void *p) BENCHMARK_THROW_NOTHING
+{
+	free(p);
+}
+
+BENCHMARK_NOINLINE void operator delete[](void *p) BENCHMARK_THROW_NOTHING
+{
+	free(p);
+}
+
+BENCHMARK_NOINLINE void operator delete(void *p, size_t) BENCHMARK_THROW_NOTHING
+{
+	free(p);
+}
+
+BENCHMARK_NOINLINE void operator delete[](void *p, size_t) BENCHMARK_THROW_NOTHING
+{
+	free(p);
+}
+
+void checkerror(int rtperr)
+{
+	if (rtperr < 0)
+	{
+		fprintf(stderr, "ERROR: %s\n", RTPGetErrorString(rtperr).c_str());
+		exit(-1);
+	}
+}
+
+// A benchmark performs a number of operations in Run and may prepare its
+// state in Setup, which is not measured
+
+class Benchmark
+{
+public:
+	Benchmark(const std::string &name) : m_name(name)							{ }
+	virtual ~Benchmark()														{ }
+	const std::string &GetName() const											{ return m_name; }
+	virtual void Setup()														{ }
+	virtual void Run(int numops) = 0;
+	virtual void Cleanup()														{ }
+private:
+	std::string m_name;
+};
+
+void RunBenchmark(Benchmark &b)
+{
+	const double mintime = 0.5;
+	int numops = 1;
+	double elapsed = 0;
+	size_t allocs = 0;
+
+	b.Setup();
+	b.Run(1); // warm up
+
+	while (true)
+	{
+		size_t allocstart = numallocations;
+		RTPTime start = RTPTime::CurrentTime();
+		b.Run(numops);
+		RTPTime stop = RTPTime::CurrentTime();
+
+		allocs = numallocations - allocstart;
+		stop -= start;
+		elapsed = stop.GetDouble();
+		if (elapsed >= mintime || numops >= (1<<28))
+			break;
+
+		// Try to reach the minimum time in the next round
+		if (elapsed < mintime/100.0)
+			numops *= 100;
+		else
+			numops = (int)((double)numops*mintime*1.2/elapsed) + 1;
+	}
+	b.Cleanup();
+
+	printf("%-28s %12d ops %12.1f ns/op %10.2f allocs/op\n", b.GetName().c_str(), numops,
+	       elapsed*1e9/(double)numops, (double)allocs/(double)numops);
+}
+
+// Creates the data of an RTP packet with SSRC 'ssrc' and sequence number 'seqnr'
+
+void BuildRTPData(std::vector<uint8_t> &data, uint32_t ssrc, uint16_t seqnr, size_t payloadlen)
+{
+	std::vector<uint8_t> payload(payloadlen, 0x55);
+	RTPPacket pack(0, &payload[0], payloadlen, seqnr, 160*(uint32_t)seqnr, ssrc, false, 0, 0, false, 0, 0, 0, 1500);
+
+	checkerror(pack.GetCreationError());
+	data.assign(pack.GetPacketData(), pack.GetPacketData() + pack.GetPacketLength());
+}
+
+// RTPPacketBuilder::BuildPacket
+
+class PacketBuilderBenchmark : public Benchmark
+{
+public:
+	PacketBuilderBenchmark() : Benchmark("RTPPacketBuilder"), m_rnd(0), m_builder(0), m_payload(160, 0x55)	{ }
+	void Setup()
+	{
+		m_rnd = RTPRandom::CreateDefaultRandomNumberGenerator();
+		m_builder = new RTPPacketBuilder(*m_rnd);
+		checkerror(m_builder->Init(1400));
+		checkerror(m_builder->SetDefaultPayloadType(0));
+		checkerror(m_builder->SetDefaultMark(false));
+		checkerror(m_builder->SetDefaultTimestampIncrement(160));
+	}
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+			checkerror(m_builder->BuildPacket(&m_payload[0], m_payload.size()));
+	}
+	void Cleanup()
+	{
+		delete m_builder;
+		delete m_rnd;
+	}
+private:
+	RTPRandom *m_rnd;
+	RTPPacketBuilder *m_builder;
+	std::vector<uint8_t> m_payload;
+};
+
+// Parsing received RTP data, either into an RTPPacket instance (which takes
+// over the data of the raw packet) or into an RTPPacketView
+
+class PacketParseBenchmark : public Benchmark
+{
+public:
+	PacketParseBenchmark(bool useview) : Benchmark((useview)?"RTPPacketView::Parse":"RTPPacket(RTPRawPacket)"), m_useView(useview)	{ }
+	void Setup()
+	{
+		BuildRTPData(m_data, 0x12345678, 1000, 160);
+	}
+	void Run(int numops)
+	{
+		RTPTime t(0, 0);
+
+		for (int i = 0 ; i < numops ; i++)
+		{
+			if (m_useView)
+			{
+				RTPPacketView view;
+
+				checkerror(view.Parse(&m_data[0], m_data.size(), t));
+			}
+			else
+			{
+				// The raw packet owns its data, so we need a copy each time
+				uint8_t *buf = new uint8_t[m_data.size()];
+				memcpy(buf, &m_data[0], m_data.size());
+
+				RTPRawPacket rawpack(buf, m_data.size(), 0, t, true);
+				RTPPacket pack(rawpack);
+				checkerror(pack.GetCreationError());
+			}
+		}
+	}
+private:
+	bool m_useView;
+	std::vector<uint8_t> m_data;
+};
+
+// Builds an RTCP compound packet containing a report with 'numblocks'
+// report blocks and an SDES chunk
+
+void BuildRTCP(RTCPCompoundPacketBuilder &builder, int numblocks)
+{
+	const char cname[] = "user@host.example.com";
+
+	checkerror(builder.InitBuild(8192)); // large enough for 100 report blocks
+	checkerror(builder.StartReceiverReport(0x12345678));
+	for (int i = 0 ; i < numblocks ; i++)
+		checkerror(builder.AddReportBlock(0x1000 + i, 0, 0, 1000, 10, 0, 0));
+	checkerror(builder.AddSDESSource(0x12345678));
+	checkerror(builder.AddSDESNormalItem(RTCPSDESPacket::CNAME, cname, (uint8_t)strlen(cname)));
+	checkerror(builder.EndBuild());
+}
+
+// RTCPCompoundPacketBuilder for a number of report blocks
+
+class RTCPBuilderBenchmark : public Benchmark
+{
+public:
+	RTCPBuilderBenchmark(int numblocks, const std::string &name) : Benchmark(name), m_numBlocks(numblocks)	{ }
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			RTCPCompoundPacketBuilder builder;
+
+			BuildRTCP(builder, m_numBlocks);
+		}
+	}
+private:
+	int m_numBlocks;
+};
+
+// The same, but reusing one RTCPCompoundPacketBuilder instance
+
+class RTCPBuilderReuseBenchmark : public Benchmark
+{
+public:
+	RTCPBuilderReuseBenchmark(int numblocks, const std::string &name) : Benchmark(name), m_numBlocks(numblocks)	{ }
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			m_builder.ClearBuild();
+			BuildRTCP(m_builder, m_numBlocks);
+		}
+	}
+private:
+	int m_numBlocks;
+	RTCPCompoundPacketBuilder m_builder;
+};
+
+// RTCPCompoundPacket parsing
+
+class RTCPParseBenchmark : public Benchmark
+{
+public:
+	RTCPParseBenchmark(int numblocks, const std::string &name) : Benchmark(name), m_numBlocks(numblocks)	{ }
+	void Setup()
+	{
+		RTCPCompoundPacketBuilder builder;
+
+		BuildRTCP(builder, m_numBlocks);
+		m_data.assign(builder.GetCompoundPacketData(), builder.GetCompoundPacketData() + builder.GetCompoundPacketLength());
+	}
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			RTCPCompoundPacket pack(&m_data[0], m_data.size(), false);
+
+			checkerror(pack.GetCreationError());
+		}
+	}
+private:
+	int m_numBlocks;
+	std::vector<uint8_t> m_data;
+};
+
+// RTPSources::ProcessRawPacket with packets coming from a number of sources
+// in turn; the packets are taken from the sources' queues right away
+
+class ProcessingSources : public RTPSources
+{
+public:
+	ProcessingSources() : RTPSources(RTPSources::NoProbation)								{ }
+private:
+	void OnValidatedRTPPacket(RTPSourceData *, RTPPacket *rtppack, bool, bool *ispackethandled)
+	{
+		delete rtppack;
+		*ispackethandled = true;
+	}
+};
+
+class SourcesBenchmark : public Benchmark
+{
+public:
+	SourcesBenchmark(int numsources, const std::string &name) : Benchmark(name), m_numSources(numsources), m_sources(0), m_addr(0x7f000001, 5000), m_next(0), m_seqNr(0)	{ }
+	void Setup()
+	{
+		m_sources = new ProcessingSources();
+		m_data.resize(m_numSources);
+		for (int i = 0 ; i < m_numSources ; i++)
+			BuildRTPData(m_data[i], 0x10000 + i, 0, 160);
+
+		m_next = 0;
+		m_seqNr = 0;
+		Run(m_numSources); // make sure all sources exist
+	}
+	void Run(int numops)
+	{
+		RTPTime t = RTPTime::CurrentTime();
+
+		for (int i = 0 ; i < numops ; i++)
+		{
+			std::vector<uint8_t> &data = m_data[m_next];
+
+			// Use the next sequence number for this source
+			data[2] = (uint8_t)(m_seqNr >> 8);
+			data[3] = (uint8_t)(m_seqNr & 0xff);
+
+			uint8_t *buf = new uint8_t[data.size()];
+			memcpy(buf, &data[0], data.size());
+
+			RTPRawPacket rawpack(buf, data.size(), m_addr.CreateCopy(0), t, true);
+			checkerror(m_sources->ProcessRawPacket(&rawpack, (RTPTransmitter **)0, 0, false));
+
+			m_next++;
+			if (m_next == m_numSources)
+			{
+				m_next = 0;
+				m_seqNr++;
+			}
+		}
+	}
+	void Cleanup()
+	{
+		delete m_sources;
+	}
+private:
+	int m_numSources;
+	ProcessingSources *m_sources;
+	std::vector<std::vector<uint8_t> > m_data;
+	RTPIPv4Address m_addr;
+	int m_next;
+	uint16_t m_seqNr;
+};
+
+// RTPSources::MultipleTimeouts for a table with a number of sources, none of
+// which time out
+
+class TimeoutsBenchmark : public Benchmark
+{
+public:
+	TimeoutsBenchmark(int numsources, const std::string &name) : Benchmark(name), m_numSources(numsources), m_sources(0)	{ }
+	void Setup()
+	{
+		RTPIPv4Address addr(0x7f000001, 5000);
+		RTPTime t = RTPTime::CurrentTime();
+
+		m_sources = new ProcessingSources();
+		for (int i = 0 ; i < m_numSources ; i++)
+		{
+			std::vector<uint8_t> data;
+
+			BuildRTPData(data, 0x10000 + i, 0, 160);
+
+			uint8_t *buf = new uint8_t[data.size()];
+			memcpy(buf, &data[0], data.size());
+
+			RTPRawPacket rawpack(buf, data.size(), addr.CreateCopy(0), t, true);
+			checkerror(m_sources->ProcessRawPacket(&rawpack, (RTPTransmitter **)0, 0, false));
+		}
+	}
+	void Run(int numops)
+	{
+		RTPTime t = RTPTime::CurrentTime();
+		RTPTime timeout(3600.0);
+
+		for (int i = 0 ; i < numops ; i++)
+			m_sources->MultipleTimeouts(t, timeout, timeout, timeout, timeout);
+	}
+	void Cleanup()
+	{
+		delete m_sources;
+	}
+private:
+	int m_numSources;
+	ProcessingSources *m_sources;
+};
+
+// RTCPPacketBuilder::BuildNextPacket for a table with a number of members which
+// only send RTCP packets, and two sources which send an RTP packet before each
+// compound packet is built
+
+class RTCPPacketBuilderBenchmark : public Benchmark
+{
+public:
+	RTCPPacketBuilderBenchmark(int numsources, const std::string &name) : Benchmark(name), m_numSources(numsources), m_sources(0), m_rnd(0), m_packetBuilder(0), m_rtcpBuilder(0), m_addr(0x7f000001, 5000), m_seqNr(0)	{ }
+	void Setup()
+	{
+		RTPTime t = RTPTime::CurrentTime();
+
+		m_sources = new ProcessingSources();
+		m_rnd = RTPRandom::CreateDefaultRandomNumberGenerator();
+		m_packetBuilder = new RTPPacketBuilder(*m_rnd);
+		checkerror(m_packetBuilder->Init(1400));
+		checkerror(m_sources->CreateOwnSSRC(m_packetBuilder->GetSSRC()));
+		m_rtcpBuilder = new RTCPPacketBuilder(*m_sources, *m_packetBuilder);
+		checkerror(m_rtcpBuilder->Init(1400, 1.0/8000.0, "benchmark", 9));
+
+		for (int i = 0 ; i < m_numSources ; i++)
+			checkerror(m_sources->UpdateReceiveTime(0x10000 + i, t, &m_addr));
+
+		m_seqNr = 0;
+	}
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			RTPTime t = RTPTime::CurrentTime();
+			RTCPCompoundPacket *pack;
+
+			for (uint32_t ssrc = 1 ; ssrc <= 2 ; ssrc++)
+			{
+				std::vector<uint8_t> data;
+
+				BuildRTPData(data, ssrc, m_seqNr, 160);
+
+				uint8_t *buf = new uint8_t[data.size()];
+				memcpy(buf, &data[0], data.size());
+
+				RTPRawPacket rawpack(buf, data.size(), m_addr.CreateCopy(0), t, true);
+				checkerror(m_sources->ProcessRawPacket(&rawpack, (RTPTransmitter **)0, 0, false));
+			}
+			m_seqNr++;
+
+			checkerror(m_rtcpBuilder->BuildNextPacket(&pack));
+			delete pack;
+		}
+	}
+	void Cleanup()
+	{
+		delete m_rtcpBuilder;
+		delete m_sources;
+		delete m_packetBuilder;
+		delete m_rnd;
+	}
+private:
+	int m_numSources;
+	ProcessingSources *m_sources;
+	RTPRandom *m_rnd;
+	RTPPacketBuilder *m_packetBuilder;
+	RTCPPacketBuilder *m_rtcpBuilder;
+	RTPIPv4Address m_addr;
+	uint16_t m_seqNr;
+};
+
+// Looks up the SSRCs of a table with a number of sources in random order, using
+// the chained RTPKeyHashTable which was used for the source table before, or the
+// open addressing RTPFlatKeyHashTable
+
+class ChainedSSRCHash
+{
+public:
+	static int GetIndex(const uint32_t &ssrc)									{ return ssrc%8317; }
+};
+
+class FlatSSRCHash
+{
+public:
+	static uint32_t GetHash(const uint32_t &ssrc)								{ return ssrc; }
+};
+
+template<class Table>
+class HashTableBenchmark : public Benchmark
+{
+public:
+	HashTableBenchmark(int numsources, const std::string &name) : Benchmark(name), m_numSources(numsources), m_table(0), m_next(0)	{ }
+	void Setup()
+	{
+		m_table = new Table();
+		m_ssrcs.resize(m_numSources);
+		srand(1);
+		for (int i = 0 ; i < m_numSources ; i++)
+		{
+			do
+			{
+				m_ssrcs[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+			} while (m_table->AddElement(m_ssrcs[i], i) < 0);
+		}
+
+		// Look the sources up in a different order than the one they were added in
+		for (int i = m_numSources-1 ; i > 0 ; i--)
+		{
+			int j = rand() % (i+1);
+			uint32_t tmp = m_ssrcs[i];
+
+			m_ssrcs[i] = m_ssrcs[j];
+			m_ssrcs[j] = tmp;
+		}
+		m_next = 0;
+	}
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			checkerror(m_table->GotoElement(m_ssrcs[m_next]));
+
+			m_next++;
+			if (m_next == m_numSources)
+				m_next = 0;
+		}
+	}
+	void Cleanup()
+	{
+		delete m_table;
+	}
+private:
+	int m_numSources;
+	Table *m_table;
+	std::vector<uint32_t> m_ssrcs;
+	int m_next;
+};
+
+typedef RTPKeyHashTable<const uint32_t, int, ChainedSSRCHash, 8317> ChainedSSRCTable;
+typedef RTPFlatKeyHashTable<const uint32_t, int, FlatSSRCHash> FlatSSRCTable;
+
+// A complete session: packets are injected in the external transmitter and
+// processed by RTPSession::Poll
+
+class BenchmarkSender : public RTPExternalSender
+{
+public:
+	bool SendRTP(const void *, size_t)											{ return true; }
+	bool SendRTCP(const void *, size_t)											{ return true; }
+	bool ComesFromThisSender(const RTPAddress *)								{ return false; }
+};
+
+class ProcessingSession : public RTPSession
+{
+private:
+	void OnValidatedRTPPacket(RTPSourceData *, RTPPacket *rtppack, bool, bool *ispackethandled)
+	{
+		DeletePacket(rtppack);
+		*ispackethandled = true;
+	}
+};
+
+class SessionBenchmark : public Benchmark
+{
+public:
+	SessionBenchmark() : Benchmark("RTPSession::Poll (external)"), m_session(0), m_injecter(0), m_addr(0x7f000001, 5000), m_seqNr(0)	{ }
+	void Setup()
+	{
+		RTPSessionParams sessparams;
+		RTPExternalTransmissionParams transparams(&m_sender, 0);
+
+		sessparams.SetOwnTimestampUnit(1.0/8000.0);
+		sessparams.SetUsePollThread(false);
+		sessparams.SetCNAME("rtpbenchmark"); // doesn't depend on the login name being available
+
+		m_session = new ProcessingSession();
+		checkerror(m_session->Create(sessparams, &transparams, RTPTransmitter::ExternalProto));
+
+		RTPExternalTransmissionInfo *transinf = static_cast<RTPExternalTransmissionInfo *>(m_session->GetTransmissionInfo());
+		m_injecter = transinf->GetPacketInjector();
+		m_session->DeleteTransmissionInfo(transinf);
+
+		BuildRTPData(m_data, 0x12345678, 0, 160);
+	}
+	void Run(int numops)
+	{
+		for (int i = 0 ; i < numops ; i++)
+		{
+			m_data[2] = (uint8_t)(m_seqNr >> 8);
+			m_data[3] = (uint8_t)(m_seqNr & 0xff);
+			m_seqNr++;
+
+			m_injecter->InjectRTP(&m_data[0], m_data.size(), m_addr);
+			checkerror(m_session->Poll());
+		}
+	}
+	void Cleanup()
+	{
+		m_session->BYEDestroy(RTPTime(0), 0, 0);
+		delete m_session;
+	}
+private:
+	BenchmarkSender m_sender;
+	ProcessingSession *m_session;
+	RTPExternalPacketInjecter *m_injecter;
+	RTPIPv4Address m_addr;
+	std::vector<uint8_t> m_data;
+	uint16_t m_seqNr;
+};
+
+int main(int argc, char *argv[])
+{
+	std::vector<Benchmark *> benchmarks;
+
+	benchmarks.push_back(new PacketBuilderBenchmark());
+	benchmarks.push_back(new PacketParseBenchmark(false));
+	benchmarks.push_back(new PacketParseBenchmark(true));
+	benchmarks.push_back(new RTCPParseBenchmark(1, "RTCPCompoundPacket/1"));
+	benchmarks.push_back(new RTCPParseBenchmark(31, "RTCPCompoundPacket/31"));
+	benchmarks.push_back(new RTCPBuilderBenchmark(1, "RTCPCompoundPacketBuilder/1"));
+	benchmarks.push_back(new RTCPBuilderBenchmark(31, "RTCPCompoundPacketBuilder/31"));
+	benchmarks.push_back(new RTCPBuilderBenchmark(100, "RTCPCompoundPacketBuilder/100"));
+	benchmarks.push_back(new RTCPBuilderReuseBenchmark(31, "RTCPCompoundPacketBuilderReuse/31"));
+	benchmarks.push_back(new RTCPBuilderReuseBenchmark(100, "RTCPCompoundPacketBuilderReuse/100"));
+	benchmarks.push_back(new SourcesBenchmark(1, "ProcessRawPacket/1"));
+	benchmarks.push_back(new SourcesBenchmark(100, "ProcessRawPacket/100"));
+	benchmarks.push_back(new SourcesBenchmark(10000, "ProcessRawPacket/10000"));
+	benchmarks.push_back(new SourcesBenchmark(100000, "ProcessRawPacket/100000"));
+	benchmarks.push_back(new RTCPPacketBuilderBenchmark(100, "RTCPPacketBuilder/100"));
+	benchmarks.push_back(new RTCPPacketBuilderBenchmark(10000, "RTCPPacketBuilder/10000"));
+	benchmarks.push_back(new HashTableBenchmark<ChainedSSRCTable>(1000, "RTPKeyHashTable/1000"));
+	benchmarks.push_back(new HashTableBenchmark<ChainedSSRCTable>(100000, "RTPKeyHashTable/100000"));
+	benchmarks.push_back(new HashTableBenchmark<FlatSSRCTable>(1000, "RTPFlatKeyHashTable/1000"));
+	benchmarks.push_back(new HashTableBenchmark<FlatSSRCTable>(100000, "RTPFlatKeyHashTable/100000"));
+	benchmarks.push_back(new TimeoutsBenchmark(100, "MultipleTimeouts/100"));
+	benchmarks.push_back(new TimeoutsBenchmark(10000, "MultipleTimeouts/10000"));
+	benchmarks.push_back(new SessionBenchmark());
+
+	for (size_t i = 0 ; i < benchmarks.size() ; i++)
+	{
+		bool run = (argc < 2);
+
+		for (int j = 1 ; !run && j < argc ; j++)
+		{
+			if (benchmarks[i]->GetName().compare(0, strlen(argv[j]), argv[j]) == 0)
+				run = true;
+		}
+
+		if (run)
+			RunBenchmark(*benchmarks[i]);
+		delete benchmarks[i];
+	}
+
+	return 0;
+}
+
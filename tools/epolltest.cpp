@@ -0,0 +1,17 @@
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+int main(void)
+{
+	int efd = epoll_create1(EPOLL_CLOEXEC);
+	int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN|EPOLLONESHOT;
+	ev.data.u64 = 0;
+	epoll_ctl(efd, EPOLL_CTL_ADD, tfd, &ev);
+	close(tfd);
+	close(efd);
+	return 0;
+}
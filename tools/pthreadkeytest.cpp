@@ -0,0 +1,18 @@
+#include <pthread.h>
+
+static void Destructor(void *p)
+{
+	(void)p;
+}
+
+int main(void)
+{
+	pthread_key_t key;
+
+	if (pthread_key_create(&key, Destructor) != 0)
+		return -1;
+	pthread_setspecific(key, &key);
+	void *p = pthread_getspecific(key);
+	pthread_key_delete(key);
+	return (p == &key)?0:-1;
+}
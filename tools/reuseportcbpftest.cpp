@@ -0,0 +1,17 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+int main(void)
+{
+	struct sock_filter code[1] = { { BPF_RET|BPF_K, 0, 0, 0 } };
+	struct sock_fprog prog;
+	int on = 1;
+
+	prog.len = 1;
+	prog.filter = code;
+
+	int status = setsockopt(0, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(int));
+	status += setsockopt(0, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+	return status;
+}
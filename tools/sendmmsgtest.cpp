@@ -0,0 +1,9 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+
+int main(void)
+{
+	struct mmsghdr msgs[2];
+	int status = sendmmsg(0, msgs, 2, 0);
+	return status;
+}
@@ -0,0 +1,12 @@
+int main(void)
+{
+	void *head = 0;
+	void *value = &head;
+	long counter = 0;
+
+	__sync_bool_compare_and_swap(&head, (void *)0, value);
+	__sync_lock_test_and_set(&head, (void *)0);
+	__sync_fetch_and_add(&counter, 1);
+	__sync_synchronize();
+	return (int)counter;
+}
@@ -0,0 +1,19 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+int main(void)
+{
+	int on = 1;
+	int status = setsockopt(0, SOL_UDP, UDP_GRO, &on, sizeof(int));
+	char control[CMSG_SPACE(sizeof(int))];
+	struct msghdr msg;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	status += (int)recvmsg(0, &msg, MSG_DONTWAIT);
+	struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+	if (cm && cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+		status++;
+	return status;
+}
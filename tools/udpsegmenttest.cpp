@@ -0,0 +1,18 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+int main(void)
+{
+	char control[CMSG_SPACE(sizeof(unsigned short))];
+	struct msghdr msg;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = SOL_UDP;
+	cm->cmsg_type = UDP_SEGMENT;
+	cm->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+	*((unsigned short *)CMSG_DATA(cm)) = 1000;
+	return (int)sendmsg(0, &msg, 0);
+}